@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "ast.h"
+
+struct ASTSize {
+    uint32_t nodes;
+    uint32_t leaves;
+    size_t chars;
+    int depth; // of the deepest node
+};
+
+
+struct ASTFill {
+    struct AST* ast;
+    char* chars; // where the next lexeme goes
+    uint32_t* last; // last node seen at each depth
+    int depth; // of the node before
+};
+
+
+int count_AST(struct ParseTree* node, int depth, void* arg) {
+    struct ASTSize* size = arg;
+    size->nodes++;
+    if (depth > size->depth)
+        size->depth = depth;
+    if (node->child == NULL) {
+        size->leaves++;
+        size->chars += node->data->len + 1;
+    }
+    return 0;
+}
+
+
+int fill_AST(struct ParseTree* node, int depth, void* arg) {
+    /*
+     * The walk gives the nodes in the order of the AST. A node is the first child
+     * of the one right before it, if that one is one level up,
+     * else the next sibling of the last node seen at its depth.
+    */
+    struct ASTFill* fill = arg;
+    struct AST* ast = fill->ast;
+    struct Token* tok;
+    uint32_t i;
+
+    i = ast->count++;
+    if (i > 0 && depth == fill->depth + 1)
+        ast->child[i - 1] = i;
+    else if (i > 0)
+        ast->sibling[fill->last[depth]] = i;
+    fill->last[depth] = i;
+    fill->depth = depth;
+
+    ast->kind[i] = node->data->type;
+    ast->child[i] = AST_NONE;
+    ast->sibling[i] = AST_NONE;
+    ast->token[i] = AST_NONE;
+    if (node->child == NULL) {
+        ast->token[i] = ast->ntokens;
+        tok = &ast->tokens[ast->ntokens++];
+        *tok = *node->data;
+        tok->lexeme = fill->chars;
+        memcpy(fill->chars, node->data->lexeme, tok->len);
+        fill->chars[tok->len] = '\0';
+        fill->chars += tok->len + 1;
+    }
+    return 0;
+}
+
+
+struct AST* build_AST(struct ParseTree* tree) {
+    struct AST* ast;
+    struct ASTSize size;
+    struct ASTFill fill;
+    uint32_t nodes, leaves;
+    size_t chars, bytes;
+    char* block;
+
+    size.nodes = 0;
+    size.leaves = 0;
+    size.chars = 0;
+    size.depth = 0;
+    if (walk_ParseTree(tree, count_AST, &size) != SUBTREE_OK)
+        return NULL;
+    nodes = size.nodes;
+    leaves = size.leaves;
+    chars = size.chars;
+
+    // Widest members first, so that every array stays aligned
+    bytes = sizeof(struct AST) + leaves * sizeof(struct Token)
+          + 3 * nodes * sizeof(uint32_t) + nodes * sizeof(uint8_t) + chars;
+    block = malloc(bytes);
+    if (block == NULL)
+        return NULL;
+    ast = (struct AST*) block;
+    block += sizeof(struct AST);
+    ast->tokens = (struct Token*) block;
+    block += leaves * sizeof(struct Token);
+    ast->child = (uint32_t*) block;
+    ast->sibling = ast->child + nodes;
+    ast->token = ast->sibling + nodes;
+    block = (char*) (ast->token + nodes);
+    ast->kind = (uint8_t*) block;
+    block += nodes * sizeof(uint8_t);
+    ast->count = 0;
+    ast->ntokens = 0;
+    ast->view = NULL;
+    ast->bytes = bytes;
+
+    if (nodes == 0)
+        return ast;
+    fill.ast = ast;
+    fill.chars = block;
+    fill.depth = 0;
+    fill.last = malloc((size.depth + 1) * sizeof(uint32_t));
+    if (fill.last == NULL || walk_ParseTree(tree, fill_AST, &fill) != SUBTREE_OK) {
+        free(fill.last);
+        free(ast);
+        return NULL;
+    }
+    free(fill.last);
+    return ast;
+}
+
+
+struct ParseTree* view_AST(struct AST* ast) {
+    struct ParseTree* view;
+    uint32_t i;
+
+    if (ast->count == 0)
+        return NULL;
+    if (ast->view != NULL)
+        return ast->view;
+    view = malloc(ast->count * sizeof(struct ParseTree));
+    if (view == NULL)
+        return NULL;
+    for (i = 0; i < ast->count; i++) {
+        if (ast->token[i] != AST_NONE)
+            view[i].data = &ast->tokens[ast->token[i]];
+        else
+            view[i].data = tag_Token(ast->kind[i]);
+        view[i].child = ast->child[i] == AST_NONE ? NULL : &view[ast->child[i]];
+        view[i].sibling = ast->sibling[i] == AST_NONE ? NULL : &view[ast->sibling[i]];
+        view[i].slot = -1;
+        view[i].value_type = -1;
+    }
+    ast->view = view;
+    return view;
+}
+
+
+void print_AST(struct AST* ast) {
+    /*
+     * Same output as print_ParseTree.
+     * The depth of a node is one more than its parent's, that comes before it:
+     * the parent of a first child is the node right before it.
+    */
+    uint32_t *depth, i, s;
+
+    if (ast->count == 0)
+        return;
+    depth = malloc(ast->count * sizeof(uint32_t));
+    if (depth == NULL)
+        return;
+    depth[0] = 0;
+    for (i = 0; i < ast->count; i++) {
+        if (ast->child[i] != AST_NONE)
+            depth[ast->child[i]] = depth[i] + 2;
+        s = ast->sibling[i];
+        if (s != AST_NONE)
+            depth[s] = depth[i];
+        printf("%*s", (int) depth[i], "");
+        if (ast->token[i] != AST_NONE)
+            print_Token(&ast->tokens[ast->token[i]]);
+        else
+            printf("<%s>\n", type2char(ast->kind[i]));
+    }
+    free(depth);
+}
+
+
+void free_AST(struct AST* ast) {
+    if (ast == NULL)
+        return;
+    free(ast->view);
+    free(ast);
+}
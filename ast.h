@@ -0,0 +1,51 @@
+#ifndef AST_H
+#define AST_H
+
+#include <stdint.h>
+
+#include "parser.h"
+
+#define AST_NONE UINT32_MAX
+
+/*
+ * A flat copy of a ParseTree.
+ *
+ * Nodes are numbered in depth-first order (a node comes right before its children)
+ * and each array below has one entry per node. Only leaves have a Token.
+ * Arrays, Tokens and lexemes all live in one block: free_AST is a single free.
+ *
+ * The compiler does not use it: the parser builds the ParseTree and the passes walk that.
+ * An AST is made from a whole ParseTree, and view_AST gives back one ParseTree node
+ * per AST node, so going through it costs more than the tree alone.
+*/
+struct AST {
+    uint32_t count; // number of nodes
+    uint32_t ntokens; // number of Tokens (leaves)
+    uint8_t* kind; // TokenType of the node
+    uint32_t* child; // index of the first child, or AST_NONE
+    uint32_t* sibling; // index of the next sibling, or AST_NONE
+    uint32_t* token; // index in tokens, or AST_NONE
+    struct Token* tokens;
+    struct ParseTree* view; // see view_AST
+    size_t bytes; // size of the block
+};
+
+/*
+ * Copy the ParseTree into a new AST. The tree can be freed afterwards.
+ * Return NULL if a memory error happens.
+*/
+struct AST* build_AST(struct ParseTree* tree);
+
+/*
+ * Return the root of a ParseTree whose nodes are the nodes of the AST,
+ * so that the passes written for ParseTrees (semantic, cgen) can walk it.
+ * The view belongs to the AST: do NOT call free_ParseTree on it.
+ * Return NULL if a memory error happens.
+*/
+struct ParseTree* view_AST(struct AST* ast);
+
+void print_AST(struct AST* ast);
+
+void free_AST(struct AST* ast);
+
+#endif
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../ast.h"
+#include "gen.h"
+
+// gcc -O2 bench_ast.c gen.c ../ast.c ../parser.c ../lexer.c ../log.c -o bench_ast.out
+// ./bench_ast.out [MB]
+
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+size_t walk_Tree(struct ParseTree* tree) {
+    // Depth-first visit: count the nodes
+    size_t count = 0;
+    for (; tree != NULL; tree = tree->sibling) {
+        count++;
+        count += walk_Tree(tree->child);
+    }
+    return count;
+}
+
+
+size_t walk_AST(struct AST* ast, uint32_t node) {
+    // Same visit, following the indexes
+    size_t count = 0;
+    for (; node != AST_NONE; node = ast->sibling[node]) {
+        count++;
+        count += walk_AST(ast, ast->child[node]);
+    }
+    return count;
+}
+
+
+int main(int argc, char* argv[]) {
+    struct TokenList* list;
+    struct ParseTree* tree;
+    struct AST* ast;
+    struct PoolStats pool;
+    char* src;
+    size_t size, nodes, bytes, flat_bytes, lines;
+    double begin, parse, flat, walk1, walk2, free1, free2;
+
+    size = (size_t) (argc > 1 ? atoi(argv[1]) : 20) * 1024 * 1024;
+    src = gen_Program(size);
+    if (src == NULL)
+        return 1;
+    size = strlen(src);
+    lines = 0;
+    for (char* c = src; *c != '\0'; c++)
+        lines += *c == '\n';
+    list = build_TokenList_Parallel(src, size, 1, 1);
+    if (list == NULL)
+        return 1;
+
+    begin = now();
+    tree = alloc_ParseTree();
+    if (build_ParseTree(list, &tree) != SUBTREE_OK) {
+        printf("Parsing failed\n");
+        return 1;
+    }
+    parse = now() - begin;
+
+    begin = now();
+    ast = build_AST(tree);
+    flat = now() - begin;
+    if (ast == NULL)
+        return 1;
+
+    begin = now();
+    nodes = walk_Tree(tree);
+    walk1 = now() - begin;
+    begin = now();
+    walk_AST(ast, 0);
+    walk2 = now() - begin;
+
+    // Heap taken by the node pool (Tokens belong to the list)
+    pool = stats_ParseTree();
+    bytes = pool.mallocs * POOL_BLOCK * sizeof(struct ParseTree);
+    flat_bytes = ast->bytes;
+    begin = now();
+    free_ParseTree(tree);
+    free1 = now() - begin;
+    begin = now();
+    free_AST(ast);
+    free2 = now() - begin;
+
+    printf("====================\n");
+    printf("Source size   : %.1f MB, %zu nodes\n", size / (1024.0 * 1024.0), nodes);
+    printf("               ParseTree       AST\n");
+    printf("Build         : %6.2f M nodes/sec  %6.2f M nodes/sec (from the ParseTree)\n",
+           nodes / parse / 1e6, nodes / flat / 1e6);
+    printf("Walk          : %6.2f M nodes/sec  %6.2f M nodes/sec\n", nodes / walk1 / 1e6, nodes / walk2 / 1e6);
+    printf("Free          : %9.4f s        %9.4f s\n", free1, free2);
+    printf("Bytes/node    : %9.1f          %9.1f\n", (double) bytes / nodes, (double) flat_bytes / nodes);
+    printf("Nodes/line    : %9.2f allocated, %.4f mallocs\n", (double) pool.allocs / lines, (double) pool.mallocs / lines);
+    printf("====================\n");
+
+    free_TokenList(list);
+    free(src);
+    return 0;
+}
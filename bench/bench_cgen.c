@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../cgen.h"
+#include "../stats.h"
+#include "gen.h"
+
+// gcc -O2 -pthread -DSTATS_ALLOC -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc bench_cgen.c gen.c ../stats.c ../cgen.c ../parser.c ../lexer.c ../log.c -o bench_cgen.out
+// ./bench_cgen.out [KB per depth] [max depth]
+
+/*
+ * Code generation of programs of while and if nested deeper and deeper.
+ * Every level of nesting adds INDENT_LEV spaces to each line inside it,
+ * so the output grows with the depth: the time per output byte should not.
+*/
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int run_Depth(size_t size, int depth) {
+    struct TokenList* list;
+    struct ParseTree* tree;
+    size_t allocs, bytes, l_code;
+    char *src, *code;
+    double begin, cgen;
+
+    src = gen_Shape(SHAPE_NESTED, size, depth);
+    if (src == NULL)
+        return 1;
+    list = build_TokenList_Parallel(src, strlen(src), 1, 1);
+    if (list == NULL)
+        return 1;
+    tree = alloc_ParseTree();
+    if (build_ParseTree(list, &tree) != SUBTREE_OK) {
+        printf("Parsing failed\n");
+        return 1;
+    }
+
+    allocs = count_Allocs();
+    bytes = count_AllocBytes();
+    begin = now();
+    code = code_gen(tree);
+    cgen = now() - begin;
+    allocs = count_Allocs() - allocs;
+    bytes = count_AllocBytes() - bytes;
+    if (code == NULL) {
+        printf("Code generation failed\n");
+        return 1;
+    }
+    l_code = strlen(code);
+
+    printf("%6d %9.2f %9.3f %9.1f %11zu %9.2f\n", depth, l_code / (1024.0 * 1024.0), cgen,
+           l_code / (1024.0 * 1024.0) / cgen, allocs, (double) bytes / l_code);
+
+    free(code);
+    free_ParseTree(tree);
+    free_TokenList(list);
+    free(src);
+    return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+    size_t size;
+    int max;
+
+    size = (size_t) (argc > 1 ? atoi(argv[1]) : 1024) * 1024;
+    max = argc > 2 ? atoi(argv[2]) : 256;
+
+    printf("%6s %9s %9s %9s %11s %9s\n", "depth", "out MB", "cgen s", "MB/s", "allocs", "bytes/out");
+    for (int depth = 1; depth <= max; depth *= 2)
+        if (run_Depth(size, depth))
+            return 1;
+    return 0;
+}
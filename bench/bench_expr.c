@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../parser.h"
+
+// gcc -O2 -pthread bench_expr.c ../parser.c ../lexer.c ../log.c -o bench_expr.out
+// ./bench_expr.out [operands] [lines]
+
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+char* gen_Expr(int operands, int lines) {
+    /*
+     * Return `lines` assignments, each one with a single long expression:
+     * x = a0 + a1 * a2 - a3 / a4 + ... ;
+    */
+    static const char* ops[] = {" + ", " * ", " - ", " / "};
+    size_t cap, len;
+    char* src;
+
+    cap = (size_t) lines * (operands * 12 + 16) + 1;
+    src = malloc(cap);
+    if (src == NULL)
+        return NULL;
+    len = 0;
+    for (int l = 0; l < lines; l++) {
+        len += sprintf(src + len, "x%d = a0", l);
+        for (int i = 1; i < operands; i++)
+            len += sprintf(src + len, "%sa%d", ops[i % 4], i);
+        len += sprintf(src + len, ";\n");
+    }
+    return src;
+}
+
+
+int depth_Tree(struct ParseTree* node, int depth, void* arg) {
+    int* max = arg;
+    if (depth > *max)
+        *max = depth;
+    return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+    struct TokenList* list;
+    struct ParseTree* tree;
+    char* src;
+    int operands, lines, depth;
+    size_t size;
+    double begin, parse, release;
+
+    operands = argc > 1 ? atoi(argv[1]) : 100000;
+    lines = argc > 2 ? atoi(argv[2]) : 10;
+
+    src = gen_Expr(operands, lines);
+    if (src == NULL)
+        return 1;
+    size = strlen(src);
+    list = build_TokenList_Parallel(src, size, 1, 1);
+    if (list == NULL)
+        return 1;
+
+    begin = now();
+    tree = alloc_ParseTree();
+    if (build_ParseTree(list, &tree) != SUBTREE_OK) {
+        printf("Parsing failed\n");
+        return 1;
+    }
+    parse = now() - begin;
+
+    depth = 0;
+    walk_ParseTree(tree, depth_Tree, &depth);
+
+    begin = now();
+    free_ParseTree(tree);
+    release = now() - begin;
+
+    printf("====================\n");
+    printf("Source size   : %.1f MB, %d lines of %d operands\n", size / (1024.0 * 1024.0), lines, operands);
+    printf("Parse         : %.3f s, %.2f M operands/sec\n", parse, (double) operands * lines / parse / 1e6);
+    printf("Free          : %.3f s\n", release);
+    printf("Tree depth    : %d\n", depth);
+    printf("====================\n");
+
+    free_TokenList(list);
+    free(src);
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// gcc -O2 bench_interp.c -o bench_interp.out
+// ./bench_interp.out [compiler, ../a.out by default] [rounds]
+
+/*
+ * Latency of small scripts, from the start of the process to its end, as a user sees it:
+ * `a.out --interp` and `a.out --run` read and run the source at once,
+ * while the Python code is generated once and then each round starts python3 on it.
+ * The time of each one is the mean of the rounds, in milliseconds. They must print the same lines.
+*/
+
+struct Script {
+    const char* name;
+    const char* src;
+    const char* input;
+};
+
+struct Script scripts[] = {
+    {"hello", "writeOut \"hello\";\n", ""},
+    {"strings",
+        "readStr name;\n"
+        "readInt n;\n"
+        "m = n * 2;\n"
+        "l = [n, m, 1];\n"
+        "s = \"hi %s: %s\", name, l;\n"
+        "t = \"%s (%s)\", s, m;\n"
+        "writeOut t;\n",
+        "bob\n7\n"},
+    {"code.e", NULL, "100\n"},
+    {"loop1k",
+        "readInt n;\n"
+        "s = 0;\n"
+        "i = 0;\n"
+        "while (i < n)\n"
+        "    if (i % 3 == 0)\n"
+        "        s = s + i;\n"
+        "    ;\n"
+        "    i = i + 1;\n"
+        ";\n"
+        "writeOut s;\n",
+        "1000\n"},
+};
+
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+double run_Mean(const char* command, int rounds) {
+    // Milliseconds taken by the command, on average, or -1 if it failed
+    double begin;
+    int i;
+
+    begin = now();
+    for (i = 0; i < rounds; i++)
+        if (system(command) != 0)
+            return -1;
+    return (now() - begin) * 1e3 / rounds;
+}
+
+
+int same_Files(const char* name1, const char* name2) {
+    FILE *fp1, *fp2;
+    int c1, c2;
+
+    fp1 = fopen(name1, "r");
+    fp2 = fopen(name2, "r");
+    c1 = c2 = 0;
+    if (fp1 != NULL && fp2 != NULL)
+        do {
+            c1 = getc(fp1);
+            c2 = getc(fp2);
+        } while (c1 == c2 && c1 != EOF);
+    if (fp1 != NULL)
+        fclose(fp1);
+    if (fp2 != NULL)
+        fclose(fp2);
+    return fp1 != NULL && fp2 != NULL && c1 == c2;
+}
+
+
+int write_File(const char* name, const char* text) {
+    FILE* fp;
+
+    fp = fopen(name, "w");
+    if (fp == NULL)
+        return 1;
+    fputs(text, fp);
+    fclose(fp);
+    return 0;
+}
+
+
+int run_Script(struct Script* script, const char* compiler, int rounds) {
+    const char* fileName;
+    char command[512];
+    double python, interp, run;
+    int same;
+
+    fileName = script->src == NULL ? "../code.e" : "./bench_interp.e";
+    if ((script->src != NULL && write_File(fileName, script->src)) || write_File("./bench_interp.in", script->input))
+        return 1;
+    snprintf(command, sizeof(command), "%s --quiet %s ./bench_interp.py", compiler, fileName);
+    if (system(command) != 0) {
+        printf("%-8s compilation failed\n", script->name);
+        return 1;
+    }
+
+    snprintf(command, sizeof(command), "python3 ./bench_interp.py < ./bench_interp.in > ./bench_interp.py.txt");
+    python = run_Mean(command, rounds);
+    snprintf(command, sizeof(command), "%s --quiet --interp %s < ./bench_interp.in > ./bench_interp.txt", compiler, fileName);
+    interp = run_Mean(command, rounds);
+    same = python >= 0 && interp >= 0 && same_Files("./bench_interp.py.txt", "./bench_interp.txt");
+    snprintf(command, sizeof(command), "%s --quiet --run %s < ./bench_interp.in > ./bench_interp.txt", compiler, fileName);
+    run = run_Mean(command, rounds);
+    same = same && run >= 0 && same_Files("./bench_interp.py.txt", "./bench_interp.txt");
+
+    printf("%-8s %10.2f %10.2f %10.2f %9.1f %6s\n", script->name, python, interp, run,
+           python > 0 && interp > 0 ? python / interp : 0.0, same ? "yes" : "NO");
+    if (script->src != NULL)
+        remove(fileName);
+    remove("./bench_interp.in");
+    remove("./bench_interp.py");
+    remove("./bench_interp.py.txt");
+    remove("./bench_interp.txt");
+    return ! same;
+}
+
+
+int main(int argc, char* argv[]) {
+    const char* compiler;
+    size_t i;
+    int rounds, fail;
+
+    compiler = argc > 1 ? argv[1] : "../a.out";
+    rounds = argc > 2 ? atoi(argv[2]) : 20;
+
+    printf("%-8s %10s %10s %10s %9s %6s\n", "script", "python ms", "interp ms", "run ms", "speedup", "same");
+    fail = 0;
+    for (i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++)
+        fail |= run_Script(&scripts[i], compiler, rounds);
+    return fail;
+}
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lexer.h"
+
+// gcc -O2 bench_keywords.c ../lexer.c ../log.c -o bench_keywords.out
+// ./bench_keywords.out [millions of lookups]
+
+
+const char* words[] = {
+    // every keyword, then identifiers that look alike
+    "NULL", "True", "False", "break", "if", "else", "while",
+    "readInt", "readFloat", "readStr", "readBool", "writeOut", "continue",
+    "i", "j", "N", "x", "totSum", "isPrime", "counter", "index", "value",
+    "iff", "els", "whilex", "readint", "writeOutput", "Truth", "Nil",
+    "breaker", "cont", "result", "tmp", "a1", "b2", "readFloats"
+};
+
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int main(int argc, char* argv[]) {
+    size_t lens[sizeof(words) / sizeof(words[0])];
+    int nWords, reps;
+    long lookups, keywords;
+    double begin, elapsed, best;
+
+    lookups = (argc > 1 ? atol(argv[1]) : 50) * 1000000;
+    nWords = sizeof(words) / sizeof(words[0]);
+    for (int i = 0; i < nWords; i++)
+        lens[i] = strlen(words[i]);
+
+    best = 0;
+    keywords = 0;
+    reps = 5;
+    for (int r = 0; r < reps; r++) {
+        keywords = 0;
+        begin = now();
+        for (long i = 0; i < lookups; i += nWords)
+            for (int w = 0; w < nWords; w++)
+                keywords += keyword_type(words[w], lens[w]) != Var;
+        elapsed = now() - begin;
+        if (r == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    printf("====================\n");
+    printf("Lookups       : %ld (%ld keywords)\n", lookups, keywords);
+    printf("Best time     : %.3f s\n", best);
+    printf("Lookups/sec   : %.1f M\n", lookups / best / 1e6);
+    printf("====================\n");
+    return 0;
+}
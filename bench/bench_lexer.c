@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lexer.h"
+#include "gen.h"
+
+// gcc -O2 bench_lexer.c gen.c ../lexer.c ../log.c -o bench_lexer.out
+// ./bench_lexer.out [MB] [repetitions]
+
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int main(int argc, char* argv[]) {
+    struct TokenList *list, *curr;
+    char* src;
+    size_t size, count;
+    double begin, elapsed, best;
+    int reps;
+
+    size = (argc > 1 ? atoi(argv[1]) : 50) * 1024 * 1024;
+    reps = argc > 2 ? atoi(argv[2]) : 3;
+
+    src = gen_Program(size);
+    if (src == NULL)
+        return 1;
+    size = strlen(src);
+
+    // Only the recognition of Tokens, nothing is stored
+    best = 0;
+    count = 0;
+    for (int i = 0; i < reps; i++) {
+        const char* fp = src;
+        struct Token tok;
+        begin = now();
+        count = 0;
+        while (*fp != '\0' && next_Token(&fp, &tok) == 0)
+            count++;
+        elapsed = now() - begin;
+        if (i == 0 || elapsed < best)
+            best = elapsed;
+    }
+    printf("====================\n");
+    printf("next_Token    : %.2f M tokens/sec, %.1f MB/s\n", count / best / 1e6, size / (1024.0 * 1024.0) / best);
+
+    best = 0;
+    count = 0;
+    for (int i = 0; i < reps; i++) {
+        begin = now();
+        list = build_TokenList(src);
+        if (list == NULL) {
+            printf("Lexing failed\n");
+            free(src);
+            return 1;
+        }
+        count = 0;
+        for (curr = list; curr != NULL; curr = curr->next)
+            count++;
+        free_TokenList(list);
+        elapsed = now() - begin;
+        if (i == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    printf("====================\n");
+    printf("Source size   : %.1f MB\n", size / (1024.0 * 1024.0));
+    printf("Tokens        : %zu\n", count);
+    printf("Best time     : %.3f s (build + free)\n", best);
+    printf("Throughput    : %.1f MB/s\n", size / (1024.0 * 1024.0) / best);
+    printf("Tokens/sec    : %.2f M\n", count / best / 1e6);
+    printf("====================\n");
+
+    free(src);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../lexer.h"
+#include "gen.h"
+
+// gcc -O2 -pthread bench_parallel.c gen.c ../lexer.c ../log.c -o bench_parallel.out
+// ./bench_parallel.out [MB] [max threads] [repetitions]
+
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int main(int argc, char* argv[]) {
+    struct TokenList* list;
+    char* src;
+    size_t size;
+    double begin, elapsed, best, base;
+    int threads, reps;
+
+    size = (size_t) (argc > 1 ? atoi(argv[1]) : 300) * 1024 * 1024;
+    threads = argc > 2 ? atoi(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+    reps = argc > 3 ? atoi(argv[3]) : 3;
+
+    src = gen_Program(size);
+    if (src == NULL)
+        return 1;
+    size = strlen(src);
+
+    printf("Source size   : %.1f MB, %ld cores online\n", size / (1024.0 * 1024.0), sysconf(_SC_NPROCESSORS_ONLN));
+    printf("====================\n");
+    base = 0;
+    for (int t = 1; t <= threads; t++) {
+        best = 0;
+        for (int i = 0; i < reps; i++) {
+            begin = now();
+            list = build_TokenList_Parallel(src, size, t, 1);
+            if (list == NULL) {
+                printf("Lexing failed\n");
+                free(src);
+                return 1;
+            }
+            free_TokenList(list);
+            elapsed = now() - begin;
+            if (i == 0 || elapsed < best)
+                best = elapsed;
+        }
+        if (t == 1)
+            base = best;
+        printf("%2d threads    : %.3f s, %.1f MB/s, speedup %.2fx\n",
+               t, best, size / (1024.0 * 1024.0) / best, base / best);
+    }
+    printf("====================\n");
+
+    free(src);
+    return 0;
+}
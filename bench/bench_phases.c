@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../cgen.h"
+#include "../semantic.h"
+#include "../stats.h"
+#include "gen.h"
+
+// gcc -O2 -pthread bench_phases.c gen.c ../stats.c ../semantic.c ../cgen.c ../parser.c ../lexer.c ../log.c -o bench_phases.out
+// ./bench_phases.out [KB per shape] [json] [mmap]
+
+/*
+ * Run every phase of the compiler on each shape of generated program,
+ * in its own process so that the peak RSS is the one of that shape only.
+ * The source is written to a file and lexed by a Reader, like the driver does,
+ * or with mmap mapped and lexed in place, like the driver does with --mmap.
+ * The code is streamed to the standard output, also like the driver, that is to /dev/null.
+ * The phases print a lot on stdout: it goes to /dev/null while they run.
+*/
+
+int quiet_Stdout() {
+    int out;
+    fflush(stdout);
+    out = dup(STDOUT_FILENO);
+    if (freopen("/dev/null", "w", stdout) == NULL)
+        return -1;
+    return out;
+}
+
+
+void restore_Stdout(int out) {
+    fflush(stdout);
+    dup2(out, STDOUT_FILENO);
+    close(out);
+}
+
+
+int run_Shape(enum Shape shape, size_t size, int json, int mapped) {
+    struct TokenList *tokens, *curr;
+    struct ParseTree* tree;
+    struct Reader* reader;
+    struct Stats stats;
+    const char* text;
+    size_t len;
+    char* src;
+    char fileName[64];
+    FILE* fp;
+    int status, out, i;
+
+    src = gen_Shape(shape, size, 0);
+    if (src == NULL)
+        return MEMORY_ERROR;
+    init_Stats(&stats);
+    stats.source = strlen(src);
+    snprintf(fileName, sizeof(fileName), "./bench_%s.tmp", shape_Name(shape));
+    fp = fopen(fileName, "w");
+    if (fp == NULL)
+        return MEMORY_ERROR;
+    fputs(src, fp);
+    fclose(fp);
+    free(src);
+
+    out = quiet_Stdout();
+    text = NULL;
+    len = 0;
+    begin_Phase(&stats, PHASE_LEX);
+    if (mapped) {
+        text = map_Source(fileName, &len);
+        tokens = text == NULL ? NULL : build_TokenList_Parallel(text, len, 1, 1);
+    }
+    else {
+        reader = open_Reader(fileName, 1);
+        tokens = reader == NULL ? NULL : read_TokenList(reader);
+        close_Reader(reader);
+    }
+    end_Phase(&stats, PHASE_LEX);
+    unlink(fileName);
+    if (tokens == NULL) {
+        restore_Stdout(out);
+        printf("%s: lexing failed\n", shape_Name(shape));
+        return PARSING_ERROR;
+    }
+    for (curr = tokens; curr != NULL; curr = curr->next) {
+        stats.tokens++;
+        if (curr->token->type == Endline)
+            stats.lines++;
+    }
+
+    begin_Phase(&stats, PHASE_PARSE);
+    tree = alloc_ParseTree();
+    status = build_ParseTree(tokens, &tree);
+    end_Phase(&stats, PHASE_PARSE);
+    stats.nodes = stats_ParseTree().live;
+
+    begin_Phase(&stats, PHASE_SEMANTIC);
+    if (status == SUBTREE_OK && analyze_Program(tree) < 0)
+        status = PARSING_ERROR;
+    end_Phase(&stats, PHASE_SEMANTIC);
+
+    begin_Phase(&stats, PHASE_CGEN);
+    if (status == SUBTREE_OK)
+        status = code_gen_ToFile(tree, "-", &stats.output);
+    end_Phase(&stats, PHASE_CGEN);
+    restore_Stdout(out);
+
+    if (status != SUBTREE_OK) {
+        printf("%s: compilation failed\n", shape_Name(shape));
+        return PARSING_ERROR;
+    }
+
+    if (json) {
+        printf("{\"shape\": \"%s\", \"param\": %d, \"stats\": ", shape_Name(shape), shape_Param(shape));
+        fflush(stdout);
+        print_StatsJSON(&stats, stdout);
+        printf("}\n");
+    }
+    else {
+        printf("==================== %s (%d) ====================\n", shape_Name(shape), shape_Param(shape));
+        print_Stats(&stats, stdout);
+        printf("MB/s      ");
+        for (i = 0; i < N_PHASES; i++)
+            if (stats.phase[i].ran)
+                printf(" %s %.1f", phase_Names[i], stats.source / (1024.0 * 1024.0) / stats.phase[i].wall);
+        printf("\n");
+    }
+
+    free_ParseTree(tree);
+    free_TokenList(tokens);
+    unmap_Source(text, len);
+    return SUBTREE_OK;
+}
+
+
+int main(int argc, char* argv[]) {
+    size_t size;
+    int json, mapped, fail, status;
+    pid_t pid;
+
+    size = (size_t) (argc > 1 ? atoi(argv[1]) : 1024) * 1024;
+    json = 0;
+    mapped = 0;
+    for (int i = 2; i < argc; i++) {
+        json |= strcmp(argv[i], "json") == 0;
+        mapped |= strcmp(argv[i], "mmap") == 0;
+    }
+
+    fail = 0;
+    for (int shape = 0; shape < N_SHAPES; shape++) {
+        fflush(stdout);
+        pid = fork();
+        if (pid < 0)
+            return 1;
+        if (pid == 0)
+            return run_Shape(shape, size, json, mapped);
+        waitpid(pid, &status, 0);
+        if (! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("%s: failed\n", shape_Name(shape));
+            fail = 1;
+        }
+    }
+    return fail;
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../semantic.h"
+#include "gen.h"
+
+// gcc -O2 -pthread bench_semantic.c gen.c ../semantic.c ../parser.c ../lexer.c ../log.c -o bench_semantic.out
+// ./bench_semantic.out [max KB] [sieve]
+
+/*
+ * Semantic analysis of programs with more and more distinct variables:
+ * one per line (the vars shape), or five per copy of the sieve.
+ * With a symbol table of constant time per lookup, the time per line stays flat.
+ * The source goes through a file and a Reader: semantic needs NUL-terminated lexemes.
+*/
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int run_Size(enum Shape shape, size_t size) {
+    struct TokenList *tokens, *curr;
+    struct ParseTree* tree;
+    struct Reader* reader;
+    const char* fileName = "./bench_semantic.tmp";
+    size_t lines;
+    double begin, semantic;
+    char* src;
+    FILE* fp;
+    int status;
+
+    src = gen_Shape(shape, size, 0);
+    if (src == NULL)
+        return 1;
+    fp = fopen(fileName, "w");
+    if (fp == NULL)
+        return 1;
+    fputs(src, fp);
+    fclose(fp);
+    free(src);
+
+    reader = open_Reader(fileName, 1);
+    tokens = reader == NULL ? NULL : read_TokenList(reader);
+    close_Reader(reader);
+    unlink(fileName);
+    if (tokens == NULL)
+        return 1;
+    lines = 0;
+    for (curr = tokens; curr != NULL; curr = curr->next)
+        if (curr->token->type == Endline)
+            lines++;
+
+    tree = alloc_ParseTree();
+    if (build_ParseTree(tokens, &tree) != SUBTREE_OK) {
+        printf("Parsing failed\n");
+        return 1;
+    }
+
+    begin = now();
+    status = analyze_Program(tree);
+    semantic = now() - begin;
+    if (status < 0) {
+        printf("Semantic analysis failed\n");
+        return 1;
+    }
+
+    printf("%8zu %10zu %10.3f %10.2f\n", size / 1024, lines, semantic, semantic / lines * 1e6);
+
+    free_ParseTree(tree);
+    free_TokenList(tokens);
+    return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+    enum Shape shape;
+    size_t max;
+
+    max = (size_t) (argc > 1 ? atoi(argv[1]) : 1024) * 1024;
+    shape = argc > 2 && strcmp(argv[2], "sieve") == 0 ? SHAPE_SIEVE : SHAPE_VARS;
+
+    printf("%s\n", shape_Name(shape));
+    printf("%8s %10s %10s %10s\n", "KB", "lines", "seconds", "us/line");
+    for (size_t size = 16 * 1024; size <= max; size *= 2)
+        if (run_Size(shape, size))
+            return 1;
+    return 0;
+}
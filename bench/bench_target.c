@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../cgen_c.h"
+#include "gen.h"
+
+// gcc -O2 -pthread bench_target.c gen.c ../cgen_c.c ../cgen.c ../semantic.c ../parser.c ../lexer.c ../log.c -o bench_target.out
+// ./bench_target.out [N of code.e] [KB per shape] [C compiler]
+
+/*
+ * Runtime of the programs compiled to Python and to C: code.e, that reads N,
+ * and each shape of generated program (the sieve reads a small N for each copy).
+ * The Python code runs with python3, the C code is built with `cc -O2` (or the given compiler)
+ * and the time to build it is reported apart. Both must print the same lines.
+*/
+
+#define SHAPE_N 200 // what each copy of the sieve reads
+#define NESTED_DEPTH 16 // Python refuses more than 20 nested blocks
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+double run_Timed(const char* command) {
+    // Seconds taken by the command, or -1 if it failed
+    double begin;
+
+    begin = now();
+    if (system(command) != 0)
+        return -1;
+    return now() - begin;
+}
+
+
+int same_Files(const char* name1, const char* name2) {
+    FILE *fp1, *fp2;
+    int c1, c2;
+
+    fp1 = fopen(name1, "r");
+    fp2 = fopen(name2, "r");
+    c1 = c2 = 0;
+    if (fp1 != NULL && fp2 != NULL)
+        do {
+            c1 = getc(fp1);
+            c2 = getc(fp2);
+        } while (c1 == c2 && c1 != EOF);
+    if (fp1 != NULL)
+        fclose(fp1);
+    if (fp2 != NULL)
+        fclose(fp2);
+    return fp1 != NULL && fp2 != NULL && c1 == c2;
+}
+
+
+int compile_Both(const char* fileName) {
+    // Write ./bench_target.py and ./bench_target.c.tmp from the source file
+    struct TokenList* tokens;
+    struct ParseTree* tree;
+    struct SymbolTable* table;
+    struct Reader* reader;
+    int status;
+
+    reader = open_Reader(fileName, 1);
+    tokens = reader == NULL ? NULL : read_TokenList(reader);
+    close_Reader(reader);
+    if (tokens == NULL)
+        return PARSING_ERROR;
+    tree = alloc_ParseTree();
+    status = build_ParseTree(tokens, &tree);
+    if (status == SUBTREE_OK)
+        status = analyze_Program_Table(tree, &table) < 0 ? PARSING_ERROR : SUBTREE_OK;
+    if (status == SUBTREE_OK) {
+        status = code_gen_ToFile(tree, "./bench_target.py", NULL);
+        if (status == SUBTREE_OK)
+            status = code_gen_C_ToFile(tree, table, "./bench_target.c.tmp", NULL);
+        free_SymbolTable(table);
+    }
+    free_ParseTree(tree);
+    free_TokenList(tokens);
+    return status;
+}
+
+
+int run_Program(const char* name, const char* fileName, const char* input, const char* cc) {
+    char command[512];
+    double python, build, c;
+    int same;
+
+    if (compile_Both(fileName) != SUBTREE_OK) {
+        printf("%-8s compilation failed\n", name);
+        return 1;
+    }
+    snprintf(command, sizeof(command), "python3 ./bench_target.py < %s > ./bench_target.py.txt", input);
+    python = run_Timed(command);
+    snprintf(command, sizeof(command), "%s -O2 -x c ./bench_target.c.tmp -o ./bench_target.bin -lm", cc);
+    build = run_Timed(command);
+    snprintf(command, sizeof(command), "./bench_target.bin < %s > ./bench_target.c.txt", input);
+    c = build < 0 ? -1 : run_Timed(command);
+    same = python >= 0 && c >= 0 && same_Files("./bench_target.py.txt", "./bench_target.c.txt");
+
+    printf("%-8s %10.3f %10.3f %10.3f %9.1f %6s\n", name, python, build, c,
+           python > 0 && c > 0 ? python / c : 0.0, same ? "yes" : "NO");
+    remove("./bench_target.py");
+    remove("./bench_target.c.tmp");
+    remove("./bench_target.bin");
+    remove("./bench_target.py.txt");
+    remove("./bench_target.c.txt");
+    return ! same;
+}
+
+
+int main(int argc, char* argv[]) {
+    const char* fileName = "./bench_target.tmp";
+    const char* input = "./bench_target.in";
+    const char* cc;
+    size_t size, lines;
+    enum Shape shape;
+    int n, fail;
+    char* src;
+    FILE* fp;
+
+    n = argc > 1 ? atoi(argv[1]) : 5000;
+    size = (size_t) (argc > 2 ? atoi(argv[2]) : 64) * 1024;
+    cc = argc > 3 ? argv[3] : "cc";
+
+    printf("%-8s %10s %10s %10s %9s %6s\n", "program", "python s", "cc s", "C s", "speedup", "same");
+    fp = fopen(input, "w");
+    if (fp == NULL)
+        return 1;
+    fprintf(fp, "%d\n", n);
+    fclose(fp);
+    fail = run_Program("code.e", "../code.e", input, cc);
+
+    for (shape = 0; shape < N_SHAPES; shape++) {
+        src = gen_Shape(shape, size, shape == SHAPE_NESTED ? NESTED_DEPTH : 0);
+        if (src == NULL)
+            return 1;
+        fp = fopen(fileName, "w");
+        if (fp == NULL)
+            return 1;
+        fputs(src, fp);
+        fclose(fp);
+        free(src);
+
+        // One N for each readInt of the sieve copies, more lines are harmless
+        fp = fopen(input, "w");
+        if (fp == NULL)
+            return 1;
+        for (lines = 0; lines < size / 64; lines++)
+            fprintf(fp, "%d\n", SHAPE_N);
+        fclose(fp);
+        fail |= run_Program(shape_Name(shape), fileName, input, cc);
+    }
+    remove(fileName);
+    remove(input);
+    return fail;
+}
@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../cgen.h"
+#include "../vm.h"
+
+// gcc -O2 -pthread bench_vm.c ../bytecode.c ../vm.c ../cgen.c ../semantic.c ../parser.c ../lexer.c ../log.c -lm -o bench_vm.out
+// ./bench_vm.out [N of code.e] [rounds of the loops]
+
+/*
+ * Runtime of loop-heavy programs run by python3 on the generated code, and by the VM
+ * of --run: the VM time includes the compilation to bytecode, the Python time includes
+ * the startup of the interpreter, that is reported apart. Both must print the same lines.
+ * Build with -DVM_SWITCH to measure the switch dispatch instead of the computed goto.
+*/
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+double run_Timed(const char* command) {
+    // Seconds taken by the command, or -1 if it failed
+    double begin;
+
+    begin = now();
+    if (system(command) != 0)
+        return -1;
+    return now() - begin;
+}
+
+
+int same_Files(const char* name1, const char* name2) {
+    FILE *fp1, *fp2;
+    int c1, c2;
+
+    fp1 = fopen(name1, "r");
+    fp2 = fopen(name2, "r");
+    c1 = c2 = 0;
+    if (fp1 != NULL && fp2 != NULL)
+        do {
+            c1 = getc(fp1);
+            c2 = getc(fp2);
+        } while (c1 == c2 && c1 != EOF);
+    if (fp1 != NULL)
+        fclose(fp1);
+    if (fp2 != NULL)
+        fclose(fp2);
+    return fp1 != NULL && fp2 != NULL && c1 == c2;
+}
+
+
+double run_Vm(const char* fileName, const char* input, const char* output, int* ins) {
+    // Seconds to compile and run the program with the VM, -1 on error
+    struct TokenList* tokens;
+    struct ParseTree* tree;
+    struct SymbolTable* table;
+    struct VmCode* code;
+    struct Reader* reader;
+    FILE *in, *out;
+    double begin;
+    int status;
+
+    reader = open_Reader(fileName, 1);
+    tokens = reader == NULL ? NULL : read_TokenList(reader);
+    close_Reader(reader);
+    if (tokens == NULL)
+        return -1;
+    tree = alloc_ParseTree();
+    status = build_ParseTree(tokens, &tree);
+    if (status == SUBTREE_OK)
+        status = code_gen_ToFile(tree, "./bench_vm.py", NULL);
+    if (status == SUBTREE_OK && analyze_Program_Table(tree, &table) < 0)
+        status = PARSING_ERROR;
+
+    code = NULL;
+    begin = now();
+    if (status == SUBTREE_OK) {
+        code = compile_Bytecode(tree, table);
+        free_SymbolTable(table);
+    }
+    in = fopen(input, "r");
+    out = fopen(output, "w");
+    status = code == NULL || in == NULL || out == NULL ? -1 : run_Bytecode(code, in, out);
+    if (in != NULL)
+        fclose(in);
+    if (out != NULL)
+        fclose(out);
+    *ins = code == NULL ? 0 : code->n;
+    free_Bytecode(code);
+    free_ParseTree(tree);
+    free_TokenList(tokens);
+    return status == 0 ? now() - begin : -1;
+}
+
+
+int run_Program(const char* name, const char* src, const char* input, double startup) {
+    const char* fileName = "./bench_vm.tmp";
+    char command[512];
+    double python, vm;
+    int same, ins;
+    FILE* fp;
+
+    fp = fopen(fileName, "w");
+    if (fp == NULL)
+        return 1;
+    fputs(src, fp);
+    fclose(fp);
+    vm = run_Vm(fileName, input, "./bench_vm.vm.txt", &ins);
+    snprintf(command, sizeof(command), "python3 ./bench_vm.py < %s > ./bench_vm.py.txt", input);
+    python = vm < 0 ? -1 : run_Timed(command);
+    same = python >= 0 && vm >= 0 && same_Files("./bench_vm.py.txt", "./bench_vm.vm.txt");
+
+    printf("%-8s %8d %10.3f %10.3f %10.3f %9.1f %6s\n", name, ins, python, python - startup, vm,
+           python > 0 && vm > 0 ? python / vm : 0.0, same ? "yes" : "NO");
+    remove(fileName);
+    remove("./bench_vm.py");
+    remove("./bench_vm.py.txt");
+    remove("./bench_vm.vm.txt");
+    return ! same;
+}
+
+
+/*
+ * The loops: each one reads the number of rounds.
+*/
+
+const char* loop_Sum =
+    "readInt n;\n"
+    "s = 0;\n"
+    "i = 0;\n"
+    "while (i < n)\n"
+    "    s = s + i * i % 7;\n"
+    "    i = i + 1;\n"
+    ";\n"
+    "writeOut s;\n";
+
+const char* loop_Float =
+    "readInt n;\n"
+    "x = 0.0;\n"
+    "i = 0;\n"
+    "while (i < n)\n"
+    "    x = x + 1 /. (i + 1);\n"
+    "    if (x > 10.0)\n"
+    "        x = x - 10.0;\n"
+    "    ;\n"
+    "    i = i + 1;\n"
+    ";\n"
+    "writeOut x;\n";
+
+const char* loop_Nested =
+    "readInt n;\n"
+    "c = 0;\n"
+    "i = 0;\n"
+    "while (i < n / 1000)\n"
+    "    j = 0;\n"
+    "    while (j < 1000)\n"
+    "        if ((i + j) % 3 == 0)\n"
+    "            c = c + 1;\n"
+    "        ;\n"
+    "        j = j + 1;\n"
+    "    ;\n"
+    "    i = i + 1;\n"
+    ";\n"
+    "writeOut c;\n";
+
+const char* loop_List =
+    "readInt n;\n"
+    "l = [3, 1, 4, 1, 5, 9, 2, 6];\n"
+    "s = 0;\n"
+    "i = 0;\n"
+    "while (i < n)\n"
+    "    k = i % 8;\n"
+    "    s = s + l[k];\n"
+    "    i = i + 1;\n"
+    ";\n"
+    "writeOut s;\n";
+
+const char* loop_Break =
+    "readInt n;\n"
+    "s = 0;\n"
+    "i = 0;\n"
+    "while (True)\n"
+    "    i = i + 1;\n"
+    "    if (i % 2 == 0)\n"
+    "        continue;\n"
+    "    ;\n"
+    "    if (i > n)\n"
+    "        break;\n"
+    "    ;\n"
+    "    s = s + i;\n"
+    ";\n"
+    "writeOut s;\n";
+
+
+int main(int argc, char* argv[]) {
+    const char* input = "./bench_vm.in";
+    const char* names[] = {"sum", "float", "nested", "list", "break"};
+    const char* loops[] = {loop_Sum, loop_Float, loop_Nested, loop_List, loop_Break};
+    char* src;
+    double startup;
+    int n, rounds, fail, i;
+    FILE* fp;
+
+    n = argc > 1 ? atoi(argv[1]) : 5000;
+    rounds = argc > 2 ? atoi(argv[2]) : 1000000;
+
+    startup = run_Timed("python3 -c pass");
+    printf("python3 startup %.3f s\n", startup);
+    printf("%-8s %8s %10s %10s %10s %9s %6s\n", "program", "ins", "python s", "w/o start", "VM s", "speedup", "same");
+
+    fp = fopen(input, "w");
+    if (fp == NULL)
+        return 1;
+    fprintf(fp, "%d\n", n);
+    fclose(fp);
+    fp = fopen("../code.e", "r");
+    src = calloc(1 << 16, 1);
+    if (fp == NULL || src == NULL)
+        return 1;
+    fread(src, 1, (1 << 16) - 1, fp);
+    fclose(fp);
+    fail = run_Program("code.e", src, input, startup);
+    free(src);
+
+    fp = fopen(input, "w");
+    if (fp == NULL)
+        return 1;
+    fprintf(fp, "%d\n", rounds);
+    fclose(fp);
+    for (i = 0; i < 5; i++)
+        fail |= run_Program(names[i], loops[i], input, startup);
+    remove(input);
+    return fail;
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "gen.h"
+
+
+const char* sieve_template =
+    "readInt N%1$d;\n"
+    "totSum%1$d = 0;\n"
+    "i%1$d = 0;\n"
+    "while (i%1$d <= N%1$d)\n"
+    "    j%1$d = 2;\n"
+    "    isPrime%1$d = True;\n"
+    "    while ((j%1$d <= i%1$d / 2) && isPrime%1$d)\n"
+    "        if (i%1$d %% j%1$d == 0)\n"
+    "            writeOut \"%%s is not prime\", i%1$d;\n"
+    "            isPrime%1$d = False;\n"
+    "        ;\n"
+    "        j%1$d = j%1$d + 1;\n"
+    "    ;\n"
+    "    if (isPrime%1$d)\n"
+    "        totSum%1$d = totSum%1$d + i%1$d;\n"
+    "    ;\n"
+    "    i%1$d = i%1$d + 1;\n"
+    ";\n"
+    "writeOut \"Total primes sum until %%s is %%s\", N%1$d, totSum%1$d;\n";
+
+
+struct GenBuf {
+    char* src;
+    size_t len;
+    size_t cap;
+};
+
+
+int gen_Append(struct GenBuf* buf, const char* format, ...) {
+    // printf at the end of the buffer, growing it if needed. Return 1 on memory error.
+    va_list args;
+    char* tmp;
+    int n;
+
+    while (1) {
+        va_start(args, format);
+        n = vsnprintf(buf->src + buf->len, buf->cap - buf->len, format, args);
+        va_end(args);
+        if (n < 0)
+            return 1;
+        if ((size_t) n < buf->cap - buf->len)
+            break;
+        tmp = realloc(buf->src, 2 * buf->cap + n);
+        if (tmp == NULL)
+            return 1;
+        buf->src = tmp;
+        buf->cap = 2 * buf->cap + n;
+    }
+    buf->len += n;
+    return 0;
+}
+
+
+int gen_Nested(struct GenBuf* buf, int block, int depth) {
+    // Alternate while and if, `depth` levels deep, around one assignment
+    int i, err;
+
+    err = gen_Append(buf, "x%d = 0;\n", block);
+    for (i = 0; i < depth; i++) {
+        if (i % 2 == 0)
+            err |= gen_Append(buf, "%*swhile (x%d < %d)\n", 4 * i, "", block, i + 1);
+        else
+            err |= gen_Append(buf, "%*sif (x%d != %d)\n", 4 * i, "", block, i);
+    }
+    err |= gen_Append(buf, "%*sx%d = x%d + 1;\n", 4 * depth, "", block, block);
+    for (i = depth - 1; i >= 0; i--)
+        err |= gen_Append(buf, "%*s;\n", 4 * i, "");
+    return err;
+}
+
+
+int gen_Expr(struct GenBuf* buf, int block, int operands) {
+    // e = v + 2 * v - 3 / v + ... , with ints and one variable
+    static const char* ops[] = {" + ", " * ", " - ", " / "};
+    int i, err;
+
+    err = gen_Append(buf, "v%d = 1;\ne%d = v%d", block, block, block);
+    for (i = 1; i < operands; i++) {
+        if (i % 2 == 0)
+            err |= gen_Append(buf, "%sv%d", ops[i % 4], block);
+        else
+            err |= gen_Append(buf, "%s%d", ops[i % 4], i);
+    }
+    err |= gen_Append(buf, ";\n");
+    return err;
+}
+
+
+int gen_String(struct GenBuf* buf, int block, int args) {
+    // writeOut "%s %s ... %s", s, s, ... , s;
+    int i, err;
+
+    err = gen_Append(buf, "s%d = \"text\";\nwriteOut \"", block);
+    for (i = 0; i < args; i++)
+        err |= gen_Append(buf, i == 0 ? "%%s" : " %%s");
+    err |= gen_Append(buf, "\"");
+    for (i = 0; i < args; i++)
+        err |= gen_Append(buf, ", s%d", block);
+    err |= gen_Append(buf, ";\n");
+    return err;
+}
+
+
+int gen_List(struct GenBuf* buf, int block, int elems) {
+    // l = [0, 1, 2, ...];
+    int i, err;
+
+    err = gen_Append(buf, "l%d = [", block);
+    for (i = 0; i < elems; i++)
+        err |= gen_Append(buf, i == 0 ? "%d" : ", %d", i);
+    err |= gen_Append(buf, "];\n");
+    return err;
+}
+
+
+int gen_Vars(struct GenBuf* buf, int block, int back) {
+    // v = w + 1; with w defined `back` lines before
+    if (block < back)
+        return gen_Append(buf, "v%d = %d;\n", block, block);
+    return gen_Append(buf, "v%d = v%d + 1;\n", block, block - back);
+}
+
+
+char* gen_Shape(enum Shape shape, size_t size, int param) {
+    struct GenBuf buf;
+    int block, err;
+
+    buf.cap = size + 4096;
+    buf.len = 0;
+    buf.src = malloc(buf.cap);
+    if (buf.src == NULL)
+        return NULL;
+    buf.src[0] = '\0';
+    if (param <= 0)
+        param = shape_Param(shape);
+    block = 0;
+    err = 0;
+    while (buf.len < size && ! err) {
+        switch (shape) {
+            case SHAPE_NESTED: err = gen_Nested(&buf, block, param); break;
+            case SHAPE_EXPR: err = gen_Expr(&buf, block, param); break;
+            case SHAPE_STRING: err = gen_String(&buf, block, param); break;
+            case SHAPE_LIST: err = gen_List(&buf, block, param); break;
+            case SHAPE_VARS: err = gen_Vars(&buf, block, param); break;
+            default: err = gen_Append(&buf, sieve_template, block); break;
+        }
+        block++;
+    }
+    if (err) {
+        free(buf.src);
+        return NULL;
+    }
+    return buf.src;
+}
+
+
+char* gen_Program(size_t size) {
+    return gen_Shape(SHAPE_SIEVE, size, 0);
+}
+
+
+const char* shape_Name(enum Shape shape) {
+    switch (shape) {
+        case SHAPE_NESTED: return "nested";
+        case SHAPE_EXPR: return "expr";
+        case SHAPE_STRING: return "string";
+        case SHAPE_LIST: return "list";
+        case SHAPE_VARS: return "vars";
+        default: return "sieve";
+    }
+}
+
+
+int shape_Param(enum Shape shape) {
+    switch (shape) {
+        case SHAPE_NESTED: return 64;
+        case SHAPE_EXPR: return 1000;
+        case SHAPE_STRING: return 1000;
+        case SHAPE_LIST: return 1000;
+        case SHAPE_VARS: return 1000;
+        default: return 0;
+    }
+}
@@ -0,0 +1,32 @@
+#include <stddef.h>
+
+/*
+ * Synthetic programs for the benchmarks.
+*/
+
+enum Shape {
+    SHAPE_SIEVE, // copies of the prime sieve in code.e
+    SHAPE_NESTED, // while and if nested `param` levels deep
+    SHAPE_EXPR, // assignments of one expression with `param` operands
+    SHAPE_STRING, // writeOut of a string with `param` %s
+    SHAPE_LIST, // assignments of a list of `param` elements
+    SHAPE_VARS, // one new variable per line, from the one defined `param` lines before
+    N_SHAPES
+};
+
+/*
+ * Return a NUL-terminated source of at the least `size` bytes,
+ * made of copies of the given shape, each one with its own identifiers.
+ * If param is 0 the default of the shape is used (see shape_Param).
+ * The caller must free the result.
+*/
+char* gen_Shape(enum Shape shape, size_t size, int param);
+
+/*
+ * Same as gen_Shape(SHAPE_SIEVE, size, 0).
+*/
+char* gen_Program(size_t size);
+
+const char* shape_Name(enum Shape shape);
+
+int shape_Param(enum Shape shape);
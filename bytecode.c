@@ -0,0 +1,995 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "vm.h"
+#include "cgen.h"
+#include "log.h"
+
+/*
+ * While compiling, a register is known by its kind and its index in the kind:
+ * the variables are numbered from 0, the other kinds from BC_KIND up, and they are
+ * all mapped to their final place once their counts are known (see finish_Bytecode).
+ * The labels, the targets of the jumps, are resolved at the same time.
+ * No register, label or count ever reaches BC_KIND.
+*/
+#define BC_KIND (1 << 24)
+#define BC_TEMP (1 * BC_KIND) // temporaries of numbers and bools
+#define BC_OTEMP (2 * BC_KIND) // temporaries of strings and lists
+#define BC_CONST (3 * BC_KIND)
+
+
+struct Bc {
+    struct VmIns* ins;
+    int n, cap;
+    union VmValue* consts;
+    int* const_types;
+    int nconsts, capconsts, captypes;
+    int* labels; // position of each label, -1 until it is placed
+    int nlabels, caplabels;
+    int* vars; // register of each interned id, -1 if it has none yet
+    int nids;
+    int nvars;
+    int temps, maxtemps; // in use by the current line, most ever used
+    int otemps, maxotemps;
+    int brk, cont; // labels of the innermost loop, -1 outside loops
+    int placed; // n when the last label was placed: no instruction before it can be changed
+    int error;
+    struct SymbolTable* table;
+};
+
+
+int bc_Expr (struct ParseTree* tree, struct Bc* bc, int* type);
+int bc_Cond (struct ParseTree* tree, int sense, int label, struct Bc* bc);
+int bc_Line (struct ParseTree* tree, struct Bc* bc);
+
+
+int bc_Grow (void** array, int* cap, int n, size_t size) {
+    // Room for one more element: 1 on memory error
+    void* grown;
+    int want;
+
+    if (n < *cap)
+        return 0;
+    want = *cap > 0 ? 2 * *cap : 64;
+    grown = realloc(*array, want * size);
+    if (grown == NULL)
+        return 1;
+    *array = grown;
+    *cap = want;
+    return 0;
+}
+
+
+int bc_Ins (struct Bc* bc, enum VmOp op, int t, int a, int b, int c) {
+    // Append an instruction, return its index or -1
+    struct VmIns* ins;
+
+    if (bc_Grow((void**) &bc->ins, &bc->cap, bc->n, sizeof(struct VmIns))) {
+        bc->error = MEMORY_ERROR;
+        return -1;
+    }
+    ins = bc->ins + bc->n;
+    ins->op = op;
+    ins->t = t;
+    ins->a = a;
+    ins->b = b;
+    ins->c = c;
+    return bc->n++;
+}
+
+
+int bc_Temp (struct Bc* bc, int type) {
+    if (type == _string || type == _list) {
+        if (++bc->otemps > bc->maxotemps)
+            bc->maxotemps = bc->otemps;
+        return BC_OTEMP + bc->otemps - 1;
+    }
+    if (++bc->temps > bc->maxtemps)
+        bc->maxtemps = bc->temps;
+    return BC_TEMP + bc->temps - 1;
+}
+
+
+int bc_Const (struct Bc* bc, int type, union VmValue value) {
+    // A new register that holds the value from the start
+    if (bc_Grow((void**) &bc->consts, &bc->capconsts, bc->nconsts, sizeof(union VmValue)) ||
+        bc_Grow((void**) &bc->const_types, &bc->captypes, bc->nconsts, sizeof(int))) {
+        bc->error = MEMORY_ERROR;
+        return -1;
+    }
+    bc->consts[bc->nconsts] = value;
+    bc->const_types[bc->nconsts] = type;
+    return BC_CONST + bc->nconsts++;
+}
+
+
+int bc_Int (struct Bc* bc, long long i) {
+    union VmValue value;
+
+    value.i = i;
+    return bc_Const(bc, _int, value);
+}
+
+
+int bc_Label (struct Bc* bc) {
+    if (bc_Grow((void**) &bc->labels, &bc->caplabels, bc->nlabels, sizeof(int))) {
+        bc->error = MEMORY_ERROR;
+        return -1;
+    }
+    bc->labels[bc->nlabels] = -1;
+    return bc->nlabels++;
+}
+
+
+void bc_Place (struct Bc* bc, int label) {
+    // The label is the next instruction
+    bc->labels[label] = bc->n;
+    bc->placed = bc->n;
+}
+
+
+int bc_Unsupported (struct ParseTree* tree, const char* what) {
+    log_Offset(LOG_ERROR, node_Offset(tree), "cannot run %s", what);
+    return -1;
+}
+
+
+int bc_IsObj (int type) {
+    return type == _string || type == _list;
+}
+
+
+/*
+ * ---------------
+ * Values
+ * ---------------
+*/
+
+int bc_Var (struct ParseTree* var, struct Bc* bc, int* type) {
+    // The register of the variable: the same one for the whole program
+    struct Symbol* sym;
+
+    sym = search_symbol(bc->table, var->data->id);
+    if (sym == NULL || var->data->id >= bc->nids)
+        return -1;
+    *type = sym->type;
+    if (bc->vars[var->data->id] < 0)
+        bc->vars[var->data->id] = bc->nvars++;
+    return bc->vars[var->data->id];
+}
+
+
+int bc_Num (struct ParseTree* tree, int type, struct Bc* bc) {
+    union VmValue value;
+    int status, isfloat;
+
+    status = num_Literal(tree, &value.f, &value.i, &isfloat);
+    if (status == MEMORY_ERROR)
+        bc->error = MEMORY_ERROR;
+    if (status != SUBTREE_OK && status != NUM_RANGE)
+        return -1;
+    return bc_Const(bc, type, value);
+}
+
+int bc_Literal (struct Token* lit, struct Bc* bc) {
+    // A constant string, without its quotes
+    union VmValue value;
+    char* bytes;
+    size_t len;
+
+    bytes = malloc(lit->len);
+    if (bytes == NULL) {
+        bc->error = MEMORY_ERROR;
+        return -1;
+    }
+    len = unescape_Literal(lit->lexeme + 1, lit->len - 2, bytes);
+    value.o = new_VmStr(bytes, len);
+    free(bytes);
+    if (value.o == NULL) {
+        bc->error = MEMORY_ERROR;
+        return -1;
+    }
+    return bc_Const(bc, _string, value);
+}
+
+
+int bc_Obj (struct ParseTree* tree, struct Bc* bc, int* type);
+
+
+int bc_ToStr (struct ParseTree* obj, int dst, struct Bc* bc) {
+    // dst = str() of the Obj
+    int reg, type;
+
+    reg = bc_Obj(obj, bc, &type);
+    if (reg < 0)
+        return -1;
+    if (type == _string)
+        return bc_Ins(bc, VM_MOVO, 0, dst, reg, 0);
+    return bc_Ins(bc, VM_TOSTR, type, dst, reg, 0);
+}
+
+
+int bc_QuotedStr (struct ParseTree* tree, struct Bc* bc) {
+    /*
+     * "..." , a, b  is  "..." % (str(a), str(b)): the strings go in consecutive temporaries.
+     * Without arguments the literal is the value, % is only a character.
+    */
+    struct ParseTree *lit, *arg;
+    int reg, first, n, dst;
+
+    lit = tree->child;
+    reg = bc_Literal(lit->data, bc);
+    if (reg < 0 || lit->sibling == NULL)
+        return reg;
+
+    n = 0;
+    for (arg = lit->sibling; arg != NULL; arg = arg->sibling->sibling)
+        n++;
+    first = bc->otemps;
+    bc->otemps += n;
+    if (bc->otemps > bc->maxotemps)
+        bc->maxotemps = bc->otemps;
+    dst = bc_Temp(bc, _string);
+
+    n = 0;
+    for (arg = lit->sibling->sibling; ; arg = arg->sibling->sibling) {
+        if (bc_ToStr(arg, BC_OTEMP + first + n, bc) < 0)
+            return -1;
+        n++;
+        if (arg->sibling == NULL)
+            break;
+    }
+    if (bc_Ins(bc, VM_FORMAT, n, dst, reg, BC_OTEMP + first) < 0)
+        return -1;
+    return dst;
+}
+
+
+int bc_Str (struct ParseTree* tree, struct Bc* bc) {
+    // a + b + c, from the left
+    struct ParseTree* piece;
+    int left, right, dst;
+
+    piece = tree->child;
+    left = bc_QuotedStr(piece, bc);
+    while (left >= 0 && piece->sibling != NULL) {
+        piece = piece->sibling->sibling;
+        right = bc_QuotedStr(piece, bc);
+        dst = bc_Temp(bc, _string);
+        if (right < 0 || bc_Ins(bc, VM_CONCAT, 0, dst, left, right) < 0)
+            return -1;
+        left = dst;
+    }
+    return left;
+}
+
+
+int bc_List (struct ParseTree* tree, struct Bc* bc) {
+    // The elements are converted to the type of the list, in consecutive temporaries
+    struct ParseTree *elems, *obj;
+    int type, elem, reg, first, n, dst;
+
+    elems = tree->child->sibling;
+    if (elems->data->type != ListExpr)
+        return -1;
+    type = type_Of(elems, bc->table);
+    if (type < 0)
+        return -1;
+    n = 0;
+    for (obj = elems->child; obj != NULL; obj = obj->sibling->sibling) {
+        n++;
+        if (obj->sibling == NULL)
+            break;
+    }
+
+    if (bc_IsObj(type)) {
+        first = BC_OTEMP + bc->otemps;
+        bc->otemps += n;
+        if (bc->otemps > bc->maxotemps)
+            bc->maxotemps = bc->otemps;
+    }
+    else {
+        first = BC_TEMP + bc->temps;
+        bc->temps += n;
+        if (bc->temps > bc->maxtemps)
+            bc->maxtemps = bc->temps;
+    }
+    n = 0;
+    for (obj = elems->child; obj != NULL; obj = obj->sibling->sibling) {
+        reg = bc_Obj(obj, bc, &elem);
+        if (reg < 0)
+            return -1;
+        if (type == _float && elem != _float)
+            reg = bc_Ins(bc, VM_ITOF, 0, first + n, reg, 0);
+        else
+            reg = bc_Ins(bc, bc_IsObj(type) ? VM_MOVO : VM_MOV, 0, first + n, reg, 0);
+        if (reg < 0)
+            return -1;
+        n++;
+        if (obj->sibling == NULL)
+            break;
+    }
+    dst = bc_Temp(bc, _list);
+    if (bc_Ins(bc, VM_LIST, type, dst, first, n) < 0)
+        return -1;
+    return dst;
+}
+
+
+int bc_ListElem (struct ParseTree* tree, struct Bc* bc, int* type) {
+    struct Symbol* sym;
+    struct ParseTree* idx;
+    int list, index, ltype, dst;
+
+    sym = search_symbol(bc->table, tree->child->data->id);
+    list = bc_Var(tree->child, bc, &ltype);
+    if (sym == NULL || list < 0)
+        return -1;
+    *type = sym->list_type;
+
+    idx = tree->child->sibling->sibling;
+    if (idx->data->type == Int)
+        index = bc_Int(bc, lexeme_Int(idx->data->lexeme, idx->data->len));
+    else
+        index = bc_Var(idx, bc, &ltype);
+    dst = bc_Temp(bc, *type);
+    if (index < 0 || bc_Ins(bc, VM_ELEM, *type, dst, list, index) < 0)
+        return -1;
+    return dst;
+}
+
+
+int bc_Obj (struct ParseTree* tree, struct Bc* bc, int* type) {
+    union VmValue value;
+    struct ParseTree* obj;
+
+    obj = tree;
+    tree = tree->child;
+    switch (tree->data->type) {
+        case Var:
+            return bc_Var(tree, bc, type);
+        case Num:
+            *type = type_Of(obj, bc->table);
+            return bc_Num(tree, *type, bc);
+        case Bool:
+            *type = _bool;
+            value.i = tree->data->len == 4;
+            return bc_Const(bc, _bool, value);
+        case Str:
+            *type = _string;
+            return bc_Str(tree, bc);
+        case List:
+            *type = _list;
+            return bc_List(tree, bc);
+        case ListElem:
+            return bc_ListElem(tree, bc, type);
+        default:
+            return bc_Unsupported(tree, "Null, that has no value");
+    }
+}
+
+
+/*
+ * ---------------
+ * Expressions
+ * ---------------
+*/
+
+int bc_Float (int reg, int type, struct Bc* bc) {
+    int dst;
+
+    if (type == _float || reg < 0)
+        return reg;
+    dst = bc_Temp(bc, _float);
+    if (bc_Ins(bc, VM_ITOF, 0, dst, reg, 0) < 0)
+        return -1;
+    return dst;
+}
+
+
+int bc_Operand (struct ParseTree* tree, struct Bc* bc, int* type);
+
+
+int bc_Aritm (struct ParseTree* tree, struct Bc* bc, int* type) {
+    /*
+     * Term and Pred: operand (op operand)*, from the left.
+     * Two ints give an int, but with /. : else both are floats.
+    */
+    static const enum VmOp int_ops[] = {VM_ADDI, VM_SUBI, VM_MULI, VM_DIVI, VM_MODI};
+    static const enum VmOp float_ops[] = {VM_ADDF, VM_SUBF, VM_MULF, VM_DIVF, VM_MODF};
+    struct ParseTree *child, *op;
+    int left, right, rtype, dst, k;
+
+    child = tree->child;
+    left = bc_Operand(child, bc, type);
+    while (left >= 0 && child->sibling != NULL) {
+        op = child->sibling;
+        child = op->sibling;
+        right = bc_Operand(child, bc, &rtype);
+        if (right < 0)
+            return -1;
+        switch (op->data->type) {
+            case Plus: k = 0; break;
+            case Minus: k = 1; break;
+            case Star: k = 2; break;
+            case Div: case FloatDiv: k = 3; break;
+            case Percent: k = 4; break;
+            default: return -1;
+        }
+        if (*type == _float || rtype == _float || op->data->type == FloatDiv) {
+            left = bc_Float(left, *type, bc);
+            right = bc_Float(right, rtype, bc);
+            *type = _float;
+        }
+        dst = bc_Temp(bc, *type);
+        if (left < 0 || right < 0 || bc_Ins(bc, *type == _float ? float_ops[k] : int_ops[k], 0, dst, left, right) < 0)
+            return -1;
+        left = dst;
+    }
+    return left;
+}
+
+
+int bc_Operand (struct ParseTree* tree, struct Bc* bc, int* type) {
+    switch (tree->data->type) {
+        case Pred: case Term:
+            if (tree->child->sibling == NULL)
+                return bc_Operand(tree->child, bc, type);
+            return bc_Aritm(tree, bc, type);
+        case BaseExpr:
+            if (tree->child->data->type == Obj)
+                return bc_Obj(tree->child, bc, type);
+            return bc_Expr(tree->child->sibling, bc, type); // ( Expr )
+        default:
+            return -1;
+    }
+}
+
+
+struct BcChain {
+    struct ParseTree** items; // operands at the even places, operators in between
+    int n; // operands
+};
+
+
+int init_BcChain (struct BcChain* chain, struct ParseTree* tree, struct Bc* bc) {
+    chain->items = chain_Items(tree, &chain->n);
+    if (chain->items == NULL) {
+        bc->error = MEMORY_ERROR;
+        return MEMORY_ERROR;
+    }
+    return SUBTREE_OK;
+}
+
+
+enum TokenType op_Of (struct BcChain* chain, int k) {
+    // The operator after the k-th operand
+    return chain->items[2 * k + 1]->data->type;
+}
+
+
+int bc_Truth (int reg, int type, struct Bc* bc) {
+    // bool() of a value, for and, or
+    static const enum VmOp truth[] = {VM_TRUTHI, VM_TRUTHF, VM_TRUTHS};
+    int dst;
+
+    if (type == _bool || reg < 0)
+        return reg;
+    dst = bc_Temp(bc, _bool);
+    if (bc_Ins(bc, type == _list ? VM_TRUTHL : truth[type], 0, dst, reg, 0) < 0)
+        return -1;
+    return dst;
+}
+
+
+int bc_Compare (int left, int ltype, enum TokenType op, int right, int rtype, struct Bc* bc) {
+    /*
+     * A bool for left op right. > and >= are < and <= the other way round.
+     * Strings and lists are only == and !=, and values of different types are never equal
+     * but for numbers and bools: that is known already.
+    */
+    enum VmOp vop;
+    union VmValue known;
+    int dst, tmp, isfloat;
+
+    isfloat = ltype == _float || rtype == _float;
+    if (ltype != rtype && (bc_IsObj(ltype) || bc_IsObj(rtype))) {
+        known.i = op == NotEq;
+        return bc_Const(bc, _bool, known);
+    }
+    if (op == Greater || op == GreaterEq) {
+        tmp = left;
+        left = right;
+        right = tmp;
+        tmp = ltype;
+        ltype = rtype;
+        rtype = tmp;
+        op = op == Greater ? Lesser : LesserEq;
+    }
+    switch (op) {
+        case Lesser: vop = isfloat ? VM_LTF : VM_LTI; break;
+        case LesserEq: vop = isfloat ? VM_LEF : VM_LEI; break;
+        case EqEq: vop = ltype == _string ? VM_EQS : ltype == _list ? VM_EQL : isfloat ? VM_EQF : VM_EQI; break;
+        default: vop = ltype == _string ? VM_NES : ltype == _list ? VM_NEL : isfloat ? VM_NEF : VM_NEI; break;
+    }
+    if (isfloat) {
+        left = bc_Float(left, ltype, bc);
+        right = bc_Float(right, rtype, bc);
+    }
+    dst = bc_Temp(bc, _bool);
+    if (left < 0 || right < 0 || bc_Ins(bc, vop, 0, dst, left, right) < 0)
+        return -1;
+    return dst;
+}
+
+
+int bc_Logic (struct BcChain* chain, int first, int last, struct Bc* bc, int* type) {
+    /*
+     * The value of the operands from first to last, split as chain_Level says.
+     * In a chain of comparisons each operand is computed once.
+     * and, or give a bool and stop as soon as it is known.
+    */
+    int k, from, dst, part, end, left, ltype, right, rtype, level;
+
+    level = chain_Level(chain->items, first, last);
+    if (level == 2) {
+        left = bc_Operand(chain->items[2 * first], bc, &ltype);
+        if (first == last || left < 0)
+            return bc_Truth(left, ltype, bc) >= 0 && (*type = first == last ? ltype : _bool) >= 0 ? left : -1;
+        dst = bc_Temp(bc, _bool);
+        end = bc_Label(bc);
+        for (k = first; k < last; k++) {
+            right = bc_Operand(chain->items[2 * k + 2], bc, &rtype);
+            part = right < 0 ? -1 : bc_Compare(left, ltype, op_Of(chain, k), right, rtype, bc);
+            if (part < 0 || bc_Ins(bc, VM_MOV, 0, dst, part, 0) < 0)
+                return -1;
+            if (k + 1 < last && bc_Ins(bc, VM_JZ, 0, dst, 0, end) < 0)
+                return -1;
+            left = right;
+            ltype = rtype;
+        }
+        bc_Place(bc, end);
+        *type = _bool;
+        return dst;
+    }
+
+    dst = bc_Temp(bc, _bool);
+    end = bc_Label(bc);
+    if (end < 0)
+        return -1;
+    for (from = first; from <= last; from = k + 1) {
+        k = chain_Group(chain->items, from, last, level);
+        if (from > first && bc_Ins(bc, level == 0 ? VM_JNZ : VM_JZ, 0, dst, 0, end) < 0)
+            return -1;
+        part = bc_Logic(chain, from, k, bc, type);
+        part = bc_Truth(part, *type, bc);
+        if (part < 0 || bc_Ins(bc, VM_MOV, 0, dst, part, 0) < 0)
+            return -1;
+    }
+    bc_Place(bc, end);
+    *type = _bool;
+    return dst;
+}
+
+
+int bc_Expr (struct ParseTree* tree, struct Bc* bc, int* type) {
+    struct BcChain chain;
+    int reg;
+
+    if (tree->child->sibling == NULL)
+        return bc_Operand(tree->child, bc, type);
+    if (init_BcChain(&chain, tree, bc) != SUBTREE_OK)
+        return -1;
+    reg = bc_Logic(&chain, 0, chain.n - 1, bc, type);
+    free(chain.items);
+    return reg;
+}
+
+
+/*
+ * ---------------
+ * Conditions
+ * ---------------
+*/
+
+struct ParseTree* paren_Expr (struct ParseTree* tree) {
+    // The Expr of an operand that is only ( Expr ), or NULL
+    while (tree->child != NULL && tree->child->sibling == NULL &&
+           (tree->data->type == Pred || tree->data->type == Term))
+        tree = tree->child;
+    if (tree->data->type == BaseExpr && tree->child->data->type == Lpar)
+        return tree->child->sibling;
+    return NULL;
+}
+
+
+int bc_Jump (struct BcChain* chain, int first, int last, int sense, int label, struct Bc* bc) {
+    /*
+     * Jump to label if the truth of the operands from first to last is sense.
+     * An `or` jumps at its first true part, an `and` at its first false part,
+     * and the other way round with a label of their own.
+     * A comparison of ints and bools is a single compare and jump.
+    */
+    struct ParseTree* inner;
+    enum TokenType op;
+    int k, from, skip, reg, type, left, ltype, right, rtype, jump, level;
+
+    level = chain_Level(chain->items, first, last);
+    if (level < 2) {
+        // The parts that do not decide jump over the last one
+        skip = (level == 0) == sense ? label : bc_Label(bc);
+        if (skip < 0)
+            return -1;
+        for (from = first; from <= last; from = k + 1) {
+            k = chain_Group(chain->items, from, last, level);
+            if (k == last) {
+                if (bc_Jump(chain, from, k, sense, label, bc) < 0)
+                    return -1;
+            }
+            else if (bc_Jump(chain, from, k, level == 0, skip, bc) < 0)
+                return -1;
+        }
+        if (skip != label)
+            bc_Place(bc, skip);
+        return 0;
+    }
+
+    if (first == last && (inner = paren_Expr(chain->items[2 * first])) != NULL)
+        return bc_Cond(inner, sense, label, bc);
+    if (last == first + 1) {
+        left = bc_Operand(chain->items[2 * first], bc, &ltype);
+        right = left < 0 ? -1 : bc_Operand(chain->items[2 * last], bc, &rtype);
+        if (right < 0)
+            return -1;
+        if (ltype != _float && rtype != _float && ! bc_IsObj(ltype) && ! bc_IsObj(rtype)) {
+            // Jump if not (a op b) is jump if b op' a
+            op = op_Of(chain, first);
+            if (! sense) {
+                switch (op) {
+                    case Lesser: op = GreaterEq; break;
+                    case LesserEq: op = Greater; break;
+                    case Greater: op = LesserEq; break;
+                    case GreaterEq: op = Lesser; break;
+                    case EqEq: op = NotEq; break;
+                    default: op = EqEq; break;
+                }
+            }
+            switch (op) {
+                case Lesser: jump = bc_Ins(bc, VM_JLT, 0, left, right, label); break;
+                case LesserEq: jump = bc_Ins(bc, VM_JLE, 0, left, right, label); break;
+                case Greater: jump = bc_Ins(bc, VM_JLT, 0, right, left, label); break;
+                case GreaterEq: jump = bc_Ins(bc, VM_JLE, 0, right, left, label); break;
+                case EqEq: jump = bc_Ins(bc, VM_JEQ, 0, left, right, label); break;
+                default: jump = bc_Ins(bc, VM_JNE, 0, left, right, label); break;
+            }
+            return jump < 0 ? -1 : 0;
+        }
+        reg = bc_Compare(left, ltype, op_Of(chain, first), right, rtype, bc);
+    }
+    else {
+        reg = bc_Logic(chain, first, last, bc, &type);
+        reg = bc_Truth(reg, type, bc);
+    }
+    if (reg < 0 || bc_Ins(bc, sense ? VM_JNZ : VM_JZ, 0, reg, 0, label) < 0)
+        return -1;
+    return 0;
+}
+
+
+int bc_Cond (struct ParseTree* tree, int sense, int label, struct Bc* bc) {
+    struct BcChain chain;
+    int status;
+
+    if (init_BcChain(&chain, tree, bc) != SUBTREE_OK)
+        return -1;
+    status = bc_Jump(&chain, 0, chain.n - 1, sense, label, bc);
+    free(chain.items);
+    return status;
+}
+
+
+/*
+ * ---------------
+ * Lines
+ * ---------------
+*/
+
+int writes_A (enum VmOp op) {
+    // The instructions that write their register a
+    return op != VM_HALT && op != VM_JMP && op != VM_JZ && op != VM_JNZ && op != VM_JLT &&
+           op != VM_JLE && op != VM_JEQ && op != VM_JNE && op != VM_PRINT;
+}
+
+
+int bc_Assign (struct ParseTree* tree, struct Bc* bc) {
+    /*
+     * A number computed by the last instruction goes straight into the variable:
+     * i = i + 1 is a single VM_ADDI.
+    */
+    struct VmIns* last;
+    int var, reg, vtype, type;
+
+    var = bc_Var(tree->child, bc, &vtype);
+    if (var < 0)
+        return -1;
+    reg = bc_Expr(tree->child->sibling->sibling, bc, &type);
+    if (reg < 0)
+        return -1;
+    if (bc_IsObj(vtype))
+        return bc_Ins(bc, VM_MOVO, 0, var, reg, 0) < 0 ? -1 : 0;
+    if (vtype == _float && type != _float)
+        return bc_Ins(bc, VM_ITOF, 0, var, reg, 0) < 0 ? -1 : 0;
+    last = bc->n > bc->placed ? bc->ins + bc->n - 1 : NULL;
+    if (last != NULL && reg >= BC_TEMP && reg < BC_OTEMP && writes_A(last->op) && last->a == reg) {
+        last->a = var;
+        return 0;
+    }
+    return bc_Ins(bc, VM_MOV, 0, var, reg, 0) < 0 ? -1 : 0;
+}
+
+
+int bc_Input (struct ParseTree* tree, struct Bc* bc) {
+    int var, type;
+
+    var = bc_Var(tree->child->sibling, bc, &type);
+    if (var < 0)
+        return -1;
+    return bc_Ins(bc, VM_READ, type, var, 0, 0) < 0 ? -1 : 0;
+}
+
+
+int bc_Output (struct ParseTree* tree, struct Bc* bc) {
+    int reg, type;
+
+    reg = bc_Obj(tree->child->sibling, bc, &type);
+    if (reg < 0)
+        return -1;
+    return bc_Ins(bc, VM_PRINT, type, reg, 0, 0) < 0 ? -1 : 0;
+}
+
+
+int bc_Lines (struct ParseTree* line, struct Bc* bc) {
+    // Lines up to the end or to the else
+    while (line != NULL && line->data->type != OptElse) {
+        if (bc_Line(line, bc) < 0)
+            return -1;
+        line = line->sibling->sibling;
+    }
+    return 0;
+}
+
+
+int bc_IfLine (struct ParseTree* tree, struct Bc* bc) {
+    struct ParseTree* line;
+    int orelse, end;
+
+    orelse = bc_Label(bc);
+    if (orelse < 0 || bc_Cond(tree->child->sibling->child->sibling, 0, orelse, bc) < 0)
+        return -1;
+    line = tree->child->sibling->sibling->child;
+    if (bc_Lines(line, bc) < 0)
+        return -1;
+
+    while (line != NULL && line->data->type != OptElse)
+        line = line->sibling->sibling;
+    if (line == NULL || line->child->sibling == NULL) {
+        bc_Place(bc, orelse);
+        return 0;
+    }
+    end = bc_Label(bc);
+    if (end < 0 || bc_Ins(bc, VM_JMP, 0, end, 0, 0) < 0)
+        return -1;
+    bc_Place(bc, orelse);
+    if (bc_Lines(line->child->sibling, bc) < 0)
+        return -1;
+    bc_Place(bc, end);
+    return 0;
+}
+
+
+int bc_LoopLine (struct ParseTree* tree, struct Bc* bc) {
+    /*
+     * The condition is after the body: each round runs a single jump, back to the body
+     * while the condition holds. continue goes to the condition.
+    */
+    int body, cond, end, brk, cont;
+
+    body = bc_Label(bc);
+    cond = bc_Label(bc);
+    end = bc_Label(bc);
+    if (end < 0 || bc_Ins(bc, VM_JMP, 0, cond, 0, 0) < 0)
+        return -1;
+    bc_Place(bc, body);
+
+    brk = bc->brk;
+    cont = bc->cont;
+    bc->brk = end;
+    bc->cont = cond;
+    if (bc_Lines(tree->child->sibling->sibling->child, bc) < 0)
+        return -1;
+    bc->brk = brk;
+    bc->cont = cont;
+
+    bc_Place(bc, cond);
+    if (bc_Cond(tree->child->sibling->child->sibling, 1, body, bc) < 0)
+        return -1;
+    bc_Place(bc, end);
+    return 0;
+}
+
+
+int bc_Line (struct ParseTree* tree, struct Bc* bc) {
+    // The temporaries of a line are free again after it
+    struct ParseTree* line;
+    int status;
+
+    line = tree->child;
+    switch (line->data->type) {
+        case Assign: status = bc_Assign(line, bc); break;
+        case Input: status = bc_Input(line, bc); break;
+        case Output: status = bc_Output(line, bc); break;
+        case IfLine: status = bc_IfLine(line, bc); break;
+        case LoopLine: status = bc_LoopLine(line, bc); break;
+        case Break:
+            status = bc->brk < 0 ? bc_Unsupported(line, "break out of a loop") : bc_Ins(bc, VM_JMP, 0, bc->brk, 0, 0);
+            break;
+        case Continue:
+            status = bc->cont < 0 ? bc_Unsupported(line, "continue out of a loop") : bc_Ins(bc, VM_JMP, 0, bc->cont, 0, 0);
+            break;
+        default:
+            status = -1;
+    }
+    bc->temps = 0;
+    bc->otemps = 0;
+    return status < 0 ? -1 : 0;
+}
+
+
+/*
+ * ---------------
+ * The code
+ * ---------------
+*/
+
+int final_Reg (struct Bc* bc, int reg) {
+    switch (reg / BC_KIND) {
+        case 0: return reg;
+        case 1: return bc->nvars + reg - BC_TEMP;
+        case 2: return bc->nvars + bc->maxtemps + reg - BC_OTEMP;
+        default: return bc->nvars + bc->maxtemps + bc->maxotemps + reg - BC_CONST;
+    }
+}
+
+
+struct VmCode* finish_Bytecode (struct Bc* bc) {
+    // Registers and jumps at their place, and the code takes the arrays of bc
+    struct VmCode* code;
+    struct VmIns* ip;
+    struct Symbol* sym;
+    int i;
+
+    code = malloc(sizeof(struct VmCode));
+    if (code == NULL)
+        return NULL;
+    code->nregs = bc->nvars + bc->maxtemps + bc->maxotemps + bc->nconsts;
+    code->is_obj = calloc(code->nregs + 1, 1);
+    if (code->is_obj == NULL) {
+        free(code);
+        return NULL;
+    }
+    for (sym = bc->table->last; sym != NULL; sym = sym->prev)
+        if (sym->id < bc->nids && bc->vars[sym->id] >= 0)
+            code->is_obj[bc->vars[sym->id]] = bc_IsObj(sym->type);
+    memset(code->is_obj + bc->nvars + bc->maxtemps, 1, bc->maxotemps);
+    for (i = 0; i < bc->nconsts; i++)
+        code->is_obj[code->nregs - bc->nconsts + i] = bc_IsObj(bc->const_types[i]);
+
+    for (ip = bc->ins; ip < bc->ins + bc->n; ip++) {
+        switch (ip->op) {
+            case VM_JMP:
+                ip->a = bc->labels[ip->a];
+                continue;
+            case VM_JZ: case VM_JNZ: case VM_JLT: case VM_JLE: case VM_JEQ: case VM_JNE:
+                ip->c = bc->labels[ip->c];
+                break;
+            case VM_LIST:
+                ip->b = final_Reg(bc, ip->b);
+                ip->a = final_Reg(bc, ip->a);
+                continue;
+            default:
+                ip->c = final_Reg(bc, ip->c);
+        }
+        ip->a = final_Reg(bc, ip->a);
+        ip->b = final_Reg(bc, ip->b);
+    }
+
+    code->ins = bc->ins;
+    code->n = bc->n;
+    code->consts = bc->consts;
+    code->const_types = bc->const_types;
+    code->nconsts = bc->nconsts;
+    bc->ins = NULL;
+    bc->consts = NULL;
+    bc->const_types = NULL;
+    bc->nconsts = 0;
+    return code;
+}
+
+
+void free_Bc (struct Bc* bc) {
+    int i;
+
+    for (i = 0; i < bc->nconsts; i++)
+        if (bc->const_types[i] == _string)
+            release_VmObj(bc->consts[i].o);
+    free(bc->ins);
+    free(bc->consts);
+    free(bc->const_types);
+    free(bc->labels);
+    free(bc->vars);
+}
+
+
+struct VmCode* compile_Bytecode (struct ParseTree* root, struct SymbolTable* table) {
+    struct ParseTree* line;
+    struct VmCode* code;
+    struct Symbol* sym;
+    union VmValue value;
+    struct Bc bc;
+    int i;
+
+    if (! root || root->data->type != Program || root->child == NULL)
+        return NULL;
+
+    memset(&bc, 0, sizeof(bc));
+    bc.table = table;
+    bc.brk = bc.cont = -1;
+    bc.nids = 1;
+    for (sym = table->last; sym != NULL; sym = sym->prev)
+        if (sym->id >= bc.nids)
+            bc.nids = sym->id + 1;
+    bc.vars = malloc(bc.nids * sizeof(int));
+    if (bc.vars == NULL)
+        return NULL;
+    for (i = 0; i < bc.nids; i++)
+        bc.vars[i] = -1;
+
+    // Strings and lists are empty until they are written, as in the C program
+    for (sym = table->last; sym != NULL; sym = sym->prev) {
+        if ((sym->type != _string && sym->type != _list) || bc.vars[sym->id] >= 0)
+            continue;
+        bc.vars[sym->id] = bc.nvars++;
+        if (sym->type == _list)
+            bc_Ins(&bc, VM_LIST, sym->list_type >= 0 ? sym->list_type : _int, bc.vars[sym->id], 0, 0);
+        else if ((value.o = new_VmStr("", 0)) == NULL || (i = bc_Const(&bc, _string, value)) < 0)
+            bc.error = MEMORY_ERROR;
+        else
+            bc_Ins(&bc, VM_MOVO, 0, bc.vars[sym->id], i, 0);
+    }
+
+    code = NULL;
+    for (line = bc.error == SUBTREE_OK ? root->child : NULL; line != NULL; line = line->sibling->sibling)
+        if (bc_Line(line, &bc) < 0)
+            break;
+    if (line == NULL && bc.error == SUBTREE_OK && bc_Ins(&bc, VM_HALT, 0, 0, 0, 0) >= 0)
+        code = finish_Bytecode(&bc);
+    free_Bc(&bc);
+    return code;
+}
+
+
+void free_Bytecode (struct VmCode* code) {
+    int i;
+
+    if (code == NULL)
+        return;
+    for (i = 0; i < code->nconsts; i++)
+        if (code->const_types[i] == _string)
+            release_VmObj(code->consts[i].o);
+    free(code->ins);
+    free(code->consts);
+    free(code->const_types);
+    free(code->is_obj);
+    free(code);
+}
@@ -1,5 +1,87 @@
+#ifndef CGEN_H
+#define CGEN_H
+
 #include "parser.h"
 
 #define INDENT_LEV 4
 
+#define WRITE_ERROR 2
+#define NUM_RANGE 3
+
+#ifndef EMIT_FLUSH
+#define EMIT_FLUSH (1 << 20) // bytes an Emitter on a file keeps before writing them
+#endif
+
+/*
+ * Append-only buffer where the code is generated.
+ * Every byte of the output is written once, at its final place.
+ * The indentation is written by the emitter itself, before the first
+ * character of each line: the cgen functions only change `indent`.
+ * With a file descriptor, the buffer is written out at the end of a line
+ * once it holds EMIT_FLUSH bytes: only a piece of the code is in memory.
+*/
+struct Emitter {
+    char* buf;
+    size_t len;
+    size_t cap;
+    int fd; // -1 to keep the whole code in buf
+    size_t written; // bytes already written to fd
+    size_t line; // start of the current line in buf
+    int indent; // spaces at the start of the next lines
+    int bol; // at the beginning of a line, indentation not written yet
+    int error; // MEMORY_ERROR or WRITE_ERROR, once the buffer could not grow or be written
+};
+
+int init_Emitter (struct Emitter* out, int fd);
+int flush_Emitter (struct Emitter* out);
+void emit_Mem (struct Emitter* out, const char* s, size_t n);
+void emit_Str (struct Emitter* out, const char* s);
+void emit_Char (struct Emitter* out, char c);
+void emit_Newline (struct Emitter* out);
+
+// Numbers and operators that are written the same in the other targets
+int cgen_Num (struct ParseTree* tree, struct Emitter* out);
+const char* cgen_Op (struct ParseTree* tree);
+
+/*
+ * The value of a Num, from the same text as the one of the Python code: into *f if
+ * *is_float (the literal has a fraction or an exponent, as the semantic analysis types it),
+ * into *i otherwise. Return SUBTREE_OK, NUM_RANGE when a C number cannot hold it
+ * (the value is then the closest one), PARSING_ERROR or MEMORY_ERROR.
+*/
+int num_Literal (struct ParseTree* tree, double* f, long long* i, int* is_float);
+
+/*
+ * Expr chains are grouped as Python groups the generated code: `or` is looser than `and`,
+ * that is looser than the comparisons, and a < b < c is a < b and b < c.
+ * The other targets take the groups from here.
+ * chain_Items returns the operands of a chain at the even places and its operators
+ * in between, with *n operands, or NULL if out of memory. The caller must free it.
+ * chain_Level is the level of the loosest operator between the operands first and last,
+ * where their range splits: 2 also for a single operand.
+ * chain_Group is the last operand of the group that starts at from, when the range splits at level.
+*/
+int cond_Level (enum TokenType op);
+struct ParseTree** chain_Items (struct ParseTree* tree, int* n);
+int chain_Level (struct ParseTree** items, int first, int last);
+int chain_Group (struct ParseTree** items, int from, int last, int level);
+
+/*
+ * Open the file (or take the standard output if fileName is "-") and let gen(ctx, out) write into it.
+ * On error the file is removed. The bytes written are stored in *written, if not NULL.
+ * Return SUBTREE_OK, PARSING_ERROR, MEMORY_ERROR or WRITE_ERROR.
+*/
+int emit_ToFile (const char *fileName, size_t *written, int (*gen)(void*, struct Emitter*), void *ctx);
+
+/*
+ * Return the Python code of the program as a NUL-terminated string,
+ * or NULL on error. The caller must free the result.
+*/
 char* code_gen (struct ParseTree *root);
+
+/*
+ * Generate the Python code straight into the file, with emit_ToFile.
+*/
+int code_gen_ToFile (struct ParseTree *root, const char *fileName, size_t *written);
+
+#endif
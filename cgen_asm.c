@@ -0,0 +1,1641 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "cgen_asm.h"
+#include "log.h"
+
+
+struct VReg {
+    char isfloat; // in a xmm register
+    char isvar; // holds a variable of the program, not a temporary
+    int start, end; // first and last instruction that use it, for the linear scan
+    int loc; // machine register (>= 0) or stack slot (-1 - slot) once allocated
+};
+
+/*
+ * The program being lowered: its instructions, and what they refer to.
+ * The lowering functions that give a register return -1 on error.
+*/
+struct AsmCode {
+    struct AsmIns* ins;
+    int n, cap;
+    struct VReg* regs;
+    int nregs, capregs;
+    int* vars; // register of each identifier id, -1 if it has none yet
+    int nvars;
+    double* floats; // constants of A_MOVF
+    int nfloats, capfloats;
+    char** strs; // NUL-terminated constants of A_PRINTSTR
+    int nstrs, capstrs;
+    int (*loops)[2]; // first and last instruction of each loop, the inner ones first
+    int nloops, caploops;
+    int nlabels;
+    int brk, cont; // labels of the innermost loop, -1 outside of loops
+    int slots; // stack slots of the spilled registers
+    int error; // MEMORY_ERROR once an array could not grow
+    struct SymbolTable* table;
+};
+
+
+int lower_Expr (struct ParseTree* tree, struct AsmCode* code);
+int lower_Operand (struct ParseTree* tree, struct AsmCode* code);
+int lower_Cond (struct ParseTree* tree, int label, struct AsmCode* code);
+int lower_Line (struct ParseTree* tree, struct AsmCode* code);
+
+
+// Registers the linear scan hands out. The others are scratch for the instructions and the runtime
+const char* int_Regs[] = {"%rbx", "%rcx", "%rsi", "%r8", "%r9", "%r10", "%r12", "%r13", "%r14", "%r15"};
+const char* float_Regs[] = {"%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6",
+                            "%xmm7", "%xmm8", "%xmm9", "%xmm10", "%xmm11", "%xmm12", "%xmm13"};
+#define N_INT_REGS ((int) (sizeof(int_Regs) / sizeof(int_Regs[0])))
+#define N_FLOAT_REGS ((int) (sizeof(float_Regs) / sizeof(float_Regs[0])))
+
+
+/*
+ * The runtime, written after the code. It reads and writes through its own buffers
+ * with the system calls of Linux: no C library. Its functions take their argument in %rdi,
+ * return in %rax and keep every other register but the flags.
+*/
+const char* runtime_Asm =
+    "rt_exit:\n"
+    "    call rt_flush\n"
+    "    movl $60, %eax\n"
+    "    xorl %edi, %edi\n"
+    "    syscall\n"
+    "\n"
+    "rt_flush:\n"
+    "    pushq %rcx\n"
+    "    pushq %rdx\n"
+    "    pushq %rsi\n"
+    "    pushq %rdi\n"
+    "    pushq %r11\n"
+    "    leaq rt_out(%rip), %rsi\n"
+    "    movq rt_outlen(%rip), %rdx\n"
+    "1:  testq %rdx, %rdx\n"
+    "    je 2f\n"
+    "    movl $1, %eax\n"
+    "    movl $1, %edi\n"
+    "    syscall\n"
+    "    cmpq $-4, %rax\n"
+    "    je 1b\n"
+    "    testq %rax, %rax\n"
+    "    jle 3f\n"
+    "    addq %rax, %rsi\n"
+    "    subq %rax, %rdx\n"
+    "    jmp 1b\n"
+    "2:  movq $0, rt_outlen(%rip)\n"
+    "    popq %r11\n"
+    "    popq %rdi\n"
+    "    popq %rsi\n"
+    "    popq %rdx\n"
+    "    popq %rcx\n"
+    "    ret\n"
+    "3:  movl $60, %eax\n"
+    "    movl $1, %edi\n"
+    "    syscall\n"
+    "\n"
+    "rt_putc:\n"
+    "    movq rt_outlen(%rip), %rax\n"
+    "    cmpq $65536, %rax\n"
+    "    jb 1f\n"
+    "    call rt_flush\n"
+    "    xorl %eax, %eax\n"
+    "1:  pushq %rcx\n"
+    "    leaq rt_out(%rip), %rcx\n"
+    "    movb %dil, (%rcx,%rax)\n"
+    "    popq %rcx\n"
+    "    incq %rax\n"
+    "    movq %rax, rt_outlen(%rip)\n"
+    "    ret\n"
+    "\n"
+    "rt_print_str:\n"
+    "    pushq %rsi\n"
+    "    movq %rdi, %rsi\n"
+    "1:  movzbl (%rsi), %edi\n"
+    "    testl %edi, %edi\n"
+    "    je 2f\n"
+    "    call rt_putc\n"
+    "    incq %rsi\n"
+    "    jmp 1b\n"
+    "2:  popq %rsi\n"
+    "    ret\n"
+    "\n"
+    "rt_print_bool:\n"
+    "    testq %rdi, %rdi\n"
+    "    leaq rt_false(%rip), %rdi\n"
+    "    je rt_print_str\n"
+    "    leaq rt_true(%rip), %rdi\n"
+    "    jmp rt_print_str\n"
+    "\n"
+    "rt_print_int:\n"
+    "    pushq %rcx\n"
+    "    pushq %rdx\n"
+    "    pushq %rsi\n"
+    "    subq $32, %rsp\n"
+    "    movq %rdi, %rax\n"
+    "    testq %rax, %rax\n"
+    "    jns 1f\n"
+    "    movl $45, %edi\n"
+    "    pushq %rax\n"
+    "    call rt_putc\n"
+    "    popq %rax\n"
+    "    negq %rax\n"
+    "1:  leaq 32(%rsp), %rsi\n"
+    "    movl $10, %ecx\n"
+    "2:  xorl %edx, %edx\n"
+    "    divq %rcx\n"
+    "    addl $48, %edx\n"
+    "    decq %rsi\n"
+    "    movb %dl, (%rsi)\n"
+    "    testq %rax, %rax\n"
+    "    jne 2b\n"
+    "3:  movzbl (%rsi), %edi\n"
+    "    call rt_putc\n"
+    "    incq %rsi\n"
+    "    leaq 32(%rsp), %rax\n"
+    "    cmpq %rax, %rsi\n"
+    "    jb 3b\n"
+    "    addq $32, %rsp\n"
+    "    popq %rsi\n"
+    "    popq %rdx\n"
+    "    popq %rcx\n"
+    "    ret\n"
+    "\n"
+    "rt_getc:\n"
+    "    movq rt_inpos(%rip), %rax\n"
+    "    cmpq rt_inlen(%rip), %rax\n"
+    "    jb 2f\n"
+    "    pushq %rcx\n"
+    "    pushq %rdx\n"
+    "    pushq %rsi\n"
+    "    pushq %rdi\n"
+    "    pushq %r11\n"
+    "1:  xorl %eax, %eax\n"
+    "    xorl %edi, %edi\n"
+    "    leaq rt_in(%rip), %rsi\n"
+    "    movl $65536, %edx\n"
+    "    syscall\n"
+    "    cmpq $-4, %rax\n"
+    "    je 1b\n"
+    "    popq %r11\n"
+    "    popq %rdi\n"
+    "    popq %rsi\n"
+    "    popq %rdx\n"
+    "    popq %rcx\n"
+    "    testq %rax, %rax\n"
+    "    jg 3f\n"
+    "    movq $-1, %rax\n"
+    "    ret\n"
+    "3:  movq %rax, rt_inlen(%rip)\n"
+    "    xorl %eax, %eax\n"
+    "2:  pushq %rcx\n"
+    "    movq %rax, %rcx\n"
+    "    incq %rax\n"
+    "    movq %rax, rt_inpos(%rip)\n"
+    "    leaq rt_in(%rip), %rax\n"
+    "    movzbq (%rax,%rcx), %rax\n"
+    "    popq %rcx\n"
+    "    ret\n"
+    "\n"
+    "rt_read_int:\n"
+    "    # int(input()): blanks around, a sign, digits. %rdx is 0 before the number,\n"
+    "    # 1 after the sign, 2 in the digits and 3 after them\n"
+    "    pushq %rcx\n"
+    "    pushq %rdx\n"
+    "    pushq %rsi\n"
+    "    pushq %r8\n"
+    "    xorl %r8d, %r8d\n"
+    "    xorl %esi, %esi\n"
+    "    xorl %edx, %edx\n"
+    "    xorl %ecx, %ecx\n"
+    "1:  call rt_getc\n"
+    "    cmpq $-1, %rax\n"
+    "    je 8f\n"
+    "    incq %rcx\n"
+    "    cmpq $10, %rax\n"
+    "    je 9f\n"
+    "    cmpq $32, %rax\n"
+    "    je 5f\n"
+    "    cmpq $9, %rax\n"
+    "    je 5f\n"
+    "    cmpq $13, %rax\n"
+    "    je 5f\n"
+    "    cmpq $2, %rdx\n"
+    "    ja rt_value_error\n"
+    "    leaq -48(%rax), %rdi\n"
+    "    cmpq $9, %rdi\n"
+    "    jbe 6f\n"
+    "    testq %rdx, %rdx\n"
+    "    jne rt_value_error\n"
+    "    movl $1, %edx\n"
+    "    cmpq $43, %rax\n"
+    "    je 1b\n"
+    "    cmpq $45, %rax\n"
+    "    jne rt_value_error\n"
+    "    movl $1, %esi\n"
+    "    jmp 1b\n"
+    "5:  cmpq $1, %rdx\n"
+    "    je rt_value_error\n"
+    "    cmpq $2, %rdx\n"
+    "    jne 1b\n"
+    "    movl $3, %edx\n"
+    "    jmp 1b\n"
+    "6:  movl $2, %edx\n"
+    "    imulq $10, %r8\n"
+    "    addq %rdi, %r8\n"
+    "    jmp 1b\n"
+    "8:  testq %rcx, %rcx\n"
+    "    je rt_eof_error\n"
+    "9:  cmpq $2, %rdx\n"
+    "    jb rt_value_error\n"
+    "    movq %r8, %rax\n"
+    "    testq %rsi, %rsi\n"
+    "    je 7f\n"
+    "    negq %rax\n"
+    "7:  popq %r8\n"
+    "    popq %rsi\n"
+    "    popq %rdx\n"
+    "    popq %rcx\n"
+    "    ret\n"
+    "\n"
+    "rt_read_bool:\n"
+    "    # bool(input()): true if the line is not empty\n"
+    "    pushq %rcx\n"
+    "    pushq %rdx\n"
+    "    xorl %ecx, %ecx\n"
+    "    xorl %edx, %edx\n"
+    "1:  call rt_getc\n"
+    "    cmpq $-1, %rax\n"
+    "    je 8f\n"
+    "    incq %rcx\n"
+    "    cmpq $10, %rax\n"
+    "    je 9f\n"
+    "    incq %rdx\n"
+    "    jmp 1b\n"
+    "8:  testq %rcx, %rcx\n"
+    "    je rt_eof_error\n"
+    "9:  xorl %eax, %eax\n"
+    "    testq %rdx, %rdx\n"
+    "    setne %al\n"
+    "    popq %rdx\n"
+    "    popq %rcx\n"
+    "    ret\n"
+    "\n"
+    "rt_error:\n"
+    "    # write the message in %rdi on the standard error and exit with 1\n"
+    "    call rt_flush\n"
+    "    movq %rdi, %rsi\n"
+    "    movq %rdi, %rdx\n"
+    "1:  cmpb $0, (%rdx)\n"
+    "    je 2f\n"
+    "    incq %rdx\n"
+    "    jmp 1b\n"
+    "2:  subq %rsi, %rdx\n"
+    "    movl $1, %eax\n"
+    "    movl $2, %edi\n"
+    "    syscall\n"
+    "    movl $60, %eax\n"
+    "    movl $1, %edi\n"
+    "    syscall\n"
+    "rt_zero_div:\n"
+    "    leaq rt_msg_zero(%rip), %rdi\n"
+    "    jmp rt_error\n"
+    "rt_float_zero_div:\n"
+    "    leaq rt_msg_fzero(%rip), %rdi\n"
+    "    jmp rt_error\n"
+    "rt_value_error:\n"
+    "    leaq rt_msg_value(%rip), %rdi\n"
+    "    jmp rt_error\n"
+    "rt_eof_error:\n"
+    "    leaq rt_msg_eof(%rip), %rdi\n"
+    "    jmp rt_error\n"
+    "\n"
+    "    .section .rodata\n"
+    "rt_true: .asciz \"True\"\n"
+    "rt_false: .asciz \"False\"\n"
+    "rt_msg_zero: .asciz \"ZeroDivisionError: integer division or modulo by zero\\n\"\n"
+    "rt_msg_fzero: .asciz \"ZeroDivisionError: float division by zero\\n\"\n"
+    "rt_msg_value: .asciz \"ValueError: invalid literal for int()\\n\"\n"
+    "rt_msg_eof: .asciz \"EOFError: EOF when reading a line\\n\"\n"
+    "\n"
+    "    .bss\n"
+    "    .balign 8\n"
+    "rt_outlen: .skip 8\n"
+    "rt_inpos: .skip 8\n"
+    "rt_inlen: .skip 8\n"
+    "rt_out: .skip 65536\n"
+    "rt_in: .skip 65536\n"
+    "\n"
+    "    .section .note.GNU-stack,\"\",@progbits\n";
+
+
+/*
+ * ---------------
+ * Instruction list
+ * ---------------
+*/
+
+int grow_Array (void** array, int* cap, int n, size_t size) {
+    // Room for one more element, doubling the array. Return 1 on memory error
+    void* tmp;
+    int newcap;
+
+    if (n < *cap)
+        return 0;
+    newcap = *cap > 0 ? 2 * *cap : 64;
+    tmp = realloc(*array, newcap * size);
+    if (tmp == NULL)
+        return 1;
+    *array = tmp;
+    *cap = newcap;
+    return 0;
+}
+
+
+
+
+int new_Reg (struct AsmCode* code, int isfloat) {
+    struct VReg* reg;
+
+    if (grow_Array((void**) &code->regs, &code->capregs, code->nregs, sizeof(struct VReg))) {
+        code->error = MEMORY_ERROR;
+        return -1;
+    }
+    reg = code->regs + code->nregs;
+    reg->isfloat = isfloat;
+    reg->isvar = 0;
+    reg->start = reg->end = -1;
+    reg->loc = 0;
+    return code->nregs++;
+}
+
+
+int add_Ins (struct AsmCode* code, enum AsmOp op, int dst, int a, int b, long long imm) {
+    // Append an instruction, return its index or -1
+    struct AsmIns* ins;
+
+    if (grow_Array((void**) &code->ins, &code->cap, code->n, sizeof(struct AsmIns))) {
+        code->error = MEMORY_ERROR;
+        return -1;
+    }
+    ins = code->ins + code->n;
+    ins->op = op;
+    ins->dst = dst;
+    ins->a = a;
+    ins->b = b;
+    ins->imm = imm;
+    ins->cond = UNK;
+    ins->label = -1;
+    return code->n++;
+}
+
+
+int add_Jump (struct AsmCode* code, enum AsmOp op, int a, int label) {
+    // A_JMP, A_JZ, A_JNZ or A_LABEL
+    int i;
+
+    i = add_Ins(code, op, -1, a, -1, 0);
+    if (i >= 0)
+        code->ins[i].label = label;
+    return i;
+}
+
+
+int add_Cond (struct AsmCode* code, enum AsmOp op, enum TokenType cond, int dst, int a, int b, long long imm) {
+    int i;
+
+    i = add_Ins(code, op, dst, a, b, imm);
+    if (i >= 0)
+        code->ins[i].cond = cond;
+    return i;
+}
+
+
+int add_Float (struct AsmCode* code, double value) {
+    if (grow_Array((void**) &code->floats, &code->capfloats, code->nfloats, sizeof(double))) {
+        code->error = MEMORY_ERROR;
+        return -1;
+    }
+    code->floats[code->nfloats] = value;
+    return code->nfloats++;
+}
+
+
+int add_Str (struct AsmCode* code, const char* s, size_t len) {
+    char* copy;
+
+    if (grow_Array((void**) &code->strs, &code->capstrs, code->nstrs, sizeof(char*))) {
+        code->error = MEMORY_ERROR;
+        return -1;
+    }
+    copy = malloc(len + 1);
+    if (copy == NULL) {
+        code->error = MEMORY_ERROR;
+        return -1;
+    }
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    code->strs[code->nstrs] = copy;
+    return code->nstrs++;
+}
+
+
+int unsupported (struct ParseTree* tree, const char* what) {
+    log_Offset(LOG_ERROR, node_Offset(tree), "the asm target does not support %s", what);
+    return -1;
+}
+
+
+/*
+ * ---------------
+ * Lowering
+ * ---------------
+*/
+
+int int_Literal (struct ParseTree* tree, struct AsmCode* code, long long* value) {
+    // 1 if the operand is only an int literal that fits an immediate, with its value
+    double f;
+    int isfloat;
+
+    while (tree->child != NULL && tree->child->sibling == NULL &&
+           (tree->data->type == Expr || tree->data->type == Pred ||
+            tree->data->type == Term || tree->data->type == BaseExpr))
+        tree = tree->child;
+    if (tree->data->type != Obj || tree->child->data->type != Num || type_Of(tree, code->table) != _int)
+        return 0;
+    if (num_Literal(tree->child, &f, value, &isfloat) != SUBTREE_OK || isfloat)
+        return 0;
+    return *value >= -2147483648LL && *value <= 2147483647LL;
+}
+
+
+int var_Reg (struct ParseTree* var, struct AsmCode* code) {
+    // The register of a variable: the same one for its whole life
+    struct Symbol* sym;
+    int reg;
+
+    sym = search_symbol(code->table, var->data->id);
+    if (sym == NULL)
+        return -1;
+    if (sym->type != _int && sym->type != _float && sym->type != _bool)
+        return unsupported(var, "strings and lists");
+    if (var->data->id >= code->nvars)
+        return -1;
+    if (code->vars[var->data->id] < 0) {
+        reg = new_Reg(code, sym->type == _float);
+        if (reg < 0)
+            return -1;
+        code->regs[reg].isvar = 1;
+        code->vars[var->data->id] = reg;
+    }
+    return code->vars[var->data->id];
+}
+
+
+int lower_Obj (struct ParseTree* tree, struct AsmCode* code) {
+    struct ParseTree* obj;
+    long long i;
+    double f;
+    int reg, k, isfloat;
+
+    obj = tree->child;
+    switch (obj->data->type) {
+        case Var:
+            return var_Reg(obj, code);
+        case Bool:
+            reg = new_Reg(code, 0);
+            if (reg < 0 || add_Ins(code, A_MOVI, reg, -1, -1, obj->data->len == 4) < 0)
+                return -1;
+            return reg;
+        case Num:
+            k = num_Literal(obj, &f, &i, &isfloat);
+            if (k != SUBTREE_OK && k != NUM_RANGE)
+                return -1;
+            if (! isfloat) {
+                reg = new_Reg(code, 0);
+                if (reg < 0 || add_Ins(code, A_MOVI, reg, -1, -1, i) < 0)
+                    return -1;
+                return reg;
+            }
+            k = add_Float(code, f);
+            reg = new_Reg(code, 1);
+            if (k < 0 || reg < 0 || add_Ins(code, A_MOVF, reg, -1, -1, k) < 0)
+                return -1;
+            return reg;
+        case Str:
+            return unsupported(obj, "strings out of writeOut");
+        default:
+            return unsupported(obj, "lists and Null");
+    }
+}
+
+
+int to_Float (int reg, int type, struct AsmCode* code) {
+    int dst;
+
+    if (type == _float)
+        return reg;
+    dst = new_Reg(code, 1);
+    if (dst < 0 || add_Ins(code, A_CVT, dst, reg, -1, 0) < 0)
+        return -1;
+    return dst;
+}
+
+
+int lower_Aritm (struct ParseTree* tree, struct AsmCode* code) {
+    /*
+     * Term and Pred: operand (op operand)*, from the left.
+     * An int literal on the right is an immediate, so `i + 1` takes no register.
+    */
+    struct ParseTree *child, *op;
+    enum AsmOp aop;
+    int left, right, ltype, rtype, dst;
+    long long imm;
+
+    child = tree->child;
+    left = lower_Operand(child, code);
+    ltype = type_Of(child, code->table);
+    while (left >= 0 && child->sibling != NULL) {
+        op = child->sibling;
+        child = op->sibling;
+        rtype = type_Of(child, code->table);
+
+        if (ltype == _float || rtype == _float || op->data->type == FloatDiv) {
+            switch (op->data->type) {
+                case Plus: aop = A_FADD; break;
+                case Minus: aop = A_FSUB; break;
+                case Star: aop = A_FMUL; break;
+                case Div: case FloatDiv: aop = A_FDIV; break;
+                default: return unsupported(op, "% on floats");
+            }
+            left = to_Float(left, ltype, code);
+            right = lower_Operand(child, code);
+            if (left < 0 || right < 0)
+                return -1;
+            right = to_Float(right, rtype, code);
+            dst = new_Reg(code, 1);
+            if (right < 0 || dst < 0 || add_Ins(code, aop, dst, left, right, 0) < 0)
+                return -1;
+            left = dst;
+            ltype = _float;
+            continue;
+        }
+
+        switch (op->data->type) {
+            case Plus: aop = A_ADD; break;
+            case Minus: aop = A_SUB; break;
+            case Star: aop = A_MUL; break;
+            case Div: aop = A_DIV; break;
+            case Percent: aop = A_MOD; break;
+            default: return -1;
+        }
+        if (int_Literal(child, code, &imm))
+            right = -1;
+        else if ((right = lower_Operand(child, code)) < 0)
+            return -1;
+        dst = new_Reg(code, 0);
+        if (dst < 0 || add_Ins(code, aop, dst, left, right, imm) < 0)
+            return -1;
+        left = dst;
+    }
+    return left;
+}
+
+
+int lower_Operand (struct ParseTree* tree, struct AsmCode* code) {
+    switch (tree->data->type) {
+        case Pred: case Term:
+            return lower_Aritm(tree, code);
+        case BaseExpr:
+            if (tree->child->data->type == Obj)
+                return lower_Obj(tree->child, code);
+            return lower_Expr(tree->child->sibling, code); // ( Expr )
+        default:
+            return -1;
+    }
+}
+
+
+struct AsmChain {
+    struct ParseTree** items; // operands at the even places, operators in between
+    int* types; // type of each operand
+    int n; // operands
+};
+
+
+void free_AsmChain (struct AsmChain* chain) {
+    free(chain->items);
+    free(chain->types);
+}
+
+
+int init_AsmChain (struct AsmChain* chain, struct ParseTree* tree, struct AsmCode* code) {
+    int i;
+
+    chain->items = chain_Items(tree, &chain->n);
+    chain->types = chain->items == NULL ? NULL : malloc(chain->n * sizeof(int));
+    if (chain->types == NULL) {
+        free_AsmChain(chain);
+        code->error = MEMORY_ERROR;
+        return MEMORY_ERROR;
+    }
+    for (i = 0; i < chain->n; i++)
+        chain->types[i] = type_Of(chain->items[2 * i], code->table);
+    return SUBTREE_OK;
+}
+
+
+int is_Number (int type) {
+    // bool compares as a number, as in Python
+    return type == _int || type == _float || type == _bool;
+}
+
+
+int lower_Truth (int reg, int type, struct AsmCode* code) {
+    // The operand of and, or as a bool
+    int dst, zero, k;
+
+    if (type == _bool)
+        return reg;
+    dst = new_Reg(code, 0);
+    if (dst < 0)
+        return -1;
+    if (type == _int) {
+        if (add_Cond(code, A_CMP, NotEq, dst, reg, -1, 0) < 0)
+            return -1;
+        return dst;
+    }
+    k = add_Float(code, 0.0);
+    zero = new_Reg(code, 1);
+    if (k < 0 || zero < 0 || add_Ins(code, A_MOVF, zero, -1, -1, k) < 0 ||
+        add_Cond(code, A_FCMP, NotEq, dst, reg, zero, 0) < 0)
+        return -1;
+    return dst;
+}
+
+
+int lower_Compare (struct AsmChain* chain, int k, struct AsmCode* code) {
+    // The k-th operand compared with the next one
+    struct ParseTree* op;
+    int left, right, dst, isfloat;
+    long long imm;
+
+    op = chain->items[2 * k + 1];
+    if (! is_Number(chain->types[k]) || ! is_Number(chain->types[k + 1]))
+        return unsupported(op, "comparisons of strings and lists");
+    isfloat = chain->types[k] == _float || chain->types[k + 1] == _float;
+
+    left = lower_Operand(chain->items[2 * k], code);
+    if (left < 0)
+        return -1;
+    if (! isfloat && int_Literal(chain->items[2 * k + 2], code, &imm))
+        right = -1;
+    else if ((right = lower_Operand(chain->items[2 * k + 2], code)) < 0)
+        return -1;
+    if (isfloat) {
+        left = to_Float(left, chain->types[k], code);
+        right = to_Float(right, chain->types[k + 1], code);
+        if (left < 0 || right < 0)
+            return -1;
+    }
+    dst = new_Reg(code, 0);
+    if (dst < 0 || add_Cond(code, isfloat ? A_FCMP : A_CMP, op->data->type, dst, left, right, imm) < 0)
+        return -1;
+    return dst;
+}
+
+
+int lower_Logic (struct AsmChain* chain, int first, int last, struct AsmCode* code) {
+    /*
+     * The value of the operands from first to last, split as chain_Level says.
+     * and, or stop as soon as the result is known, and a chain of comparisons
+     * at its first false one.
+    */
+    int k, from, dst, part, end, level;
+
+    level = chain_Level(chain->items, first, last);
+    if (level == 2 && first == last)
+        return lower_Operand(chain->items[2 * first], code);
+
+    dst = new_Reg(code, 0);
+    if (dst < 0)
+        return -1;
+    end = code->nlabels++;
+    for (from = first; from <= last; from = k + 1) {
+        k = chain_Group(chain->items, from, last, level);
+        if (level == 2 && k == last)
+            break;
+        if (from > first && add_Jump(code, level == 0 ? A_JNZ : A_JZ, dst, end) < 0)
+            return -1;
+        if (level == 2)
+            part = lower_Compare(chain, k, code);
+        else {
+            part = lower_Logic(chain, from, k, code);
+            if (part >= 0 && from == k)
+                part = lower_Truth(part, chain->types[k], code);
+        }
+        if (part < 0 || add_Ins(code, A_MOV, dst, part, -1, 0) < 0)
+            return -1;
+    }
+    if (add_Jump(code, A_LABEL, -1, end) < 0)
+        return -1;
+    return dst;
+}
+
+
+int lower_Expr (struct ParseTree* tree, struct AsmCode* code) {
+    struct AsmChain chain;
+    int reg;
+
+    if (tree->child->sibling == NULL)
+        return lower_Operand(tree->child, code);
+    if (init_AsmChain(&chain, tree, code) != SUBTREE_OK)
+        return -1;
+    reg = lower_Logic(&chain, 0, chain.n - 1, code);
+    free_AsmChain(&chain);
+    return reg;
+}
+
+
+enum TokenType negate_Cond (enum TokenType cond) {
+    switch (cond) {
+        case Lesser: return GreaterEq;
+        case GreaterEq: return Lesser;
+        case Greater: return LesserEq;
+        case LesserEq: return Greater;
+        case EqEq: return NotEq;
+        default: return EqEq;
+    }
+}
+
+
+struct ParseTree* inner_Expr (struct ParseTree* tree) {
+    // The Expr of an operand that is only ( Expr ), or NULL
+    while (tree->child != NULL && tree->child->sibling == NULL &&
+           (tree->data->type == Pred || tree->data->type == Term))
+        tree = tree->child;
+    if (tree->data->type == BaseExpr && tree->child->data->type == Lpar)
+        return tree->child->sibling;
+    return NULL;
+}
+
+
+int cond_Range (struct AsmChain* chain, int first, int last, int label, struct AsmCode* code) {
+    /*
+     * Jump to label if the operands from first to last are false.
+     * An `and` is a jump for each part, a comparison of ints is a single compare and jump:
+     * no bool is made for the conditions of if and while.
+    */
+    struct ParseTree* inner;
+    int k, from, reg, left, right, level;
+    long long imm;
+
+    level = chain_Level(chain->items, first, last);
+    if (level == 1) {
+        for (from = first; from <= last; from = k + 1) {
+            k = chain_Group(chain->items, from, last, level);
+            if (cond_Range(chain, from, k, label, code) < 0)
+                return -1;
+        }
+        return 0;
+    }
+    if (first == last && (inner = inner_Expr(chain->items[2 * first])) != NULL)
+        return lower_Cond(inner, label, code);
+    else if (level == 2 && last == first + 1 && chain->types[first] != _float && chain->types[last] != _float &&
+             is_Number(chain->types[first]) && is_Number(chain->types[last])) {
+        left = lower_Operand(chain->items[2 * first], code);
+        if (left < 0)
+            return -1;
+        if (int_Literal(chain->items[2 * last], code, &imm))
+            right = -1;
+        else if ((right = lower_Operand(chain->items[2 * last], code)) < 0)
+            return -1;
+        k = add_Cond(code, A_BR, negate_Cond(chain->items[2 * first + 1]->data->type), -1, left, right, imm);
+        if (k < 0)
+            return -1;
+        code->ins[k].label = label;
+        return 0;
+    }
+
+    reg = lower_Logic(chain, first, last, code);
+    if (reg >= 0 && first == last)
+        reg = lower_Truth(reg, chain->types[first], code);
+    if (reg < 0 || add_Jump(code, A_JZ, reg, label) < 0)
+        return -1;
+    return 0;
+}
+
+
+int lower_Cond (struct ParseTree* tree, int label, struct AsmCode* code) {
+    struct AsmChain chain;
+    int status;
+
+    if (init_AsmChain(&chain, tree, code) != SUBTREE_OK)
+        return -1;
+    status = cond_Range(&chain, 0, chain.n - 1, label, code);
+    free_AsmChain(&chain);
+    return status;
+}
+
+
+int lower_Assign (struct ParseTree* tree, struct AsmCode* code) {
+    /*
+     * The last instruction of the expression writes straight into the variable,
+     * when it made a new temporary: x = x + 1 is a single A_ADD.
+    */
+    struct AsmIns* last;
+    int var, reg, mark;
+
+    var = var_Reg(tree->child, code);
+    if (var < 0)
+        return -1;
+    mark = code->nregs;
+    reg = lower_Expr(tree->child->sibling->sibling, code);
+    if (reg < 0)
+        return -1;
+    last = code->n > 0 ? code->ins + code->n - 1 : NULL;
+    if (reg >= mark && last != NULL && last->dst == reg && last->op != A_LABEL) {
+        last->dst = var;
+        return 0;
+    }
+    return add_Ins(code, A_MOV, var, reg, -1, 0) < 0 ? -1 : 0;
+}
+
+
+int lower_Input (struct ParseTree* tree, struct AsmCode* code) {
+    int var;
+
+    if (tree->child->data->id != ID_READINT && tree->child->data->id != ID_READBOOL)
+        return unsupported(tree, "readFloat and readStr");
+    var = var_Reg(tree->child->sibling, code);
+    if (var < 0)
+        return -1;
+    if (tree->child->data->id == ID_READINT)
+        return add_Ins(code, A_READINT, var, -1, -1, 0) < 0 ? -1 : 0;
+    return add_Ins(code, A_READBOOL, var, -1, -1, 0) < 0 ? -1 : 0;
+}
+
+
+size_t unescape_Str (const char* s, size_t len, char* out) {
+    // The bytes of a Python literal. Unknown escapes keep their backslash, as in Python
+    static const char* from = "ntr\\'\"abfv";
+    static const char* to = "\n\t\r\\'\"\a\b\f\v";
+    const char* c;
+    size_t i, n;
+
+    n = 0;
+    for (i = 0; i < len; i++) {
+        if (s[i] == '\\' && i + 1 < len && (c = strchr(from, s[i + 1])) != NULL) {
+            out[n++] = to[c - from];
+            i++;
+        }
+        else
+            out[n++] = s[i];
+    }
+    return n;
+}
+
+
+int lower_PrintObj (struct ParseTree* obj, struct AsmCode* code) {
+    // str() of an int or bool Obj, without newline
+    int reg, type;
+
+    type = type_Of(obj, code->table);
+    if (type == _float)
+        return unsupported(obj, "writing floats");
+    if (type != _int && type != _bool)
+        return unsupported(obj, "writing strings and lists out of literals");
+    reg = lower_Obj(obj, code);
+    if (reg < 0)
+        return -1;
+    return add_Ins(code, type == _int ? A_PRINTINT : A_PRINTBOOL, -1, reg, -1, 0) < 0 ? -1 : 0;
+}
+
+
+int lower_QuotedStr (struct ParseTree* tree, struct AsmCode* code) {
+    /*
+     * "a %s b", x  is written as "a ", x, " b". Without arguments % is only a character.
+    */
+    struct ParseTree *lit, *arg;
+    const char* s;
+    char* bytes;
+    size_t len, i, n;
+    int k;
+
+    lit = tree->child;
+    arg = lit->sibling == NULL ? NULL : lit->sibling->sibling;
+    s = lit->data->lexeme + 1; // without the quotes
+    len = lit->data->len - 2;
+    bytes = malloc(len + 1);
+    if (bytes == NULL) {
+        code->error = MEMORY_ERROR;
+        return -1;
+    }
+    n = 0;
+    for (i = 0; i <= len; i++) {
+        if (i < len && (lit->sibling == NULL || s[i] != '%')) {
+            bytes[n++] = s[i];
+            continue;
+        }
+        if (i + 1 < len && s[i + 1] == '%') {
+            bytes[n++] = '%';
+            i++;
+            continue;
+        }
+        // %s or the end: what comes before is written first
+        n = unescape_Str(bytes, n, bytes);
+        if (n > 0 && ((k = add_Str(code, bytes, n)) < 0 || add_Ins(code, A_PRINTSTR, -1, -1, -1, k) < 0)) {
+            free(bytes);
+            return -1;
+        }
+        n = 0;
+        if (i < len && s[i + 1] == 's' && arg != NULL) {
+            if (lower_PrintObj(arg, code) < 0) {
+                free(bytes);
+                return -1;
+            }
+            arg = arg->sibling == NULL ? NULL : arg->sibling->sibling;
+            i++;
+        }
+        else if (i < len)
+            bytes[n++] = s[i];
+    }
+    free(bytes);
+    return 0;
+}
+
+
+int lower_Output (struct ParseTree* tree, struct AsmCode* code) {
+    struct ParseTree* obj;
+    struct ParseTree* piece;
+
+    obj = tree->child->sibling;
+    if (obj->child->data->type == Str) {
+        for (piece = obj->child->child; piece != NULL; piece = piece->sibling == NULL ? NULL : piece->sibling->sibling)
+            if (lower_QuotedStr(piece, code) < 0)
+                return -1;
+    }
+    else if (obj->child->data->type == Bool) {
+        int k = add_Str(code, obj->child->data->len == 4 ? "True" : "False", obj->child->data->len);
+        if (k < 0 || add_Ins(code, A_PRINTSTR, -1, -1, -1, k) < 0)
+            return -1;
+    }
+    else if (lower_PrintObj(obj, code) < 0)
+        return -1;
+    return add_Ins(code, A_NEWLINE, -1, -1, -1, 0) < 0 ? -1 : 0;
+}
+
+
+int lower_Lines (struct ParseTree* line, struct AsmCode* code) {
+    // Lines up to the end or to the else
+    while (line != NULL && line->data->type != OptElse) {
+        if (lower_Line(line, code) < 0)
+            return -1;
+        line = line->sibling->sibling;
+    }
+    return 0;
+}
+
+
+int lower_IfLine (struct ParseTree* tree, struct AsmCode* code) {
+    struct ParseTree *cond, *line;
+    int orelse, end;
+
+    cond = tree->child->sibling->child->sibling;
+    orelse = code->nlabels++;
+    if (lower_Cond(cond, orelse, code) < 0)
+        return -1;
+    line = tree->child->sibling->sibling->child;
+    if (lower_Lines(line, code) < 0)
+        return -1;
+
+    while (line != NULL && line->data->type != OptElse)
+        line = line->sibling->sibling;
+    if (line == NULL || line->child->sibling == NULL)
+        return add_Jump(code, A_LABEL, -1, orelse) < 0 ? -1 : 0;
+
+    end = code->nlabels++;
+    if (add_Jump(code, A_JMP, -1, end) < 0 || add_Jump(code, A_LABEL, -1, orelse) < 0)
+        return -1;
+    if (lower_Lines(line->child->sibling, code) < 0)
+        return -1;
+    return add_Jump(code, A_LABEL, -1, end) < 0 ? -1 : 0;
+}
+
+
+int lower_LoopLine (struct ParseTree* tree, struct AsmCode* code) {
+    /*
+     * head: jump to end if not cond; body; jump to head; end:
+     * The instructions from head to the jump back make the loop, for the linear scan.
+    */
+    int head, end, first, brk, cont;
+
+    head = code->nlabels++;
+    end = code->nlabels++;
+    first = add_Jump(code, A_LABEL, -1, head);
+    if (first < 0 || lower_Cond(tree->child->sibling->child->sibling, end, code) < 0)
+        return -1;
+
+    brk = code->brk;
+    cont = code->cont;
+    code->brk = end;
+    code->cont = head;
+    if (lower_Lines(tree->child->sibling->sibling->child, code) < 0)
+        return -1;
+    code->brk = brk;
+    code->cont = cont;
+
+    if (add_Jump(code, A_JMP, -1, head) < 0)
+        return -1;
+    if (grow_Array((void**) &code->loops, &code->caploops, code->nloops, sizeof(code->loops[0]))) {
+        code->error = MEMORY_ERROR;
+        return -1;
+    }
+    code->loops[code->nloops][0] = first;
+    code->loops[code->nloops][1] = code->n - 1;
+    code->nloops++;
+    return add_Jump(code, A_LABEL, -1, end) < 0 ? -1 : 0;
+}
+
+
+int lower_Line (struct ParseTree* tree, struct AsmCode* code) {
+    struct ParseTree* line;
+
+    line = tree->child;
+    switch (line->data->type) {
+        case Assign: return lower_Assign(line, code);
+        case Input: return lower_Input(line, code);
+        case Output: return lower_Output(line, code);
+        case IfLine: return lower_IfLine(line, code);
+        case LoopLine: return lower_LoopLine(line, code);
+        case Break:
+            if (code->brk < 0)
+                return unsupported(line, "break out of a loop");
+            return add_Jump(code, A_JMP, -1, code->brk) < 0 ? -1 : 0;
+        case Continue:
+            if (code->cont < 0)
+                return unsupported(line, "continue out of a loop");
+            return add_Jump(code, A_JMP, -1, code->cont) < 0 ? -1 : 0;
+        default:
+            return -1;
+    }
+}
+
+
+/*
+ * ---------------
+ * Linear scan
+ * ---------------
+*/
+
+void use_Reg (struct AsmCode* code, int reg, int i) {
+    if (reg < 0)
+        return;
+    if (code->regs[reg].start < 0)
+        code->regs[reg].start = i;
+    code->regs[reg].end = i;
+}
+
+
+struct VReg* sorted_Regs; // the registers that by_Start compares
+
+
+int by_Start (const void* a, const void* b) {
+    return sorted_Regs[*(const int*) a].start - sorted_Regs[*(const int*) b].start;
+}
+
+
+int alloc_Registers (struct AsmCode* code) {
+    /*
+     * Poletto and Sarkar: the intervals by increasing start, a register for each one
+     * while they last; when they are all taken, the interval that ends last goes to the stack.
+     * An interval is the first and last instruction of its register. A variable that is used
+     * in a loop lives for the whole loop: its value goes around the jump back.
+    */
+    struct VReg* regs;
+    int *order, *active;
+    int nactive, nfree[2], freeregs[2][N_FLOAT_REGS];
+    int i, j, k, v, isf, last;
+
+    regs = code->regs;
+    for (i = 0; i < code->n; i++) {
+        use_Reg(code, code->ins[i].dst, i);
+        use_Reg(code, code->ins[i].a, i);
+        use_Reg(code, code->ins[i].b, i);
+    }
+    for (k = 0; k < code->nloops; k++)
+        for (v = 0; v < code->nregs; v++)
+            if (regs[v].isvar && regs[v].start >= 0 &&
+                regs[v].start <= code->loops[k][1] && regs[v].end >= code->loops[k][0]) {
+                if (regs[v].start > code->loops[k][0])
+                    regs[v].start = code->loops[k][0];
+                if (regs[v].end < code->loops[k][1])
+                    regs[v].end = code->loops[k][1];
+            }
+
+    order = malloc((code->nregs + 1) * sizeof(int));
+    active = malloc((code->nregs + 1) * sizeof(int));
+    if (order == NULL || active == NULL) {
+        free(order);
+        free(active);
+        return MEMORY_ERROR;
+    }
+    k = 0;
+    for (v = 0; v < code->nregs; v++)
+        if (regs[v].start >= 0)
+            order[k++] = v;
+    sorted_Regs = regs;
+    qsort(order, k, sizeof(int), by_Start);
+
+    nfree[0] = N_INT_REGS;
+    nfree[1] = N_FLOAT_REGS;
+    for (i = 0; i < N_FLOAT_REGS; i++) {
+        freeregs[0][i] = N_INT_REGS - 1 - i; // %rbx is handed out first
+        freeregs[1][i] = N_FLOAT_REGS - 1 - i;
+    }
+    nactive = 0;
+    code->slots = 0;
+    for (i = 0; i < k; i++) {
+        v = order[i];
+        isf = regs[v].isfloat;
+        // Expire: a register that is read for the last time by the instruction can be its destination
+        for (j = 0; j < nactive; j++)
+            if (regs[active[j]].end <= regs[v].start) {
+                freeregs[(int) regs[active[j]].isfloat][nfree[(int) regs[active[j]].isfloat]++] = regs[active[j]].loc;
+                active[j--] = active[--nactive];
+            }
+        if (nfree[isf] > 0) {
+            regs[v].loc = freeregs[isf][--nfree[isf]];
+            active[nactive++] = v;
+            continue;
+        }
+        // Spill the one of the same class that lives the longest
+        last = -1;
+        for (j = 0; j < nactive; j++)
+            if (regs[active[j]].isfloat == isf && (last < 0 || regs[active[j]].end > regs[active[last]].end))
+                last = j;
+        if (regs[active[last]].end > regs[v].end) {
+            regs[v].loc = regs[active[last]].loc;
+            regs[active[last]].loc = -1 - code->slots++;
+            active[last] = v;
+        }
+        else
+            regs[v].loc = -1 - code->slots++;
+    }
+    free(order);
+    free(active);
+    return SUBTREE_OK;
+}
+
+
+/*
+ * ---------------
+ * Assembly
+ * ---------------
+*/
+
+void emit_Asm (struct Emitter* out, const char* format, ...) {
+    // One line of assembly
+    char line[256];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    emit_Str(out, line);
+    emit_Newline(out);
+}
+
+
+const char* loc_Of (struct AsmCode* code, int reg, char* buf) {
+    // The operand of a virtual register: its machine register or its stack slot
+    int loc;
+
+    loc = code->regs[reg].loc;
+    if (loc >= 0)
+        return code->regs[reg].isfloat ? float_Regs[loc] : int_Regs[loc];
+    snprintf(buf, 32, "%d(%%rbp)", 8 * loc);
+    return buf;
+}
+
+
+int in_Mem (struct AsmCode* code, int reg) {
+    return code->regs[reg].loc < 0;
+}
+
+
+const char* set_Cond (enum TokenType cond) {
+    switch (cond) {
+        case Lesser: return "l";
+        case LesserEq: return "le";
+        case Greater: return "g";
+        case GreaterEq: return "ge";
+        case EqEq: return "e";
+        default: return "ne";
+    }
+}
+
+
+int log2_Exact (long long v) {
+    // k if v is 2^k, with k > 0, else -1
+    int k;
+
+    if (v < 2 || (v & (v - 1)) != 0)
+        return -1;
+    for (k = 0; v > 1; k++)
+        v >>= 1;
+    return k;
+}
+
+
+void emit_IntOp (struct AsmCode* code, struct AsmIns* ins, struct Emitter* out) {
+    // dst = a op b: in dst itself when it is a register that b does not use, else through %rax
+    const char* name;
+    char bd[32], ba[32], bb[32], imm[32];
+    const char *d, *a, *b;
+
+    name = ins->op == A_ADD ? "addq" : ins->op == A_SUB ? "subq" : "imulq";
+    d = loc_Of(code, ins->dst, bd);
+    a = loc_Of(code, ins->a, ba);
+    if (ins->b < 0) {
+        snprintf(imm, sizeof(imm), "$%lld", ins->imm);
+        b = imm;
+    }
+    else
+        b = loc_Of(code, ins->b, bb);
+    if (! in_Mem(code, ins->dst) && (ins->b < 0 || strcmp(b, d) != 0 || ins->a == ins->b)) {
+        if (strcmp(a, d) != 0)
+            emit_Asm(out, "    movq %s, %s", a, d);
+        emit_Asm(out, "    %s %s, %s", name, b, d);
+        return;
+    }
+    emit_Asm(out, "    movq %s, %%rax", a);
+    emit_Asm(out, "    %s %s, %%rax", name, b);
+    emit_Asm(out, "    movq %%rax, %s", d);
+}
+
+
+void emit_DivMod (struct AsmCode* code, struct AsmIns* ins, struct Emitter* out) {
+    /*
+     * Floor division and modulo, as in Python: idiv truncates, the result is fixed
+     * when the remainder is not zero and has not the sign of the divisor.
+     * By a power of 2 they are a shift and a mask.
+    */
+    char bd[32], ba[32], bb[32];
+    const char *d, *a;
+    int k, mod;
+
+    mod = ins->op == A_MOD;
+    d = loc_Of(code, ins->dst, bd);
+    a = loc_Of(code, ins->a, ba);
+    if (ins->b < 0 && (k = log2_Exact(ins->imm)) > 0) {
+        emit_Asm(out, "    movq %s, %%rax", a);
+        if (mod)
+            emit_Asm(out, "    andq $%lld, %%rax", ins->imm - 1);
+        else
+            emit_Asm(out, "    sarq $%d, %%rax", k);
+        emit_Asm(out, "    movq %%rax, %s", d);
+        return;
+    }
+    if (ins->b < 0 && ins->imm == 0) {
+        emit_Asm(out, "    jmp rt_zero_div");
+        return;
+    }
+    if (ins->b < 0)
+        emit_Asm(out, "    movq $%lld, %%r11", ins->imm);
+    else {
+        emit_Asm(out, "    movq %s, %%r11", loc_Of(code, ins->b, bb));
+        emit_Asm(out, "    testq %%r11, %%r11");
+        emit_Asm(out, "    je rt_zero_div");
+    }
+    emit_Asm(out, "    movq %s, %%rax", a);
+    emit_Asm(out, "    cqto");
+    emit_Asm(out, "    idivq %%r11");
+    emit_Asm(out, "    testq %%rdx, %%rdx");
+    emit_Asm(out, "    je 1f");
+    emit_Asm(out, "    movq %%rdx, %%rdi");
+    emit_Asm(out, "    xorq %%r11, %%rdi");
+    emit_Asm(out, "    jns 1f");
+    if (mod)
+        emit_Asm(out, "    addq %%r11, %%rdx");
+    else
+        emit_Asm(out, "    decq %%rax");
+    emit_Asm(out, "1:");
+    emit_Asm(out, "    movq %s, %s", mod ? "%rdx" : "%rax", d);
+}
+
+
+void emit_Compare (struct AsmCode* code, struct AsmIns* ins, struct Emitter* out) {
+    // cmp b, a for the flags of a - b. a cannot be an immediate, a and b cannot be both in memory
+    char ba[32], bb[32];
+    const char *a, *b;
+
+    a = loc_Of(code, ins->a, ba);
+    if (ins->b < 0) {
+        snprintf(bb, sizeof(bb), "$%lld", ins->imm);
+        b = bb;
+    }
+    else
+        b = loc_Of(code, ins->b, bb);
+    if (in_Mem(code, ins->a) && (ins->b < 0 || in_Mem(code, ins->b))) {
+        emit_Asm(out, "    movq %s, %%rax", a);
+        a = "%rax";
+    }
+    emit_Asm(out, "    cmpq %s, %s", b, a);
+}
+
+
+void emit_FloatOp (struct AsmCode* code, struct AsmIns* ins, struct Emitter* out) {
+    const char* name;
+    char bd[32], ba[32], bb[32];
+    const char *d, *a, *b;
+
+    switch (ins->op) {
+        case A_FADD: name = "addsd"; break;
+        case A_FSUB: name = "subsd"; break;
+        case A_FMUL: name = "mulsd"; break;
+        default: name = "divsd"; break;
+    }
+    d = loc_Of(code, ins->dst, bd);
+    a = loc_Of(code, ins->a, ba);
+    b = loc_Of(code, ins->b, bb);
+    if (ins->op == A_FDIV) {
+        // ZeroDivisionError for 0.0 and -0.0: all the bits but the sign are zero
+        emit_Asm(out, "    movq %s, %%rax", b);
+        emit_Asm(out, "    shlq $1, %%rax");
+        emit_Asm(out, "    je rt_float_zero_div");
+    }
+    if (! in_Mem(code, ins->dst) && (strcmp(b, d) != 0 || ins->a == ins->b)) {
+        if (strcmp(a, d) != 0)
+            emit_Asm(out, "    movsd %s, %s", a, d);
+        emit_Asm(out, "    %s %s, %s", name, b, d);
+        return;
+    }
+    emit_Asm(out, "    movsd %s, %%xmm15", a);
+    emit_Asm(out, "    %s %s, %%xmm15", name, b);
+    emit_Asm(out, "    movsd %%xmm15, %s", d);
+}
+
+
+void emit_FloatCompare (struct AsmCode* code, struct AsmIns* ins, struct Emitter* out) {
+    /*
+     * ucomisd sets the flags of an unsigned compare, and the parity when a NaN makes them unordered:
+     * < and <= are > and >= with the operands swapped, so that NaN is false for all four.
+    */
+    char ba[32], bb[32], bd[32];
+    const char *a, *b, *set;
+    enum TokenType cond;
+
+    a = loc_Of(code, ins->a, ba);
+    b = loc_Of(code, ins->b, bb);
+    cond = ins->cond;
+    if (cond == Lesser || cond == LesserEq) {
+        const char* tmp = a;
+        a = b;
+        b = tmp;
+        cond = cond == Lesser ? Greater : GreaterEq;
+    }
+    emit_Asm(out, "    movsd %s, %%xmm15", a);
+    emit_Asm(out, "    ucomisd %s, %%xmm15", b);
+    if (cond == EqEq) {
+        emit_Asm(out, "    sete %%al");
+        emit_Asm(out, "    setnp %%dl");
+        emit_Asm(out, "    andb %%dl, %%al");
+    }
+    else if (cond == NotEq) {
+        emit_Asm(out, "    setne %%al");
+        emit_Asm(out, "    setp %%dl");
+        emit_Asm(out, "    orb %%dl, %%al");
+    }
+    else {
+        set = cond == Greater ? "seta" : "setae";
+        emit_Asm(out, "    %s %%al", set);
+    }
+    emit_Asm(out, "    movzbq %%al, %%rax");
+    emit_Asm(out, "    movq %%rax, %s", loc_Of(code, ins->dst, bd));
+}
+
+
+void emit_Ins (struct AsmCode* code, struct AsmIns* ins, struct Emitter* out) {
+    char bd[32], ba[32];
+    const char *d, *a;
+
+    switch (ins->op) {
+        case A_MOVI:
+            d = loc_Of(code, ins->dst, bd);
+            if (ins->imm >= -2147483648LL && ins->imm <= 2147483647LL)
+                emit_Asm(out, "    movq $%lld, %s", ins->imm, d);
+            else {
+                emit_Asm(out, "    movabsq $%lld, %%rax", ins->imm);
+                emit_Asm(out, "    movq %%rax, %s", d);
+            }
+            break;
+        case A_MOVF:
+            d = loc_Of(code, ins->dst, bd);
+            if (in_Mem(code, ins->dst)) {
+                emit_Asm(out, "    movq .LF%lld(%%rip), %%rax", ins->imm);
+                emit_Asm(out, "    movq %%rax, %s", d);
+            }
+            else
+                emit_Asm(out, "    movsd .LF%lld(%%rip), %s", ins->imm, d);
+            break;
+        case A_MOV:
+            d = loc_Of(code, ins->dst, bd);
+            a = loc_Of(code, ins->a, ba);
+            if (strcmp(a, d) == 0)
+                break;
+            if (code->regs[ins->dst].isfloat && ! in_Mem(code, ins->dst))
+                emit_Asm(out, "    movsd %s, %s", a, d);
+            else if (code->regs[ins->dst].isfloat && ! in_Mem(code, ins->a))
+                emit_Asm(out, "    movsd %s, %s", a, d);
+            else if (in_Mem(code, ins->dst) && in_Mem(code, ins->a)) {
+                emit_Asm(out, "    movq %s, %%rax", a);
+                emit_Asm(out, "    movq %%rax, %s", d);
+            }
+            else
+                emit_Asm(out, "    movq %s, %s", a, d);
+            break;
+        case A_ADD: case A_SUB: case A_MUL:
+            emit_IntOp(code, ins, out);
+            break;
+        case A_DIV: case A_MOD:
+            emit_DivMod(code, ins, out);
+            break;
+        case A_FADD: case A_FSUB: case A_FMUL: case A_FDIV:
+            emit_FloatOp(code, ins, out);
+            break;
+        case A_CVT:
+            d = loc_Of(code, ins->dst, bd);
+            a = loc_Of(code, ins->a, ba);
+            if (in_Mem(code, ins->dst)) {
+                emit_Asm(out, "    cvtsi2sdq %s, %%xmm15", a);
+                emit_Asm(out, "    movsd %%xmm15, %s", d);
+            }
+            else
+                emit_Asm(out, "    cvtsi2sdq %s, %s", a, d);
+            break;
+        case A_CMP:
+            emit_Compare(code, ins, out);
+            emit_Asm(out, "    set%s %%al", set_Cond(ins->cond));
+            emit_Asm(out, "    movzbq %%al, %%rax");
+            emit_Asm(out, "    movq %%rax, %s", loc_Of(code, ins->dst, bd));
+            break;
+        case A_FCMP:
+            emit_FloatCompare(code, ins, out);
+            break;
+        case A_BR:
+            emit_Compare(code, ins, out);
+            emit_Asm(out, "    j%s .L%d", set_Cond(ins->cond), ins->label);
+            break;
+        case A_JZ: case A_JNZ:
+            emit_Asm(out, "    cmpq $0, %s", loc_Of(code, ins->a, ba));
+            emit_Asm(out, "    %s .L%d", ins->op == A_JZ ? "je" : "jne", ins->label);
+            break;
+        case A_JMP:
+            emit_Asm(out, "    jmp .L%d", ins->label);
+            break;
+        case A_LABEL:
+            emit_Asm(out, ".L%d:", ins->label);
+            break;
+        case A_READINT: case A_READBOOL:
+            emit_Asm(out, "    call %s", ins->op == A_READINT ? "rt_read_int" : "rt_read_bool");
+            emit_Asm(out, "    movq %%rax, %s", loc_Of(code, ins->dst, bd));
+            break;
+        case A_PRINTINT: case A_PRINTBOOL:
+            emit_Asm(out, "    movq %s, %%rdi", loc_Of(code, ins->a, ba));
+            emit_Asm(out, "    call %s", ins->op == A_PRINTINT ? "rt_print_int" : "rt_print_bool");
+            break;
+        case A_PRINTSTR:
+            emit_Asm(out, "    leaq .LS%lld(%%rip), %%rdi", ins->imm);
+            emit_Asm(out, "    call rt_print_str");
+            break;
+        case A_NEWLINE:
+            emit_Asm(out, "    movl $10, %%edi");
+            emit_Asm(out, "    call rt_putc");
+            break;
+    }
+}
+
+
+void emit_Bytes (const char* s, struct Emitter* out) {
+    // A .asciz string, any byte that is not plain text in octal
+    char esc[8];
+
+    emit_Mem(out, "    .asciz \"", 12);
+    for (; *s != '\0'; s++) {
+        if (*s >= ' ' && *s <= '~' && *s != '"' && *s != '\\')
+            emit_Char(out, *s);
+        else {
+            snprintf(esc, sizeof(esc), "\\%03o", (unsigned char) *s);
+            emit_Str(out, esc);
+        }
+    }
+    emit_Char(out, '"');
+    emit_Newline(out);
+}
+
+
+int cgenAsm_Program (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    struct AsmCode code;
+    struct Symbol* sym;
+    int i, status;
+    long long bits;
+
+    if (! tree || tree->data->type != Program || tree->child == NULL)
+        return PARSING_ERROR;
+
+    memset(&code, 0, sizeof(code));
+    code.table = table;
+    code.brk = code.cont = -1;
+    code.nvars = 1;
+    for (sym = table->last; sym != NULL; sym = sym->prev)
+        if (sym->id >= code.nvars)
+            code.nvars = sym->id + 1;
+    code.vars = malloc(code.nvars * sizeof(int));
+    if (code.vars == NULL)
+        return MEMORY_ERROR;
+    for (i = 0; i < code.nvars; i++)
+        code.vars[i] = -1;
+
+    status = SUBTREE_OK;
+    for (tree = tree->child; tree != NULL && status == SUBTREE_OK; tree = tree->sibling->sibling)
+        if (lower_Line(tree, &code) < 0)
+            status = code.error != SUBTREE_OK ? code.error : PARSING_ERROR;
+    if (status == SUBTREE_OK)
+        status = alloc_Registers(&code);
+
+    if (status == SUBTREE_OK) {
+        emit_Asm(out, "    .text");
+        emit_Asm(out, "    .globl _start");
+        emit_Asm(out, "_start:");
+        emit_Asm(out, "    movq %%rsp, %%rbp");
+        if (code.slots > 0)
+            emit_Asm(out, "    subq $%d, %%rsp", 8 * code.slots);
+        for (i = 0; i < code.n; i++)
+            emit_Ins(&code, code.ins + i, out);
+        emit_Asm(out, "    jmp rt_exit");
+        emit_Newline(out);
+        emit_Str(out, runtime_Asm);
+        emit_Newline(out);
+
+        emit_Asm(out, "    .section .rodata");
+        emit_Asm(out, "    .balign 8");
+        for (i = 0; i < code.nfloats; i++) {
+            memcpy(&bits, code.floats + i, sizeof(bits));
+            emit_Asm(out, ".LF%d: .quad %lld", i, bits);
+        }
+        for (i = 0; i < code.nstrs; i++) {
+            emit_Asm(out, ".LS%d:", i);
+            emit_Bytes(code.strs[i], out);
+        }
+    }
+
+    for (i = 0; i < code.nstrs; i++)
+        free(code.strs[i]);
+    free(code.strs);
+    free(code.floats);
+    free(code.ins);
+    free(code.regs);
+    free(code.vars);
+    free(code.loops);
+    return status;
+}
+
+
+struct CodeAsm {
+    struct ParseTree* root;
+    struct SymbolTable* table;
+};
+
+
+int gen_Asm (void* ctx, struct Emitter* out) {
+    struct CodeAsm* code;
+
+    code = ctx;
+    return cgenAsm_Program(code->root, out, code->table);
+}
+
+
+char* code_gen_Asm (struct ParseTree *root, struct SymbolTable *table) {
+    struct Emitter out;
+
+    if (init_Emitter(&out, -1) != SUBTREE_OK)
+        return NULL;
+    if (cgenAsm_Program(root, &out, table) != SUBTREE_OK || out.error != SUBTREE_OK) {
+        free(out.buf);
+        return NULL;
+    }
+    out.buf[out.len] = '\0';
+    return out.buf;
+}
+
+
+int code_gen_Asm_ToFile (struct ParseTree *root, struct SymbolTable *table, const char *fileName, size_t *written) {
+    struct CodeAsm code;
+
+    code.root = root;
+    code.table = table;
+    return emit_ToFile(fileName, written, gen_Asm, &code);
+}
@@ -0,0 +1,58 @@
+#ifndef CGEN_ASM_H
+#define CGEN_ASM_H
+
+#include "cgen.h"
+#include "semantic.h"
+
+/*
+ * Third target of the code generation: x86-64 assembly for GNU as (AT&T syntax),
+ * a static program for Linux with its own entry point, to link with `ld` alone.
+ * Only the int, float and bool subset of the language is compiled:
+ * no strings but the literals of writeOut, no lists, no readStr or readFloat,
+ * floats are never printed and have no %.
+ *
+ * The ParseTree is lowered to a list of AsmIns on virtual registers,
+ * that a linear scan maps to the machine registers (or to the stack when they are not enough),
+ * and only then written as assembly.
+*/
+
+enum AsmOp {
+    A_MOVI, // dst = imm
+    A_MOVF, // dst = floats[imm]
+    A_MOV, // dst = a
+    A_ADD, A_SUB, A_MUL, A_DIV, A_MOD, // dst = a op b (or a op imm if b is -1), floor / and %
+    A_FADD, A_FSUB, A_FMUL, A_FDIV, // dst = a op b, on floats
+    A_CVT, // float dst = int a
+    A_CMP, // dst = a cond b (or imm), ints
+    A_FCMP, // dst = a cond b, floats
+    A_BR, // jump to label if a cond b (or imm), ints
+    A_JZ, A_JNZ, // jump to label if a is zero, not zero
+    A_JMP,
+    A_LABEL,
+    A_READINT, A_READBOOL, // dst = readInt, readBool
+    A_PRINTINT, A_PRINTBOOL, // write a, without newline
+    A_PRINTSTR, // write strs[imm]
+    A_NEWLINE
+};
+
+struct AsmIns {
+    enum AsmOp op;
+    int dst, a, b; // virtual registers, -1 if not used
+    long long imm;
+    enum TokenType cond; // Lesser, EqEq, ... for A_CMP, A_FCMP, A_BR
+    int label; // of the jumps and of A_LABEL
+};
+
+/*
+ * Return the assembly of the program as a NUL-terminated string,
+ * or NULL on error (also when the program is out of the subset). The caller must free the result.
+ * The table is the one filled by analyze_Program_Table.
+*/
+char* code_gen_Asm (struct ParseTree *root, struct SymbolTable *table);
+
+/*
+ * Generate the assembly straight into the file, with emit_ToFile.
+*/
+int code_gen_Asm_ToFile (struct ParseTree *root, struct SymbolTable *table, const char *fileName, size_t *written);
+
+#endif
@@ -0,0 +1,1220 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "cgen_c.h"
+
+
+int cgenC_Obj (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table);
+int cgenC_Expr (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table);
+int cgenC_Pred (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table);
+int cgenC_Term (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table);
+int cgenC_BaseExpr (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table);
+int cgenC_Line (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table);
+int cgenC_Program (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table);
+
+
+/*
+ * Written at the top of every program. The type codes of rt_list are the ones of semantic.h
+*/
+const char* runtime_C =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "#include <stdarg.h>\n"
+    "#include <math.h>\n"
+    "\n"
+    "/* Runtime of the C target: values follow the Python code of the other target */\n"
+    "\n"
+    "typedef struct rt_list {\n"
+    "    long long n;\n"
+    "    int type; /* type of the elements: 0 int, 1 float, 2 string, 4 bool, 5 list */\n"
+    "    union rt_elem {long long i; double f; char* s; struct rt_list* l;} *data;\n"
+    "} rt_list;\n"
+    "\n"
+    "void rt_fail(const char* error, const char* msg) {\n"
+    "    fflush(stdout);\n"
+    "    fprintf(stderr, \"%s: %s\\n\", error, msg);\n"
+    "    exit(1);\n"
+    "}\n"
+    "\n"
+    "void* rt_alloc(size_t n) {\n"
+    "    void* p = malloc(n > 0 ? n : 1);\n"
+    "    if (p == NULL)\n"
+    "        rt_fail(\"MemoryError\", \"out of memory\");\n"
+    "    return p;\n"
+    "}\n"
+    "\n"
+    "char* rt_dup(const char* s) {\n"
+    "    size_t n;\n"
+    "    char* d;\n"
+    "\n"
+    "    if (s == NULL)\n"
+    "        s = \"\";\n"
+    "    n = strlen(s);\n"
+    "    d = rt_alloc(n + 1);\n"
+    "    memcpy(d, s, n + 1);\n"
+    "    return d;\n"
+    "}\n"
+    "\n"
+    "void rt_set(char** var, char* s) {\n"
+    "    free(*var);\n"
+    "    *var = s;\n"
+    "}\n"
+    "\n"
+    "long long rt_idiv(long long a, long long b) {\n"
+    "    long long q;\n"
+    "\n"
+    "    if (b == 0)\n"
+    "        rt_fail(\"ZeroDivisionError\", \"integer division by zero\");\n"
+    "    q = a / b;\n"
+    "    if ((a % b != 0) && ((a < 0) != (b < 0)))\n"
+    "        q--;\n"
+    "    return q;\n"
+    "}\n"
+    "\n"
+    "long long rt_imod(long long a, long long b) {\n"
+    "    long long r;\n"
+    "\n"
+    "    if (b == 0)\n"
+    "        rt_fail(\"ZeroDivisionError\", \"integer modulo by zero\");\n"
+    "    r = a % b;\n"
+    "    if (r != 0 && ((r < 0) != (b < 0)))\n"
+    "        r += b;\n"
+    "    return r;\n"
+    "}\n"
+    "\n"
+    "double rt_fdiv(double a, double b) {\n"
+    "    if (b == 0.0)\n"
+    "        rt_fail(\"ZeroDivisionError\", \"float division by zero\");\n"
+    "    return a / b;\n"
+    "}\n"
+    "\n"
+    "double rt_fmod(double a, double b) {\n"
+    "    double r;\n"
+    "\n"
+    "    if (b == 0.0)\n"
+    "        rt_fail(\"ZeroDivisionError\", \"float modulo\");\n"
+    "    r = fmod(a, b);\n"
+    "    if (r != 0.0 && ((r < 0) != (b < 0)))\n"
+    "        r += b;\n"
+    "    else if (r == 0.0)\n"
+    "        r = copysign(0.0, b);\n"
+    "    return r;\n"
+    "}\n"
+    "\n"
+    "char* rt_str_int(long long v) {\n"
+    "    char buf[32];\n"
+    "\n"
+    "    snprintf(buf, sizeof(buf), \"%lld\", v);\n"
+    "    return rt_dup(buf);\n"
+    "}\n"
+    "\n"
+    "char* rt_str_float(double v) {\n"
+    "    /* repr of a Python float: the shortest digits that read back the same value */\n"
+    "    char buf[64], digits[32], out[400];\n"
+    "    int prec, exp, nd, i, k;\n"
+    "    char* p;\n"
+    "\n"
+    "    if (isnan(v))\n"
+    "        return rt_dup(\"nan\");\n"
+    "    if (isinf(v))\n"
+    "        return rt_dup(v > 0 ? \"inf\" : \"-inf\");\n"
+    "    for (prec = 0; prec < 17; prec++) {\n"
+    "        snprintf(buf, sizeof(buf), \"%.*e\", prec, v);\n"
+    "        if (strtod(buf, NULL) == v)\n"
+    "            break;\n"
+    "    }\n"
+    "    nd = 0;\n"
+    "    for (p = buf; *p != 'e'; p++)\n"
+    "        if (*p >= '0' && *p <= '9')\n"
+    "            digits[nd++] = *p;\n"
+    "    exp = atoi(p + 1);\n"
+    "    while (nd > 1 && digits[nd - 1] == '0')\n"
+    "        nd--;\n"
+    "    k = 0;\n"
+    "    if (buf[0] == '-')\n"
+    "        out[k++] = '-';\n"
+    "    if (exp >= -4 && exp < 16) {\n"
+    "        if (exp < 0) {\n"
+    "            out[k++] = '0';\n"
+    "            out[k++] = '.';\n"
+    "            for (i = 0; i < -exp - 1; i++)\n"
+    "                out[k++] = '0';\n"
+    "            for (i = 0; i < nd; i++)\n"
+    "                out[k++] = digits[i];\n"
+    "        }\n"
+    "        else {\n"
+    "            for (i = 0; i <= exp; i++)\n"
+    "                out[k++] = i < nd ? digits[i] : '0';\n"
+    "            out[k++] = '.';\n"
+    "            if (nd <= exp + 1)\n"
+    "                out[k++] = '0';\n"
+    "            for (i = exp + 1; i < nd; i++)\n"
+    "                out[k++] = digits[i];\n"
+    "        }\n"
+    "        out[k] = '\\0';\n"
+    "    }\n"
+    "    else {\n"
+    "        out[k++] = digits[0];\n"
+    "        if (nd > 1) {\n"
+    "            out[k++] = '.';\n"
+    "            for (i = 1; i < nd; i++)\n"
+    "                out[k++] = digits[i];\n"
+    "        }\n"
+    "        snprintf(out + k, sizeof(out) - k, \"e%c%02d\", exp < 0 ? '-' : '+', exp < 0 ? -exp : exp);\n"
+    "    }\n"
+    "    return rt_dup(out);\n"
+    "}\n"
+    "\n"
+    "char* rt_str_bool(int v) {\n"
+    "    return rt_dup(v ? \"True\" : \"False\");\n"
+    "}\n"
+    "\n"
+    "char* rt_concat(char* a, char* b) {\n"
+    "    /* Both are consumed */\n"
+    "    size_t la, lb;\n"
+    "    char* s;\n"
+    "\n"
+    "    la = strlen(a);\n"
+    "    lb = strlen(b);\n"
+    "    s = rt_alloc(la + lb + 1);\n"
+    "    memcpy(s, a, la);\n"
+    "    memcpy(s + la, b, lb + 1);\n"
+    "    free(a);\n"
+    "    free(b);\n"
+    "    return s;\n"
+    "}\n"
+    "\n"
+    "char* rt_repr_str(const char* s) {\n"
+    "    /* Python quotes with ' unless the string has a ' and no \" */\n"
+    "    char q;\n"
+    "    size_t n, k;\n"
+    "    char* r;\n"
+    "\n"
+    "    q = strchr(s, '\\'') != NULL && strchr(s, '\"') == NULL ? '\"' : '\\'';\n"
+    "    n = strlen(s);\n"
+    "    r = rt_alloc(2 * n + 3);\n"
+    "    k = 0;\n"
+    "    r[k++] = q;\n"
+    "    for (; *s != '\\0'; s++) {\n"
+    "        if (*s == q || *s == '\\\\')\n"
+    "            r[k++] = '\\\\';\n"
+    "        if (*s == '\\n') {\n"
+    "            r[k++] = '\\\\';\n"
+    "            r[k++] = 'n';\n"
+    "        }\n"
+    "        else\n"
+    "            r[k++] = *s;\n"
+    "    }\n"
+    "    r[k++] = q;\n"
+    "    r[k] = '\\0';\n"
+    "    return r;\n"
+    "}\n"
+    "\n"
+    "char* rt_str_list(rt_list* l) {\n"
+    "    char* s;\n"
+    "    char* e;\n"
+    "    long long i;\n"
+    "\n"
+    "    s = rt_dup(\"[\");\n"
+    "    for (i = 0; l != NULL && i < l->n; i++) {\n"
+    "        if (i > 0)\n"
+    "            s = rt_concat(s, rt_dup(\", \"));\n"
+    "        switch (l->type) {\n"
+    "            case 0: e = rt_str_int(l->data[i].i); break;\n"
+    "            case 1: e = rt_str_float(l->data[i].f); break;\n"
+    "            case 2: e = rt_repr_str(l->data[i].s); break;\n"
+    "            case 4: e = rt_str_bool((int) l->data[i].i); break;\n"
+    "            default: e = rt_str_list(l->data[i].l); break;\n"
+    "        }\n"
+    "        s = rt_concat(s, e);\n"
+    "    }\n"
+    "    return rt_concat(s, rt_dup(\"]\"));\n"
+    "}\n"
+    "\n"
+    "char* rt_format(const char* lit, int n, ...) {\n"
+    "    /* lit % (args): the args are strings already, and they are consumed */\n"
+    "    va_list ap;\n"
+    "    char** args;\n"
+    "    char* s;\n"
+    "    size_t len, cap, m;\n"
+    "    int i, used;\n"
+    "\n"
+    "    args = rt_alloc(n * sizeof(char*));\n"
+    "    va_start(ap, n);\n"
+    "    for (i = 0; i < n; i++)\n"
+    "        args[i] = va_arg(ap, char*);\n"
+    "    va_end(ap);\n"
+    "    cap = strlen(lit) + 1;\n"
+    "    for (i = 0; i < n; i++)\n"
+    "        cap += strlen(args[i]);\n"
+    "    s = rt_alloc(cap);\n"
+    "    len = 0;\n"
+    "    used = 0;\n"
+    "    for (; *lit != '\\0'; lit++) {\n"
+    "        if (*lit == '%' && lit[1] == '%') {\n"
+    "            s[len++] = '%';\n"
+    "            lit++;\n"
+    "        }\n"
+    "        else if (*lit == '%' && lit[1] == 's') {\n"
+    "            if (used == n)\n"
+    "                rt_fail(\"TypeError\", \"not enough arguments for format string\");\n"
+    "            m = strlen(args[used]);\n"
+    "            memcpy(s + len, args[used], m);\n"
+    "            len += m;\n"
+    "            used++;\n"
+    "            lit++;\n"
+    "        }\n"
+    "        else\n"
+    "            s[len++] = *lit;\n"
+    "    }\n"
+    "    s[len] = '\\0';\n"
+    "    if (used < n)\n"
+    "        rt_fail(\"TypeError\", \"not all arguments converted during string formatting\");\n"
+    "    for (i = 0; i < n; i++)\n"
+    "        free(args[i]);\n"
+    "    free(args);\n"
+    "    return s;\n"
+    "}\n"
+    "\n"
+    "void rt_print(char* s) {\n"
+    "    /* Consumed */\n"
+    "    fputs(s, stdout);\n"
+    "    putchar('\\n');\n"
+    "    free(s);\n"
+    "}\n"
+    "\n"
+    "int rt_streq(char* a, char* b) {\n"
+    "    /* Both are consumed */\n"
+    "    int eq;\n"
+    "\n"
+    "    eq = strcmp(a, b) == 0;\n"
+    "    free(a);\n"
+    "    free(b);\n"
+    "    return eq;\n"
+    "}\n"
+    "\n"
+    "int rt_truth_str(char* a) {\n"
+    "    int t;\n"
+    "\n"
+    "    t = a[0] != '\\0';\n"
+    "    free(a);\n"
+    "    return t;\n"
+    "}\n"
+    "\n"
+    "int rt_list_eq(rt_list* a, rt_list* b) {\n"
+    "    /* Numbers are equal whatever their type, as in Python */\n"
+    "    long long i, n;\n"
+    "    int sa, sb;\n"
+    "\n"
+    "    n = a == NULL ? 0 : a->n;\n"
+    "    if (n != (b == NULL ? 0 : b->n))\n"
+    "        return 0;\n"
+    "    if (n == 0)\n"
+    "        return 1;\n"
+    "    sa = a->type == 2 || a->type == 5;\n"
+    "    sb = b->type == 2 || b->type == 5;\n"
+    "    if ((sa || sb) && a->type != b->type)\n"
+    "        return 0;\n"
+    "    for (i = 0; i < n; i++) {\n"
+    "        if (a->type == 2 && strcmp(a->data[i].s, b->data[i].s) != 0)\n"
+    "            return 0;\n"
+    "        if (a->type == 5 && ! rt_list_eq(a->data[i].l, b->data[i].l))\n"
+    "            return 0;\n"
+    "        if (! sa && (a->type == 1 ? a->data[i].f : a->data[i].i) != (b->type == 1 ? b->data[i].f : b->data[i].i))\n"
+    "            return 0;\n"
+    "    }\n"
+    "    return 1;\n"
+    "}\n"
+    "\n"
+    "int rt_truth_list(rt_list* l) {\n"
+    "    return l != NULL && l->n > 0;\n"
+    "}\n"
+    "\n"
+    "rt_list* rt_new_list(int type, long long n, ...) {\n"
+    "    /* The elements come as long long, double, char* or rt_list* after their type */\n"
+    "    va_list ap;\n"
+    "    rt_list* l;\n"
+    "    long long i;\n"
+    "\n"
+    "    l = rt_alloc(sizeof(rt_list));\n"
+    "    l->n = n;\n"
+    "    l->type = type;\n"
+    "    l->data = rt_alloc(n * sizeof(union rt_elem));\n"
+    "    va_start(ap, n);\n"
+    "    for (i = 0; i < n; i++)\n"
+    "        switch (type) {\n"
+    "            case 0: case 4: l->data[i].i = va_arg(ap, long long); break;\n"
+    "            case 1: l->data[i].f = va_arg(ap, double); break;\n"
+    "            case 2: l->data[i].s = va_arg(ap, char*); break;\n"
+    "            default: l->data[i].l = va_arg(ap, rt_list*); break;\n"
+    "        }\n"
+    "    va_end(ap);\n"
+    "    return l;\n"
+    "}\n"
+    "\n"
+    "union rt_elem* rt_index(rt_list* l, long long i, int type) {\n"
+    "    /* A list variable can hold ints and then floats: the static type of its elements comes along */\n"
+    "    long long n;\n"
+    "\n"
+    "    n = l == NULL ? 0 : l->n;\n"
+    "    if (i < 0)\n"
+    "        i += n;\n"
+    "    if (i < 0 || i >= n)\n"
+    "        rt_fail(\"IndexError\", \"list index out of range\");\n"
+    "    if (l->type != type && ! ((l->type == 0 || l->type == 4) && (type == 0 || type == 1 || type == 4)))\n"
+    "        rt_fail(\"TypeError\", \"list element of unexpected type\");\n"
+    "    return &l->data[i];\n"
+    "}\n"
+    "\n"
+    "long long rt_elem_int(rt_list* l, long long i) {\n"
+    "    return rt_index(l, i, 0)->i;\n"
+    "}\n"
+    "\n"
+    "double rt_elem_float(rt_list* l, long long i) {\n"
+    "    union rt_elem* e = rt_index(l, i, 1);\n"
+    "    return l->type == 1 ? e->f : (double) e->i;\n"
+    "}\n"
+    "\n"
+    "char* rt_elem_str(rt_list* l, long long i) {\n"
+    "    return rt_dup(rt_index(l, i, 2)->s);\n"
+    "}\n"
+    "\n"
+    "int rt_elem_bool(rt_list* l, long long i) {\n"
+    "    return (int) rt_index(l, i, 4)->i;\n"
+    "}\n"
+    "\n"
+    "rt_list* rt_elem_list(rt_list* l, long long i) {\n"
+    "    return rt_index(l, i, 5)->l;\n"
+    "}\n"
+    "\n"
+    "char* rt_read_str(void) {\n"
+    "    char* line;\n"
+    "    size_t cap, n;\n"
+    "    int c;\n"
+    "\n"
+    "    cap = 64;\n"
+    "    line = rt_alloc(cap);\n"
+    "    n = 0;\n"
+    "    while ((c = getchar()) != EOF && c != '\\n') {\n"
+    "        if (n + 1 == cap)\n"
+    "            line = realloc(line, cap *= 2);\n"
+    "        if (line == NULL)\n"
+    "            rt_fail(\"MemoryError\", \"out of memory\");\n"
+    "        line[n++] = (char) c;\n"
+    "    }\n"
+    "    if (c == EOF && n == 0)\n"
+    "        rt_fail(\"EOFError\", \"EOF when reading a line\");\n"
+    "    line[n] = '\\0';\n"
+    "    return line;\n"
+    "}\n"
+    "\n"
+    "long long rt_read_int(void) {\n"
+    "    char *line, *end;\n"
+    "    long long v;\n"
+    "\n"
+    "    line = rt_read_str();\n"
+    "    v = strtoll(line, &end, 10);\n"
+    "    while (*end == ' ' || *end == '\\t' || *end == '\\r')\n"
+    "        end++;\n"
+    "    if (end == line || *end != '\\0')\n"
+    "        rt_fail(\"ValueError\", \"invalid literal for int()\");\n"
+    "    free(line);\n"
+    "    return v;\n"
+    "}\n"
+    "\n"
+    "double rt_read_float(void) {\n"
+    "    char *line, *end;\n"
+    "    double v;\n"
+    "\n"
+    "    line = rt_read_str();\n"
+    "    v = strtod(line, &end);\n"
+    "    while (*end == ' ' || *end == '\\t' || *end == '\\r')\n"
+    "        end++;\n"
+    "    if (end == line || *end != '\\0')\n"
+    "        rt_fail(\"ValueError\", \"could not convert string to float\");\n"
+    "    free(line);\n"
+    "    return v;\n"
+    "}\n"
+    "\n"
+    "int rt_read_bool(void) {\n"
+    "    return rt_truth_str(rt_read_str());\n"
+    "}\n";
+
+
+const char* cgenC_Type (int type) {
+    switch (type) {
+        case _int: return "long long";
+        case _float: return "double";
+        case _string: return "char*";
+        case _list: return "rt_list*";
+        default: return "int";
+    }
+}
+
+
+int is_Numeric (int type) {
+    // bool compares as a number, as in Python
+    return type == _int || type == _float || type == _bool;
+}
+
+
+void cgenC_Name (struct Token* var, struct Emitter* out) {
+    // The prefix keeps the identifiers away from the C keywords and from the runtime
+    emit_Mem(out, "v_", 2);
+    emit_Mem(out, var->lexeme, var->len);
+}
+
+
+void cgenC_Literal (struct Token* str, struct Emitter* out) {
+    /*
+     * The lexeme keeps its quotes. C reads the escapes of Python but a few:
+     * a raw newline becomes \n, and an unknown escape keeps its backslash as in Python.
+    */
+    const char* s;
+    size_t i;
+
+    s = str->lexeme;
+    for (i = 0; i < str->len; i++) {
+        if (s[i] == '\n')
+            emit_Mem(out, "\\n", 2);
+        else if (s[i] == '\\' && i + 2 < str->len && strchr("\\'\"abfnrtvx01234567", s[i + 1]) != NULL) {
+            emit_Mem(out, s + i, 2);
+            i++;
+        }
+        else if (s[i] == '\\')
+            emit_Mem(out, "\\\\", 2);
+        else
+            emit_Char(out, s[i]);
+    }
+}
+
+
+int cgenC_Var (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    /*
+     * A string is copied: every string expression gives a new string,
+     * that whoever uses it (rt_set, rt_print, ...) frees.
+    */
+    struct Symbol* sym;
+
+    if (! tree || tree->data->type != Var)
+        return PARSING_ERROR;
+    sym = search_symbol(table, tree->data->id);
+    if (sym == NULL)
+        return PARSING_ERROR;
+    if (sym->type == _string) {
+        emit_Mem(out, "rt_dup(", 7);
+        cgenC_Name(tree->data, out);
+        emit_Char(out, ')');
+    }
+    else
+        cgenC_Name(tree->data, out);
+    return SUBTREE_OK;
+}
+
+
+int cgenC_ToStr (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    // str() of the Obj, as a new string
+    const char* conv;
+
+    switch (type_Of(tree, table)) {
+        case _int: conv = "rt_str_int("; break;
+        case _float: conv = "rt_str_float("; break;
+        case _bool: conv = "rt_str_bool("; break;
+        case _list: conv = "rt_str_list("; break;
+        case _string: return cgenC_Obj(tree, out, table);
+        default: return PARSING_ERROR;
+    }
+    emit_Str(out, conv);
+    if (cgenC_Obj(tree, out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    emit_Char(out, ')');
+    return SUBTREE_OK;
+}
+
+
+int cgenC_QuotedStr (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    /*
+     * "..." , a, b  becomes  rt_format("...", 2, str(a), str(b))
+    */
+    struct ParseTree* arg;
+    char count[16];
+    int n;
+
+    if (! tree || tree->data->type != QuotedStr)
+        return PARSING_ERROR;
+
+    tree = tree->child; // actual quoted string node
+    if (tree->sibling == NULL) {
+        emit_Mem(out, "rt_dup(", 7);
+        cgenC_Literal(tree->data, out);
+        emit_Char(out, ')');
+        return SUBTREE_OK;
+    }
+
+    n = 0;
+    for (arg = tree->sibling; arg != NULL; arg = arg->sibling->sibling)
+        n++;
+    emit_Mem(out, "rt_format(", 10);
+    cgenC_Literal(tree->data, out);
+    snprintf(count, sizeof(count), ", %d", n);
+    emit_Str(out, count);
+    while (tree->sibling != NULL) {
+        tree = tree->sibling->sibling; // skip Comma
+        emit_Mem(out, ", ", 2);
+        if (cgenC_ToStr(tree, out, table) != SUBTREE_OK)
+            return PARSING_ERROR;
+    }
+    emit_Char(out, ')');
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Str (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    // a + b + c  becomes  rt_concat(rt_concat(a, b), c)
+    struct ParseTree* piece;
+
+    if (! tree || tree->data->type != Str)
+        return PARSING_ERROR;
+
+    tree = tree->child; // The first QuotedStr
+    for (piece = tree->sibling; piece != NULL; piece = piece->sibling->sibling)
+        emit_Mem(out, "rt_concat(", 10);
+    if (cgenC_QuotedStr(tree, out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    while (tree->sibling != NULL) {
+        emit_Mem(out, ", ", 2);
+        tree = tree->sibling->sibling;
+        if (cgenC_QuotedStr(tree, out, table) != SUBTREE_OK)
+            return PARSING_ERROR;
+        emit_Char(out, ')');
+    }
+    return SUBTREE_OK;
+}
+
+
+int cgenC_List (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    /*
+     * [a, b]  becomes  rt_new_list(type, 2, a, b), with each element cast to the
+     * type of the list: they go through the variable arguments.
+    */
+    struct ParseTree *elems, *obj;
+    const char* cast;
+    char head[48];
+    int type, n;
+
+    if (! tree || tree->data->type != List)
+        return PARSING_ERROR;
+
+    elems = tree->child->sibling;
+    if (elems->data->type != ListExpr)
+        return PARSING_ERROR;
+    type = type_Of(elems, table);
+    if (type < 0)
+        return PARSING_ERROR;
+    n = 0;
+    for (obj = elems->child; obj != NULL; obj = obj->sibling->sibling) {
+        n++;
+        if (obj->sibling == NULL)
+            break;
+    }
+
+    if (type == _int || type == _bool)
+        cast = "(long long) ";
+    else if (type == _float)
+        cast = "(double) ";
+    else
+        cast = "";
+    snprintf(head, sizeof(head), "rt_new_list(%d, %d", type, n);
+    emit_Str(out, head);
+    for (obj = elems->child; obj != NULL; obj = obj->sibling->sibling) {
+        emit_Mem(out, ", ", 2);
+        emit_Str(out, cast);
+        if (cgenC_Obj(obj, out, table) != SUBTREE_OK)
+            return PARSING_ERROR;
+        if (obj->sibling == NULL)
+            break;
+    }
+    emit_Char(out, ')');
+    return SUBTREE_OK;
+}
+
+
+int cgenC_ListElem (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    struct Symbol* sym;
+    struct ParseTree* idx;
+    const char* get;
+
+    if (! tree || tree->data->type != ListElem)
+        return PARSING_ERROR;
+
+    sym = search_symbol(table, tree->child->data->id);
+    if (sym == NULL)
+        return PARSING_ERROR;
+    switch (sym->list_type) {
+        case _int: get = "rt_elem_int("; break;
+        case _float: get = "rt_elem_float("; break;
+        case _string: get = "rt_elem_str("; break;
+        case _bool: get = "rt_elem_bool("; break;
+        case _list: get = "rt_elem_list("; break;
+        default: return PARSING_ERROR;
+    }
+    emit_Str(out, get);
+    cgenC_Name(tree->child->data, out);
+    emit_Mem(out, ", ", 2);
+
+    idx = tree->child->sibling->sibling;
+    if (idx->data->type == Int)
+        emit_Mem(out, idx->data->lexeme, idx->data->len);
+    else if (idx->data->type == Var)
+        cgenC_Name(idx->data, out);
+    else
+        return PARSING_ERROR;
+    emit_Char(out, ')');
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Obj (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    if (! tree || tree->data->type != Obj)
+        return PARSING_ERROR;
+
+    tree = tree->child;
+    switch (tree->data->type) {
+        case Var: return cgenC_Var(tree, out, table);
+        case Num: return cgen_Num(tree, out); // the same literal in C and Python
+        case Str: return cgenC_Str(tree, out, table);
+        case List: return cgenC_List(tree, out, table);
+        case ListElem: return cgenC_ListElem(tree, out, table);
+        case Bool:
+            emit_Char(out, tree->data->len == 4 ? '1' : '0');
+            return SUBTREE_OK;
+        default: return PARSING_ERROR; // as in the Python code, Null has no value
+    }
+}
+
+
+int cgenC_BaseExpr (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    if (! tree || tree->data->type != BaseExpr)
+        return PARSING_ERROR;
+
+    if (tree->child->data->type == Obj)
+        return cgenC_Obj(tree->child, out, table);
+
+    // must be ( Expr )
+    emit_Char(out, '(');
+    if (cgenC_Expr(tree->child->sibling, out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    emit_Char(out, ')');
+    return SUBTREE_OK;
+}
+
+
+/*
+ * Expr, Pred and Term are chains: operand (op operand)*
+ * The items of a chain are its operands at the even places and its operators in between.
+*/
+
+struct Chain {
+    struct ParseTree** items;
+    int* types; // type of each operand
+    int* left; // type of the chain up to each operand, for Term and Pred
+    int n; // operands
+};
+
+
+int type_Aritm (int left, enum TokenType op, int right) {
+    if (left == _int && right == _int && op != FloatDiv)
+        return _int;
+    return _float;
+}
+
+
+void free_Chain (struct Chain* chain) {
+    free(chain->items);
+    free(chain->types);
+    free(chain->left);
+}
+
+
+int init_Chain (struct Chain* chain, struct ParseTree* tree, struct SymbolTable* table) {
+    int i;
+
+    chain->items = chain_Items(tree, &chain->n);
+    if (chain->items == NULL)
+        return MEMORY_ERROR;
+    chain->types = malloc(chain->n * sizeof(int));
+    chain->left = malloc(chain->n * sizeof(int));
+    if (chain->types == NULL || chain->left == NULL) {
+        free_Chain(chain);
+        return MEMORY_ERROR;
+    }
+    for (i = 0; i < chain->n; i++)
+        chain->types[i] = type_Of(chain->items[2 * i], table);
+    chain->left[0] = chain->types[0];
+    for (i = 1; i < chain->n; i++)
+        chain->left[i] = type_Aritm(chain->left[i - 1], chain->items[2 * i - 1]->data->type, chain->types[i]);
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Operand (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    switch (tree->data->type) {
+        case Pred: return cgenC_Pred(tree, out, table);
+        case Term: return cgenC_Term(tree, out, table);
+        default: return cgenC_BaseExpr(tree, out, table);
+    }
+}
+
+
+int cgenC_Aritm (struct Chain* chain, int k, struct Emitter* out, struct SymbolTable* table) {
+    /*
+     * The chain up to its k-th operand.
+     * Python evaluates it from the left: a - b / c  is  a - rt_idiv(b, c)  in a Pred,
+     * a / b * c  is  rt_idiv(a, b) * c  in a Term. / and % need a call for their
+     * floor and their error on zero, + - * are written as they are.
+    */
+    struct ParseTree* op;
+    const char* call;
+    int both_int;
+
+    if (k == 0)
+        return cgenC_Operand(chain->items[0], out, table);
+
+    op = chain->items[2 * k - 1];
+    both_int = chain->left[k - 1] == _int && chain->types[k] == _int;
+
+    switch (op->data->type) {
+        case Div: call = both_int ? "rt_idiv(" : "rt_fdiv("; break;
+        case FloatDiv: call = "rt_fdiv("; break;
+        case Percent: call = both_int ? "rt_imod(" : "rt_fmod("; break;
+        default: call = NULL;
+    }
+
+    if (call != NULL)
+        emit_Str(out, call);
+    if (cgenC_Aritm(chain, k - 1, out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    if (call != NULL)
+        emit_Mem(out, ", ", 2);
+    else if (op->data->type == Plus)
+        emit_Mem(out, " + ", 3);
+    else if (op->data->type == Minus)
+        emit_Mem(out, " - ", 3);
+    else if (op->data->type == Star)
+        emit_Mem(out, " * ", 3);
+    else
+        return PARSING_ERROR;
+    if (cgenC_Operand(chain->items[2 * k], out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    if (call != NULL)
+        emit_Char(out, ')');
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Term (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    struct Chain chain;
+    int status;
+
+    if (! tree || tree->data->type != Term)
+        return PARSING_ERROR;
+    if (tree->child->sibling == NULL)
+        return cgenC_BaseExpr(tree->child, out, table);
+    status = init_Chain(&chain, tree, table);
+    if (status != SUBTREE_OK)
+        return status;
+    status = cgenC_Aritm(&chain, chain.n - 1, out, table);
+    free_Chain(&chain);
+    return status;
+}
+
+
+int cgenC_Pred (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    struct Chain chain;
+    int status;
+
+    if (! tree || tree->data->type != Pred)
+        return PARSING_ERROR;
+    if (tree->child->sibling == NULL)
+        return cgenC_Term(tree->child, out, table);
+    status = init_Chain(&chain, tree, table);
+    if (status != SUBTREE_OK)
+        return status;
+    status = cgenC_Aritm(&chain, chain.n - 1, out, table);
+    free_Chain(&chain);
+    return status;
+}
+
+
+int cgenC_Truth (struct Chain* chain, int k, struct Emitter* out, struct SymbolTable* table) {
+    // The k-th operand as a condition: and, or work on any type in Python
+    const char* call;
+
+    switch (chain->types[k]) {
+        case _bool: return cgenC_Pred(chain->items[2 * k], out, table);
+        case _string: call = "rt_truth_str("; break;
+        case _list: call = "rt_truth_list("; break;
+        default: call = NULL;
+    }
+    emit_Str(out, call != NULL ? call : "(");
+    if (cgenC_Pred(chain->items[2 * k], out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    emit_Str(out, call != NULL ? ")" : " != 0)");
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Compare (struct Chain* chain, int k, struct Emitter* out, struct SymbolTable* table) {
+    /*
+     * The k-th operand compared with the next one.
+     * Strings and lists compare by value. Values of different types are never
+     * equal, but numbers and bools: the comparison is known already.
+    */
+    enum TokenType op;
+    int left, right, eq;
+    const char* call;
+
+    op = chain->items[2 * k + 1]->data->type;
+    left = chain->types[k];
+    right = chain->types[k + 1];
+    eq = op == EqEq || op == NotEq;
+    if (is_Numeric(left) && is_Numeric(right))
+        call = NULL;
+    else if (eq && left == _string && right == _string)
+        call = "rt_streq(";
+    else if (eq && left == _list && right == _list)
+        call = "rt_list_eq(";
+    else if (eq) {
+        emit_Char(out, op == EqEq ? '0' : '1');
+        return SUBTREE_OK;
+    }
+    else
+        return PARSING_ERROR;
+
+    if (call == NULL)
+        emit_Char(out, '(');
+    else {
+        if (op == NotEq)
+            emit_Mem(out, "! ", 2);
+        emit_Str(out, call);
+    }
+    if (cgenC_Pred(chain->items[2 * k], out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    if (call != NULL)
+        emit_Mem(out, ", ", 2);
+    else {
+        emit_Char(out, ' ');
+        emit_Str(out, cgen_Op(chain->items[2 * k + 1]));
+        emit_Char(out, ' ');
+    }
+    if (cgenC_Pred(chain->items[2 * k + 2], out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    emit_Char(out, ')');
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Logic (struct Chain* chain, int first, int last, int truth, struct Emitter* out, struct SymbolTable* table) {
+    /*
+     * The operands from first to last, grouped as Python groups the Python code (see chain_Level).
+     * With truth, a single operand is written as a condition.
+    */
+    int k, from, level;
+
+    level = chain_Level(chain->items, first, last);
+    if (level == 2) {
+        if (first == last && truth)
+            return cgenC_Truth(chain, first, out, table);
+        if (first == last)
+            return cgenC_Pred(chain->items[2 * first], out, table);
+        if (last > first + 1)
+            emit_Char(out, '(');
+        for (k = first; k < last; k++) {
+            if (k > first)
+                emit_Mem(out, " && ", 4);
+            if (cgenC_Compare(chain, k, out, table) != SUBTREE_OK)
+                return PARSING_ERROR;
+        }
+        if (last > first + 1)
+            emit_Char(out, ')');
+        return SUBTREE_OK;
+    }
+
+    emit_Char(out, '(');
+    for (from = first; from <= last; from = k + 1) {
+        k = chain_Group(chain->items, from, last, level);
+        if (from > first)
+            emit_Str(out, level == 0 ? " || " : " && ");
+        if (cgenC_Logic(chain, from, k, 1, out, table) != SUBTREE_OK)
+            return PARSING_ERROR;
+    }
+    emit_Char(out, ')');
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Expr (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    struct Chain chain;
+    int status;
+
+    if (! tree || tree->data->type != Expr)
+        return PARSING_ERROR;
+    if (tree->child->sibling == NULL)
+        return cgenC_Pred(tree->child, out, table);
+    status = init_Chain(&chain, tree, table);
+    if (status != SUBTREE_OK)
+        return status;
+    status = cgenC_Logic(&chain, 0, chain.n - 1, 0, out, table);
+    free_Chain(&chain);
+    return status;
+}
+
+
+int cgenC_Assign (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    struct Symbol* sym;
+
+    if (! tree || tree->data->type != Assign)
+        return PARSING_ERROR;
+
+    sym = search_symbol(table, tree->child->data->id);
+    if (sym == NULL)
+        return PARSING_ERROR;
+    if (sym->type == _string) {
+        // the old string is freed
+        emit_Mem(out, "rt_set(&", 8);
+        cgenC_Name(tree->child->data, out);
+        emit_Mem(out, ", ", 2);
+    }
+    else {
+        cgenC_Name(tree->child->data, out);
+        emit_Mem(out, " = ", 3);
+    }
+    if (cgenC_Expr(tree->child->sibling->sibling, out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    emit_Str(out, sym->type == _string ? ");" : ";");
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Input (struct ParseTree* tree, struct Emitter* out) {
+    struct Token *readin, *var;
+
+    if (! tree || tree->data->type != Input)
+        return PARSING_ERROR;
+
+    readin = tree->child->data;
+    var = tree->child->sibling->data;
+
+    if (readin->id == ID_READSTR) {
+        emit_Mem(out, "rt_set(&", 8);
+        cgenC_Name(var, out);
+        emit_Str(out, ", rt_read_str());");
+        return SUBTREE_OK;
+    }
+    cgenC_Name(var, out);
+    if (readin->id == ID_READINT)
+        emit_Str(out, " = rt_read_int();");
+    else if (readin->id == ID_READFLOAT)
+        emit_Str(out, " = rt_read_float();");
+    else
+        emit_Str(out, " = rt_read_bool();");
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Output (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    if (! tree || tree->data->type != Output)
+        return PARSING_ERROR;
+
+    emit_Mem(out, "rt_print(", 9);
+    if (cgenC_ToStr(tree->child->sibling, out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    emit_Mem(out, ");", 2);
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Block (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    // Lines up to the end or to the else, one level more indented, and the closing brace
+    out->indent += INDENT_LEV;
+    while (tree != NULL && tree->data->type != OptElse) {
+        if (cgenC_Line(tree, out, table) != SUBTREE_OK)
+            return PARSING_ERROR;
+        tree = tree->sibling->sibling;
+    }
+    out->indent -= INDENT_LEV;
+    emit_Char(out, '}');
+    return SUBTREE_OK;
+}
+
+
+int cgenC_IfLine (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    struct ParseTree *cond, *body;
+
+    if (! tree || tree->data->type != IfLine)
+        return PARSING_ERROR;
+
+    cond = tree->child->sibling->child->sibling;
+    emit_Mem(out, "if (", 4);
+    if (cgenC_Expr(cond, out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    emit_Mem(out, ") {", 3);
+    emit_Newline(out);
+
+    body = tree->child->sibling->sibling->child; // 1st line
+    if (cgenC_Block(body, out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+
+    while (body != NULL && body->data->type != OptElse)
+        body = body->sibling->sibling;
+    if (body == NULL || body->child->sibling == NULL)
+        return SUBTREE_OK;
+    emit_Mem(out, " else {", 7);
+    emit_Newline(out);
+    return cgenC_Block(body->child->sibling, out, table);
+}
+
+
+int cgenC_LoopLine (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    struct ParseTree *cond, *body;
+
+    if (! tree || tree->data->type != LoopLine)
+        return PARSING_ERROR;
+
+    cond = tree->child->sibling->child->sibling;
+    emit_Mem(out, "while (", 7);
+    if (cgenC_Expr(cond, out, table) != SUBTREE_OK)
+        return PARSING_ERROR;
+    emit_Mem(out, ") {", 3);
+    emit_Newline(out);
+
+    body = tree->child->sibling->sibling;
+    if (! body || body->data->type != Program)
+        return PARSING_ERROR;
+    return cgenC_Block(body->child, out, table);
+}
+
+
+int cgenC_Line (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    int status;
+    enum TokenType type;
+
+    if (! tree || tree->data->type != Line)
+        return PARSING_ERROR;
+
+    type = tree->child->data->type;
+    if (type == Assign)
+        status = cgenC_Assign(tree->child, out, table);
+    else if (type == Output)
+        status = cgenC_Output(tree->child, out, table);
+    else if (type == Input)
+        status = cgenC_Input(tree->child, out);
+    else if (type == IfLine)
+        status = cgenC_IfLine(tree->child, out, table);
+    else if (type == LoopLine)
+        status = cgenC_LoopLine(tree->child, out, table);
+    else if (type == Break) {
+        emit_Mem(out, "break;", 6);
+        status = SUBTREE_OK;
+    }
+    else if (type == Continue) {
+        emit_Mem(out, "continue;", 9);
+        status = SUBTREE_OK;
+    }
+    else
+        status = PARSING_ERROR;
+
+    if (status != SUBTREE_OK)
+        return status;
+    emit_Newline(out);
+    return SUBTREE_OK;
+}
+
+
+int cgenC_Program (struct ParseTree* tree, struct Emitter* out, struct SymbolTable* table) {
+    /*
+     * The runtime, one global for each symbol, and the lines in main.
+     * The variables are globals as in the Python code, where if and while have no scope.
+    */
+    struct Symbol *sym, **syms;
+    size_t n, i;
+
+    if (! tree || tree->data->type != Program || tree->child == NULL)
+        return PARSING_ERROR;
+
+    emit_Str(out, runtime_C);
+    emit_Newline(out);
+
+    // In the order they were defined
+    n = 0;
+    for (sym = table->last; sym != NULL; sym = sym->prev)
+        n++;
+    syms = malloc((n + 1) * sizeof(struct Symbol*));
+    if (syms == NULL)
+        return MEMORY_ERROR;
+    i = n;
+    for (sym = table->last; sym != NULL; sym = sym->prev)
+        syms[--i] = sym;
+    for (i = 0; i < n; i++) {
+        emit_Mem(out, "static ", 7);
+        emit_Str(out, cgenC_Type(syms[i]->type));
+        emit_Mem(out, " v_", 3);
+        emit_Str(out, syms[i]->sym);
+        emit_Char(out, ';');
+        emit_Newline(out);
+    }
+    free(syms);
+    emit_Newline(out);
+
+    emit_Str(out, "int main(void) {");
+    emit_Newline(out);
+    out->indent += INDENT_LEV;
+    for (tree = tree->child; tree != NULL; tree = tree->sibling->sibling)
+        if (cgenC_Line(tree, out, table) != SUBTREE_OK)
+            return PARSING_ERROR;
+    emit_Str(out, "return 0;");
+    emit_Newline(out);
+    out->indent -= INDENT_LEV;
+    emit_Char(out, '}');
+    emit_Newline(out);
+    return SUBTREE_OK;
+}
+
+
+struct CodeC {
+    struct ParseTree* root;
+    struct SymbolTable* table;
+};
+
+
+int gen_C (void* ctx, struct Emitter* out) {
+    struct CodeC* code;
+
+    code = ctx;
+    return cgenC_Program(code->root, out, code->table);
+}
+
+
+char* code_gen_C (struct ParseTree *root, struct SymbolTable *table) {
+    struct Emitter out;
+
+    if (init_Emitter(&out, -1) != SUBTREE_OK)
+        return NULL;
+    if (cgenC_Program(root, &out, table) != SUBTREE_OK || out.error != SUBTREE_OK) {
+        free(out.buf);
+        return NULL;
+    }
+    out.buf[out.len] = '\0';
+    return out.buf;
+}
+
+
+int code_gen_C_ToFile (struct ParseTree *root, struct SymbolTable *table, const char *fileName, size_t *written) {
+    struct CodeC code;
+
+    code.root = root;
+    code.table = table;
+    return emit_ToFile(fileName, written, gen_C, &code);
+}
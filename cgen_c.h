@@ -0,0 +1,26 @@
+#ifndef CGEN_C_H
+#define CGEN_C_H
+
+#include "cgen.h"
+#include "semantic.h"
+
+/*
+ * Second target of the code generation: a portable C program.
+ * The variables get the C type of their symbol (long long, double, int, char*, rt_list*)
+ * and the program carries a small runtime, so that it behaves like the Python code:
+ * floor division and modulo, repr of floats and lists, errors that exit with status 1.
+ * The table is the one filled by analyze_Program_Table.
+*/
+
+/*
+ * Return the C code of the program as a NUL-terminated string,
+ * or NULL on error. The caller must free the result.
+*/
+char* code_gen_C (struct ParseTree *root, struct SymbolTable *table);
+
+/*
+ * Generate the C code straight into the file, with emit_ToFile.
+*/
+int code_gen_C_ToFile (struct ParseTree *root, struct SymbolTable *table, const char *fileName, size_t *written);
+
+#endif
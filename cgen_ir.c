@@ -0,0 +1,627 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "cgen_ir.h"
+#include "vm.h"
+
+
+/*
+ * Precedence of the Python operators, from the loosest.
+ * Comparisons chain in Python (a < b == c), so one is never an operand of another without parentheses.
+*/
+#define PREC_OR 1
+#define PREC_AND 2
+#define PREC_NOT 3
+#define PREC_CMP 4
+#define PREC_ADD 5
+#define PREC_MUL 6
+#define PREC_UNARY 7
+#define PREC_ATOM 9
+
+
+struct RaiseLoop {
+    int head, exit;
+    int test; // the block that branches out of the loop, -1 if it does not
+};
+
+struct Raise {
+    struct Ir* ir;
+    struct Emitter* out;
+    int* uses;
+    int* user; // the instruction of the last use, or -1 - block for a phi of a successor
+    int* pos; // in its block
+    int* at; // position where the value is computed: its own, or the one of its user. The copies of the phis come after the terminator
+    char* inlined; // written in place of its use
+};
+
+
+/*
+ * ---------------
+ * Where each value is computed
+ * ---------------
+*/
+
+int is_Loud (struct Ir* ir, struct IrIns* ins) {
+    // What cannot change its place with another loud one: output, input, errors
+    return (ir_Ops[ins->op].effect && ! ir_Ops[ins->op].term) || may_Fail(ir, ins);
+}
+
+
+int has_Expr (int op) {
+    // Values computed by an expression, that can be written in place of their use
+    return (op >= IR_ADD && op <= IR_ELEM) || op == IR_READ;
+}
+
+
+int can_Inline (struct Raise* r, int v) {
+    /*
+     * A value with one use, in the same block, goes in place of it.
+     * A loud one only if no loud instruction between them is computed
+     * before or in the same statement: it would go first.
+    */
+    struct Ir* ir = r->ir;
+    struct IrIns* ins = ir->ins + v;
+    int u, block, at, x;
+
+    if (! has_Expr(ins->op) || r->uses[v] != 1)
+        return 0;
+    u = r->user[v];
+    block = u >= 0 ? ir->ins[u].block : -1 - u;
+    if (block != ins->block)
+        return 0;
+    if (! is_Loud(ir, ins))
+        return 1;
+    if (u < 0 && ir->ins[ir->blocks[block].last].op != IR_JMP)
+        return 0; // the copies come after the condition of the branch
+    at = u >= 0 ? r->at[u] : r->pos[ir->blocks[block].last] + 1;
+    for (x = ins->next; x >= 0 && r->pos[x] < at; x = ir->ins[x].next)
+        if (is_Loud(ir, ir->ins + x) && r->at[x] <= at)
+            return 0;
+    return 1;
+}
+
+
+int place_Values (struct Raise* r) {
+    // Uses, then the values of each block from the last one: a user is placed before its operands
+    struct Ir* ir = r->ir;
+    struct IrBlock* bl;
+    struct IrIns* ins;
+    int b, i, k, v, n;
+
+    for (b = 0; b < ir->nblocks; b++) {
+        bl = ir->blocks + b;
+        if (bl->dead)
+            continue;
+        n = 0;
+        for (i = bl->first; i >= 0; i = ins->next) {
+            ins = ir->ins + i;
+            r->pos[i] = n++;
+            for (k = 0; k < count_Operands(ins); k++) {
+                v = *operand_At(ir, ins, k);
+                r->uses[v]++;
+                r->user[v] = ins->op == IR_PHI ? -1 - ir->preds[bl->pred + k] : i;
+            }
+        }
+    }
+    for (b = 0; b < ir->nblocks; b++) {
+        bl = ir->blocks + b;
+        if (bl->dead)
+            continue;
+        for (i = bl->last; i >= 0; i = ir->ins[i].prev) {
+            r->inlined[i] = can_Inline(r, i);
+            if (! r->inlined[i])
+                r->at[i] = r->pos[i];
+            else if (r->user[i] < 0)
+                r->at[i] = r->pos[bl->last] + 1;
+            else
+                r->at[i] = r->at[r->user[i]];
+        }
+    }
+    return SUBTREE_OK;
+}
+
+
+/*
+ * ---------------
+ * Expressions
+ * ---------------
+*/
+
+void raise_Name (struct Raise* r, int v) {
+    // Source names have no underscore: these never hide one
+    char num[32];
+
+    if (r->ir->ins[v].var > 0) {
+        emit_Str(r->out, lexeme_Of(r->ir->ins[v].var));
+        emit_Char(r->out, '_');
+    }
+    else
+        emit_Mem(r->out, "t_", 2);
+    snprintf(num, sizeof(num), "%d", v);
+    emit_Str(r->out, num);
+}
+
+
+int const_Prec (struct IrConst* c) {
+    // A negative number is an operation in Python, and so is +1
+    if (c->text != NULL)
+        return c->text[0] == '-' || c->text[0] == '+' ? PREC_UNARY : PREC_ATOM;
+    if (c->type == _float)
+        return signbit(c->f) ? PREC_UNARY : PREC_ATOM;
+    if (c->type == _int)
+        return c->i < 0 ? PREC_UNARY : PREC_ATOM;
+    return PREC_ATOM;
+}
+
+
+void raise_Const (struct Raise* r, struct IrConst* c) {
+    char num[400];
+
+    if (c->text != NULL)
+        emit_Str(r->out, c->text);
+    else if (c->type == _float) {
+        str_Float(c->f, num);
+        emit_Str(r->out, num);
+    }
+    else if (c->type == _bool)
+        emit_Str(r->out, c->i ? "True" : "False");
+    else if (c->type == _null)
+        emit_Mem(r->out, "None", 4);
+    else {
+        snprintf(num, sizeof(num), "%lld", c->i);
+        emit_Str(r->out, num);
+    }
+}
+
+
+int def_Prec (struct Raise* r, int v) {
+    struct IrIns* ins = r->ir->ins + v;
+
+    switch (ins->op) {
+        case IR_CONST: return const_Prec(r->ir->consts + ins->a);
+        case IR_OR: return PREC_OR;
+        case IR_AND: return PREC_AND;
+        case IR_LT: case IR_LE: case IR_GT: case IR_GE: case IR_EQ: case IR_NE: return PREC_CMP;
+        case IR_ADD: case IR_SUB: case IR_CONCAT: return PREC_ADD;
+        case IR_MUL: case IR_DIV: case IR_FDIV: case IR_MOD: case IR_FORMAT: return PREC_MUL;
+        default: return PREC_ATOM;
+    }
+}
+
+
+void raise_Def (struct Raise* r, int v, int prec);
+
+
+void raise_Expr (struct Raise* r, int v, int prec) {
+    // The value where it is used: its name, its constant, or its expression
+    struct IrIns* ins = r->ir->ins + v;
+
+    if (ins->op == IR_CONST || r->inlined[v])
+        raise_Def(r, v, prec);
+    else
+        raise_Name(r, v);
+}
+
+
+const char* op_Python (int op) {
+    switch (op) {
+        case IR_ADD: case IR_CONCAT: return " + ";
+        case IR_SUB: return " - ";
+        case IR_MUL: return " * ";
+        case IR_DIV: case IR_FDIV: return " / ";
+        case IR_MOD: case IR_FORMAT: return " % ";
+        case IR_LT: return " < ";
+        case IR_LE: return " <= ";
+        case IR_GT: return " > ";
+        case IR_GE: return " >= ";
+        case IR_EQ: return " == ";
+        case IR_NE: return " != ";
+        case IR_AND: return " and ";
+        case IR_OR: return " or ";
+        default: return NULL;
+    }
+}
+
+
+void raise_Def (struct Raise* r, int v, int prec) {
+    // The expression that computes v, in parentheses if it binds looser than prec
+    struct IrIns* ins = r->ir->ins + v;
+    int p, k;
+
+    p = def_Prec(r, v);
+    if (p < prec)
+        emit_Char(r->out, '(');
+    switch (ins->op) {
+        case IR_CONST:
+            raise_Const(r, r->ir->consts + ins->a);
+            break;
+        case IR_LIST:
+            emit_Char(r->out, '[');
+            for (k = 0; k < ins->c; k++) {
+                if (k > 0)
+                    emit_Mem(r->out, ", ", 2);
+                raise_Expr(r, r->ir->args[ins->b + k], PREC_OR);
+            }
+            emit_Char(r->out, ']');
+            break;
+        case IR_ELEM:
+            raise_Expr(r, ins->a, PREC_ATOM);
+            emit_Char(r->out, '[');
+            raise_Expr(r, ins->b, PREC_OR);
+            emit_Char(r->out, ']');
+            break;
+        case IR_FORMAT:
+            // "..." % x, or "..." % (x, y)
+            raise_Expr(r, ins->a, PREC_MUL);
+            emit_Str(r->out, op_Python(ins->op));
+            if (ins->c == 1)
+                raise_Expr(r, r->ir->args[ins->b], PREC_UNARY);
+            else {
+                emit_Char(r->out, '(');
+                for (k = 0; k < ins->c; k++) {
+                    if (k > 0)
+                        emit_Mem(r->out, ", ", 2);
+                    raise_Expr(r, r->ir->args[ins->b + k], PREC_OR);
+                }
+                emit_Char(r->out, ')');
+            }
+            break;
+        case IR_READ:
+            if (ins->type == _int)
+                emit_Str(r->out, "int(input())");
+            else if (ins->type == _float)
+                emit_Str(r->out, "float(input())");
+            else if (ins->type == _string)
+                emit_Str(r->out, "input()");
+            else
+                emit_Str(r->out, "bool(input())");
+            break;
+        default:
+            // a op b: the left operand can be at the same level, unless it is a comparison
+            raise_Expr(r, ins->a, p == PREC_CMP ? p + 1 : p);
+            emit_Str(r->out, op_Python(ins->op));
+            raise_Expr(r, ins->b, p + 1);
+    }
+    if (p < prec)
+        emit_Char(r->out, ')');
+}
+
+
+/*
+ * ---------------
+ * Statements
+ * ---------------
+*/
+
+int is_Stmt (struct Raise* r, int i) {
+    // Instructions written as a line of their own
+    struct IrIns* ins = r->ir->ins + i;
+
+    if (ins->op == IR_PRINT)
+        return 1;
+    if (! has_Expr(ins->op) || r->inlined[i])
+        return 0;
+    return r->uses[i] > 0 || is_Loud(r->ir, ins);
+}
+
+
+void raise_Stmt (struct Raise* r, int i) {
+    struct IrIns* ins = r->ir->ins + i;
+
+    if (ins->op == IR_PRINT) {
+        emit_Mem(r->out, "print(", 6);
+        raise_Expr(r, ins->a, PREC_OR);
+        emit_Char(r->out, ')');
+    }
+    else {
+        // A value that nothing uses is only there for its error
+        if (r->uses[i] > 0) {
+            raise_Name(r, i);
+            emit_Mem(r->out, " = ", 3);
+        }
+        raise_Def(r, i, PREC_OR);
+    }
+    emit_Newline(r->out);
+}
+
+
+int phi_Arg (struct Ir* ir, int phi, int from) {
+    // Operand of the phi for the edge, -1 if there is nothing to assign
+    struct IrBlock* bl = ir->blocks + ir->ins[phi].block;
+    int k, v;
+
+    for (k = 0; k < bl->npreds; k++)
+        if (ir->preds[bl->pred + k] == from)
+            break;
+    if (k == bl->npreds)
+        return -1;
+    v = ir->args[ir->ins[phi].b + k];
+    if (v == phi || ir->ins[v].op == IR_UNDEF)
+        return -1;
+    return v;
+}
+
+
+int has_Copies (struct Raise* r, int from, int to) {
+    int i;
+
+    for (i = r->ir->blocks[to].first; i >= 0; i = r->ir->ins[i].next)
+        if (r->ir->ins[i].op == IR_PHI && phi_Arg(r->ir, i, from) >= 0)
+            return 1;
+    return 0;
+}
+
+
+void raise_Copies (struct Raise* r, int from, int to) {
+    // The phis of the edge, all at once: each one gets the value it had before the others
+    struct Ir* ir = r->ir;
+    int i, n;
+
+    n = 0;
+    for (i = ir->blocks[to].first; i >= 0; i = ir->ins[i].next)
+        if (ir->ins[i].op == IR_PHI && phi_Arg(ir, i, from) >= 0) {
+            if (n++ > 0)
+                emit_Mem(r->out, ", ", 2);
+            raise_Name(r, i);
+        }
+    if (n == 0)
+        return;
+    emit_Mem(r->out, " = ", 3);
+    n = 0;
+    for (i = ir->blocks[to].first; i >= 0; i = ir->ins[i].next)
+        if (ir->ins[i].op == IR_PHI && phi_Arg(ir, i, from) >= 0) {
+            if (n++ > 0)
+                emit_Mem(r->out, ", ", 2);
+            raise_Expr(r, phi_Arg(ir, i, from), PREC_OR);
+        }
+    emit_Newline(r->out);
+}
+
+
+int has_Stmts (struct Raise* r, int b) {
+    int i;
+
+    for (i = r->ir->blocks[b].first; i >= 0; i = r->ir->ins[i].next)
+        if (is_Stmt(r, i))
+            return 1;
+    return 0;
+}
+
+
+int loop_Skipped (struct Ir* ir, int h) {
+    // The condition is always false: the header is written as any other block, and goes on to the exit
+    struct IrBlock* test = ir->blocks + ir->blocks[h].test;
+
+    return ir->ins[test->last].op == IR_JMP && test->succ[0] == ir->blocks[h].exit;
+}
+
+
+int arm_Empty (struct Raise* r, int from, int b, int stop, struct RaiseLoop* loop) {
+    // Nothing would be written on the way from the edge to stop
+    struct IrBlock* bl;
+
+    if (has_Copies(r, from, b))
+        return 0;
+    while (b != stop) {
+        bl = r->ir->blocks + b;
+        if ((bl->exit >= 0 && ! loop_Skipped(r->ir, b)) || has_Stmts(r, b) || r->ir->ins[bl->last].op != IR_JMP)
+            return 0;
+        if (has_Copies(r, b, bl->succ[0]))
+            return 0;
+        if (bl->succ[0] != stop && loop != NULL && (bl->succ[0] == loop->head || bl->succ[0] == loop->exit))
+            return 0;
+        b = bl->succ[0];
+    }
+    return 1;
+}
+
+
+int raise_Seq (struct Raise* r, int b, int stop, struct RaiseLoop* loop, int entered);
+
+
+int raise_Arm (struct Raise* r, int from, int b, int stop, struct RaiseLoop* loop) {
+    // The lines of a branch, one level more indented
+    int status;
+
+    r->out->indent += INDENT_LEV;
+    raise_Copies(r, from, b);
+    status = raise_Seq(r, b, stop, loop, 0);
+    r->out->indent -= INDENT_LEV;
+    return status;
+}
+
+
+int raise_If (struct Raise* r, int b, struct RaiseLoop* loop) {
+    // The two ways meet at the join, or never if both leave by a break or a continue
+    struct IrBlock* bl = r->ir->blocks + b;
+    struct IrIns* br = r->ir->ins + bl->last;
+    int yes, no, status;
+
+    yes = ! arm_Empty(r, b, bl->succ[0], bl->join, loop);
+    no = ! arm_Empty(r, b, bl->succ[1], bl->join, loop);
+    if (! yes && no) {
+        emit_Mem(r->out, "if not ", 7);
+        raise_Expr(r, br->a, PREC_NOT + 1);
+        emit_Char(r->out, ':');
+        emit_Newline(r->out);
+        return raise_Arm(r, b, bl->succ[1], bl->join, loop);
+    }
+
+    emit_Mem(r->out, "if ", 3);
+    raise_Expr(r, br->a, PREC_OR);
+    emit_Char(r->out, ':');
+    emit_Newline(r->out);
+    if (! yes) {
+        r->out->indent += INDENT_LEV;
+        emit_Mem(r->out, "pass", 4);
+        emit_Newline(r->out);
+        r->out->indent -= INDENT_LEV;
+        return SUBTREE_OK;
+    }
+    status = raise_Arm(r, b, bl->succ[0], bl->join, loop);
+    if (status != SUBTREE_OK || ! no)
+        return status;
+    emit_Mem(r->out, "else:", 5);
+    emit_Newline(r->out);
+    return raise_Arm(r, b, bl->succ[1], bl->join, loop);
+}
+
+
+int raise_Loop (struct Raise* r, int h) {
+    /*
+     * while c: when the header only computes the condition, and leaving needs no copy.
+     * Else the header is the start of the body:
+     * while True: ... if not c: break ... with the copies of the exit before the break.
+    */
+    struct Ir* ir = r->ir;
+    struct IrBlock* bl = ir->blocks + h;
+    struct IrBlock* test = ir->blocks + bl->test;
+    struct IrIns* last = ir->ins + test->last;
+    struct RaiseLoop inner;
+    int status;
+
+    inner.head = h;
+    inner.exit = bl->exit;
+    inner.test = last->op == IR_BR ? bl->test : -1;
+    if (last->op == IR_BR && bl->test == h && ! has_Stmts(r, h) && ! has_Copies(r, h, bl->exit)) {
+        emit_Mem(r->out, "while ", 6);
+        raise_Expr(r, last->a, PREC_OR);
+        emit_Char(r->out, ':');
+        emit_Newline(r->out);
+        if (arm_Empty(r, h, bl->succ[0], h, &inner)) {
+            r->out->indent += INDENT_LEV;
+            emit_Mem(r->out, "pass", 4);
+            emit_Newline(r->out);
+            r->out->indent -= INDENT_LEV;
+            return SUBTREE_OK;
+        }
+        return raise_Arm(r, h, bl->succ[0], h, &inner);
+    }
+
+    emit_Mem(r->out, "while True:", 11);
+    emit_Newline(r->out);
+    r->out->indent += INDENT_LEV;
+    status = raise_Seq(r, h, h, &inner, 1);
+    r->out->indent -= INDENT_LEV;
+    return status;
+}
+
+
+int raise_Seq (struct Raise* r, int b, int stop, struct RaiseLoop* loop, int entered) {
+    /*
+     * The blocks from b to stop, that is the join of the enclosing if or the header
+     * of the enclosing loop. With entered, b is that header, and its loop is being written.
+    */
+    struct Ir* ir = r->ir;
+    struct IrBlock* bl;
+    struct IrIns* last;
+    int i, s, status;
+
+    while (b != stop || entered) {
+        bl = ir->blocks + b;
+        if (bl->exit >= 0 && ! entered && ! loop_Skipped(ir, b)) {
+            status = raise_Loop(r, b);
+            if (status != SUBTREE_OK)
+                return status;
+            emit_Newline(r->out);
+            b = bl->exit;
+            if (ir->blocks[b].dead || ir->blocks[b].npreds == 0)
+                return SUBTREE_OK; // the loop never ends
+            continue;
+        }
+        entered = 0;
+        for (i = bl->first; i >= 0; i = ir->ins[i].next)
+            if (is_Stmt(r, i))
+                raise_Stmt(r, i);
+
+        last = ir->ins + bl->last;
+        if (last->op == IR_EXIT)
+            return SUBTREE_OK;
+        if (last->op == IR_JMP) {
+            s = bl->succ[0];
+            raise_Copies(r, b, s);
+            if (s == stop)
+                return SUBTREE_OK;
+            if (loop != NULL && (s == loop->head || s == loop->exit)) {
+                emit_Str(r->out, s == loop->head ? "continue" : "break");
+                emit_Newline(r->out);
+                return SUBTREE_OK;
+            }
+            b = s;
+            continue;
+        }
+        if (last->op != IR_BR)
+            return PARSING_ERROR;
+
+        if (loop != NULL && b == loop->test) {
+            emit_Mem(r->out, "if not ", 7);
+            raise_Expr(r, last->a, PREC_NOT + 1);
+            emit_Char(r->out, ':');
+            emit_Newline(r->out);
+            r->out->indent += INDENT_LEV;
+            raise_Copies(r, b, bl->succ[1]);
+            emit_Mem(r->out, "break", 5);
+            emit_Newline(r->out);
+            r->out->indent -= INDENT_LEV;
+            emit_Newline(r->out);
+            raise_Copies(r, b, bl->succ[0]);
+            b = bl->succ[0];
+            continue;
+        }
+        status = raise_If(r, b, loop);
+        if (status != SUBTREE_OK)
+            return status;
+        emit_Newline(r->out);
+        if (bl->join < 0 || ir->blocks[bl->join].dead)
+            return SUBTREE_OK;
+        b = bl->join;
+    }
+    return SUBTREE_OK;
+}
+
+
+int gen_Ir (void* ir, struct Emitter* out) {
+    struct Raise r;
+    int n, status;
+
+    memset(&r, 0, sizeof(r));
+    r.ir = ir;
+    r.out = out;
+    n = r.ir->n + 1;
+    r.uses = calloc(n, sizeof(int));
+    r.user = malloc(n * sizeof(int));
+    r.at = malloc(n * sizeof(int));
+    r.pos = calloc(n, sizeof(int));
+    r.inlined = calloc(n, 1);
+    status = MEMORY_ERROR;
+    if (r.uses != NULL && r.user != NULL && r.at != NULL && r.pos != NULL && r.inlined != NULL
+        && place_Values(&r) == SUBTREE_OK)
+        status = raise_Seq(&r, 0, -1, NULL, 0);
+    free(r.uses);
+    free(r.user);
+    free(r.at);
+    free(r.pos);
+    free(r.inlined);
+    return status;
+}
+
+
+char* code_gen_Ir (struct Ir *ir) {
+    struct Emitter out;
+
+    if (init_Emitter(&out, -1) != SUBTREE_OK)
+        return NULL;
+    if (gen_Ir(ir, &out) != SUBTREE_OK || out.error != SUBTREE_OK) {
+        free(out.buf);
+        return NULL;
+    }
+    out.buf[out.len] = '\0';
+    return out.buf;
+}
+
+
+int code_gen_Ir_ToFile (struct Ir *ir, const char *fileName, size_t *written) {
+    return emit_ToFile(fileName, written, gen_Ir, ir);
+}
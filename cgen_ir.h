@@ -0,0 +1,28 @@
+#ifndef CGEN_IR_H
+#define CGEN_IR_H
+
+#include "cgen.h"
+#include "ir.h"
+
+/*
+ * Python code of a program in SSA form (see ir.h), after the passes.
+ * The blocks are written back as if, else and while: the ones that the lowering
+ * made for an if or a loop say where its branches meet (join) or where it ends (exit).
+ * Each value that is not written in place of its single use gets its own name,
+ * the one of its variable and its index (i_12), and the phis are assigned
+ * at the end of the blocks that jump to them, all at once: x, y = y, x.
+ * Nothing that can fail or read the input is moved past anything else that can.
+*/
+
+/*
+ * Return the Python code as a NUL-terminated string,
+ * or NULL on error. The caller must free the result.
+*/
+char* code_gen_Ir (struct Ir *ir);
+
+/*
+ * Generate the Python code straight into the file, with emit_ToFile.
+*/
+int code_gen_Ir_ToFile (struct Ir *ir, const char *fileName, size_t *written);
+
+#endif
@@ -0,0 +1,683 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "interp.h"
+#include "cgen.h"
+
+/*
+ * The frame holds the variables at their slots, then the literals: before the program runs,
+ * each number, string literal and constant index gets a slot of its own, with its value,
+ * so that a literal is read as a variable is.
+ * Expressions give their value in a union VmValue: a string or a list is a new reference,
+ * that the caller gives back.
+*/
+
+#define EXEC_ERROR -1
+#define EXEC_NEXT 0
+#define EXEC_BREAK 1
+#define EXEC_CONTINUE 2
+
+struct Interp {
+    union VmValue* frame;
+    char* is_obj; // slots that hold a string or a list
+    int nslots, cap;
+    struct VmBuf buf; // the strings being made, each one after the one that contains it
+    struct VmBuf line; // the last input line
+    const char* error; // the message of the runtime error
+    FILE *in, *out;
+};
+
+
+int eval_Expr (struct ParseTree* tree, struct Interp* it, union VmValue* v);
+int exec_Lines (struct ParseTree* line, struct Interp* it);
+
+
+int is_ObjType (int type) {
+    return type == _string || type == _list;
+}
+
+
+int fail_Interp (struct Interp* it, const char* error) {
+    it->error = error;
+    return EXEC_ERROR;
+}
+
+
+/*
+ * ---------------
+ * The frame
+ * ---------------
+*/
+
+int add_Slot (struct Interp* it, union VmValue v, int is_obj) {
+    // A new slot after the others, -1 on memory error
+    union VmValue* frame;
+    char* objs;
+    int cap;
+
+    if (it->nslots == it->cap) {
+        cap = it->cap > 0 ? 2 * it->cap : 64;
+        frame = realloc(it->frame, cap * sizeof(union VmValue));
+        if (frame == NULL)
+            return -1;
+        it->frame = frame;
+        objs = realloc(it->is_obj, cap);
+        if (objs == NULL)
+            return -1;
+        it->is_obj = objs;
+        it->cap = cap;
+    }
+    it->frame[it->nslots] = v;
+    it->is_obj[it->nslots] = is_obj;
+    return it->nslots++;
+}
+
+
+
+int visit_Literal (struct ParseTree* node, int depth, void* arg) {
+    // Give a slot to the literal under node, if there is one
+    struct Interp* it;
+    struct ParseTree* lit;
+    union VmValue v;
+    char* bytes;
+    int status, isfloat;
+
+    (void) depth;
+    it = arg;
+    if (it->error != NULL)
+        return 1;
+    switch (node->data->type) {
+        case Obj:
+            lit = node->child;
+            if (lit->data->type != Num)
+                return 0;
+            status = num_Literal(lit, &v.f, &v.i, &isfloat);
+            if ((status != SUBTREE_OK && status != NUM_RANGE) || (lit->slot = add_Slot(it, v, 0)) < 0)
+                it->error = "MemoryError: out of memory";
+            return 1;
+        case ListElem:
+            lit = node->child->sibling->sibling;
+            if (lit->data->type != Int)
+                return 1;
+            v.i = lexeme_Int(lit->data->lexeme, lit->data->len);
+            if ((lit->slot = add_Slot(it, v, 0)) < 0)
+                it->error = "MemoryError: out of memory";
+            return 1;
+        case QuotedStr:
+            lit = node->child;
+            if (lit == NULL)
+                return 0; // the literal itself
+            bytes = malloc(lit->data->len);
+            v.o = bytes == NULL ? NULL : new_VmStr(bytes, unescape_Literal(lit->data->lexeme + 1, lit->data->len - 2, bytes));
+            free(bytes);
+            if (v.o == NULL || (lit->slot = add_Slot(it, v, 1)) < 0) {
+                release_VmObj(v.o);
+                it->error = "MemoryError: out of memory";
+            }
+            return 0; // the arguments can have literals
+        default:
+            return 0;
+    }
+}
+
+
+int init_Frame (struct Interp* it, struct ParseTree* root, struct SymbolTable* table) {
+    // The variables first: strings and lists are empty until they are written, as in the C program
+    struct Symbol* sym;
+    union VmValue v;
+    int i;
+
+    v.i = 0;
+    for (i = 0; i < table->nslots; i++)
+        if (add_Slot(it, v, 0) < 0)
+            return MEMORY_ERROR;
+    for (sym = table->last; sym != NULL; sym = sym->prev) {
+        if (sym->type == _string)
+            v.o = new_VmStr("", 0);
+        else if (sym->type == _list)
+            v.o = new_VmList(0, sym->list_type >= 0 ? sym->list_type : _int);
+        else
+            continue;
+        if (v.o == NULL)
+            return MEMORY_ERROR;
+        it->frame[sym->slot] = v;
+        it->is_obj[sym->slot] = 1;
+    }
+    if (walk_ParseTree(root, visit_Literal, it) != SUBTREE_OK || it->error != NULL)
+        return MEMORY_ERROR;
+    return SUBTREE_OK;
+}
+
+
+/*
+ * ---------------
+ * Values
+ * ---------------
+*/
+
+int eval_Obj (struct ParseTree* tree, struct Interp* it, union VmValue* v);
+
+
+int append_QuotedStr (struct ParseTree* tree, struct Interp* it) {
+    // The literal, or literal % (args), at the end of it->buf
+    struct ParseTree *arg;
+    struct VmObj* lit;
+    union VmValue v;
+    size_t i;
+    int status;
+
+    lit = it->frame[tree->child->slot].o;
+    arg = tree->child->sibling;
+    if (arg == NULL)
+        return put_Buf(&it->buf, lit->s, lit->len) == SUBTREE_OK ? EXEC_NEXT : fail_Interp(it, "MemoryError: out of memory");
+
+    arg = arg->sibling;
+    status = SUBTREE_OK;
+    for (i = 0; i < lit->len && status == SUBTREE_OK; i++) {
+        if (lit->s[i] == '%' && lit->s[i + 1] == '%') {
+            status = put_Buf(&it->buf, "%", 1);
+            i++;
+        }
+        else if (lit->s[i] == '%' && lit->s[i + 1] == 's' && arg != NULL) {
+            if (eval_Obj(arg, it, &v) < 0)
+                return EXEC_ERROR;
+            status = str_Value(&it->buf, v, arg->value_type, 0);
+            if (is_ObjType(arg->value_type))
+                release_VmObj(v.o);
+            arg = arg->sibling != NULL ? arg->sibling->sibling : NULL;
+            i++;
+        }
+        else
+            status = put_Buf(&it->buf, lit->s + i, 1);
+    }
+    return status == SUBTREE_OK ? EXEC_NEXT : fail_Interp(it, "MemoryError: out of memory");
+}
+
+
+int eval_Str (struct ParseTree* tree, struct Interp* it, union VmValue* v) {
+    // The pieces one after the other, at the end of it->buf: a single literal is its slot
+    struct ParseTree* piece;
+    size_t start;
+
+    piece = tree->child;
+    if (piece->sibling == NULL && piece->child->sibling == NULL) {
+        v->o = it->frame[piece->child->slot].o;
+        v->o->refs++;
+        return EXEC_NEXT;
+    }
+    start = it->buf.len;
+    for (; piece != NULL; piece = piece->sibling != NULL ? piece->sibling->sibling : NULL)
+        if (append_QuotedStr(piece, it) < 0)
+            return EXEC_ERROR;
+    v->o = new_VmStr(it->buf.s + start, it->buf.len - start);
+    it->buf.len = start;
+    return v->o != NULL ? EXEC_NEXT : fail_Interp(it, "MemoryError: out of memory");
+}
+
+
+int eval_List (struct ParseTree* tree, struct Interp* it, union VmValue* v) {
+    // The elements are converted to the type of the list
+    struct ParseTree *elems, *obj;
+    struct VmObj* list;
+    union VmValue e;
+    size_t n;
+    int type;
+
+    elems = tree->child->sibling;
+    type = elems->value_type;
+    n = 0;
+    for (obj = elems->child; obj != NULL; obj = obj->sibling != NULL ? obj->sibling->sibling : NULL)
+        n++;
+    list = new_VmList(n, type);
+    if (list == NULL)
+        return fail_Interp(it, "MemoryError: out of memory");
+    list->len = 0;
+    for (obj = elems->child; obj != NULL; obj = obj->sibling != NULL ? obj->sibling->sibling : NULL) {
+        if (eval_Obj(obj, it, &e) < 0) {
+            release_VmObj(list);
+            return EXEC_ERROR;
+        }
+        if (type == _float && obj->value_type != _float)
+            e.f = (double) e.i;
+        list->data[list->len++] = e;
+    }
+    v->o = list;
+    return EXEC_NEXT;
+}
+
+
+int eval_ListElem (struct ParseTree* tree, int type, struct Interp* it, union VmValue* v) {
+    // A list variable can hold ints and then floats: the type of the elements is checked
+    struct VmObj* list;
+    union VmValue* elem;
+    long long idx;
+
+    list = it->frame[tree->child->slot].o;
+    idx = it->frame[tree->child->sibling->sibling->slot].i;
+    if (idx < 0)
+        idx += (long long) list->len;
+    if (idx < 0 || idx >= (long long) list->len)
+        return fail_Interp(it, "IndexError: list index out of range");
+    if (list->elem != type && ! ((list->elem == _int || list->elem == _bool) &&
+                                 (type == _int || type == _float || type == _bool)))
+        return fail_Interp(it, "TypeError: list element of unexpected type");
+    elem = list->data + idx;
+    if (is_ObjType(type))
+        elem->o->refs++;
+    if (type == _float && list->elem != _float)
+        v->f = (double) elem->i;
+    else
+        *v = *elem;
+    return EXEC_NEXT;
+}
+
+
+int eval_Obj (struct ParseTree* tree, struct Interp* it, union VmValue* v) {
+    struct ParseTree* node;
+
+    node = tree->child;
+    switch (node->data->type) {
+        case Var:
+        case Num:
+            *v = it->frame[node->slot];
+            if (is_ObjType(tree->value_type))
+                v->o->refs++;
+            return EXEC_NEXT;
+        case Bool:
+            v->i = node->data->len == 4;
+            return EXEC_NEXT;
+        case Str:
+            return eval_Str(node, it, v);
+        case List:
+            return eval_List(node, it, v);
+        case ListElem:
+            return eval_ListElem(node, tree->value_type, it, v);
+        default:
+            v->i = 0; // None
+            return EXEC_NEXT;
+    }
+}
+
+
+/*
+ * ---------------
+ * Expressions
+ * ---------------
+*/
+
+int eval_Operand (struct ParseTree* tree, struct Interp* it, union VmValue* v);
+
+
+int eval_Aritm (struct ParseTree* tree, struct Interp* it, union VmValue* v) {
+    /*
+     * Term and Pred: operand (op operand)*, from the left.
+     * A chain of type int has only ints: else each step is float once one side is,
+     * or the operator is /. (so 7 / 2 /. 2 is 1.5).
+    */
+    struct ParseTree* child;
+    enum TokenType op;
+    union VmValue r;
+    double a, b;
+    int type;
+
+    child = tree->child;
+    if (eval_Operand(child, it, v) < 0)
+        return EXEC_ERROR;
+    type = child->value_type;
+    while (child->sibling != NULL) {
+        op = child->sibling->data->type;
+        child = child->sibling->sibling;
+        if (eval_Operand(child, it, &r) < 0)
+            return EXEC_ERROR;
+
+        if (tree->value_type == _int || (type == _int && child->value_type == _int && op != FloatDiv)) {
+            switch (op) {
+                case Plus: v->i += r.i; break;
+                case Minus: v->i -= r.i; break;
+                case Star: v->i *= r.i; break;
+                case Div:
+                    if (r.i == 0)
+                        return fail_Interp(it, "ZeroDivisionError: integer division by zero");
+                    v->i = floor_Div(v->i, r.i);
+                    break;
+                default:
+                    if (r.i == 0)
+                        return fail_Interp(it, "ZeroDivisionError: integer modulo by zero");
+                    v->i = floor_Mod(v->i, r.i);
+            }
+            continue;
+        }
+        a = type == _float ? v->f : (double) v->i;
+        b = child->value_type == _float ? r.f : (double) r.i;
+        type = _float;
+        switch (op) {
+            case Plus: v->f = a + b; break;
+            case Minus: v->f = a - b; break;
+            case Star: v->f = a * b; break;
+            case Percent:
+                if (b == 0.0)
+                    return fail_Interp(it, "ZeroDivisionError: float modulo");
+                v->f = floor_FMod(a, b);
+                break;
+            default:
+                if (b == 0.0)
+                    return fail_Interp(it, "ZeroDivisionError: float division by zero");
+                v->f = a / b;
+        }
+    }
+    return EXEC_NEXT;
+}
+
+
+int eval_Operand (struct ParseTree* tree, struct Interp* it, union VmValue* v) {
+    switch (tree->data->type) {
+        case Pred: case Term:
+            if (tree->child->sibling == NULL)
+                return eval_Operand(tree->child, it, v);
+            return eval_Aritm(tree, it, v);
+        case BaseExpr:
+            if (tree->child->data->type == Obj)
+                return eval_Obj(tree->child, it, v);
+            return eval_Expr(tree->child->sibling, it, v); // ( Expr )
+        default:
+            return fail_Interp(it, "SystemError: unexpected node");
+    }
+}
+
+
+int truth_Of (union VmValue v, int type) {
+    // bool() of a value
+    switch (type) {
+        case _float: return v.f != 0.0;
+        case _string: case _list: return v.o->len > 0;
+        case _null: return 0;
+        default: return v.i != 0;
+    }
+}
+
+
+int compare_Values (union VmValue a, int ta, enum TokenType op, union VmValue b, int tb) {
+    // a op b: values of different types are never equal, but for numbers and bools
+    int eq;
+
+    if (ta != tb && (is_ObjType(ta) || is_ObjType(tb) || ta == _null || tb == _null))
+        return op == NotEq;
+    if (ta == _float || tb == _float) {
+        double x = ta == _float ? a.f : (double) a.i;
+        double y = tb == _float ? b.f : (double) b.i;
+        switch (op) {
+            case Lesser: return x < y;
+            case LesserEq: return x <= y;
+            case Greater: return x > y;
+            case GreaterEq: return x >= y;
+            case EqEq: return x == y;
+            default: return x != y;
+        }
+    }
+    if (ta == _string || ta == _list || ta == _null) {
+        eq = ta == _null || (ta == _string ? equal_Strs(a.o, b.o) : equal_Lists(a.o, b.o));
+        return op == EqEq ? eq : ! eq;
+    }
+    switch (op) {
+        case Lesser: return a.i < b.i;
+        case LesserEq: return a.i <= b.i;
+        case Greater: return a.i > b.i;
+        case GreaterEq: return a.i >= b.i;
+        case EqEq: return a.i == b.i;
+        default: return a.i != b.i;
+    }
+}
+
+
+/*
+ * Expr chains are grouped by cond_Level, walking the operands from *node:
+ * each group leaves *node on the operator that ends it (NULL at the end of the chain).
+ * and, or stop as soon as the result is known: the operands they skip are never evaluated.
+*/
+
+struct ParseTree* skip_Group (struct ParseTree* node, int level) {
+    // The first operator from node where the chain splits at level, or NULL
+    for (; node != NULL; node = node->sibling)
+        if (cond_Level(node->data->type) <= level)
+            return node;
+    return NULL;
+}
+
+
+int eval_Compare (struct ParseTree** node, struct Interp* it, int* truth) {
+    // The truth of one operand, or of a chain of comparisons
+    struct ParseTree* operand;
+    union VmValue a, b;
+    enum TokenType op;
+    int ta, tb;
+
+    operand = *node;
+    if (eval_Operand(operand, it, &a) < 0)
+        return EXEC_ERROR;
+    ta = operand->value_type;
+    *node = operand->sibling;
+    if (*node == NULL || cond_Level((*node)->data->type) < 2) {
+        *truth = truth_Of(a, ta);
+        if (is_ObjType(ta))
+            release_VmObj(a.o);
+        return EXEC_NEXT;
+    }
+
+    *truth = 1;
+    while (*truth && *node != NULL && cond_Level((*node)->data->type) == 2) {
+        op = (*node)->data->type;
+        operand = (*node)->sibling;
+        if (eval_Operand(operand, it, &b) < 0) {
+            if (is_ObjType(ta))
+                release_VmObj(a.o);
+            return EXEC_ERROR;
+        }
+        tb = operand->value_type;
+        *truth = compare_Values(a, ta, op, b, tb);
+        if (is_ObjType(ta))
+            release_VmObj(a.o);
+        a = b;
+        ta = tb;
+        *node = operand->sibling;
+    }
+    if (is_ObjType(ta))
+        release_VmObj(a.o);
+    *node = skip_Group(*node, 1);
+    return EXEC_NEXT;
+}
+
+
+int eval_And (struct ParseTree** node, struct Interp* it, int* truth) {
+    while (1) {
+        if (eval_Compare(node, it, truth) < 0)
+            return EXEC_ERROR;
+        if (*node == NULL || (*node)->data->type == Or)
+            return EXEC_NEXT;
+        *node = (*node)->sibling; // after the `and`
+        if (! *truth) {
+            *node = skip_Group(*node, 0);
+            return EXEC_NEXT;
+        }
+    }
+}
+
+
+int eval_Expr (struct ParseTree* tree, struct Interp* it, union VmValue* v) {
+    // A chain of comparisons, and, or is a bool
+    struct ParseTree* node;
+    int truth;
+
+    if (tree->child->sibling == NULL)
+        return eval_Operand(tree->child, it, v);
+    node = tree->child;
+    while (1) {
+        if (eval_And(&node, it, &truth) < 0)
+            return EXEC_ERROR;
+        if (truth || node == NULL)
+            break;
+        node = node->sibling; // after the `or`
+    }
+    v->i = truth;
+    return EXEC_NEXT;
+}
+
+
+/*
+ * ---------------
+ * Lines
+ * ---------------
+*/
+
+int exec_Assign (struct ParseTree* tree, struct Interp* it) {
+    // The types cannot change: the value is the one of the variable
+    union VmValue v;
+    int slot;
+
+    if (eval_Expr(tree->child->sibling->sibling, it, &v) < 0)
+        return EXEC_ERROR;
+    slot = tree->child->slot;
+    if (it->is_obj[slot])
+        set_Obj(it->frame + slot, v.o);
+    else
+        it->frame[slot] = v;
+    return EXEC_NEXT;
+}
+
+
+int exec_Input (struct ParseTree* tree, struct Interp* it) {
+    union VmValue v;
+    const char* error;
+    int type, slot;
+
+    switch (tree->child->data->id) {
+        case ID_READINT: type = _int; break;
+        case ID_READFLOAT: type = _float; break;
+        case ID_READBOOL: type = _bool; break;
+        default: type = _string;
+    }
+    error = read_Value(it->in, type, &v, &it->line);
+    if (error != NULL)
+        return fail_Interp(it, error);
+    slot = tree->child->sibling->slot;
+    if (type == _string)
+        set_Obj(it->frame + slot, v.o);
+    else
+        it->frame[slot] = v;
+    return EXEC_NEXT;
+}
+
+
+int exec_Output (struct ParseTree* tree, struct Interp* it) {
+    struct ParseTree* obj;
+    union VmValue v;
+    size_t start;
+    int status;
+
+    obj = tree->child->sibling;
+    if (eval_Obj(obj, it, &v) < 0)
+        return EXEC_ERROR;
+    status = SUBTREE_OK;
+    if (obj->value_type == _string)
+        fwrite(v.o->s, 1, v.o->len, it->out);
+    else if (obj->value_type == _int)
+        fprintf(it->out, "%lld", v.i);
+    else {
+        start = it->buf.len;
+        status = str_Value(&it->buf, v, obj->value_type, 0);
+        fwrite(it->buf.s + start, 1, it->buf.len - start, it->out);
+        it->buf.len = start;
+    }
+    putc('\n', it->out);
+    if (is_ObjType(obj->value_type))
+        release_VmObj(v.o);
+    return status == SUBTREE_OK ? EXEC_NEXT : fail_Interp(it, "MemoryError: out of memory");
+}
+
+
+int exec_IfLine (struct ParseTree* tree, struct Interp* it) {
+    struct ParseTree* line;
+    union VmValue cond;
+
+    if (eval_Expr(tree->child->sibling->child->sibling, it, &cond) < 0)
+        return EXEC_ERROR;
+    line = tree->child->sibling->sibling->child;
+    if (cond.i)
+        return exec_Lines(line, it);
+    while (line != NULL && line->data->type != OptElse)
+        line = line->sibling->sibling;
+    if (line == NULL)
+        return EXEC_NEXT;
+    return exec_Lines(line->child->sibling, it);
+}
+
+
+int exec_LoopLine (struct ParseTree* tree, struct Interp* it) {
+    struct ParseTree *expr, *body;
+    union VmValue cond;
+    int status;
+
+    expr = tree->child->sibling->child->sibling;
+    body = tree->child->sibling->sibling->child;
+    while (1) {
+        if (eval_Expr(expr, it, &cond) < 0)
+            return EXEC_ERROR;
+        if (! cond.i)
+            return EXEC_NEXT;
+        status = exec_Lines(body, it);
+        if (status == EXEC_BREAK)
+            return EXEC_NEXT;
+        if (status == EXEC_ERROR)
+            return EXEC_ERROR;
+    }
+}
+
+
+int exec_Lines (struct ParseTree* line, struct Interp* it) {
+    // Lines up to the end or to the else: break and continue stop them, as errors do
+    struct ParseTree* stmt;
+    int status;
+
+    for (; line != NULL && line->data->type != OptElse; line = line->sibling->sibling) {
+        stmt = line->child;
+        switch (stmt->data->type) {
+            case Assign: status = exec_Assign(stmt, it); break;
+            case Input: status = exec_Input(stmt, it); break;
+            case Output: status = exec_Output(stmt, it); break;
+            case IfLine: status = exec_IfLine(stmt, it); break;
+            case LoopLine: status = exec_LoopLine(stmt, it); break;
+            case Break: return EXEC_BREAK;
+            case Continue: return EXEC_CONTINUE;
+            default: return fail_Interp(it, "SystemError: unexpected line");
+        }
+        if (status != EXEC_NEXT)
+            return status;
+    }
+    return EXEC_NEXT;
+}
+
+
+int interp_Program (struct ParseTree* root, struct SymbolTable* table, FILE* in, FILE* out) {
+    struct Interp it;
+    int i;
+
+    memset(&it, 0, sizeof(it));
+    it.in = in;
+    it.out = out;
+    if (init_Frame(&it, root, table) != SUBTREE_OK)
+        fail_Interp(&it, "MemoryError: out of memory");
+    else
+        exec_Lines(root->child, &it);
+
+    fflush(out);
+    if (it.error != NULL)
+        fprintf(stderr, "%s\n", it.error);
+    for (i = 0; i < it.nslots; i++)
+        if (it.is_obj[i])
+            release_VmObj(it.frame[i].o);
+    free(it.frame);
+    free(it.is_obj);
+    free(it.buf.s);
+    free(it.line.s);
+    return it.error != NULL;
+}
@@ -0,0 +1,18 @@
+#ifndef INTERP_H
+#define INTERP_H
+
+#include <stdio.h>
+
+#include "vm.h"
+
+/*
+ * Run the program on its ParseTree, that passed analyze_Program_Table with these symbols.
+ * The variables live in a frame of table->nslots values, each one at the slot
+ * the analysis gave to its Var, and each operation has the types annotated on its operands:
+ * no name is looked up and no value carries its type while the program runs.
+ * The values are the ones of the VM (vm.h), and so is the output.
+ * Return 0, or 1 after a runtime error, written on stderr as Python writes it.
+*/
+int interp_Program(struct ParseTree *root, struct SymbolTable *table, FILE *in, FILE *out);
+
+#endif
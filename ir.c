@@ -0,0 +1,1664 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "ir.h"
+#include "cgen.h"
+#include "vm.h"
+#include "log.h"
+
+
+const struct IrOpInfo ir_Ops[N_IR_OPS] = {
+    {"nop", 0, 0, 0, 0},
+    {"const", 0, 0, 0, 0},
+    {"undef", 0, 0, 0, 0},
+    {"phi", 0, 1, 0, 0},
+    {"copy", 1, 0, 0, 0},
+    {"add", 2, 0, 0, 0},
+    {"sub", 2, 0, 0, 0},
+    {"mul", 2, 0, 0, 0},
+    {"div", 2, 0, 0, 0},
+    {"fdiv", 2, 0, 0, 0},
+    {"mod", 2, 0, 0, 0},
+    {"lt", 2, 0, 0, 0},
+    {"le", 2, 0, 0, 0},
+    {"gt", 2, 0, 0, 0},
+    {"ge", 2, 0, 0, 0},
+    {"eq", 2, 0, 0, 0},
+    {"ne", 2, 0, 0, 0},
+    {"and", 2, 0, 0, 0},
+    {"or", 2, 0, 0, 0},
+    {"concat", 2, 0, 0, 0},
+    {"format", 1, 1, 0, 0},
+    {"list", 0, 1, 0, 0},
+    {"elem", 2, 0, 0, 0},
+    {"read", 0, 0, 1, 0},
+    {"print", 1, 0, 1, 0},
+    {"jmp", 0, 0, 1, 1},
+    {"br", 1, 0, 1, 1},
+    {"exit", 0, 0, 1, 1},
+};
+
+
+/*
+ * ---------------
+ * The arrays
+ * ---------------
+*/
+
+int ir_Grow (void** array, int* cap, int n, size_t size) {
+    // Room for one more element: 1 on memory error
+    void* grown;
+    int want;
+
+    if (n < *cap)
+        return 0;
+    want = *cap > 0 ? 2 * *cap : 64;
+    grown = realloc(*array, want * size);
+    if (grown == NULL)
+        return 1;
+    *array = grown;
+    *cap = want;
+    return 0;
+}
+
+
+int new_IrIns (struct Ir* ir, enum IrOp op, int type, int a, int b, int c) {
+    // A new instruction, in no block yet. Return its index or -1
+    struct IrIns* ins;
+
+    if (ir_Grow((void**) &ir->ins, &ir->cap, ir->n, sizeof(struct IrIns))) {
+        ir->error = MEMORY_ERROR;
+        return -1;
+    }
+    ins = ir->ins + ir->n;
+    ins->op = op;
+    ins->type = type;
+    ins->a = a;
+    ins->b = b;
+    ins->c = c;
+    ins->block = -1;
+    ins->prev = ins->next = -1;
+    ins->var = 0;
+    return ir->n++;
+}
+
+
+void append_Ins (struct Ir* ir, int block, int i) {
+    struct IrBlock* bl = ir->blocks + block;
+
+    ir->ins[i].block = block;
+    ir->ins[i].prev = bl->last;
+    ir->ins[i].next = -1;
+    if (bl->last >= 0)
+        ir->ins[bl->last].next = i;
+    else
+        bl->first = i;
+    bl->last = i;
+}
+
+
+void prepend_Ins (struct Ir* ir, int block, int i) {
+    struct IrBlock* bl = ir->blocks + block;
+
+    ir->ins[i].block = block;
+    ir->ins[i].prev = -1;
+    ir->ins[i].next = bl->first;
+    if (bl->first >= 0)
+        ir->ins[bl->first].prev = i;
+    else
+        bl->last = i;
+    bl->first = i;
+}
+
+
+void unlink_Ins (struct Ir* ir, int i) {
+    // Out of its block, and removed
+    struct IrIns* ins = ir->ins + i;
+    struct IrBlock* bl;
+
+    if (ins->block >= 0) {
+        bl = ir->blocks + ins->block;
+        if (ins->prev >= 0)
+            ir->ins[ins->prev].next = ins->next;
+        else
+            bl->first = ins->next;
+        if (ins->next >= 0)
+            ir->ins[ins->next].prev = ins->prev;
+        else
+            bl->last = ins->prev;
+    }
+    ins->op = IR_NOP;
+    ins->block = ins->prev = ins->next = -1;
+}
+
+
+int new_IrBlock (struct Ir* ir) {
+    struct IrBlock* bl;
+
+    if (ir_Grow((void**) &ir->blocks, &ir->capblocks, ir->nblocks, sizeof(struct IrBlock))) {
+        ir->error = MEMORY_ERROR;
+        return -1;
+    }
+    bl = ir->blocks + ir->nblocks;
+    bl->first = bl->last = -1;
+    bl->succ[0] = bl->succ[1] = -1;
+    bl->pred = bl->npreds = 0;
+    bl->join = bl->exit = bl->test = -1;
+    bl->dead = 0;
+    return ir->nblocks++;
+}
+
+
+int new_IrArgs (struct Ir* ir, int n) {
+    // n consecutive operands, return the first or -1
+    while (ir->nargs + n > ir->capargs)
+        if (ir_Grow((void**) &ir->args, &ir->capargs, ir->capargs, sizeof(int))) {
+            ir->error = MEMORY_ERROR;
+            return -1;
+        }
+    ir->nargs += n;
+    return ir->nargs - n;
+}
+
+
+int new_IrConst (struct Ir* ir, struct IrConst* c) {
+    // The pool takes the strings of c. Return the index or -1
+    if (ir_Grow((void**) &ir->consts, &ir->capconsts, ir->nconsts, sizeof(struct IrConst))) {
+        ir->error = MEMORY_ERROR;
+        free(c->s);
+        free(c->text);
+        return -1;
+    }
+    ir->consts[ir->nconsts] = *c;
+    return ir->nconsts++;
+}
+
+
+void free_Ir (struct Ir* ir) {
+    int i;
+
+    if (ir == NULL)
+        return;
+    for (i = 0; i < ir->nconsts; i++) {
+        free(ir->consts[i].s);
+        free(ir->consts[i].text);
+    }
+    free(ir->ins);
+    free(ir->blocks);
+    free(ir->args);
+    free(ir->preds);
+    free(ir->consts);
+    free(ir);
+}
+
+
+/*
+ * ---------------
+ * Shared by the passes
+ * ---------------
+*/
+
+int count_Operands (struct IrIns* ins) {
+    return ir_Ops[ins->op].nfixed + (ir_Ops[ins->op].variadic ? ins->c : 0);
+}
+
+
+int* operand_At (struct Ir* ir, struct IrIns* ins, int k) {
+    // The k-th operand, to read or to change
+    if (k < ir_Ops[ins->op].nfixed)
+        return k == 0 ? &ins->a : &ins->b;
+    return ir->args + ins->b + k - ir_Ops[ins->op].nfixed;
+}
+
+
+int resolve_Copy (struct Ir* ir, int v) {
+    // The value a chain of copies stands for. The chain is shortened on the way
+    int root, next;
+
+    root = v;
+    while (ir->ins[root].op == IR_COPY)
+        root = ir->ins[root].a;
+    while (ir->ins[v].op == IR_COPY) {
+        next = ir->ins[v].a;
+        ir->ins[v].a = root;
+        v = next;
+    }
+    return root;
+}
+
+
+void remove_Pred (struct Ir* ir, int block, int pred) {
+    // The edge from pred is gone: so is the operand of each phi for it
+    struct IrBlock* bl = ir->blocks + block;
+    struct IrIns* ins;
+    int k, i;
+
+    for (k = 0; k < bl->npreds; k++)
+        if (ir->preds[bl->pred + k] == pred)
+            break;
+    if (k == bl->npreds)
+        return;
+    memmove(ir->preds + bl->pred + k, ir->preds + bl->pred + k + 1, (bl->npreds - k - 1) * sizeof(int));
+    bl->npreds--;
+    for (i = bl->first; i >= 0; i = ins->next) {
+        ins = ir->ins + i;
+        if (ins->op != IR_PHI || ins->c <= k)
+            continue;
+        memmove(ir->args + ins->b + k, ir->args + ins->b + k + 1, (ins->c - k - 1) * sizeof(int));
+        ins->c--;
+    }
+}
+
+
+int is_NonZero (struct Ir* ir, int v) {
+    struct IrConst* k;
+
+    v = resolve_Copy(ir, v);
+    if (ir->ins[v].op != IR_CONST)
+        return 0;
+    k = ir->consts + ir->ins[v].a;
+    if (! k->exact)
+        return 0;
+    return k->type == _float ? k->f != 0 : (k->type == _int || k->type == _bool) && k->i != 0;
+}
+
+
+int may_Fail (struct Ir* ir, struct IrIns* ins) {
+    // Python raises on a zero divisor, an index out of the list, a format that does not match its values
+    switch (ins->op) {
+        case IR_DIV: case IR_FDIV: case IR_MOD:
+            return ! is_NonZero(ir, ins->b);
+        case IR_ELEM: case IR_FORMAT: case IR_READ:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+
+int count_IrOps (struct Ir* ir) {
+    int i, n;
+
+    n = 0;
+    for (i = 0; i < ir->n; i++)
+        n += ir->ins[i].op != IR_NOP;
+    return n;
+}
+
+
+int dominators_Ir (struct Ir* ir, int* order, int* idom) {
+    /*
+     * The blocks in reverse postorder of a depth-first visit, without recursion,
+     * then the dominators as Cooper, Harvey and Kennedy compute them: the immediate dominator
+     * of a block is where the dominators of its predecessors met, until nothing changes.
+    */
+    int *stack, *next, *rpo;
+    int n, top, b, s, i, k, p, d, changed;
+
+    stack = malloc(ir->nblocks * sizeof(int));
+    next = calloc(ir->nblocks, sizeof(int));
+    rpo = malloc(ir->nblocks * sizeof(int));
+    if (stack == NULL || next == NULL || rpo == NULL) {
+        free(stack);
+        free(next);
+        free(rpo);
+        return -1;
+    }
+    for (b = 0; b < ir->nblocks; b++) {
+        idom[b] = -1;
+        rpo[b] = -1;
+    }
+
+    n = ir->nblocks;
+    top = 0;
+    stack[top++] = 0;
+    rpo[0] = 0; // visited, numbered at the end
+    while (top > 0) {
+        b = stack[top - 1];
+        s = next[b] < 2 ? ir->blocks[b].succ[next[b]++] : -2;
+        if (s == -2) {
+            order[--n] = b;
+            top--;
+        }
+        else if (s >= 0 && rpo[s] < 0 && ! ir->blocks[s].dead) {
+            rpo[s] = 0;
+            stack[top++] = s;
+        }
+    }
+    // The blocks reached are at the end of order
+    k = ir->nblocks - n;
+    memmove(order, order + n, k * sizeof(int));
+    for (i = 0; i < k; i++)
+        rpo[order[i]] = i;
+
+    idom[0] = 0;
+    changed = 1;
+    while (changed) {
+        changed = 0;
+        for (i = 1; i < k; i++) {
+            b = order[i];
+            d = -1;
+            for (p = 0; p < ir->blocks[b].npreds; p++) {
+                s = ir->preds[ir->blocks[b].pred + p];
+                if (idom[s] < 0)
+                    continue;
+                if (d < 0) {
+                    d = s;
+                    continue;
+                }
+                while (d != s) {
+                    while (rpo[d] > rpo[s])
+                        d = idom[d];
+                    while (rpo[s] > rpo[d])
+                        s = idom[s];
+                }
+            }
+            if (d != idom[b]) {
+                idom[b] = d;
+                changed = 1;
+            }
+        }
+    }
+    idom[0] = -1;
+    free(stack);
+    free(next);
+    free(rpo);
+    return k;
+}
+
+
+/*
+ * ---------------
+ * Lowering
+ * ---------------
+ * The SSA form is built while the blocks are made, as Braun et al. do:
+ * each block knows the current value of the variables written in it, a read looks
+ * back through the predecessors, and a block where ways meet gets a phi.
+ * A block is sealed when all its predecessors are known: before that, a read
+ * there makes a phi whose operands are added when the block is sealed.
+ * Phis that turn out to have a single value are left to the copy propagation.
+*/
+
+struct IrEdge {
+    int from;
+    int next; // next edge into the same block, -1 at the end
+};
+
+struct IrLowBlock {
+    int head, tail; // edges into the block
+    int npreds;
+    int sealed;
+};
+
+struct IrLower {
+    struct Ir* ir;
+    struct SymbolTable* table;
+    int cur; // block of the next instruction, -1 after a break or a continue
+    int head, exit; // of the innermost loop, -1 outside loops
+    struct IrEdge* edges;
+    int nedges, capedges;
+    struct IrLowBlock* low; // one per block of ir
+    int caplow;
+    // current value of each (block, slot): open addressing on block * nslots + slot
+    long long* keys;
+    int* vals;
+    size_t cap, count;
+    int nslots;
+    int* slot_types;
+    int* slot_ids;
+    int* undefs; // the undef of each slot, -1 until one is needed
+    int* stack; // values of a list or a format, while they are computed
+    int nstack, capstack;
+};
+
+
+int ir_Expr (struct ParseTree* tree, struct IrLower* lw);
+int ir_Obj (struct ParseTree* tree, struct IrLower* lw);
+int ir_Line (struct ParseTree* tree, struct IrLower* lw);
+
+
+int ir_Block (struct IrLower* lw) {
+    int b;
+
+    b = new_IrBlock(lw->ir);
+    if (b < 0)
+        return -1;
+    if (ir_Grow((void**) &lw->low, &lw->caplow, b, sizeof(struct IrLowBlock))) {
+        lw->ir->error = MEMORY_ERROR;
+        return -1;
+    }
+    lw->low[b].head = lw->low[b].tail = -1;
+    lw->low[b].npreds = 0;
+    lw->low[b].sealed = 0;
+    return b;
+}
+
+
+int ir_Emit (struct IrLower* lw, enum IrOp op, int type, int a, int b, int c) {
+    // An instruction at the end of the current block
+    int i;
+
+    i = new_IrIns(lw->ir, op, type, a, b, c);
+    if (i >= 0)
+        append_Ins(lw->ir, lw->cur, i);
+    return i;
+}
+
+
+int ir_Edge (struct IrLower* lw, int from, int to) {
+    struct IrLowBlock* low = lw->low + to;
+
+    if (ir_Grow((void**) &lw->edges, &lw->capedges, lw->nedges, sizeof(struct IrEdge))) {
+        lw->ir->error = MEMORY_ERROR;
+        return -1;
+    }
+    lw->edges[lw->nedges].from = from;
+    lw->edges[lw->nedges].next = -1;
+    if (low->tail >= 0)
+        lw->edges[low->tail].next = lw->nedges;
+    else
+        low->head = lw->nedges;
+    low->tail = lw->nedges++;
+    low->npreds++;
+    return 0;
+}
+
+
+int ir_Jump (struct IrLower* lw, int to) {
+    // The current block ends here
+    if (ir_Emit(lw, IR_JMP, -1, 0, 0, 0) < 0 || ir_Edge(lw, lw->cur, to) < 0)
+        return -1;
+    lw->ir->blocks[lw->cur].succ[0] = to;
+    lw->cur = -1;
+    return 0;
+}
+
+
+int ir_Branch (struct IrLower* lw, int cond, int yes, int no) {
+    if (ir_Emit(lw, IR_BR, -1, cond, 0, 0) < 0 || ir_Edge(lw, lw->cur, yes) < 0 || ir_Edge(lw, lw->cur, no) < 0)
+        return -1;
+    lw->ir->blocks[lw->cur].succ[0] = yes;
+    lw->ir->blocks[lw->cur].succ[1] = no;
+    lw->cur = -1;
+    return 0;
+}
+
+
+int ir_Entry (struct IrLower* lw, enum IrOp op, int type, int a) {
+    // Constants and undefs go at the start of the program, where they dominate every use
+    int i;
+
+    i = new_IrIns(lw->ir, op, type, a, 0, 0);
+    if (i >= 0)
+        prepend_Ins(lw->ir, 0, i);
+    return i;
+}
+
+
+int ir_Const (struct IrLower* lw, struct IrConst* c, int type) {
+    int k;
+
+    k = new_IrConst(lw->ir, c);
+    return k < 0 ? -1 : ir_Entry(lw, IR_CONST, type, k);
+}
+
+
+int ir_Int (struct IrLower* lw, long long i) {
+    struct IrConst c;
+
+    memset(&c, 0, sizeof(c));
+    c.type = _int;
+    c.exact = 1;
+    c.i = i;
+    return ir_Const(lw, &c, _int);
+}
+
+
+int ir_Bool (struct IrLower* lw, int b) {
+    struct IrConst c;
+
+    memset(&c, 0, sizeof(c));
+    c.type = _bool;
+    c.exact = 1;
+    c.i = b;
+    return ir_Const(lw, &c, _bool);
+}
+
+
+/*
+ * ---------------
+ * Variables
+ * ---------------
+*/
+
+size_t def_Hash (long long key, size_t cap) {
+    return (size_t) (key * 0x9E3779B97F4A7C15ULL >> 17) & (cap - 1);
+}
+
+
+int grow_Defs (struct IrLower* lw) {
+    long long* keys;
+    int* vals;
+    size_t cap, i, h;
+
+    cap = lw->cap > 0 ? 2 * lw->cap : 256;
+    keys = malloc(cap * sizeof(long long));
+    vals = malloc(cap * sizeof(int));
+    if (keys == NULL || vals == NULL) {
+        free(keys);
+        free(vals);
+        lw->ir->error = MEMORY_ERROR;
+        return MEMORY_ERROR;
+    }
+    for (i = 0; i < cap; i++)
+        keys[i] = -1;
+    for (i = 0; i < lw->cap; i++) {
+        if (lw->keys[i] < 0)
+            continue;
+        for (h = def_Hash(lw->keys[i], cap); keys[h] >= 0; h = (h + 1) & (cap - 1))
+            ;
+        keys[h] = lw->keys[i];
+        vals[h] = lw->vals[i];
+    }
+    free(lw->keys);
+    free(lw->vals);
+    lw->keys = keys;
+    lw->vals = vals;
+    lw->cap = cap;
+    return SUBTREE_OK;
+}
+
+
+int write_Var (struct IrLower* lw, int block, int slot, int v) {
+    long long key;
+    size_t h;
+
+    if (2 * (lw->count + 1) > lw->cap && grow_Defs(lw) != SUBTREE_OK)
+        return -1;
+    key = (long long) block * lw->nslots + slot;
+    for (h = def_Hash(key, lw->cap); lw->keys[h] >= 0; h = (h + 1) & (lw->cap - 1))
+        if (lw->keys[h] == key) {
+            lw->vals[h] = v;
+            return v;
+        }
+    lw->keys[h] = key;
+    lw->vals[h] = v;
+    lw->count++;
+    return v;
+}
+
+
+int find_Var (struct IrLower* lw, int block, int slot) {
+    // The value written in the block, or -1
+    long long key;
+    size_t h;
+
+    if (lw->cap == 0)
+        return -1;
+    key = (long long) block * lw->nslots + slot;
+    for (h = def_Hash(key, lw->cap); lw->keys[h] >= 0; h = (h + 1) & (lw->cap - 1))
+        if (lw->keys[h] == key)
+            return lw->vals[h];
+    return -1;
+}
+
+
+int read_Var (struct IrLower* lw, int block, int slot);
+
+
+int add_PhiOperands (struct IrLower* lw, int phi) {
+    // One operand for each predecessor, in their order. The range is taken before the reads
+    int b, k, e, v, slot;
+
+    slot = lw->ir->ins[phi].a;
+    b = new_IrArgs(lw->ir, lw->low[lw->ir->ins[phi].block].npreds);
+    if (b < 0)
+        return -1;
+    lw->ir->ins[phi].b = b;
+    lw->ir->ins[phi].c = lw->low[lw->ir->ins[phi].block].npreds;
+    k = 0;
+    for (e = lw->low[lw->ir->ins[phi].block].head; e >= 0; e = lw->edges[e].next) {
+        v = read_Var(lw, lw->edges[e].from, slot);
+        if (v < 0)
+            return -1;
+        lw->ir->args[b + k++] = v;
+    }
+    return phi;
+}
+
+
+int new_Phi (struct IrLower* lw, int block, int slot) {
+    // A phi of the variable, before the other instructions of the block. Its operands come later
+    int i;
+
+    i = new_IrIns(lw->ir, IR_PHI, lw->slot_types[slot], slot, -1, 0);
+    if (i < 0)
+        return -1;
+    lw->ir->ins[i].var = lw->slot_ids[slot];
+    prepend_Ins(lw->ir, block, i);
+    return i;
+}
+
+
+int read_Var (struct IrLower* lw, int block, int slot) {
+    int v;
+
+    v = find_Var(lw, block, slot);
+    if (v >= 0)
+        return v;
+    if (! lw->low[block].sealed)
+        v = new_Phi(lw, block, slot);
+    else if (lw->low[block].npreds == 1)
+        v = read_Var(lw, lw->edges[lw->low[block].head].from, slot);
+    else if (lw->low[block].npreds == 0) {
+        // Never written on the way from the start: Python would find the name unbound
+        if (lw->undefs[slot] < 0) {
+            lw->undefs[slot] = ir_Entry(lw, IR_UNDEF, lw->slot_types[slot], slot);
+            if (lw->undefs[slot] >= 0)
+                lw->ir->ins[lw->undefs[slot]].var = lw->slot_ids[slot];
+        }
+        v = lw->undefs[slot];
+    }
+    else {
+        // The phi is the value of the block before its operands are read, that can loop back here
+        v = new_Phi(lw, block, slot);
+        if (v < 0 || write_Var(lw, block, slot, v) < 0)
+            return -1;
+        v = add_PhiOperands(lw, v);
+    }
+    if (v < 0)
+        return -1;
+    return write_Var(lw, block, slot, v);
+}
+
+
+int seal_Block (struct IrLower* lw, int block) {
+    // All the predecessors are known: the phis made before get their operands
+    int i;
+
+    for (i = lw->ir->blocks[block].first; i >= 0; i = lw->ir->ins[i].next)
+        if (lw->ir->ins[i].op == IR_PHI && lw->ir->ins[i].b < 0 && add_PhiOperands(lw, i) < 0)
+            return -1;
+    lw->low[block].sealed = 1;
+    return 0;
+}
+
+
+/*
+ * ---------------
+ * Values
+ * ---------------
+*/
+
+int ir_Num (struct ParseTree* tree, int type, struct IrLower* lw) {
+    // The literal of the Python code, kept as it is when a C number cannot hold it
+    struct Emitter text;
+    struct IrConst c;
+    int status, isfloat;
+
+    memset(&c, 0, sizeof(c));
+    c.type = type;
+    c.exact = 1;
+    status = num_Literal(tree, &c.f, &c.i, &isfloat);
+    if (status == NUM_RANGE) {
+        c.exact = 0;
+        status = init_Emitter(&text, -1);
+        if (status == SUBTREE_OK && (cgen_Num(tree, &text) != SUBTREE_OK || text.error != SUBTREE_OK)) {
+            free(text.buf);
+            status = MEMORY_ERROR;
+        }
+        if (status == SUBTREE_OK) {
+            text.buf[text.len] = '\0';
+            c.text = text.buf;
+        }
+    }
+    if (status == MEMORY_ERROR)
+        lw->ir->error = MEMORY_ERROR;
+    if (status != SUBTREE_OK)
+        return -1;
+    return ir_Const(lw, &c, type);
+}
+
+int ir_Literal (struct Token* lit, struct IrLower* lw) {
+    /*
+     * A string literal is written as it is in the source. Its bytes are only known
+     * without escapes: Python reads some that unescape_Literal does not.
+    */
+    struct IrConst c;
+
+    memset(&c, 0, sizeof(c));
+    c.type = _string;
+    c.text = malloc(lit->len + 1);
+    if (c.text == NULL) {
+        lw->ir->error = MEMORY_ERROR;
+        return -1;
+    }
+    memcpy(c.text, lit->lexeme, lit->len);
+    c.text[lit->len] = '\0';
+    c.exact = memchr(lit->lexeme, '\\', lit->len) == NULL;
+    if (c.exact) {
+        c.len = lit->len - 2;
+        c.s = malloc(c.len + 1);
+        if (c.s == NULL) {
+            free(c.text);
+            lw->ir->error = MEMORY_ERROR;
+            return -1;
+        }
+        memcpy(c.s, lit->lexeme + 1, c.len);
+        c.s[c.len] = '\0';
+    }
+    return ir_Const(lw, &c, _string);
+}
+
+
+int push_Value (struct IrLower* lw, int v) {
+    if (v < 0)
+        return -1;
+    if (ir_Grow((void**) &lw->stack, &lw->capstack, lw->nstack, sizeof(int))) {
+        lw->ir->error = MEMORY_ERROR;
+        return -1;
+    }
+    lw->stack[lw->nstack++] = v;
+    return v;
+}
+
+
+int pop_Values (struct IrLower* lw, int n) {
+    // The last n values pushed become consecutive operands: return the first
+    int b;
+
+    b = new_IrArgs(lw->ir, n);
+    if (b < 0)
+        return -1;
+    lw->nstack -= n;
+    memcpy(lw->ir->args + b, lw->stack + lw->nstack, n * sizeof(int));
+    return b;
+}
+
+
+int ir_QuotedStr (struct ParseTree* tree, struct IrLower* lw) {
+    // "..." , a, b  is  "..." % (a, b)
+    struct ParseTree *lit, *arg;
+    int v, n, b;
+
+    lit = tree->child;
+    v = ir_Literal(lit->data, lw);
+    if (v < 0 || lit->sibling == NULL)
+        return v;
+    n = 0;
+    for (arg = lit->sibling; arg != NULL; arg = arg->sibling) {
+        arg = arg->sibling; // skip the Comma
+        if (push_Value(lw, ir_Obj(arg, lw)) < 0)
+            return -1;
+        n++;
+    }
+    b = pop_Values(lw, n);
+    return b < 0 ? -1 : ir_Emit(lw, IR_FORMAT, _string, v, b, n);
+}
+
+
+int ir_Str (struct ParseTree* tree, struct IrLower* lw) {
+    // a + b + c, from the left
+    struct ParseTree* piece;
+    int left, right;
+
+    piece = tree->child;
+    left = ir_QuotedStr(piece, lw);
+    while (left >= 0 && piece->sibling != NULL) {
+        piece = piece->sibling->sibling;
+        right = ir_QuotedStr(piece, lw);
+        left = right < 0 ? -1 : ir_Emit(lw, IR_CONCAT, _string, left, right, 0);
+    }
+    return left;
+}
+
+
+int ir_List (struct ParseTree* tree, struct IrLower* lw) {
+    // The elements keep their values: Python does not convert them
+    struct ParseTree *elems, *obj;
+    int n, b;
+
+    elems = tree->child->sibling;
+    n = 0;
+    if (elems->data->type == ListExpr)
+        for (obj = elems->child; obj != NULL; obj = obj->sibling->sibling) {
+            if (push_Value(lw, ir_Obj(obj, lw)) < 0)
+                return -1;
+            n++;
+            if (obj->sibling == NULL)
+                break;
+        }
+    b = pop_Values(lw, n);
+    return b < 0 ? -1 : ir_Emit(lw, IR_LIST, _list, 0, b, n);
+}
+
+
+int ir_ListElem (struct ParseTree* tree, struct IrLower* lw) {
+    struct ParseTree* idx;
+    int list, index, type;
+
+    type = type_Of(tree, lw->table);
+    list = read_Var(lw, lw->cur, tree->child->slot);
+    idx = tree->child->sibling->sibling;
+    if (idx->data->type == Int)
+        index = ir_Int(lw, lexeme_Int(idx->data->lexeme, idx->data->len));
+    else
+        index = read_Var(lw, lw->cur, idx->slot);
+    if (list < 0 || index < 0 || type < 0)
+        return -1;
+    return ir_Emit(lw, IR_ELEM, type, list, index, 0);
+}
+
+
+int ir_Obj (struct ParseTree* tree, struct IrLower* lw) {
+    struct IrConst c;
+    struct ParseTree* obj;
+
+    obj = tree;
+    tree = tree->child;
+    switch (tree->data->type) {
+        case Var:
+            return read_Var(lw, lw->cur, tree->slot);
+        case Num:
+            return ir_Num(tree, obj->value_type, lw);
+        case Bool:
+            return ir_Bool(lw, tree->data->len == 4);
+        case Null:
+            memset(&c, 0, sizeof(c));
+            c.type = _null;
+            c.exact = 1;
+            return ir_Const(lw, &c, _null);
+        case Str:
+            return ir_Str(tree, lw);
+        case List:
+            return ir_List(tree, lw);
+        case ListElem:
+            return ir_ListElem(tree, lw);
+        default:
+            return -1;
+    }
+}
+
+
+/*
+ * ---------------
+ * Expressions
+ * ---------------
+*/
+
+int ir_Type (struct IrLower* lw, int v) {
+    return lw->ir->ins[v].type;
+}
+
+
+int ir_Operand (struct ParseTree* tree, struct IrLower* lw);
+
+
+int ir_Aritm (struct ParseTree* tree, struct IrLower* lw) {
+    // Term and Pred: operand (op operand)*, from the left, typed as analyze_Term does
+    struct ParseTree *child, *op;
+    enum IrOp irop;
+    int left, right, type;
+
+    child = tree->child;
+    left = ir_Operand(child, lw);
+    while (left >= 0 && child->sibling != NULL) {
+        op = child->sibling;
+        child = op->sibling;
+        right = ir_Operand(child, lw);
+        if (right < 0)
+            return -1;
+        switch (op->data->type) {
+            case Plus: irop = IR_ADD; break;
+            case Minus: irop = IR_SUB; break;
+            case Star: irop = IR_MUL; break;
+            case Div: irop = IR_DIV; break;
+            case FloatDiv: irop = IR_FDIV; break;
+            case Percent: irop = IR_MOD; break;
+            default: return -1;
+        }
+        if (irop == IR_FDIV)
+            type = resultType_FloatDiv[ir_Type(lw, left)][ir_Type(lw, right)];
+        else
+            type = resultType_aritm[ir_Type(lw, left)][ir_Type(lw, right)];
+        left = ir_Emit(lw, irop, type, left, right, 0);
+    }
+    return left;
+}
+
+
+int ir_Operand (struct ParseTree* tree, struct IrLower* lw) {
+    switch (tree->data->type) {
+        case Pred: case Term:
+            if (tree->child->sibling == NULL)
+                return ir_Operand(tree->child, lw);
+            return ir_Aritm(tree, lw);
+        case BaseExpr:
+            if (tree->child->data->type == Obj)
+                return ir_Obj(tree->child, lw);
+            return ir_Expr(tree->child->sibling, lw); // ( Expr )
+        default:
+            return -1;
+    }
+}
+
+
+/*
+ * and, or and the comparisons after the first one of a chain are only computed
+ * when the value on their left does not decide. What comes on the right is lowered
+ * in a block of its own: if that stays a single block with nothing that can fail,
+ * it goes back into the block on the left and the result is a plain IR_AND or IR_OR.
+ * Else the block on the left branches around it, and a phi takes the result.
+*/
+
+struct IrLazy {
+    int from; // the block on the left
+    int rhs; // the block on the right
+};
+
+
+int begin_Lazy (struct IrLower* lw, struct IrLazy* lazy) {
+    lazy->from = lw->cur;
+    lazy->rhs = ir_Block(lw);
+    if (lazy->rhs < 0 || ir_Edge(lw, lazy->from, lazy->rhs) < 0 || seal_Block(lw, lazy->rhs) < 0)
+        return -1;
+    lw->cur = lazy->rhs;
+    return 0;
+}
+
+
+int end_Lazy (struct IrLower* lw, struct IrLazy* lazy, enum IrOp op, int left, int right) {
+    struct Ir* ir = lw->ir;
+    struct IrBlock *from, *rhs;
+    int i, type, join, end, b;
+
+    if (left < 0 || right < 0)
+        return -1;
+    type = resultType_logic[ir_Type(lw, left)][ir_Type(lw, right)];
+    if (lw->cur == lazy->rhs) {
+        for (i = ir->blocks[lazy->rhs].first; i >= 0; i = ir->ins[i].next)
+            if (may_Fail(ir, ir->ins + i))
+                break;
+        if (i < 0) {
+            // Back into the block on the left: the edge to the right one is dropped with it
+            from = ir->blocks + lazy->from;
+            rhs = ir->blocks + lazy->rhs;
+            for (i = rhs->first; i >= 0; i = ir->ins[i].next)
+                ir->ins[i].block = lazy->from;
+            if (rhs->first >= 0) {
+                ir->ins[rhs->first].prev = from->last;
+                if (from->last >= 0)
+                    ir->ins[from->last].next = rhs->first;
+                else
+                    from->first = rhs->first;
+                from->last = rhs->last;
+            }
+            rhs->first = rhs->last = -1;
+            rhs->dead = 1;
+            lw->low[lazy->rhs].head = lw->low[lazy->rhs].tail = -1;
+            lw->low[lazy->rhs].npreds = 0;
+            lw->cur = lazy->from;
+            return ir_Emit(lw, op, type, left, right, 0);
+        }
+    }
+
+    join = ir_Block(lw);
+    if (join < 0)
+        return -1;
+    end = lw->cur;
+    lw->cur = lazy->from;
+    if (ir_Emit(lw, IR_BR, -1, left, 0, 0) < 0 || ir_Edge(lw, lazy->from, join) < 0)
+        return -1;
+    ir->blocks[lazy->from].succ[0] = op == IR_AND ? lazy->rhs : join;
+    ir->blocks[lazy->from].succ[1] = op == IR_AND ? join : lazy->rhs;
+    ir->blocks[lazy->from].join = join;
+    lw->cur = end;
+    if (ir_Jump(lw, join) < 0 || seal_Block(lw, join) < 0)
+        return -1;
+
+    // The predecessors of the join are the block on the left, then the end of the right one
+    lw->cur = join;
+    b = new_IrArgs(ir, 2);
+    if (b < 0)
+        return -1;
+    ir->args[b] = left;
+    ir->args[b + 1] = right;
+    i = new_IrIns(ir, IR_PHI, type, -1, b, 2);
+    if (i >= 0)
+        prepend_Ins(ir, join, i);
+    return i;
+}
+
+
+struct IrChain {
+    struct ParseTree** items; // operands at the even places, operators in between
+    int n; // operands
+};
+
+
+enum TokenType ir_OpOf (struct IrChain* chain, int k) {
+    // The operator after the k-th operand
+    return chain->items[2 * k + 1]->data->type;
+}
+
+
+int ir_Compare (struct IrLower* lw, int left, enum TokenType op, int right) {
+    enum IrOp irop;
+    int type;
+
+    if (left < 0 || right < 0)
+        return -1;
+    switch (op) {
+        case Lesser: irop = IR_LT; break;
+        case LesserEq: irop = IR_LE; break;
+        case Greater: irop = IR_GT; break;
+        case GreaterEq: irop = IR_GE; break;
+        case EqEq: irop = IR_EQ; break;
+        case NotEq: irop = IR_NE; break;
+        default: return -1;
+    }
+    if (irop == IR_EQ || irop == IR_NE)
+        type = resultType_logic[ir_Type(lw, left)][ir_Type(lw, right)];
+    else
+        type = resultType_compare[ir_Type(lw, left)][ir_Type(lw, right)];
+    return ir_Emit(lw, irop, type, left, right, 0);
+}
+
+
+int ir_Logic (struct IrChain* chain, int first, int last, struct IrLower* lw) {
+    /*
+     * The value of the operands from first to last, split as chain_Level says:
+     * a < b < c is a < b and b < c with b computed once.
+    */
+    struct IrLazy lazy;
+    int k, from, part, result, left, right, level;
+
+    level = chain_Level(chain->items, first, last);
+    if (level == 2) {
+        left = ir_Operand(chain->items[2 * first], lw);
+        result = -1;
+        for (k = first; k < last && left >= 0; k++) {
+            if (result >= 0 && begin_Lazy(lw, &lazy) < 0)
+                return -1;
+            right = ir_Operand(chain->items[2 * k + 2], lw);
+            part = ir_Compare(lw, left, ir_OpOf(chain, k), right);
+            result = result < 0 ? part : end_Lazy(lw, &lazy, IR_AND, result, part);
+            if (result < 0)
+                return -1;
+            left = right;
+        }
+        return first == last ? left : result;
+    }
+
+    result = -1;
+    for (from = first; from <= last; from = k + 1) {
+        k = chain_Group(chain->items, from, last, level);
+        if (result >= 0 && begin_Lazy(lw, &lazy) < 0)
+            return -1;
+        part = ir_Logic(chain, from, k, lw);
+        result = result < 0 ? part : end_Lazy(lw, &lazy, level == 0 ? IR_OR : IR_AND, result, part);
+        if (result < 0)
+            return -1;
+    }
+    return result;
+}
+
+
+int ir_Expr (struct ParseTree* tree, struct IrLower* lw) {
+    struct IrChain chain;
+    int v;
+
+    if (tree->child->sibling == NULL)
+        return ir_Operand(tree->child, lw);
+    chain.items = chain_Items(tree, &chain.n);
+    if (chain.items == NULL) {
+        lw->ir->error = MEMORY_ERROR;
+        return -1;
+    }
+    v = ir_Logic(&chain, 0, chain.n - 1, lw);
+    free(chain.items);
+    return v;
+}
+
+
+/*
+ * ---------------
+ * Lines
+ * ---------------
+*/
+
+void name_Value (struct IrLower* lw, int v, int id) {
+    // The value is written in Python with the name of the first variable that holds it
+    struct IrIns* ins = lw->ir->ins + v;
+
+    if (ins->var == 0 && ins->op != IR_CONST && ins->op != IR_UNDEF)
+        ins->var = id;
+}
+
+
+int ir_Assign (struct ParseTree* tree, struct IrLower* lw) {
+    int v;
+
+    v = ir_Expr(tree->child->sibling->sibling, lw);
+    if (v < 0 || lw->cur < 0)
+        return -1;
+    name_Value(lw, v, tree->child->data->id);
+    return write_Var(lw, lw->cur, tree->child->slot, v) < 0 ? -1 : 0;
+}
+
+
+int ir_Input (struct ParseTree* tree, struct IrLower* lw) {
+    struct ParseTree* var;
+    int v, type;
+
+    switch (tree->child->data->id) {
+        case ID_READINT: type = _int; break;
+        case ID_READFLOAT: type = _float; break;
+        case ID_READSTR: type = _string; break;
+        default: type = _bool;
+    }
+    var = tree->child->sibling;
+    v = ir_Emit(lw, IR_READ, type, 0, 0, 0);
+    if (v < 0)
+        return -1;
+    name_Value(lw, v, var->data->id);
+    return write_Var(lw, lw->cur, var->slot, v) < 0 ? -1 : 0;
+}
+
+
+int ir_Output (struct ParseTree* tree, struct IrLower* lw) {
+    int v;
+
+    v = ir_Obj(tree->child->sibling, lw);
+    return v < 0 || ir_Emit(lw, IR_PRINT, -1, v, 0, 0) < 0 ? -1 : 0;
+}
+
+
+int ir_Lines (struct ParseTree* line, struct IrLower* lw) {
+    // Lines up to the end or to the else: the ones after a break or a continue never run
+    while (line != NULL && line->data->type != OptElse && lw->cur >= 0) {
+        if (ir_Line(line, lw) < 0)
+            return -1;
+        line = line->sibling->sibling;
+    }
+    return 0;
+}
+
+
+int ir_IfLine (struct ParseTree* tree, struct IrLower* lw) {
+    struct ParseTree* line;
+    int cond, from, yes, no, join;
+
+    cond = ir_Expr(tree->child->sibling->child->sibling, lw);
+    if (cond < 0)
+        return -1;
+    line = tree->child->sibling->sibling->child;
+    while (line != NULL && line->data->type != OptElse)
+        line = line->sibling->sibling;
+    if (line != NULL && line->child->sibling == NULL)
+        line = NULL; // an empty else
+
+    from = lw->cur;
+    yes = ir_Block(lw);
+    no = line != NULL ? ir_Block(lw) : -1;
+    join = ir_Block(lw);
+    if (yes < 0 || join < 0 || (line != NULL && no < 0))
+        return -1;
+    if (ir_Branch(lw, cond, yes, line != NULL ? no : join) < 0 || seal_Block(lw, yes) < 0)
+        return -1;
+    lw->ir->blocks[from].join = join;
+
+    lw->cur = yes;
+    if (ir_Lines(tree->child->sibling->sibling->child, lw) < 0)
+        return -1;
+    if (lw->cur >= 0 && ir_Jump(lw, join) < 0)
+        return -1;
+    if (line != NULL) {
+        if (seal_Block(lw, no) < 0)
+            return -1;
+        lw->cur = no;
+        if (ir_Lines(line->child->sibling, lw) < 0)
+            return -1;
+        if (lw->cur >= 0 && ir_Jump(lw, join) < 0)
+            return -1;
+    }
+
+    if (lw->low[join].npreds == 0) {
+        // Both ways break or continue: what follows never runs
+        lw->ir->blocks[join].dead = 1;
+        lw->ir->blocks[from].join = -1;
+        lw->cur = -1;
+        return 0;
+    }
+    lw->cur = join;
+    return seal_Block(lw, join);
+}
+
+
+int ir_LoopLine (struct ParseTree* tree, struct IrLower* lw) {
+    /*
+     * The header computes the condition, that can take some blocks of its own:
+     * the last one branches to the body or out. The header is sealed after the body,
+     * once the continues and the end of the body have jumped back to it.
+    */
+    int head, test, body, exit, cond, outer_head, outer_exit;
+
+    head = ir_Block(lw);
+    if (head < 0 || ir_Jump(lw, head) < 0)
+        return -1;
+    lw->cur = head;
+    cond = ir_Expr(tree->child->sibling->child->sibling, lw);
+    if (cond < 0)
+        return -1;
+    test = lw->cur;
+    body = ir_Block(lw);
+    exit = ir_Block(lw);
+    if (body < 0 || exit < 0 || ir_Branch(lw, cond, body, exit) < 0 || seal_Block(lw, body) < 0)
+        return -1;
+    lw->ir->blocks[head].exit = exit;
+    lw->ir->blocks[head].test = test;
+
+    outer_head = lw->head;
+    outer_exit = lw->exit;
+    lw->head = head;
+    lw->exit = exit;
+    lw->cur = body;
+    if (ir_Lines(tree->child->sibling->sibling->child, lw) < 0)
+        return -1;
+    if (lw->cur >= 0 && ir_Jump(lw, head) < 0)
+        return -1;
+    lw->head = outer_head;
+    lw->exit = outer_exit;
+
+    if (seal_Block(lw, head) < 0 || seal_Block(lw, exit) < 0)
+        return -1;
+    lw->cur = exit;
+    return 0;
+}
+
+
+int ir_Line (struct ParseTree* tree, struct IrLower* lw) {
+    struct ParseTree* line;
+
+    line = tree->child;
+    switch (line->data->type) {
+        case Assign: return ir_Assign(line, lw);
+        case Input: return ir_Input(line, lw);
+        case Output: return ir_Output(line, lw);
+        case IfLine: return ir_IfLine(line, lw);
+        case LoopLine: return ir_LoopLine(line, lw);
+        case Break: return lw->exit < 0 ? -1 : ir_Jump(lw, lw->exit);
+        case Continue: return lw->head < 0 ? -1 : ir_Jump(lw, lw->head);
+        default: return -1;
+    }
+}
+
+
+int finish_Lower (struct IrLower* lw) {
+    // The predecessors of each block become a range of ir->preds, in the order of the phi operands
+    struct Ir* ir = lw->ir;
+    int b, e;
+
+    ir->preds = malloc((lw->nedges + 1) * sizeof(int));
+    if (ir->preds == NULL)
+        return MEMORY_ERROR;
+    ir->cappreds = lw->nedges + 1;
+    for (b = 0; b < ir->nblocks; b++) {
+        ir->blocks[b].pred = ir->npreds;
+        ir->blocks[b].npreds = 0;
+        if (ir->blocks[b].dead)
+            continue;
+        for (e = lw->low[b].head; e >= 0; e = lw->edges[e].next) {
+            ir->preds[ir->npreds++] = lw->edges[e].from;
+            ir->blocks[b].npreds++;
+        }
+    }
+    return SUBTREE_OK;
+}
+
+
+void free_Lower (struct IrLower* lw) {
+    free(lw->edges);
+    free(lw->low);
+    free(lw->keys);
+    free(lw->vals);
+    free(lw->slot_types);
+    free(lw->slot_ids);
+    free(lw->undefs);
+    free(lw->stack);
+}
+
+
+struct Ir* lower_Program (struct ParseTree* root, struct SymbolTable* table) {
+    struct ParseTree* line;
+    struct IrLower lw;
+    struct Symbol* sym;
+    struct Ir* ir;
+    int i, status;
+
+    if (! root || root->data->type != Program || root->child == NULL)
+        return NULL;
+    ir = calloc(1, sizeof(struct Ir));
+    if (ir == NULL)
+        return NULL;
+
+    memset(&lw, 0, sizeof(lw));
+    lw.ir = ir;
+    lw.table = table;
+    lw.head = lw.exit = -1;
+    lw.nslots = table->nslots > 0 ? table->nslots : 1;
+    lw.slot_types = malloc(lw.nslots * sizeof(int));
+    lw.slot_ids = calloc(lw.nslots, sizeof(int));
+    lw.undefs = malloc(lw.nslots * sizeof(int));
+    status = lw.slot_types == NULL || lw.slot_ids == NULL || lw.undefs == NULL ? MEMORY_ERROR : SUBTREE_OK;
+    for (i = 0; status == SUBTREE_OK && i < lw.nslots; i++)
+        lw.slot_types[i] = lw.undefs[i] = -1;
+    for (sym = status == SUBTREE_OK ? table->last : NULL; sym != NULL; sym = sym->prev)
+        if (sym->slot >= 0 && sym->slot < lw.nslots) {
+            lw.slot_types[sym->slot] = sym->type;
+            lw.slot_ids[sym->slot] = sym->id;
+        }
+
+    if (status == SUBTREE_OK && ((lw.cur = ir_Block(&lw)) < 0 || seal_Block(&lw, 0) < 0))
+        status = MEMORY_ERROR;
+    for (line = status == SUBTREE_OK ? root->child : NULL; line != NULL && lw.cur >= 0; line = line->sibling->sibling)
+        if (ir_Line(line, &lw) < 0) {
+            status = PARSING_ERROR;
+            break;
+        }
+    if (status == SUBTREE_OK && lw.cur >= 0 && ir_Emit(&lw, IR_EXIT, -1, 0, 0, 0) < 0)
+        status = MEMORY_ERROR;
+    if (status == SUBTREE_OK && ir->error == SUBTREE_OK)
+        status = finish_Lower(&lw);
+    if (ir->error != SUBTREE_OK)
+        status = ir->error;
+    free_Lower(&lw);
+    if (status != SUBTREE_OK) {
+        free_Ir(ir);
+        return NULL;
+    }
+    return ir;
+}
+
+
+/*
+ * ---------------
+ * Verifier
+ * ---------------
+*/
+
+int ir_Invalid (struct Ir* ir, int i, const char* what) {
+    if (i >= 0)
+        log_Error("invalid IR at v%d (%s in b%d): %s", i, ir_Ops[ir->ins[i].op].name, ir->ins[i].block, what);
+    else
+        log_Error("invalid IR: %s", what);
+    return PARSING_ERROR;
+}
+
+
+int has_Value (int op) {
+    return op != IR_NOP && op != IR_PRINT && ! ir_Ops[op].term;
+}
+
+
+int is_NumType (int type) {
+    return type == _int || type == _float;
+}
+
+
+int check_Types (struct Ir* ir, struct IrIns* ins) {
+    // The types of the analysis, where it gives them: copies and phis can carry what and, or give
+    int ta, tb;
+
+    ta = ir_Ops[ins->op].nfixed > 0 ? ir->ins[ins->a].type : -1;
+    tb = ir_Ops[ins->op].nfixed > 1 ? ir->ins[ins->b].type : -1;
+    switch (ins->op) {
+        case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD:
+            return is_NumType(ta) && is_NumType(tb) && ins->type == resultType_aritm[ta][tb];
+        case IR_FDIV:
+            return is_NumType(ta) && is_NumType(tb) && ins->type == resultType_FloatDiv[ta][tb];
+        case IR_LT: case IR_LE: case IR_GT: case IR_GE:
+            return is_NumType(ta) && is_NumType(tb) && ins->type == _bool;
+        case IR_EQ: case IR_NE: case IR_AND: case IR_OR:
+            return ins->type == _bool;
+        case IR_CONCAT:
+            return ta == _string && tb == _string && ins->type == _string;
+        case IR_FORMAT:
+            return ta == _string && ins->type == _string;
+        case IR_LIST:
+            return ins->type == _list;
+        case IR_ELEM:
+            return ta == _list && tb == _int && ins->type >= 0;
+        case IR_READ:
+            return ins->type == _int || ins->type == _float || ins->type == _string || ins->type == _bool;
+        case IR_CONST:
+            return ins->a >= 0 && ins->a < ir->nconsts && ins->type >= 0;
+        case IR_PRINT: case IR_JMP: case IR_BR: case IR_EXIT:
+            return 1;
+        default:
+            return ins->type >= 0;
+    }
+}
+
+
+int dom_Numbers (struct Ir* ir, int* idom, int* order, int n, int* pre, int* post) {
+    // Numbers of a depth-first visit of the dominator tree: a dominates b if it encloses it
+    int *child, *first, *stack, *next;
+    int i, b, top, clock;
+
+    child = malloc((n + 1) * sizeof(int));
+    first = calloc(ir->nblocks + 1, sizeof(int));
+    stack = malloc((n + 1) * sizeof(int));
+    next = malloc((ir->nblocks + 1) * sizeof(int));
+    if (child == NULL || first == NULL || stack == NULL || next == NULL) {
+        free(child);
+        free(first);
+        free(stack);
+        free(next);
+        return MEMORY_ERROR;
+    }
+    for (i = 1; i < n; i++)
+        first[idom[order[i]] + 1]++;
+    for (b = 0; b < ir->nblocks; b++)
+        first[b + 1] += first[b];
+    memcpy(next, first, (ir->nblocks + 1) * sizeof(int));
+    for (i = 1; i < n; i++)
+        child[next[idom[order[i]]]++] = order[i];
+
+    memcpy(next, first, (ir->nblocks + 1) * sizeof(int));
+    clock = 0;
+    top = 0;
+    stack[top++] = 0;
+    pre[0] = clock++;
+    while (top > 0) {
+        b = stack[top - 1];
+        if (next[b] < first[b + 1]) {
+            i = child[next[b]++];
+            pre[i] = clock++;
+            stack[top++] = i;
+        }
+        else {
+            post[b] = clock++;
+            top--;
+        }
+    }
+    free(child);
+    free(first);
+    free(stack);
+    free(next);
+    return SUBTREE_OK;
+}
+
+
+int verify_Ir (struct Ir* ir) {
+    struct IrBlock* bl;
+    struct IrIns* ins;
+    int *order, *idom, *pre, *post, *pos;
+    int n, b, i, k, p, s, v, d, use, nsucc, phis, status;
+
+    order = malloc((ir->nblocks + 1) * sizeof(int));
+    idom = malloc((ir->nblocks + 1) * sizeof(int));
+    pre = malloc((ir->nblocks + 1) * sizeof(int));
+    post = malloc((ir->nblocks + 1) * sizeof(int));
+    pos = malloc((ir->n + 1) * sizeof(int));
+    status = order == NULL || idom == NULL || pre == NULL || post == NULL || pos == NULL ? MEMORY_ERROR : SUBTREE_OK;
+    n = status == SUBTREE_OK ? dominators_Ir(ir, order, idom) : -1;
+    if (n < 0 || dom_Numbers(ir, idom, order, n, pre, post) != SUBTREE_OK)
+        status = MEMORY_ERROR;
+    for (b = 0; status == SUBTREE_OK && b < ir->nblocks; b++)
+        pre[b] = ir->blocks[b].dead ? -2 : pre[b];
+    for (i = 0; status == SUBTREE_OK && i < n; i++)
+        pre[order[i]] += ir->nblocks + 2; // reached: the numbers of the others stay below
+    for (b = 0; status == SUBTREE_OK && b < ir->nblocks; b++) {
+        if (ir->blocks[b].dead)
+            continue;
+        if (pre[b] < ir->nblocks + 2)
+            status = ir_Invalid(ir, -1, "a block is never reached");
+        for (i = ir->blocks[b].first, k = 0; status == SUBTREE_OK && i >= 0; i = ir->ins[i].next)
+            pos[i] = k++;
+    }
+
+    for (b = 0; status == SUBTREE_OK && b < ir->nblocks; b++) {
+        bl = ir->blocks + b;
+        if (bl->dead)
+            continue;
+
+        // The list, the phis first and a single terminator at the end
+        phis = 1;
+        for (i = bl->first; status == SUBTREE_OK && i >= 0; i = ins->next) {
+            ins = ir->ins + i;
+            if (ins->block != b || (ins->next >= 0 && ir->ins[ins->next].prev != i) || (ins->next < 0 && bl->last != i))
+                status = ir_Invalid(ir, i, "the list of the block is broken");
+            else if (ins->op == IR_NOP)
+                status = ir_Invalid(ir, i, "a removed instruction is in a block");
+            else if (ins->op == IR_PHI && ! phis)
+                status = ir_Invalid(ir, i, "a phi after the other instructions");
+            else if (ir_Ops[ins->op].term != (ins->next < 0))
+                status = ir_Invalid(ir, i, "a terminator that is not at the end");
+            else if (! check_Types(ir, ins))
+                status = ir_Invalid(ir, i, "wrong types");
+            else if (ins->op == IR_PHI && ins->c != bl->npreds)
+                status = ir_Invalid(ir, i, "a phi without an operand per predecessor");
+            if (ins->op != IR_PHI && ins->op != IR_COPY && ins->op != IR_CONST && ins->op != IR_UNDEF)
+                phis = 0;
+
+            // Each operand is a value whose definition dominates the use
+            for (k = 0; status == SUBTREE_OK && k < count_Operands(ins); k++) {
+                v = *operand_At(ir, ins, k);
+                if (v < 0 || v >= ir->n || ! has_Value(ir->ins[v].op) || ir->ins[v].block < 0) {
+                    status = ir_Invalid(ir, i, "an operand that is not a value");
+                    break;
+                }
+                d = ir->ins[v].block;
+                use = ins->op == IR_PHI ? ir->preds[bl->pred + k] : b;
+                if (d == use ? ins->op != IR_PHI && pos[v] >= pos[i] : ! (pre[d] < pre[use] && post[use] < post[d]))
+                    status = ir_Invalid(ir, i, "an operand whose definition does not dominate the use");
+            }
+        }
+        if (status != SUBTREE_OK)
+            break;
+        if (bl->last < 0) {
+            status = ir_Invalid(ir, -1, "a block without terminator");
+            break;
+        }
+
+        // The edges, both ways
+        ins = ir->ins + bl->last;
+        nsucc = ins->op == IR_BR ? 2 : ins->op == IR_JMP;
+        for (k = 0; k < 2 && status == SUBTREE_OK; k++) {
+            s = bl->succ[k];
+            if ((k < nsucc) != (s >= 0) || (s >= 0 && ir->blocks[s].dead))
+                status = ir_Invalid(ir, bl->last, "the successors do not match the terminator");
+            else if (s >= 0) {
+                for (p = 0, v = 0; p < ir->blocks[s].npreds; p++)
+                    v += ir->preds[ir->blocks[s].pred + p] == b;
+                if (v != 1 || (k == 1 && s == bl->succ[0]))
+                    status = ir_Invalid(ir, bl->last, "a successor that does not have the block as predecessor once");
+            }
+        }
+        for (p = 0; p < bl->npreds && status == SUBTREE_OK; p++) {
+            s = ir->preds[bl->pred + p];
+            if (s < 0 || s >= ir->nblocks || ir->blocks[s].dead || (ir->blocks[s].succ[0] != b && ir->blocks[s].succ[1] != b))
+                status = ir_Invalid(ir, -1, "a predecessor that does not jump to the block");
+        }
+    }
+    free(order);
+    free(idom);
+    free(pre);
+    free(post);
+    free(pos);
+    return status;
+}
+
+
+/*
+ * ---------------
+ * Dump
+ * ---------------
+*/
+
+void print_IrConst (struct IrConst* c, FILE* fp) {
+    char num[64];
+
+    if (c->text != NULL)
+        fputs(c->text, fp);
+    else if (c->type == _float) {
+        str_Float(c->f, num);
+        fputs(num, fp);
+    }
+    else if (c->type == _bool)
+        fputs(c->i ? "True" : "False", fp);
+    else if (c->type == _null)
+        fputs("None", fp);
+    else
+        fprintf(fp, "%lld", c->i);
+}
+
+
+void print_Ir (struct Ir* ir, FILE* fp) {
+    struct IrBlock* bl;
+    struct IrIns* ins;
+    int b, i, k;
+
+    for (b = 0; b < ir->nblocks; b++) {
+        bl = ir->blocks + b;
+        if (bl->dead)
+            continue;
+        fprintf(fp, "b%d:", b);
+        for (k = 0; k < bl->npreds; k++)
+            fprintf(fp, "%s b%d", k == 0 ? " <-" : ",", ir->preds[bl->pred + k]);
+        if (bl->exit >= 0)
+            fprintf(fp, "  ; loop, test b%d, exit b%d", bl->test, bl->exit);
+        if (bl->join >= 0)
+            fprintf(fp, "  ; join b%d", bl->join);
+        fputc('\n', fp);
+
+        for (i = bl->first; i >= 0; i = ins->next) {
+            ins = ir->ins + i;
+            fputs("    ", fp);
+            if (has_Value(ins->op))
+                fprintf(fp, "v%d = %s %s", i, ir_Ops[ins->op].name, type2str(ins->type));
+            else
+                fputs(ir_Ops[ins->op].name, fp);
+            if (ins->op == IR_CONST) {
+                fputc(' ', fp);
+                print_IrConst(ir->consts + ins->a, fp);
+            }
+            for (k = 0; k < count_Operands(ins); k++) {
+                fprintf(fp, "%s", k == 0 ? " " : ", ");
+                if (ins->op == IR_PHI)
+                    fprintf(fp, "[b%d v%d]", ir->preds[bl->pred + k], *operand_At(ir, ins, k));
+                else
+                    fprintf(fp, "v%d", *operand_At(ir, ins, k));
+            }
+            if (ins->op == IR_JMP)
+                fprintf(fp, " b%d", bl->succ[0]);
+            else if (ins->op == IR_BR)
+                fprintf(fp, ", b%d, b%d", bl->succ[0], bl->succ[1]);
+            if (ins->var > 0)
+                fprintf(fp, "  ; %s", lexeme_Of(ins->var));
+            fputc('\n', fp);
+        }
+    }
+}
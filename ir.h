@@ -0,0 +1,179 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stdio.h>
+
+#include "semantic.h"
+
+/*
+ * Middle end of the Python target: the program in SSA form, in basic blocks,
+ * between the semantic analysis and the code generation (see cgen_ir.h).
+ * Each instruction defines at most one value, known by the index of the instruction:
+ * the operands are such indexes. Everything is in flat arrays, instructions, blocks,
+ * the operands of phis, lists and formats, the predecessors of the blocks and the constants.
+ *
+ * The operations are the ones of the Python code, with its semantics: / is the true division,
+ * and, or give one of their operands. The type of each value is the one that analyze_Expr
+ * derived from the resultType tables, so / of two ints is an int here: only the constants
+ * carry the type of their Python value (see struct IrConst).
+*/
+
+enum IrOp {
+    IR_NOP, // removed by a pass
+    IR_CONST, // consts[a]
+    IR_UNDEF, // a variable read where it was never written: a name that Python never bound
+    IR_PHI, // one of args[b .. b + c), in the order of the predecessors. a is the slot of its variable, or -1
+    IR_COPY, // a
+    IR_ADD, IR_SUB, IR_MUL, IR_DIV, IR_FDIV, IR_MOD, // a op b, numbers. IR_FDIV is /. of the source
+    IR_LT, IR_LE, IR_GT, IR_GE, // a op b, numbers
+    IR_EQ, IR_NE, // a op b
+    IR_AND, IR_OR, // a and b, a or b: b is computed anyway, so it cannot fail
+    IR_CONCAT, // a + b, strings
+    IR_FORMAT, // a % (args[b .. b + c)), a is the literal
+    IR_LIST, // [args[b .. b + c)]
+    IR_ELEM, // a[b]
+    IR_READ, // the next input line, as a value of the type
+    IR_PRINT, // print(a)
+    IR_JMP, // to succ[0]
+    IR_BR, // to succ[0] if a is true, else to succ[1]
+    IR_EXIT, // end of the program
+    N_IR_OPS
+};
+
+struct IrOpInfo {
+    const char* name; // in the dump
+    char nfixed; // operands in a, then b
+    char variadic; // and the ones in args[b .. b + c) after them
+    char effect; // not removed, not moved, not merged
+    char term; // ends a block
+};
+
+extern const struct IrOpInfo ir_Ops[N_IR_OPS];
+
+struct IrIns {
+    short op;
+    short type; // _int, _float, ... of the value, -1 if there is none
+    int a, b, c;
+    int block;
+    int prev, next; // in the list of the block, -1 at the ends
+    int var; // interned id of the variable the value was first given to, 0 if none: for the names
+};
+
+struct IrBlock {
+    int first, last; // instructions, -1 if none: the phis first, a terminator at the end
+    int succ[2]; // -1 if none
+    int pred, npreds; // range in preds
+    int join; // where the two ways of the branch that ends this block meet again, -1 if none
+    int exit, test; // of the header of a loop: the block after the loop and the one that branches on the condition, -1 otherwise
+    int dead; // removed by a pass
+};
+
+/*
+ * A constant, as written in the Python code.
+ * text is the literal of the source when it is kept as it is (a string, a number out of range),
+ * exact is 0 if its value is not known for sure: such a constant is never folded.
+*/
+struct IrConst {
+    int type; // of the Python value: _int, _float, _bool, _string or _null
+    int exact;
+    long long i; // ints and bools
+    double f;
+    char* s; // bytes of an exact string
+    size_t len;
+    char* text; // NULL to write the value
+};
+
+struct Ir {
+    struct IrIns* ins;
+    int n, cap;
+    struct IrBlock* blocks;
+    int nblocks, capblocks; // block 0 is the entry
+    int* args;
+    int nargs, capargs;
+    int* preds;
+    int npreds, cappreds;
+    struct IrConst* consts;
+    int nconsts, capconsts;
+    int error; // MEMORY_ERROR once an array could not grow
+};
+
+/*
+ * Lower the program, that passed analyze_Program_Table with these symbols.
+ * The variables are found by the slots that the analysis gave to each Var,
+ * and they never go through memory: phis are placed while the blocks are made.
+ * Return NULL on error. The caller must free_Ir the result.
+*/
+struct Ir* lower_Program(struct ParseTree *root, struct SymbolTable *table);
+
+void free_Ir(struct Ir *ir);
+
+/*
+ * Check that the blocks link both ways and end with their terminator,
+ * that each phi has an operand per predecessor, that the operands are values
+ * of the right types and that each definition dominates its uses.
+ * The first problem found is logged. Return SUBTREE_OK, PARSING_ERROR or MEMORY_ERROR.
+*/
+int verify_Ir(struct Ir *ir);
+
+/*
+ * One block after the other, one instruction per line.
+*/
+void print_Ir(struct Ir *ir, FILE *fp);
+
+// Instructions that are still there
+int count_IrOps(struct Ir *ir);
+
+// Shared by the passes and the verifier
+int new_IrConst(struct Ir *ir, struct IrConst *c); // the pool takes the strings of c: return the index or -1
+int count_Operands(struct IrIns *ins);
+int* operand_At(struct Ir *ir, struct IrIns *ins, int k);
+int resolve_Copy(struct Ir *ir, int v);
+void unlink_Ins(struct Ir *ir, int i);
+void remove_Pred(struct Ir *ir, int block, int pred);
+int may_Fail(struct Ir *ir, struct IrIns *ins);
+
+/*
+ * Blocks reachable from the entry, in reverse postorder, and the immediate dominator
+ * of each one (-1 for the entry and the blocks not reached).
+ * Return the number of blocks in order, or -1 on memory error.
+*/
+int dominators_Ir(struct Ir *ir, int *order, int *idom);
+
+/*
+ * ---------------
+ * The passes (ir_opt.c)
+ * ---------------
+ * Each one returns how many instructions it changed, or -1 on memory error.
+*/
+
+// Sparse conditional constant propagation: constants, branches that always go one way, blocks never reached
+int run_Sccp(struct Ir *ir);
+
+// Global value numbering: an operation already computed in a dominator is not computed again
+int run_Gvn(struct Ir *ir);
+
+// Copy propagation: the uses of a copy, or of a phi of a single value, read that value
+int run_CopyProp(struct Ir *ir);
+
+// Dead code elimination: the values that nothing needs. Effects and operations that can fail stay
+int run_Dce(struct Ir *ir);
+
+struct IrPassStats {
+    const char* name;
+    double ms;
+    int before, after; // operations, see count_IrOps
+    int changes;
+};
+
+#define IR_PASSES 4
+
+/*
+ * Run the passes in order: sccp, gvn, copyprop, dce, and fill stats[IR_PASSES].
+ * With verify, the IR is checked after each pass too, not only at the end.
+ * Return SUBTREE_OK, MEMORY_ERROR, or PARSING_ERROR if a check fails.
+*/
+int optimize_Ir(struct Ir *ir, struct IrPassStats *stats, int verify);
+
+void print_PassStats(struct IrPassStats *stats, int n, FILE *fp);
+
+#endif
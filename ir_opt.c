@@ -0,0 +1,836 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <limits.h>
+#include <time.h>
+
+#include "ir.h"
+#include "vm.h"
+
+
+#define MAX_EXACT (1LL << 53) // ints up to here are the same as doubles
+
+
+int is_Exact (struct IrConst* c) {
+    // A number that is the same as an int and as a float
+    return c->type == _float || (c->i >= -MAX_EXACT && c->i <= MAX_EXACT);
+}
+
+
+/*
+ * ---------------
+ * Constants, with the semantics of Python
+ * ---------------
+*/
+
+int const_Truth (struct IrConst* c) {
+    // 1 or 0 as bool() gives it, -1 if not known
+    if (c->type == _string)
+        return c->exact ? c->len > 0 : 1; // an escape is at least a byte
+    if (! c->exact)
+        return -1;
+    if (c->type == _float)
+        return c->f != 0;
+    if (c->type == _null)
+        return 0;
+    return c->i != 0;
+}
+
+
+int same_Const (struct IrConst* x, struct IrConst* y) {
+    // The same value, of the same type: -0.0 is not 0.0 here, it is written differently
+    if (x == y)
+        return 1;
+    if (! x->exact || ! y->exact || x->type != y->type)
+        return 0;
+    switch (x->type) {
+        case _float: return memcmp(&x->f, &y->f, sizeof(double)) == 0;
+        case _string: return x->len == y->len && memcmp(x->s, y->s, x->len) == 0;
+        case _null: return 1;
+        default: return x->i == y->i;
+    }
+}
+
+
+int fold_Number (struct Ir* ir, struct IrConst* c, int type, long long i, double f) {
+    // A new constant: never a value that Python would not write back as a literal
+    memset(c, 0, sizeof(struct IrConst));
+    c->type = type;
+    c->exact = 1;
+    c->i = i;
+    c->f = f;
+    if (type == _float && ! isfinite(f))
+        return -1;
+    return new_IrConst(ir, c);
+}
+
+
+int fold_Concat (struct Ir* ir, struct IrConst* x, struct IrConst* y) {
+    struct IrConst c;
+
+    memset(&c, 0, sizeof(c));
+    c.type = _string;
+    c.exact = 1;
+    c.len = x->len + y->len;
+    c.s = malloc(c.len + 1);
+    c.text = malloc(c.len + 3);
+    if (c.s == NULL || c.text == NULL) {
+        free(c.s);
+        free(c.text);
+        ir->error = MEMORY_ERROR;
+        return -2;
+    }
+    memcpy(c.s, x->s, x->len);
+    memcpy(c.s + x->len, y->s, y->len);
+    c.s[c.len] = '\0';
+    // The bytes of an exact string have neither quotes nor backslashes
+    c.text[0] = '"';
+    memcpy(c.text + 1, c.s, c.len);
+    c.text[c.len + 1] = '"';
+    c.text[c.len + 2] = '\0';
+    return new_IrConst(ir, &c);
+}
+
+
+int fold_Equal (struct IrConst* x, struct IrConst* y) {
+    // x == y as Python says, bools being ints: -1 if not known
+    double fx, fy;
+
+    if (! x->exact || ! y->exact)
+        return -1;
+    if (x->type == _string || y->type == _string)
+        return x->type == y->type && x->len == y->len && memcmp(x->s, y->s, x->len) == 0;
+    if (x->type == _null || y->type == _null)
+        return x->type == y->type;
+    if (x->type != _float && y->type != _float)
+        return x->i == y->i;
+    if (! is_Exact(x) || ! is_Exact(y))
+        return -1;
+    fx = x->type == _float ? x->f : (double) x->i;
+    fy = y->type == _float ? y->f : (double) y->i;
+    return fx == fy;
+}
+
+
+int fold_Ins (struct Ir* ir, struct IrIns* ins, int ca, int cb) {
+    /*
+     * The constant of an operation on the constants ca and cb.
+     * Return its index, -1 if it is not folded, -2 on memory error.
+     * Only what Python computes in the same way is folded: no overflow,
+     * no division by zero, no int compared to a float it cannot be.
+    */
+    struct IrConst *x, *y, c;
+    long long r;
+    double fx, fy, f;
+    int op, eq;
+
+    op = ins->op;
+    x = ir->consts + ca;
+    y = ir->consts + cb;
+    if (op == IR_CONCAT)
+        return x->exact && y->exact && x->type == _string && y->type == _string ? fold_Concat(ir, x, y) : -1;
+    if (op == IR_EQ || op == IR_NE) {
+        eq = fold_Equal(x, y);
+        return eq < 0 ? -1 : fold_Number(ir, &c, _bool, eq == (op == IR_EQ), 0);
+    }
+    if (! x->exact || ! y->exact || (x->type != _int && x->type != _float) || (y->type != _int && y->type != _float))
+        return -1;
+
+    if (x->type == _int && y->type == _int && op != IR_DIV && op != IR_FDIV) {
+        switch (op) {
+            case IR_ADD: return __builtin_add_overflow(x->i, y->i, &r) ? -1 : fold_Number(ir, &c, _int, r, 0);
+            case IR_SUB: return __builtin_sub_overflow(x->i, y->i, &r) ? -1 : fold_Number(ir, &c, _int, r, 0);
+            case IR_MUL: return __builtin_mul_overflow(x->i, y->i, &r) ? -1 : fold_Number(ir, &c, _int, r, 0);
+            case IR_MOD:
+                if (y->i == 0)
+                    return -1;
+                return fold_Number(ir, &c, _int, y->i == -1 ? 0 : floor_Mod(x->i, y->i), 0);
+            case IR_LT: return fold_Number(ir, &c, _bool, x->i < y->i, 0);
+            case IR_LE: return fold_Number(ir, &c, _bool, x->i <= y->i, 0);
+            case IR_GT: return fold_Number(ir, &c, _bool, x->i > y->i, 0);
+            case IR_GE: return fold_Number(ir, &c, _bool, x->i >= y->i, 0);
+            default: return -1;
+        }
+    }
+
+    // In floats, as Python converts the ints: exactly, or not at all here
+    if (! is_Exact(x) || ! is_Exact(y))
+        return -1;
+    fx = x->type == _float ? x->f : (double) x->i;
+    fy = y->type == _float ? y->f : (double) y->i;
+    switch (op) {
+        case IR_ADD: f = fx + fy; break;
+        case IR_SUB: f = fx - fy; break;
+        case IR_MUL: f = fx * fy; break;
+        case IR_DIV: case IR_FDIV:
+            if (fy == 0)
+                return -1;
+            f = fx / fy;
+            break;
+        case IR_MOD:
+            if (fy == 0)
+                return -1;
+            f = floor_FMod(fx, fy);
+            break;
+        case IR_LT: return fold_Number(ir, &c, _bool, fx < fy, 0);
+        case IR_LE: return fold_Number(ir, &c, _bool, fx <= fy, 0);
+        case IR_GT: return fold_Number(ir, &c, _bool, fx > fy, 0);
+        case IR_GE: return fold_Number(ir, &c, _bool, fx >= fy, 0);
+        default: return -1;
+    }
+    return fold_Number(ir, &c, _float, 0, f);
+}
+
+
+/*
+ * ---------------
+ * SCCP
+ * ---------------
+ * As Wegman and Zadeck: each value starts unknown (TOP), becomes a constant
+ * or varies (BOTTOM), and never goes back. Only the edges that can be taken
+ * are followed, so a phi only meets the values that can reach it.
+*/
+
+#define LAT_TOP 0
+#define LAT_CONST 1
+#define LAT_BOTTOM 2
+
+struct Sccp {
+    struct Ir* ir;
+    char* lattice;
+    int* value; // index of the constant, with LAT_CONST
+    char* reached; // blocks
+    char* taken; // edges, by their place in ir->preds
+    int *user_start, *users; // for each value, the instructions that read it
+    int *work, nwork; // instructions to evaluate again
+    char* queued;
+    int *blocks, nblocks; // blocks reached, not visited yet
+};
+
+
+int build_Users (struct Ir* ir, int** start, int** users) {
+    // The readers of each value, in one array
+    struct IrIns* ins;
+    int *count, i, k, v, total;
+
+    count = calloc(ir->n + 1, sizeof(int));
+    if (count == NULL)
+        return MEMORY_ERROR;
+    total = 0;
+    for (i = 0; i < ir->n; i++) {
+        ins = ir->ins + i;
+        if (ins->op == IR_NOP)
+            continue;
+        for (k = 0; k < count_Operands(ins); k++) {
+            count[*operand_At(ir, ins, k) + 1]++;
+            total++;
+        }
+    }
+    for (i = 0; i < ir->n; i++)
+        count[i + 1] += count[i];
+    *users = malloc((total + 1) * sizeof(int));
+    *start = malloc((ir->n + 1) * sizeof(int));
+    if (*users == NULL || *start == NULL) {
+        free(*users);
+        free(*start);
+        free(count);
+        return MEMORY_ERROR;
+    }
+    memcpy(*start, count, (ir->n + 1) * sizeof(int));
+    for (i = 0; i < ir->n; i++) {
+        ins = ir->ins + i;
+        if (ins->op == IR_NOP)
+            continue;
+        for (k = 0; k < count_Operands(ins); k++) {
+            v = *operand_At(ir, ins, k);
+            (*users)[count[v]++] = i;
+        }
+    }
+    free(count);
+    return SUBTREE_OK;
+}
+
+
+void sccp_Queue (struct Sccp* s, int i) {
+    if (! s->queued[i]) {
+        s->queued[i] = 1;
+        s->work[s->nwork++] = i;
+    }
+}
+
+
+void sccp_Set (struct Sccp* s, int i, int lattice, int value) {
+    // A lower value: its readers are evaluated again
+    int u;
+
+    if (lattice == s->lattice[i] && (lattice != LAT_CONST || same_Const(s->ir->consts + value, s->ir->consts + s->value[i])))
+        return;
+    s->lattice[i] = lattice;
+    s->value[i] = value;
+    for (u = s->user_start[i]; u < s->user_start[i + 1]; u++)
+        sccp_Queue(s, s->users[u]);
+}
+
+
+void sccp_Edge (struct Sccp* s, int from, int to) {
+    // The edge can be taken: the phis of its end see one more value
+    struct IrBlock* bl = s->ir->blocks + to;
+    int k, i;
+
+    for (k = 0; k < bl->npreds; k++)
+        if (s->ir->preds[bl->pred + k] == from)
+            break;
+    if (k == bl->npreds || s->taken[bl->pred + k])
+        return;
+    s->taken[bl->pred + k] = 1;
+    if (! s->reached[to]) {
+        s->reached[to] = 1;
+        s->blocks[s->nblocks++] = to;
+        return;
+    }
+    for (i = bl->first; i >= 0; i = s->ir->ins[i].next)
+        if (s->ir->ins[i].op == IR_PHI)
+            sccp_Queue(s, i);
+}
+
+
+int sccp_Eval (struct Sccp* s, int i) {
+    struct Ir* ir = s->ir;
+    struct IrIns* ins = ir->ins + i;
+    struct IrBlock* bl = ir->blocks + ins->block;
+    int k, v, lat, val, truth, a, b, folded;
+
+    switch (ins->op) {
+        case IR_CONST:
+            sccp_Set(s, i, LAT_CONST, ins->a);
+            return 0;
+        case IR_COPY:
+            sccp_Set(s, i, s->lattice[ins->a], s->value[ins->a]);
+            return 0;
+        case IR_PHI:
+            lat = LAT_TOP;
+            val = -1;
+            for (k = 0; k < ins->c && lat != LAT_BOTTOM; k++) {
+                if (! s->taken[bl->pred + k])
+                    continue;
+                v = ir->args[ins->b + k];
+                if (s->lattice[v] == LAT_BOTTOM || (s->lattice[v] == LAT_CONST && lat == LAT_CONST && ! same_Const(ir->consts + val, ir->consts + s->value[v])))
+                    lat = LAT_BOTTOM;
+                else if (s->lattice[v] == LAT_CONST && lat == LAT_TOP) {
+                    lat = LAT_CONST;
+                    val = s->value[v];
+                }
+            }
+            sccp_Set(s, i, lat, val);
+            return 0;
+        case IR_JMP:
+            sccp_Edge(s, ins->block, bl->succ[0]);
+            return 0;
+        case IR_BR:
+            truth = s->lattice[ins->a] == LAT_CONST ? const_Truth(ir->consts + s->value[ins->a]) : -1;
+            if (s->lattice[ins->a] == LAT_TOP)
+                return 0;
+            if (truth != 0)
+                sccp_Edge(s, ins->block, bl->succ[0]);
+            if (truth != 1)
+                sccp_Edge(s, ins->block, bl->succ[1]);
+            return 0;
+        case IR_AND: case IR_OR:
+            // The value on the left, when it decides, else the one on the right
+            if (s->lattice[ins->a] != LAT_CONST) {
+                sccp_Set(s, i, s->lattice[ins->a], -1);
+                return 0;
+            }
+            truth = const_Truth(ir->consts + s->value[ins->a]);
+            if (truth < 0)
+                sccp_Set(s, i, LAT_BOTTOM, -1);
+            else if (truth == (ins->op == IR_OR))
+                sccp_Set(s, i, LAT_CONST, s->value[ins->a]);
+            else
+                sccp_Set(s, i, s->lattice[ins->b], s->value[ins->b]);
+            return 0;
+        case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_FDIV: case IR_MOD:
+        case IR_LT: case IR_LE: case IR_GT: case IR_GE: case IR_EQ: case IR_NE: case IR_CONCAT:
+            a = s->lattice[ins->a];
+            b = s->lattice[ins->b];
+            if (a == LAT_BOTTOM || b == LAT_BOTTOM)
+                sccp_Set(s, i, LAT_BOTTOM, -1);
+            else if (a == LAT_CONST && b == LAT_CONST) {
+                folded = fold_Ins(ir, ins, s->value[ins->a], s->value[ins->b]);
+                if (folded == -2 || ir->error != SUBTREE_OK)
+                    return -1;
+                sccp_Set(s, i, folded >= 0 ? LAT_CONST : LAT_BOTTOM, folded);
+            }
+            return 0;
+        case IR_UNDEF: case IR_FORMAT: case IR_LIST: case IR_ELEM: case IR_READ:
+            sccp_Set(s, i, LAT_BOTTOM, -1);
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+
+int sccp_Rewrite (struct Sccp* s) {
+    // Constants for the values, jumps for the branches that go one way, and the blocks never reached are dropped
+    struct Ir* ir = s->ir;
+    struct IrBlock* bl;
+    struct IrIns* ins;
+    int b, i, next, k, other, truth, changes;
+
+    changes = 0;
+    for (b = 0; b < ir->nblocks; b++) {
+        bl = ir->blocks + b;
+        if (bl->dead || ! s->reached[b])
+            continue;
+        for (i = bl->first; i >= 0; i = ins->next) {
+            ins = ir->ins + i;
+            if (ins->op == IR_CONST || ins->op == IR_UNDEF)
+                continue;
+            if (s->lattice[i] == LAT_CONST) {
+                ins->op = IR_CONST;
+                ins->a = s->value[i];
+                ins->b = ins->c = 0;
+                changes++;
+            }
+            else if ((ins->op == IR_AND || ins->op == IR_OR) && s->lattice[ins->a] == LAT_CONST
+                     && (truth = const_Truth(ir->consts + s->value[ins->a])) >= 0) {
+                ins->a = truth == (ins->op == IR_OR) ? ins->a : ins->b;
+                ins->op = IR_COPY;
+                changes++;
+            }
+            else if (ins->op == IR_BR && s->lattice[ins->a] == LAT_CONST
+                     && (truth = const_Truth(ir->consts + s->value[ins->a])) >= 0) {
+                other = bl->succ[truth];
+                bl->succ[0] = bl->succ[! truth];
+                bl->succ[1] = -1;
+                ins->op = IR_JMP;
+                if (other != bl->succ[0])
+                    remove_Pred(ir, other, b);
+                changes++;
+            }
+        }
+    }
+
+    for (b = 0; b < ir->nblocks; b++) {
+        bl = ir->blocks + b;
+        if (bl->dead || s->reached[b])
+            continue;
+        for (k = 0; k < 2; k++)
+            if (bl->succ[k] >= 0 && s->reached[bl->succ[k]])
+                remove_Pred(ir, bl->succ[k], b);
+        for (i = bl->first; i >= 0; i = next) {
+            next = ir->ins[i].next;
+            unlink_Ins(ir, i);
+            changes++;
+        }
+        bl->dead = 1;
+    }
+    return changes;
+}
+
+
+int run_Sccp (struct Ir* ir) {
+    struct Sccp s;
+    struct IrBlock* bl;
+    int b, i, changes;
+
+    memset(&s, 0, sizeof(s));
+    s.ir = ir;
+    s.lattice = calloc(ir->n + 1, 1);
+    s.value = malloc((ir->n + 1) * sizeof(int));
+    s.queued = calloc(ir->n + 1, 1);
+    s.work = malloc((ir->n + 1) * sizeof(int));
+    s.reached = calloc(ir->nblocks + 1, 1);
+    s.blocks = malloc((ir->nblocks + 1) * sizeof(int));
+    s.taken = calloc(ir->npreds + 1, 1);
+    changes = -1;
+    if (s.lattice == NULL || s.value == NULL || s.queued == NULL || s.work == NULL || s.reached == NULL
+        || s.blocks == NULL || s.taken == NULL || build_Users(ir, &s.user_start, &s.users) != SUBTREE_OK)
+        goto end;
+
+    s.reached[0] = 1;
+    s.blocks[s.nblocks++] = 0;
+    while (s.nblocks > 0 || s.nwork > 0) {
+        if (s.nblocks > 0) {
+            bl = ir->blocks + s.blocks[--s.nblocks];
+            for (i = bl->first; i >= 0; i = ir->ins[i].next)
+                if (sccp_Eval(&s, i) < 0)
+                    goto end;
+            continue;
+        }
+        i = s.work[--s.nwork];
+        s.queued[i] = 0;
+        b = ir->ins[i].block;
+        if (b >= 0 && s.reached[b] && sccp_Eval(&s, i) < 0)
+            goto end;
+    }
+    changes = sccp_Rewrite(&s);
+
+end:
+    free(s.lattice);
+    free(s.value);
+    free(s.queued);
+    free(s.work);
+    free(s.reached);
+    free(s.blocks);
+    free(s.taken);
+    free(s.user_start);
+    free(s.users);
+    return changes;
+}
+
+
+/*
+ * ---------------
+ * GVN
+ * ---------------
+ * The blocks are visited down the dominator tree. The operations met on the way
+ * from the entry are in a hash table: an operation that is there already, with the
+ * same operands, is a copy of it. The entries of a block go away when the visit
+ * leaves its subtree, so only operations of a dominator are found.
+*/
+
+struct Gvn {
+    struct Ir* ir;
+    int* buckets; // the last instruction put in each one, -1 if empty
+    int* chain; // the one put before it in its bucket
+    size_t mask;
+    int* undo; // buckets, in the order they got an instruction
+    int nundo;
+};
+
+
+int gvn_Pure (struct Ir* ir, struct IrIns* ins) {
+    // Same operation, same operands, same value: the language has no way to change a list in place
+    (void) ir;
+    return ins->op != IR_NOP && ins->op != IR_UNDEF && ins->op != IR_COPY && ! ir_Ops[ins->op].effect;
+}
+
+
+int gvn_Operand (struct Ir* ir, struct IrIns* ins, int k) {
+    // Operands of + * == != are taken in order of index
+    int x, y;
+
+    if (ins->op == IR_ADD || ins->op == IR_MUL || ins->op == IR_EQ || ins->op == IR_NE) {
+        x = resolve_Copy(ir, ins->a);
+        y = resolve_Copy(ir, ins->b);
+        return (k == 0) == (x < y) ? x : y;
+    }
+    return resolve_Copy(ir, *operand_At(ir, ins, k));
+}
+
+
+size_t gvn_Hash (struct Ir* ir, struct IrIns* ins) {
+    struct IrConst* c;
+    long long bits;
+    size_t h;
+    int k;
+
+    h = (size_t) ins->op * 31 + (size_t) ins->type;
+    if (ins->op == IR_CONST) {
+        c = ir->consts + ins->a;
+        if (! c->exact)
+            return h * 1000003 + ins->a;
+        h = h * 1000003 + c->type;
+        if (c->type == _float) {
+            memcpy(&bits, &c->f, sizeof(bits));
+            h = h * 1000003 + (size_t) bits;
+        }
+        else if (c->type == _string)
+            for (k = 0; k < (int) c->len; k++)
+                h = h * 31 + (unsigned char) c->s[k];
+        else
+            h = h * 1000003 + (size_t) c->i;
+        return h;
+    }
+    if (ins->op == IR_PHI)
+        h = h * 1000003 + ins->block;
+    for (k = 0; k < count_Operands(ins); k++)
+        h = h * 1000003 + gvn_Operand(ir, ins, k);
+    return h;
+}
+
+
+int gvn_Same (struct Ir* ir, struct IrIns* x, struct IrIns* y) {
+    int k;
+
+    if (x->op != y->op || x->type != y->type || count_Operands(x) != count_Operands(y))
+        return 0;
+    if (x->op == IR_CONST)
+        return same_Const(ir->consts + x->a, ir->consts + y->a);
+    if (x->op == IR_PHI && x->block != y->block)
+        return 0;
+    for (k = 0; k < count_Operands(x); k++)
+        if (gvn_Operand(ir, x, k) != gvn_Operand(ir, y, k))
+            return 0;
+    return 1;
+}
+
+
+int gvn_Block (struct Gvn* g, int b) {
+    // The operations of the block: a copy of the first one seen, or the first one seen
+    struct Ir* ir = g->ir;
+    struct IrIns* ins;
+    size_t h;
+    int i, j, changes;
+
+    changes = 0;
+    for (i = ir->blocks[b].first; i >= 0; i = ins->next) {
+        ins = ir->ins + i;
+        if (! gvn_Pure(ir, ins))
+            continue;
+        h = gvn_Hash(ir, ins) & g->mask;
+        for (j = g->buckets[h]; j >= 0; j = g->chain[j])
+            if (gvn_Same(ir, ir->ins + j, ins))
+                break;
+        if (j >= 0) {
+            ins->op = IR_COPY;
+            ins->a = j;
+            ins->b = ins->c = 0;
+            changes++;
+            continue;
+        }
+        g->chain[i] = g->buckets[h];
+        g->buckets[h] = i;
+        g->undo[g->nundo++] = (int) h;
+    }
+    return changes;
+}
+
+
+int run_Gvn (struct Ir* ir) {
+    struct Gvn g;
+    int *order, *idom, *first, *child, *next, *stack, *mark;
+    int n, i, b, top, changes;
+    size_t cap;
+
+    memset(&g, 0, sizeof(g));
+    g.ir = ir;
+    for (cap = 64; cap < 2 * (size_t) ir->n; cap *= 2)
+        ;
+    g.mask = cap - 1;
+    g.buckets = malloc(cap * sizeof(int));
+    g.chain = malloc((ir->n + 1) * sizeof(int));
+    g.undo = malloc((ir->n + 1) * sizeof(int));
+    order = malloc((ir->nblocks + 1) * sizeof(int));
+    idom = malloc((ir->nblocks + 1) * sizeof(int));
+    first = calloc(ir->nblocks + 2, sizeof(int));
+    child = malloc((ir->nblocks + 1) * sizeof(int));
+    next = malloc((ir->nblocks + 1) * sizeof(int));
+    stack = malloc((ir->nblocks + 1) * sizeof(int));
+    mark = malloc((ir->nblocks + 1) * sizeof(int));
+    changes = -1;
+    if (g.buckets == NULL || g.chain == NULL || g.undo == NULL || order == NULL || idom == NULL
+        || first == NULL || child == NULL || next == NULL || stack == NULL || mark == NULL)
+        goto end;
+    n = dominators_Ir(ir, order, idom);
+    if (n < 0)
+        goto end;
+    for (i = 0; i < (int) cap; i++)
+        g.buckets[i] = -1;
+
+    // The children of each block in the dominator tree
+    for (i = 1; i < n; i++)
+        first[idom[order[i]] + 1]++;
+    for (b = 0; b < ir->nblocks; b++)
+        first[b + 1] += first[b];
+    memcpy(next, first, ir->nblocks * sizeof(int));
+    for (i = 1; i < n; i++)
+        child[next[idom[order[i]]]++] = order[i];
+    memcpy(next, first, ir->nblocks * sizeof(int));
+
+    changes = 0;
+    top = 0;
+    stack[top++] = 0;
+    mark[0] = g.nundo;
+    changes += gvn_Block(&g, 0);
+    while (top > 0) {
+        b = stack[top - 1];
+        if (next[b] < first[b + 1]) {
+            i = child[next[b]++];
+            mark[i] = g.nundo;
+            changes += gvn_Block(&g, i);
+            stack[top++] = i;
+            continue;
+        }
+        // Out of the subtree: its operations are forgotten, the last put first
+        while (g.nundo > mark[b]) {
+            i = g.buckets[g.undo[--g.nundo]];
+            g.buckets[g.undo[g.nundo]] = g.chain[i];
+        }
+        top--;
+    }
+
+end:
+    free(g.buckets);
+    free(g.chain);
+    free(g.undo);
+    free(order);
+    free(idom);
+    free(first);
+    free(child);
+    free(next);
+    free(stack);
+    free(mark);
+    return changes;
+}
+
+
+/*
+ * ---------------
+ * Copy propagation and DCE
+ * ---------------
+*/
+
+int run_CopyProp (struct Ir* ir) {
+    // The operands go past the copies, until no phi turns into one
+    struct IrIns* ins;
+    int i, k, v, same, changed, changes;
+    int* op;
+
+    changes = 0;
+    do {
+        changed = 0;
+        for (i = 0; i < ir->n; i++) {
+            ins = ir->ins + i;
+            if (ins->op == IR_NOP || ins->op == IR_COPY)
+                continue;
+            for (k = 0; k < count_Operands(ins); k++) {
+                op = operand_At(ir, ins, k);
+                v = resolve_Copy(ir, *op);
+                if (v != *op) {
+                    *op = v;
+                    changes++;
+                }
+            }
+            if (ins->op != IR_PHI)
+                continue;
+            // A phi of itself and of one value is that value
+            same = -1;
+            for (k = 0; k < ins->c; k++) {
+                v = ir->args[ins->b + k];
+                if (v == i || v == same)
+                    continue;
+                if (same >= 0)
+                    break;
+                same = v;
+            }
+            if (k == ins->c && same >= 0) {
+                ins->op = IR_COPY;
+                ins->a = same;
+                ins->b = ins->c = 0;
+                changed = 1;
+                changes++;
+            }
+        }
+    } while (changed);
+
+    for (i = 0; i < ir->n; i++)
+        if (ir->ins[i].op == IR_COPY) {
+            unlink_Ins(ir, i);
+            changes++;
+        }
+    return changes;
+}
+
+
+int run_Dce (struct Ir* ir) {
+    // What is needed by an effect, a terminator or an operation that can fail. The rest goes
+    struct IrIns* ins;
+    char* live;
+    int *work, nwork, i, k, v, changes;
+
+    live = calloc(ir->n + 1, 1);
+    work = malloc((ir->n + 1) * sizeof(int));
+    if (live == NULL || work == NULL) {
+        free(live);
+        free(work);
+        return -1;
+    }
+    nwork = 0;
+    for (i = 0; i < ir->n; i++) {
+        ins = ir->ins + i;
+        if (ins->op != IR_NOP && (ir_Ops[ins->op].effect || may_Fail(ir, ins))) {
+            live[i] = 1;
+            work[nwork++] = i;
+        }
+    }
+    while (nwork > 0) {
+        ins = ir->ins + work[--nwork];
+        for (k = 0; k < count_Operands(ins); k++) {
+            v = *operand_At(ir, ins, k);
+            if (! live[v]) {
+                live[v] = 1;
+                work[nwork++] = v;
+            }
+        }
+    }
+
+    changes = 0;
+    for (i = 0; i < ir->n; i++)
+        if (ir->ins[i].op != IR_NOP && ! live[i]) {
+            unlink_Ins(ir, i);
+            changes++;
+        }
+    free(live);
+    free(work);
+    return changes;
+}
+
+
+/*
+ * ---------------
+ * Pass manager
+ * ---------------
+*/
+
+struct IrPass {
+    const char* name;
+    int (*run)(struct Ir*);
+};
+
+const struct IrPass ir_Passes[IR_PASSES] = {
+    {"sccp", run_Sccp},
+    {"gvn", run_Gvn},
+    {"copyprop", run_CopyProp},
+    {"dce", run_Dce},
+};
+
+
+double pass_Clock () {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+
+int optimize_Ir (struct Ir* ir, struct IrPassStats* stats, int verify) {
+    double begin;
+    int p;
+
+    for (p = 0; p < IR_PASSES; p++) {
+        stats[p].name = ir_Passes[p].name;
+        stats[p].before = count_IrOps(ir);
+        begin = pass_Clock();
+        stats[p].changes = ir_Passes[p].run(ir);
+        stats[p].ms = pass_Clock() - begin;
+        stats[p].after = count_IrOps(ir);
+        if (stats[p].changes < 0 || ir->error != SUBTREE_OK)
+            return MEMORY_ERROR;
+        if (verify && verify_Ir(ir) != SUBTREE_OK)
+            return PARSING_ERROR;
+    }
+    return verify ? SUBTREE_OK : verify_Ir(ir);
+}
+
+
+void print_PassStats (struct IrPassStats* stats, int n, FILE* fp) {
+    int p;
+
+    fprintf(fp, "%-10s %10s %10s %10s %10s\n", "pass", "wall ms", "ops before", "ops after", "changes");
+    for (p = 0; p < n; p++)
+        fprintf(fp, "%-10s %10.3f %10d %10d %10d\n", stats[p].name, stats[p].ms,
+                stats[p].before, stats[p].after, stats[p].changes);
+}
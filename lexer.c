@@ -1,11 +1,22 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include "lexer.h"
+#include "log.h"
 
-#define MAX_LINE 100
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_SIMD_SCAN 1
+#endif
 
 /* Preliminary definitions */
 
@@ -94,29 +105,19 @@ void free_Token(struct Token* tok) {
 }
 
 void free_TokenList(struct TokenList* tok) {
-    struct TokenList* current;
-    while ((current = tok) != NULL) {
-        tok = tok->next;
-        free_Token(current->token);
-        free(current);
-    }
-}
-
-int alloc_failed(struct Token* tok, char* tmp) {
-    printf("FAILED TO (RE)ALLOC");
-    free_Token(tok);
-    free(tmp);
-    return -1;
+    // Lists are allocated as one block (see alloc_TokenBlock).
+    // Lexemes are views into the source, which is not owned by the list.
+    free(tok);
 }
 
 void print_Token(struct Token* p) {
     if (p == NULL)
         printf("Token is NULL\n");
     else
-        if (strlen(p->lexeme) == 0 || p->type == Endline)
+        if (p->len == 0 || p->type == Endline)
             printf("<%s>\n", type2char(p->type));
         else
-            printf("<|%s|, %s>\n", p->lexeme, type2char(p->type));
+            printf("<|%.*s|, %s>\n", (int) p->len, p->lexeme, type2char(p->type));
 }
 
 void print_TokenList(struct TokenList* p) {
@@ -132,573 +133,1001 @@ void print_TokenList(struct TokenList* p) {
     printf("====================\n");
 }
 
-char consume(const char** p) {
-    // Return the current char while advancing the pointer
-    char c = **p;
-    (*p)++;
-    return c;
+/*
+ * Table-driven lexer.
+ *
+ * The DFA is built once, by build_DFA, from the Token definitions of the `grammar` file:
+ * - the fixed lexemes (operators, punctuation, ENDLINE) become a trie out of the start state;
+ * - blanks, identifiers (var), integers (int) and quoted strings are small loops.
+ * Characters are first mapped to classes, so that the transition table is
+ * DFA_STATES x DFA_CLASSES rather than DFA_STATES x 256.
+ *
+ * No Token of the grammar needs backtracking: a run stops when the next
+ * transition is DEAD, and the Token is valid only if the last state is accepting.
+*/
+
+#define DFA_STATES 64
+#define DFA_CLASSES 64
+#define DEAD 0
+#define START 1
+
+struct FixedToken {
+    const char* lexeme;
+    enum TokenType type;
+};
+
+struct FixedToken fixed_tokens[] = {
+    {",", Comma},
+    {"(", Lpar},
+    {")", Rpar},
+    {"[", Lbrack},
+    {"]", Rbrack},
+    {"{", Lcurly},
+    {"}", Rcurly},
+    {"+", Plus},
+    {"-", Minus},
+    {"=", Equal},
+    {"==", EqEq},
+    {"!=", NotEq},
+    {"<", Lesser},
+    {">", Greater},
+    {"<=", LesserEq},
+    {">=", GreaterEq},
+    {"*", Star},
+    {"/", Div},
+    {"/.", FloatDiv},
+    {"%", Percent},
+    {"||", Or},
+    {"&&", And},
+    {"^", Pow},
+    {".", Dot},
+    {";\n", Endline},
+    {NULL, UNK}
+};
+
+unsigned char char_class[256];
+unsigned char dfa[DFA_STATES][DFA_CLASSES];
+enum TokenType dfa_accept[DFA_STATES];
+int dfa_states = 0;
+
+
+int is_blank(int c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
 }
 
-int match_ws(const char** p, struct Token* tok) {
-    // Build a Token with all consecutive blanks it can find
-    if ( **p != ' ' &&
-         **p != '\t' &&
-         **p != '\r' &&
-         **p != '\n')
-    {
-        printf("Bad call to whitespace!!");
-        return 1;
-    }
-    int i = 0;
-    char c;
-    char* tmp;
-    char ws[MAX_LINE] = "";
-    do {
-        if (i >= MAX_LINE - 1) {
-            printf("Found more than %d white spaces\n", MAX_LINE);
-            return 1;
-        }
-        c = consume(p); // p is incremented here
-        ws[i++] = c;
-    }
-    while (**p == ' ' || **p == '\t' || **p == '\r' || **p == '\n');
-    ws[i++] = '\0';
-    tmp = realloc(tok->lexeme, i * sizeof(char));
-    if (tmp == NULL)
-        return alloc_failed(tok, tmp);
-    else
-        tok->lexeme = tmp;
-    memcpy(tok->lexeme, ws, i);
-    tok->type = WS;
-    return 0;
+int is_letter(int c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
 }
 
-int match_template(const char** p, struct Token* tok, char c, enum TokenType type) {
-    // Build a Token with the character in input and advances the stream pointer.
-    if (**p != c) {
-        printf("Bad call to |%c| !!\n", c);
-        return 1;
+int is_digit(int c) {
+    return c >= '0' && c <= '9';
+}
+
+int is_alnum(int c) {
+    return is_letter(c) || is_digit(c);
+}
+
+int is_zero(int c) {
+    return c == '0';
+}
+
+int is_nonzero(int c) {
+    return c >= '1' && c <= '9';
+}
+
+int is_quote(int c) {
+    return c == '"';
+}
+
+int is_strchar(int c) {
+    return c != '"' && c != '\0';
+}
+
+
+int fixed_index(int c) {
+    // Position of the first fixed lexeme using c, or -1
+    for (int i = 0; fixed_tokens[i].lexeme != NULL; i++)
+        if (strchr(fixed_tokens[i].lexeme, c) != NULL && c != '\0')
+            return i * 8 + (strchr(fixed_tokens[i].lexeme, c) - fixed_tokens[i].lexeme);
+    return -1;
+}
+
+
+void build_classes() {
+    // Two chars share a class iff they behave the same in every definition.
+    int sig[256], seen[256];
+    int nClasses, c, k;
+
+    nClasses = 0;
+    for (c = 0; c < 256; c++) {
+        sig[c] = (fixed_index(c) + 1) * 64 +
+                 is_blank(c) * 32 + is_letter(c) * 16 + is_zero(c) * 8 +
+                 is_nonzero(c) * 4 + is_quote(c) * 2 + (c == '\0');
+        for (k = 0; k < nClasses; k++)
+            if (sig[seen[k]] == sig[c])
+                break;
+        if (k == nClasses)
+            seen[nClasses++] = c;
+        char_class[c] = k;
     }
-    char* tmp;
-    consume(p);
-    tmp = realloc(tok->lexeme, 2 * sizeof(char));
-    if (tmp == NULL)
-        return alloc_failed(tok, tmp);
-    else
-        tok->lexeme = tmp;
-    memcpy(tok->lexeme, (char[2]) {c, '\0'}, 2);
-    tok->type = type;
-    return 0;
 }
 
-int match_lbrack(const char** p, struct Token* tok) {
-    return match_template(p, tok, '[', Lbrack);
+
+/*
+ * Run scanners.
+ *
+ * The loop states of the DFA (blanks, identifiers, integers, string bodies)
+ * skip their whole run with one call, instead of one transition per char.
+ * Each scanner returns the first char at or after p that is NOT in its set.
+ * '\0' is in none of the sets, so a scanner never goes past the end of the source.
+ *
+ * The SSE2/AVX2 versions test 16/32 chars at a time. They only do aligned loads,
+ * which never cross a page boundary, so reading past the '\0' is harmless.
+ * select_scanners picks the widest version the CPU supports, at run time.
+*/
+
+typedef const unsigned char* (*scan_fn)(const unsigned char* p);
+
+scan_fn dfa_run[DFA_STATES];
+
+#define SCAN_SCALAR(name, inset)                            \
+const unsigned char* name(const unsigned char* p) {         \
+    while (inset(*p))                                       \
+        p++;                                                \
+    return p;                                               \
 }
 
-int match_rbrack(const char** p, struct Token* tok) {
-    return match_template(p, tok, ']', Rbrack);
+SCAN_SCALAR(scan_blank_scalar, is_blank)
+SCAN_SCALAR(scan_alnum_scalar, is_alnum)
+SCAN_SCALAR(scan_digit_scalar, is_digit)
+SCAN_SCALAR(scan_strchar_scalar, is_strchar)
+
+#ifdef HAVE_SIMD_SCAN
+
+/* SSE2: in-set masks, 0xFF for the chars in the set */
+
+__m128i inrange_sse2(__m128i v, char lo, char hi) {
+    // lo <= v <= hi, as unsigned, with the signed compare of SSE2
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char) (0x80 - lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char) (0x80 + hi - lo + 1)));
 }
 
-int match_plus(const char** p, struct Token* tok) {
-    return match_template(p, tok, '+', Plus);
+__m128i blank_sse2(__m128i v) {
+    return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
 }
 
-int match_comma(const char** p, struct Token* tok) {
-    return match_template(p, tok, ',', Comma);
+__m128i digit_sse2(__m128i v) {
+    return inrange_sse2(v, '0', '9');
 }
 
-int match_minus(const char** p, struct Token* tok) {
-    return match_template(p, tok, '-', Minus);
+__m128i alnum_sse2(__m128i v) {
+    // setting bit 0x20 turns upper case letters into lower case ones
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    return _mm_or_si128(inrange_sse2(lower, 'a', 'z'), digit_sse2(v));
 }
 
-int match_lpar(const char** p, struct Token* tok) {
-    return match_template(p, tok, '(', Lpar);
+__m128i strchar_sse2(__m128i v) {
+    __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    return _mm_andnot_si128(stop, _mm_set1_epi8((char) 0xFF));
 }
 
-int match_rpar(const char** p, struct Token* tok) {
-    return match_template(p, tok, ')', Rpar);
+#define SCAN_SSE2(name, inset)                                              \
+__attribute__((no_sanitize_address))                                        \
+const unsigned char* name(const unsigned char* p) {                         \
+    const unsigned char* block = (const unsigned char*) ((uintptr_t) p & ~(uintptr_t) 15); \
+    unsigned int stop;                                                      \
+    /* chars before p are ignored */                                        \
+    stop = ~_mm_movemask_epi8(inset(_mm_load_si128((const __m128i*) block))) \
+           & (0xFFFFu << (p - block));                                      \
+    while ((stop & 0xFFFFu) == 0) {                                         \
+        block += 16;                                                        \
+        stop = ~_mm_movemask_epi8(inset(_mm_load_si128((const __m128i*) block))); \
+    }                                                                       \
+    return block + __builtin_ctz(stop);                                     \
 }
 
-int match_lcurly(const char** p, struct Token* tok) {
-    return match_template(p, tok, '{', Lcurly);
+SCAN_SSE2(scan_blank_sse2, blank_sse2)
+SCAN_SSE2(scan_alnum_sse2, alnum_sse2)
+SCAN_SSE2(scan_digit_sse2, digit_sse2)
+SCAN_SSE2(scan_strchar_sse2, strchar_sse2)
+
+/* AVX2: same masks, 32 chars at a time */
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 __m256i inrange_avx2(__m256i v, char lo, char hi) {
+    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char) (0x80 - lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (0x80 + hi - lo + 1)), shifted);
 }
 
-int match_rcurly(const char** p, struct Token* tok) {
-    return match_template(p, tok, '}', Rcurly);
+AVX2 __m256i blank_avx2(__m256i v) {
+    return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                           _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
 }
 
-int match_star(const char** p, struct Token* tok) {
-    return match_template(p, tok, '*', Star);
+AVX2 __m256i digit_avx2(__m256i v) {
+    return inrange_avx2(v, '0', '9');
 }
 
-int match_percent(const char** p, struct Token* tok) {
-    return match_template(p, tok, '%', Percent);
+AVX2 __m256i alnum_avx2(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(inrange_avx2(lower, 'a', 'z'), digit_avx2(v));
 }
 
-int match_pow(const char** p, struct Token* tok) {
-    return match_template(p, tok, '^', Pow);
+AVX2 __m256i strchar_avx2(__m256i v) {
+    __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                                   _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+    return _mm256_andnot_si256(stop, _mm256_set1_epi8((char) 0xFF));
 }
 
-int match_dot(const char** p, struct Token* tok) {
-    return match_template(p, tok, '.', Dot);
+#define SCAN_AVX2(name, inset)                                              \
+AVX2 __attribute__((no_sanitize_address))                                   \
+const unsigned char* name(const unsigned char* p) {                         \
+    const unsigned char* block = (const unsigned char*) ((uintptr_t) p & ~(uintptr_t) 31); \
+    unsigned int stop;                                                      \
+    stop = ~(unsigned int) _mm256_movemask_epi8(inset(_mm256_load_si256((const __m256i*) block))) \
+           & (0xFFFFFFFFu << (p - block));                                  \
+    while (stop == 0) {                                                     \
+        block += 32;                                                        \
+        stop = ~(unsigned int) _mm256_movemask_epi8(inset(_mm256_load_si256((const __m256i*) block))); \
+    }                                                                       \
+    return block + __builtin_ctz(stop);                                     \
 }
 
-int match_equal(const char** p, struct Token* tok) {
-    if (**p != '=') {
-        printf("Bad call to = !\n");
-        return 1;
+SCAN_AVX2(scan_blank_avx2, blank_avx2)
+SCAN_AVX2(scan_alnum_avx2, alnum_avx2)
+SCAN_AVX2(scan_digit_avx2, digit_avx2)
+SCAN_AVX2(scan_strchar_avx2, strchar_avx2)
+
+#endif
+
+
+void select_scanners(int ws, int id, int integer, int body) {
+    // Attach to the loop states of the DFA the fastest scanners available
+    dfa_run[ws] = scan_blank_scalar;
+    dfa_run[id] = scan_alnum_scalar;
+    dfa_run[integer] = scan_digit_scalar;
+    dfa_run[body] = scan_strchar_scalar;
+#ifdef HAVE_SIMD_SCAN
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        dfa_run[ws] = scan_blank_avx2;
+        dfa_run[id] = scan_alnum_avx2;
+        dfa_run[integer] = scan_digit_avx2;
+        dfa_run[body] = scan_strchar_avx2;
     }
-    char* tmp;
-    // Now use lookahead for one more equal
-    consume(p);
-    if (**p == '=') {
-        consume(p);
-        tmp = realloc(tok->lexeme, 3 * sizeof(char));
-        if (tmp == NULL)
-            return alloc_failed(tok, tmp);
-        else
-            tok->lexeme = tmp;
-        memcpy(tok->lexeme, (char[3]) {'=', '=', '\0'}, 3 * sizeof(char));
-        tok->type = EqEq;
+    else if (__builtin_cpu_supports("sse2")) {
+        dfa_run[ws] = scan_blank_sse2;
+        dfa_run[id] = scan_alnum_sse2;
+        dfa_run[integer] = scan_digit_sse2;
+        dfa_run[body] = scan_strchar_sse2;
     }
-    else {
-        tmp = realloc(tok->lexeme, 2 * sizeof(char));
-        if (tmp == NULL)
-            return alloc_failed(tok, tmp);
-        else
-            tok->lexeme = tmp;
-        memcpy(tok->lexeme, (char[2]) {'=', '\0'}, 2 * sizeof(char));
-        tok->type = Equal;
+#endif
+}
+
+
+int new_state(enum TokenType accept) {
+    dfa_accept[dfa_states] = accept;
+    dfa_run[dfa_states] = NULL;
+    memset(dfa[dfa_states], DEAD, sizeof(dfa[0]));
+    return dfa_states++;
+}
+
+
+void add_edges(int from, int to, int (*pred)(int)) {
+    for (int c = 0; c < 256; c++)
+        if (pred(c))
+            dfa[from][char_class[c]] = to;
+}
+
+
+void build_DFA() {
+    int state, ws, id, zero, integer, reject, body, quoted;
+    const char* s;
+
+    build_classes();
+    new_state(UNK); // DEAD
+    new_state(UNK); // START
+
+    // Fixed lexemes: a trie, one state per prefix
+    for (int i = 0; fixed_tokens[i].lexeme != NULL; i++) {
+        state = START;
+        for (s = fixed_tokens[i].lexeme; *s != '\0'; s++) {
+            if (dfa[state][char_class[(unsigned char) *s]] == DEAD)
+                dfa[state][char_class[(unsigned char) *s]] = new_state(UNK);
+            state = dfa[state][char_class[(unsigned char) *s]];
+        }
+        dfa_accept[state] = fixed_tokens[i].type;
     }
-    return 0;
+
+    // blank+
+    ws = new_state(WS);
+    add_edges(START, ws, is_blank);
+    add_edges(ws, ws, is_blank);
+
+    // var : letter (digit | letter)* , keywords are told apart later
+    id = new_state(Var);
+    add_edges(START, id, is_letter);
+    add_edges(id, id, is_alnum);
+
+    // int : '0' | digit+ digit0* ; a 0 followed by digits is rejected
+    zero = new_state(Int);
+    integer = new_state(Int);
+    reject = new_state(UNK);
+    add_edges(START, zero, is_zero);
+    add_edges(zero, reject, is_digit);
+    add_edges(START, integer, is_nonzero);
+    add_edges(integer, integer, is_digit);
+
+    // quotedStr : '"' (char)* '"'
+    body = new_state(UNK);
+    quoted = new_state(QuotedStr);
+    add_edges(START, body, is_quote);
+    add_edges(body, body, is_strchar);
+    add_edges(body, quoted, is_quote);
+
+    select_scanners(ws, id, integer, body);
+}
+
+
+/*
+ * The interner: spellings are copied in blocks of INTERN_BLOCK chars that are never moved,
+ * so a lexeme can point to its spelling. Ids are found with a hash table of
+ * open addressing (0 is an empty slot), kept at most half full.
+*/
+
+#define INTERN_BLOCK (64 * 1024)
+
+struct InternBlock {
+    struct InternBlock* prev;
+    size_t used;
+    char chars[INTERN_BLOCK];
+};
+
+struct Interner {
+    const char** names; // names[id]
+    size_t* lens;
+    unsigned int* hashes;
+    size_t count; // ids in use, plus the unused 0
+    size_t cap;
+    int* slots;
+    size_t n_slots; // a power of 2
+    struct InternBlock* block;
+};
+
+struct Interner interner;
+
+const char* keyword_Ids[N_KEYWORD_IDS] = {
+    NULL, "if", "else", "while", "break", "continue", "writeOut",
+    "readInt", "readFloat", "readStr", "readBool", "True", "False", "NULL"
+};
+
+
+unsigned int hash_Lexeme(const char* s, size_t len) {
+    // FNV-1a
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char) s[i]) * 16777619u;
+    return h;
 }
 
-int match_lesser(const char** p, struct Token* tok) {
-    if (**p != '<') {
-        printf("Bad call to < !\n");
+
+int grow_Interner() {
+    // Double the ids and the slots, insert the ids again. Return 1 on memory error.
+    const char** names;
+    size_t* lens;
+    unsigned int* hashes;
+    int* slots;
+    size_t cap, n_slots, mask, i, j;
+
+    cap = interner.cap == 0 ? 1024 : 2 * interner.cap;
+    n_slots = 2 * cap;
+    names = realloc(interner.names, cap * sizeof(char*));
+    if (names == NULL)
         return 1;
+    interner.names = names;
+    lens = realloc(interner.lens, cap * sizeof(size_t));
+    if (lens == NULL)
+        return 1;
+    interner.lens = lens;
+    hashes = realloc(interner.hashes, cap * sizeof(unsigned int));
+    if (hashes == NULL)
+        return 1;
+    interner.hashes = hashes;
+
+    // The arrays keep working at the old cap until the slots are there too
+    slots = calloc(n_slots, sizeof(int));
+    if (slots == NULL)
+        return 1;
+    interner.cap = cap;
+    mask = n_slots - 1;
+    for (i = 1; i < interner.count; i++) {
+        j = interner.hashes[i] & mask;
+        while (slots[j] != 0)
+            j = (j + 1) & mask;
+        slots[j] = i;
     }
-    char* tmp;
-    consume(p);
-    if (**p == '=') {
-        consume(p);
-        tmp = realloc(tok->lexeme, 3 * sizeof(char));
-        if (tmp == NULL)
-            return alloc_failed(tok, tmp);
-        else
-            tok->lexeme = tmp;
-        memcpy(tok->lexeme, (char[3]) {'<', '=', '\0'}, 3 * sizeof(char));
-        tok->type = LesserEq;
-    }
-    else {
-        tmp = realloc(tok->lexeme, 2 * sizeof(char));
-        if (tmp == NULL)
-            return alloc_failed(tok, tmp);
-        else
-            tok->lexeme = tmp;
-        memcpy(tok->lexeme, (char[2]) {'<', '\0'}, 2 * sizeof(char));
-        tok->type = Lesser;
-    }
+    free(interner.slots);
+    interner.slots = slots;
+    interner.n_slots = n_slots;
     return 0;
 }
 
-int match_greater(const char** p, struct Token* tok) {
-    if (**p != '>') {
-        printf("Bad call to > !\n");
-        return 1;
-    }
-    char* tmp;
-    consume(p);
-    if (**p == '=') {
-        consume(p);
-        tmp = realloc(tok->lexeme, 3 * sizeof(char));
-        if (tmp == NULL)
-            return alloc_failed(tok, tmp);
-        else
-            tok->lexeme = tmp;
-        memcpy(tok->lexeme, (char[3]) {'>', '=', '\0'}, 3 * sizeof(char));
-        tok->type = GreaterEq;
-    }
-    else {
-        tmp = realloc(tok->lexeme, 2 * sizeof(char));
-        if (tmp == NULL)
-            return alloc_failed(tok, tmp);
-        else
-            tok->lexeme = tmp;
-        memcpy(tok->lexeme, (char[2]) {'>', '\0'}, 2 * sizeof(char));
-        tok->type = Greater;
+
+char* store_Lexeme(const char* s, size_t len) {
+    // Copy the spelling, NUL-terminated, in the current block (or in a new one)
+    struct InternBlock* block;
+    char* dst;
+
+    block = interner.block;
+    if (block == NULL || block->used + len + 1 > INTERN_BLOCK) {
+        // a spelling longer than a block gets a block of its own
+        block = malloc(sizeof(struct InternBlock) + (len + 1 > INTERN_BLOCK ? len + 1 : 0));
+        if (block == NULL)
+            return NULL;
+        block->used = 0;
+        block->prev = interner.block;
+        interner.block = block;
     }
-    return 0;
+    dst = block->chars + block->used;
+    memcpy(dst, s, len);
+    dst[len] = '\0';
+    block->used += len + 1;
+    return dst;
 }
 
-int match_div(const char** p, struct Token* tok) {
-    if (**p != '/') {
-        printf("Bad call to / !\n");
-        return 1;
+
+int add_Lexeme(const char* s, size_t len, unsigned int hash, size_t slot) {
+    char* name;
+    int id;
+
+    name = store_Lexeme(s, len);
+    if (name == NULL)
+        return 0;
+    id = interner.count++;
+    interner.names[id] = name;
+    interner.lens[id] = len;
+    interner.hashes[id] = hash;
+    interner.slots[slot] = id;
+    return id;
+}
+
+
+size_t find_Lexeme(const char* s, size_t len, unsigned int hash) {
+    // The slot of the spelling, or the empty slot where it would go
+    size_t mask, i;
+    int id;
+
+    mask = interner.n_slots - 1;
+    i = hash & mask;
+    while ((id = interner.slots[i]) != 0) {
+        if (interner.hashes[id] == hash && interner.lens[id] == len && memcmp(interner.names[id], s, len) == 0)
+            break;
+        i = (i + 1) & mask;
     }
-    char* tmp;
-    consume(p);
-    if (**p == '.') {
-        consume(p);
-        tmp = realloc(tok->lexeme, 3 * sizeof(char));
-        if (tmp == NULL)
-            return alloc_failed(tok, tmp);
-        else
-            tok->lexeme = tmp;
-        memcpy(tok->lexeme, (char[3]) {'/', '.', '\0'}, 3 * sizeof(char));
-        tok->type = FloatDiv;
+    return i;
+}
+
+
+int intern_Lexeme(const char* s, size_t len) {
+    unsigned int hash;
+    size_t slot;
+    int id;
+
+    if (interner.count == 0) {
+        // The keywords first, so that they get their fixed ids
+        interner.count = 1;
+        if (grow_Interner())
+            return 0;
+        for (id = 1; id < N_KEYWORD_IDS; id++) {
+            hash = hash_Lexeme(keyword_Ids[id], strlen(keyword_Ids[id]));
+            slot = find_Lexeme(keyword_Ids[id], strlen(keyword_Ids[id]), hash);
+            if (add_Lexeme(keyword_Ids[id], strlen(keyword_Ids[id]), hash, slot) == 0)
+                return 0;
+        }
     }
-    else {
-        tmp = realloc(tok->lexeme, 2 * sizeof(char));
-        if (tmp == NULL)
-            return alloc_failed(tok, tmp);
-        else
-            tok->lexeme = tmp;
-        memcpy(tok->lexeme, (char[2]) {'/', '\0'}, 2 * sizeof(char));
-        tok->type = Div;
+    hash = hash_Lexeme(s, len);
+    slot = find_Lexeme(s, len, hash);
+    if (interner.slots[slot] != 0)
+        return interner.slots[slot];
+    if (interner.count == interner.cap) {
+        if (grow_Interner())
+            return 0;
+        slot = find_Lexeme(s, len, hash);
     }
-    return 0;
+    return add_Lexeme(s, len, hash, slot);
 }
 
-int match_two_template(const char** p, struct Token* tok, char c1, char c2, enum TokenType type) {
-    // Builds a Token with the two given char (c1, c2) as lexeme. Advances the stream pointer.
-    if (**p != c1) {
-        printf("Bad call to |%c| !\n", c1);
-        return 1;
-    }
-    char* tmp;
-    consume(p);
-    if (**p != c2) {
-        printf("Unrecognized Token. |%c| must be followed by |%c|\n", c1, c2);
-        return 1;
+
+int intern_Token(struct Token* tok) {
+    switch (tok->type) {
+        case Var: case If: case Else: case While: case Break: case Continue:
+        case WriteOut: case ReadIn: case Bool: case Null:
+            tok->id = intern_Lexeme(tok->lexeme, tok->len);
+            return tok->id == 0;
+        default:
+            tok->id = 0;
+            return 0;
     }
-    consume(p);
-    tmp = realloc(tok->lexeme, 3 * sizeof(char));
-    if (tmp == NULL)
-        return alloc_failed(tok, tmp);
-    else
-        tok->lexeme = tmp;
-    memcpy(tok->lexeme, (char[3]) {c1, c2, '\0'}, 3 * sizeof(char));
-    tok->type = type;
-    return 0;
 }
 
-int match_noteq(const char** p, struct Token* tok) {
-    return match_two_template(p, tok, '!', '=', NotEq);
+
+const char* lexeme_Of(int id) {
+    if (id <= 0 || (size_t) id >= interner.count)
+        return NULL;
+    return interner.names[id];
 }
 
-int match_or(const char** p, struct Token* tok) {
-    return match_two_template(p, tok, '|', '|', Or);
+
+size_t count_Interned() {
+    return interner.count == 0 ? 0 : interner.count - 1;
 }
 
-int match_and(const char** p, struct Token* tok) {
-    return match_two_template(p, tok, '&', '&', And);
+
+void free_Interned() {
+    struct InternBlock* block;
+
+    while ((block = interner.block) != NULL) {
+        interner.block = block->prev;
+        free(block);
+    }
+    free(interner.names);
+    free(interner.lens);
+    free(interner.hashes);
+    free(interner.slots);
+    memset(&interner, 0, sizeof(interner));
 }
 
-int match_endline(const char** p, struct Token* tok) {
-    return match_two_template(p, tok, ';', '\n', Endline);
+
+int lexeme_is(const char* s, size_t len, const char* keyword) {
+    // Compare a (not NUL-terminated) slice of the source with a keyword.
+    return strlen(keyword) == len && memcmp(s, keyword, len) == 0;
 }
 
-int match_quote(const char** p, struct Token* tok) {
-    // Build a Token with the QuotedStr object found in the stream from
-    // the current pointer location.
-    if (**p != '"') {
-        printf("Bad call to \" !!\n");
-        return 1;
-    }
 
-    size_t curr_size = 32;
-    // Important to call calloc, NOT malloc !!
-    char* astring = calloc(curr_size, sizeof(char));
-    if (astring == NULL)
-        return alloc_failed(tok, astring);
+long long lexeme_Int(const char* s, size_t len) {
+    // Only the len digits of the view are read: strtoll would go past its end.
+    long long n;
+    size_t i;
 
-    char c = consume(p); // "
-    char* tmp;
-    int totchar = 0;
-    astring[totchar++] = c;
-    do {
-        c = consume(p);
-        if (c == '\0') {
-            printf("Quoted strings must be terminated with \" !!\n");
-            free(astring);
-            return 1;
-        }
-        if (totchar * sizeof(char) >= curr_size) {
-            tmp = realloc(astring, 2*curr_size);
-            if (tmp == NULL)
-                return alloc_failed(tok, astring);
-            else
-                astring = tmp;
-            curr_size *= 2;
-        }
-        astring[totchar++] = c;
+    n = 0;
+    for (i = 0; i < len && s[i] >= '0' && s[i] <= '9'; i++) {
+        if (n > (LLONG_MAX - (s[i] - '0')) / 10)
+            return LLONG_MAX;
+        n = n * 10 + (s[i] - '0');
     }
-    while (c != '"');
-    tmp = realloc(tok->lexeme, sizeof(char) * totchar + 1);
-    if (tmp == NULL)
-        return alloc_failed(tok, astring);
-    else
-        tok->lexeme = tmp;
-    memcpy(tok->lexeme, astring, totchar);
-    tok->lexeme[totchar] = '\0';
-    tok->type = QuotedStr;
-    free(astring);
-    return 0;
+    return n;
 }
 
-int match_int(const char** p, struct Token* tok) {
-    // Build Token matching integer number (sequence of digits)
-    if (**p < 48 || **p > 57) {
-        printf("Bad call to int !!\n");
-        return 1;
-    }
-    char* tmp;
-    size_t curr_size = 8;
-    char c;
-    int totchar = 0;
-    // Handle unique case when the INT is 0
-    if (**p == '0') {
-        c = consume(p);
-        if (**p >= 48 && **p <= 57) {
-            printf("Cannot have INT starting with 0\n");
-            return 1;
-        }
-        memcpy(tok->lexeme, (char[2]) {'0', '\0'}, 2);
-        tok->type = Int;
-        return 0;
-    }
-    tmp = realloc(tok->lexeme, curr_size);
-    if (tmp == NULL)
-        return alloc_failed(tok, tmp);
-    else
-        tok->lexeme = tmp;
-    while (**p >= 48 && **p <= 57) {
-        c = consume(p);
-        tok->lexeme[totchar++] = c;
-        if (totchar * sizeof(char) >= curr_size) {
-            tmp = realloc(tok->lexeme, 2*curr_size);
-            if (tmp == NULL)
-                return alloc_failed(tok, tmp);
-            else
-                tok->lexeme = tmp;
-            curr_size *= 2;
-        }
-    }
-    tmp = realloc(tok->lexeme, sizeof(char) * totchar + 1);
-    if (tmp == NULL)
-        return alloc_failed(tok, tmp);
-    else
-        tok->lexeme = tmp;
-    tok->lexeme[totchar] = '\0';
-    tok->type = Int;
-    return 0;
+
+/*
+ * Keywords are found with a perfect hash on (length, first char, last char).
+ * KEYWORD_HASH was chosen (by trying small shifts) so that the 13 keywords
+ * fall in 13 different slots of a 32 entries table, hence the indexes below.
+ * An identifier is a keyword only if it equals the one in its slot.
+*/
+
+#define KEYWORD_HASH(s, len) ((((len) << 2) + ((s)[0] << 1) + (s)[(len) - 1]) & 31)
+
+struct Keyword {
+    const char* lexeme;
+    size_t len;
+    enum TokenType type;
+};
+
+const struct Keyword keywords[32] = {
+    [0] = {"if", 2, If},
+    [2] = {"writeOut", 8, WriteOut},
+    [3] = {"break", 5, Break},
+    [5] = {"False", 5, Bool},
+    [7] = {"while", 5, While},
+    [11] = {"continue", 8, Continue},
+    [16] = {"readBool", 8, ReadIn},
+    [18] = {"readStr", 7, ReadIn},
+    [20] = {"readInt", 7, ReadIn},
+    [24] = {"NULL", 4, Null},
+    [28] = {"readFloat", 9, ReadIn},
+    [29] = {"True", 4, Bool},
+    [31] = {"else", 4, Else}
+};
+
+
+enum TokenType keyword_type(const char* s, size_t len) {
+    // Tell keywords apart from variable identifiers.
+    const struct Keyword* k = &keywords[KEYWORD_HASH((const unsigned char*) s, len)];
+    if (k->len == len && memcmp(k->lexeme, s, len) == 0)
+        return k->type;
+    return Var;
 }
 
-int match_id(const char** p, struct Token* tok) {
-    // Build Token matching all possible variable identifiers, or keyword.
-    if (**p < 65 || **p > 122 || (**p > 90 && **p < 97)) {
-        printf("Bad call to ID !!\n");
-        return 1;
+
+const unsigned char* scan_Token(const unsigned char* c, enum TokenType* type) {
+    /*
+     * Run the DFA from c, until no transition is possible.
+     * Return the char where it stopped and store in *type the Token
+     * recognized up to there (UNK if none).
+    */
+    const unsigned char* start = c;
+    int state, next;
+
+    if (dfa_states == 0)
+        build_DFA();
+
+    state = START;
+    while ((next = dfa[state][char_class[*c]]) != DEAD) {
+        state = next;
+        c++;
+        // scanners pay off only if the run goes on after this char
+        if (dfa_run[state] != NULL && dfa[state][char_class[*c]] == state)
+            c = dfa_run[state](c + 1);
     }
-    char* tmp;
-    size_t curr_size = 16;
-    int totchar = 0;
-    tmp = realloc(tok->lexeme, curr_size);
-    if (tmp == NULL)
-        return alloc_failed(tok, tmp); 
+    if (dfa_accept[state] == Var)
+        *type = keyword_type((const char*) start, c - start);
     else
-        tok->lexeme = tmp;
-    while ((**p >= 48 && **p <= 57) ||
-           (**p >= 65 && **p <= 90) ||
-           (**p >= 97 && **p <= 122)) {
-        tok->lexeme[totchar++] = **p;
-        consume(p);
-        if (totchar * sizeof(char) >= curr_size) {
-            tmp = realloc(tok->lexeme, 2*curr_size);
-            if (tmp == NULL)
-                return alloc_failed(tok, tmp); 
-            else
-                tok->lexeme = tmp;
-            curr_size *= 2;
-        } 
-    }
-    tmp = realloc(tok->lexeme, sizeof(char) * totchar + 1);
-    if (tmp == NULL)
-        return alloc_failed(tok, tmp); 
-    else
-        tok->lexeme = tmp;
-    tok->lexeme[totchar] = '\0';
-    if (strcmp(tok->lexeme, "NULL") == 0)
-        tok->type = Null;
-    else if (strcmp(tok->lexeme, "True") == 0 ||
-             strcmp(tok->lexeme, "False") == 0)
-        tok->type = Bool;
-    else if (strcmp(tok->lexeme, "break") == 0)
-        tok->type = Break;
-    else if (strcmp(tok->lexeme, "if") == 0)
-        tok->type = If;
-    else if (strcmp(tok->lexeme, "else") == 0)
-        tok->type = Else;
-    else if (strcmp(tok->lexeme, "while") == 0)
-        tok->type = While;
-    else if (strcmp(tok->lexeme, "readInt") == 0)
-        tok->type = ReadIn;
-    else if (strcmp(tok->lexeme, "readFloat") == 0)
-        tok->type = ReadIn;
-    else if (strcmp(tok->lexeme, "readStr") == 0)
-        tok->type = ReadIn;
-    else if (strcmp(tok->lexeme, "readBool") == 0)
-        tok->type = ReadIn;
-    else if (strcmp(tok->lexeme, "writeOut") == 0)
-        tok->type = WriteOut;
-    else if (strcmp(tok->lexeme, "continue") == 0)
-        tok->type = Continue;
-    else
-        tok->type = Var;
-    return 0;
+        *type = dfa_accept[state];
+    return c;
 }
 
+
 int next_Token(const char** p, struct Token* tok) {
     /*
-     * Process the next character(s) and store the Token.
+     * Process the next character(s), store the Token type and advance *p after the lexeme.
      * Return values:
      * 0      - STATUS OK
-     * -1    - MEMORY ISSUE
      * 1    - INVALID CHARACTER SEQUENCE FOUND
     */
-    char c = **p;
-    if (c == '\0') {
-        printf("Reached end of input\n");
+    const unsigned char* start = (const unsigned char*) *p;
+    const unsigned char* c;
+    enum TokenType type;
+
+    if (*start == '\0') {
+        log_Debug("reached end of input");
         return 0;
     }
-    //printf("NEXT-TOKEN : Current char is |%c|\n", c);fflush(stdout);
-    if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
-        return match_ws(p, tok);
-    else if ((c >= 65 && c <= 90) || (c >= 97 && c <= 122))
-        return match_id(p, tok);
-    else
-        switch (c) {
-            case '[': return match_lbrack(p, tok);
-            case ']': return match_rbrack(p, tok);
-            case '+': return match_plus(p, tok);
-            case '-': return match_minus(p, tok);
-            case ',': return match_comma(p, tok);
-            case '(': return match_lpar(p, tok);
-            case ')': return match_rpar(p, tok);
-            case '{': return match_lcurly(p, tok);
-            case '}': return match_rcurly(p, tok);
-            case '=': return match_equal(p, tok);
-            case '"': return match_quote(p, tok);
-            case '>': return match_greater(p, tok);
-            case '<': return match_lesser(p, tok);
-            case '/': return match_div(p, tok);
-            case '!': return match_noteq(p, tok);
-            case '*': return match_star(p, tok);
-            case '%': return match_percent(p, tok);
-            case '|': return match_or(p, tok);
-            case '&': return match_and(p, tok);
-            case '0': return match_int(p, tok);
-            case '1': return match_int(p, tok);
-            case '2': return match_int(p, tok);
-            case '3': return match_int(p, tok);
-            case '4': return match_int(p, tok);
-            case '5': return match_int(p, tok);
-            case '6': return match_int(p, tok);
-            case '7': return match_int(p, tok);
-            case '8': return match_int(p, tok);
-            case '9': return match_int(p, tok);
-            case '^': return match_pow(p, tok);
-            case ';': return match_endline(p, tok);
-            case '.': return match_dot(p, tok);
-            default: return 1;
-        }
+    c = scan_Token(start, &type);
+    if (type == UNK)
+        return 1; // the caller knows the position, and reports it
+    tok->type = type;
+    *p = (const char*) c;
+    return 0;
 }
 
+
 struct Token* new_Token(char* lexeme, enum TokenType type) {
     struct Token* new;
+    size_t len;
+    len = strlen(lexeme);
     new = malloc(sizeof(struct Token));
     if (new == NULL)
         return NULL;
-    new->lexeme = malloc(sizeof(char) * (strlen(lexeme) + 1));
+    new->lexeme = malloc(sizeof(char) * (len + 1));
     if (new->lexeme == NULL) {
         free(new);
         return NULL;
     }
-    memcpy(new->lexeme, lexeme, strlen(lexeme) + 1);
+    memcpy(new->lexeme, lexeme, len + 1);
     new->type = type;
+    new->offset = 0;
+    new->len = len;
+    new->trivia = 0;
+    if (intern_Token(new)) {
+        free_Token(new);
+        return NULL;
+    }
     return new;
 }
 
 
-struct TokenList* alloc_TokenList() {
-    struct TokenList* new;
-    new = malloc(sizeof(struct TokenList));
+struct Token* copy_Token(struct Token* tok) {
+    // Clone a Token, giving the clone its own copy of the lexeme.
+    struct Token* new;
+    new = malloc(sizeof(struct Token));
     if (new == NULL)
         return NULL;
-    new->token = NULL;
-    new->next = NULL;
+    new->lexeme = malloc(sizeof(char) * (tok->len + 1));
+    if (new->lexeme == NULL) {
+        free(new);
+        return NULL;
+    }
+    memcpy(new->lexeme, tok->lexeme, tok->len);
+    new->lexeme[tok->len] = '\0';
+    new->type = tok->type;
+    new->id = tok->id;
+    new->offset = tok->offset;
+    new->len = tok->len;
+    new->trivia = tok->trivia;
     return new;
 }
 
-struct TokenList* new_TokenList(struct Token* tok) {
-    struct TokenList* new;
-    struct Token* newTok;
-    new = alloc_TokenList();
-    if (new == NULL)
+
+struct TokenList* alloc_TokenBlock(struct Token* toks, size_t count, size_t chars) {
+    /*
+     * Allocate with a single malloc `count` list nodes followed by `count` Tokens,
+     * copied from toks, and by `chars` bytes for the lexemes (see read_TokenList).
+     * Nodes are linked in order and each one points to its Token.
+    */
+    struct TokenList* nodes;
+    struct Token* block;
+    size_t i;
+
+    if (count == 0)
         return NULL;
-    newTok = new_Token(tok->lexeme, tok->type);
-    if (newTok == NULL) {
-        free_TokenList(new);
+    nodes = malloc(count * (sizeof(struct TokenList) + sizeof(struct Token)) + chars);
+    if (nodes == NULL)
         return NULL;
+    block = (struct Token*) (nodes + count);
+    if (toks != NULL)
+        memcpy(block, toks, count * sizeof(struct Token));
+    for (i = 0; i < count; i++) {
+        nodes[i].token = &block[i];
+        nodes[i].next = &nodes[i + 1];
     }
-    new->token = newTok;
-    new->next = NULL;
-    return new;
+    nodes[count - 1].next = NULL;
+    return nodes;
 }
 
+
 struct TokenList* build_TokenList(const char* fp) {
-    // Prepare memory
-    char init[16] = {0};
-    struct Token* tok = new_Token(init, UNK);
-    struct TokenList* head = NULL;
-    struct TokenList* current = head;
-    struct TokenList* tail;
-    // Iterate
-    int i = 0;
+    /*
+     * Tokens are first collected into a growable array, then moved to a single block
+     * (see alloc_TokenBlock). Lexemes are not copied: they are views into fp.
+    */
+    const char* src = fp;
+    const char* start;
+    struct Token tok;
+    struct Token *toks, *tmp;
+    struct TokenList* head;
+    size_t count, cap;
     int exit;
-    while (*fp != '\0' && (exit = next_Token(&fp, tok)) == 0) {
-        i++;
-        if (head == NULL) {
-            head = new_TokenList(tok);
-            if (head == NULL) {
-                free_Token(tok);
-                return NULL;
-            }
-            current = head;
+
+    cap = 1024;
+    count = 0;
+    exit = 0;
+    toks = malloc(cap * sizeof(struct Token));
+    if (toks == NULL)
+        return NULL;
+    // Iterate
+    while (*fp != '\0') {
+        start = fp;
+        if ((exit = next_Token(&fp, &tok)) != 0) {
+            log_Offset(LOG_ERROR, start - src, "unrecognized token starting with '%c'", *start);
+            break;
         }
-        else {
-            tail = new_TokenList(tok);
-            if (tail == NULL) {
-                free_TokenList(head);
-                free_Token(tok);
+        if (count == cap) {
+            tmp = realloc(toks, 2 * cap * sizeof(struct Token));
+            if (tmp == NULL) {
+                free(toks);
                 return NULL;
             }
-            current->next = tail;
-            current = tail;
+            toks = tmp;
+            cap *= 2;
+        }
+        tok.lexeme = (char*) start;
+        tok.offset = start - src;
+        tok.len = fp - start;
+        tok.trivia = 0;
+        if (intern_Token(&tok)) {
+            free(toks);
+            return NULL;
         }
+        toks[count++] = tok;
     }
-    free_Token(tok);
+    head = NULL;
     if (exit == 0) {
         // Was able to read the entire file
-        printf("Tot Tokens = %d\n", i);
-        printf("===================================\n");
+        log_Info("%zu tokens", count);
+        head = alloc_TokenBlock(toks, count, 0);
+    }
+    // else encountered some error
+    free(toks);
+    return head;
+}
+
+
+/*
+ * Parallel lexing.
+ *
+ * Outside of strings, ";\n" is always a whole Endline Token, so the source
+ * can be cut right after any ";\n" that is not inside quotes and the pieces
+ * lexed independently. A '"' is either the start or the end of a string,
+ * so the parity of the quotes seen so far tells if a char is inside one.
+ * Chunks are taken from a shared counter by the threads, each one fills
+ * its own Token array, and the arrays are then joined in order.
+*/
+struct Chunk {
+    const char* src;
+    const char* begin;
+    const char* end;
+    int skip_ws;
+    struct Token* toks;
+    size_t count;
+    int exit;
+};
+
+struct ChunkQueue {
+    struct Chunk* chunks;
+    size_t n;
+    size_t next; // first chunk not taken yet
+};
+
+
+size_t split_Source(const char* fp, size_t size, size_t* splits, size_t n) {
+    /*
+     * Fill splits[0..n] with n chunks of about size / n chars each,
+     * every one ending with a ";\n" outside strings (but the last).
+     * Return the number of chunks, that can be less than n.
+    */
+    const char* q;
+    size_t p, target, k, m;
+    int inside;
+
+    p = 0;
+    m = 0;
+    inside = 0;
+    splits[0] = 0;
+    for (k = 1; k < n && p < size; k++) {
+        target = size / n * k;
+        if (target < p)
+            target = p;
+        while ((q = memchr(fp + p, '"', target - p)) != NULL) {
+            inside = ! inside;
+            p = q - fp + 1;
+        }
+        p = target;
+        while (p < size && (inside || fp[p] != ';' || fp[p + 1] != '\n')) {
+            if (fp[p] == '"')
+                inside = ! inside;
+            p++;
+        }
+        if (p < size)
+            splits[++m] = p + 2;
+        p += 2;
+    }
+    if (splits[m] < size)
+        splits[++m] = size;
+    return m;
+}
+
+
+void lex_Chunk(struct Chunk* chunk) {
+    const char *fp, *start;
+    struct Token tok;
+    struct Token* tmp;
+    size_t cap, trivia;
+
+    cap = 1024;
+    chunk->count = 0;
+    chunk->toks = malloc(cap * sizeof(struct Token));
+    if (chunk->toks == NULL) {
+        chunk->exit = 1;
+        return;
+    }
+    chunk->exit = 0;
+    trivia = 0;
+    fp = chunk->begin;
+    while (fp < chunk->end) {
+        start = fp;
+        // a '\0' before the end of the source is not valid in any Token
+        if (*fp == '\0' || (chunk->exit = next_Token(&fp, &tok)) != 0) {
+            log_Offset(LOG_ERROR, start - chunk->src, "unrecognized token starting with '%c'", *start);
+            chunk->exit = 1;
+            return;
+        }
+        if (tok.type == WS && chunk->skip_ws) {
+            trivia += fp - start;
+            continue;
+        }
+        if (chunk->count == cap) {
+            tmp = realloc(chunk->toks, 2 * cap * sizeof(struct Token));
+            if (tmp == NULL) {
+                chunk->exit = 1;
+                return;
+            }
+            chunk->toks = tmp;
+            cap *= 2;
+        }
+        tok.lexeme = (char*) start;
+        tok.id = 0; // interned once the chunks are joined
+        tok.offset = start - chunk->src;
+        tok.len = fp - start;
+        tok.trivia = trivia;
+        trivia = 0;
+        chunk->toks[chunk->count++] = tok;
+    }
+}
+
+
+void* lex_Chunks(void* arg) {
+    // Thread body: lex chunks until there are none left
+    struct ChunkQueue* queue = arg;
+    size_t i;
+
+    while ((i = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED)) < queue->n)
+        lex_Chunk(&queue->chunks[i]);
+    return NULL;
+}
+
+
+struct TokenList* build_TokenList_Parallel(const char* fp, size_t size, int threads, int skip_ws) {
+    struct ChunkQueue queue;
+    struct Chunk* chunks;
+    struct TokenList* head;
+    pthread_t* workers;
+    size_t *splits, n, i, count;
+    int started, exit;
+
+    if (threads <= 0)
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0)
+        threads = 1;
+    // The DFA tables are built lazily: do it before they are shared
+    if (dfa_states == 0)
+        build_DFA();
+
+    // More chunks than threads, so that a slow chunk does not stall the others
+    n = 4 * (size_t) threads;
+    splits = malloc((n + 1) * sizeof(size_t));
+    chunks = malloc(n * sizeof(struct Chunk));
+    workers = malloc(threads * sizeof(pthread_t));
+    if (splits == NULL || chunks == NULL || workers == NULL) {
+        free(splits);
+        free(chunks);
+        free(workers);
+        return NULL;
     }
-    else{
-        // Encountered some error
-        free_TokenList(head);
-        head = NULL;
+    n = split_Source(fp, size, splits, n);
+    for (i = 0; i < n; i++) {
+        chunks[i].src = fp;
+        chunks[i].begin = fp + splits[i];
+        chunks[i].end = fp + splits[i + 1];
+        chunks[i].skip_ws = skip_ws;
+        chunks[i].toks = NULL;
+    }
+    queue.chunks = chunks;
+    queue.n = n;
+    queue.next = 0;
+
+    // The calling thread is one of the workers
+    for (started = 0; started < threads - 1; started++)
+        if (pthread_create(&workers[started], NULL, lex_Chunks, &queue) != 0)
+            break;
+    lex_Chunks(&queue);
+    for (int t = 0; t < started; t++)
+        pthread_join(workers[t], NULL);
+
+    count = 0;
+    exit = 0;
+    for (i = 0; i < n; i++) {
+        count += chunks[i].count;
+        exit |= chunks[i].exit;
+    }
+    head = NULL;
+    if (exit == 0) {
+        log_Info("%zu tokens", count);
+        head = alloc_TokenBlock(NULL, count, 0);
+        count = 0;
+        for (i = 0; head != NULL && i < n; i++) {
+            memcpy(head[count].token, chunks[i].toks, chunks[i].count * sizeof(struct Token));
+            count += chunks[i].count;
+        }
+        // The interner is not shared by the threads
+        for (i = 0; head != NULL && i < count; i++)
+            if (intern_Token(head[i].token)) {
+                free(head);
+                head = NULL;
+            }
     }
+    for (i = 0; i < n; i++)
+        free(chunks[i].toks);
+    free(splits);
+    free(chunks);
+    free(workers);
     return head;
 }
 
@@ -706,29 +1135,251 @@ struct TokenList* build_TokenList(const char* fp) {
 struct TokenList* strip_WS(struct TokenList* list) {
     if (list == NULL)
         return NULL;
-    struct TokenList *head, *curr, *prev, *new;
+    struct TokenList *curr, *head;
+    size_t count, i;
 
-    curr = list;
-    head = NULL;
-    new = NULL;
-    while (curr != NULL) {
-        if (curr->token->type != WS) {
-            new = new_TokenList(curr->token);
-            if (new == NULL) {
-                free_TokenList(head);
-                return NULL;
-            }
-            if (head == NULL) {
-                head = new;
-                prev = head;
-            }
-            else {
-                prev->next = new;
-                prev = prev->next;
+    count = 0;
+    for (curr = list; curr != NULL; curr = curr->next)
+        if (curr->token->type != WS)
+            count++;
+
+    head = alloc_TokenBlock(NULL, count, 0);
+    if (head == NULL)
+        return NULL;
+    i = 0;
+    for (curr = list; curr != NULL; curr = curr->next)
+        if (curr->token->type != WS)
+            *head[i++].token = *curr->token;
+    return head;
+}
+
+
+const char* map_Source(const char* fileName, size_t* size) {
+    struct stat buffer;
+    char* area;
+    int fd;
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &buffer) != 0 || ! S_ISREG(buffer.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+    *size = buffer.st_size;
+    // Reserve one byte more than the file, the file is then mapped over it.
+    // The extra byte (and the rest of the last page) reads as '\0'.
+    area = mmap(NULL, *size + 1, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (*size > 0 &&
+        mmap(area, *size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(area, *size + 1);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    return area;
+}
+
+
+void unmap_Source(const char* src, size_t size) {
+    if (src != NULL)
+        munmap((void*) src, size + 1);
+}
+
+
+struct Reader* open_Reader(const char* fileName, int skip_ws) {
+    struct Reader* r;
+
+    r = malloc(sizeof(struct Reader));
+    if (r == NULL)
+        return NULL;
+    if (strcmp(fileName, "-") == 0)
+        r->fd = STDIN_FILENO;
+    else
+        r->fd = open(fileName, O_RDONLY);
+    if (r->fd < 0) {
+        free(r);
+        return NULL;
+    }
+    r->cap = READER_SIZE;
+    r->buf = malloc(r->cap + 1);
+    if (r->buf == NULL) {
+        close_Reader(r);
+        return NULL;
+    }
+    r->buf[0] = '\0';
+    r->pos = 0;
+    r->len = 0;
+    r->offset = 0;
+    r->eof = 0;
+    r->skip_ws = skip_ws;
+    return r;
+}
+
+
+void close_Reader(struct Reader* r) {
+    if (r == NULL)
+        return;
+    if (r->fd != STDIN_FILENO)
+        close(r->fd);
+    free(r->buf);
+    free(r);
+}
+
+
+int refill_Reader(struct Reader* r) {
+    /*
+     * Move the chars not lexed yet to the front of the buffer
+     * (doubling it if they fill it all), then read more after them.
+     * Return 0 if ok, 1 on read or memory error.
+    */
+    char* tmp;
+    ssize_t n;
+
+    if (r->pos > 0) {
+        memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+        r->offset += r->pos;
+        r->len -= r->pos;
+        r->pos = 0;
+    }
+    if (r->len == r->cap) {
+        tmp = realloc(r->buf, 2 * r->cap + 1);
+        if (tmp == NULL)
+            return 1;
+        r->buf = tmp;
+        r->cap *= 2;
+    }
+    do {
+        n = read(r->fd, r->buf + r->len, r->cap - r->len);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0)
+        return 1;
+    if (n == 0)
+        r->eof = 1;
+    r->len += n;
+    r->buf[r->len] = '\0';
+    return 0;
+}
+
+
+int read_Token(struct Reader* r, struct Token* tok) {
+    /*
+     * The DFA stops at the '\0' after the buffer as if the source ended there.
+     * When that happens the Token may go on in the next chars: refill and lex it again.
+    */
+    const unsigned char *start, *c;
+    enum TokenType type;
+    size_t trivia;
+
+    trivia = 0;
+    for (;;) {
+        start = (const unsigned char*) r->buf + r->pos;
+        c = scan_Token(start, &type);
+        if (c == (const unsigned char*) r->buf + r->len && ! r->eof) {
+            if (refill_Reader(r) != 0)
+                return READ_ERROR;
+            continue;
+        }
+        if (type != WS || ! r->skip_ws)
+            break;
+        trivia += c - start;
+        r->pos += c - start;
+    }
+    if (r->pos == r->len)
+        return READ_END;
+    if (type == UNK) {
+        log_Offset(LOG_ERROR, r->offset + r->pos, "unrecognized token starting with '%c'", *start);
+        return READ_INVALID;
+    }
+    tok->lexeme = r->buf + r->pos;
+    tok->type = type;
+    tok->offset = r->offset + r->pos;
+    tok->len = c - start;
+    tok->trivia = trivia;
+    r->pos += tok->len;
+    if (intern_Token(tok))
+        return READ_ERROR;
+    return READ_OK;
+}
+
+
+struct TokenList* read_TokenList(struct Reader* r) {
+    /*
+     * Same as build_TokenList, but lexemes are copied (NUL-terminated)
+     * in a growable array, because the Reader buffer is reused.
+     * Identifiers and keywords are not: they point to their interned spelling.
+     * They go in the same block of the Tokens at the end, and tok.lexeme
+     * holds the position in the array until then.
+    */
+    struct Token tok;
+    struct Token *toks, *tmpt;
+    struct TokenList* head;
+    char *chars, *tmpc;
+    size_t count, cap, used, size, i;
+    int exit;
+
+    cap = 1024;
+    size = 16 * 1024;
+    count = 0;
+    used = 0;
+    toks = malloc(cap * sizeof(struct Token));
+    chars = malloc(size);
+    if (toks == NULL || chars == NULL) {
+        free(toks);
+        free(chars);
+        return NULL;
+    }
+    while ((exit = read_Token(r, &tok)) == READ_OK) {
+        if (count == cap) {
+            tmpt = realloc(toks, 2 * cap * sizeof(struct Token));
+            if (tmpt == NULL) {
+                exit = READ_ERROR;
+                break;
             }
+            toks = tmpt;
+            cap *= 2;
+        }
+        if (tok.id != 0) {
+            // No copy: the lexeme is the interned spelling
+            tok.lexeme = (char*) lexeme_Of(tok.id);
+            toks[count++] = tok;
+            continue;
         }
-        curr = curr->next;
+        while (used + tok.len + 1 > size) {
+            tmpc = realloc(chars, 2 * size);
+            if (tmpc == NULL)
+                break;
+            chars = tmpc;
+            size *= 2;
+        }
+        if (used + tok.len + 1 > size) {
+            exit = READ_ERROR;
+            break;
+        }
+        memcpy(chars + used, tok.lexeme, tok.len);
+        chars[used + tok.len] = '\0';
+        tok.lexeme = (char*) (uintptr_t) used;
+        used += tok.len + 1;
+        toks[count++] = tok;
+    }
+    head = NULL;
+    if (exit == READ_END) {
+        log_Info("%zu tokens", count);
+        head = alloc_TokenBlock(toks, count, used);
+    }
+    if (head != NULL) {
+        tmpc = (char*) (head[0].token + count);
+        memcpy(tmpc, chars, used);
+        for (i = 0; i < count; i++)
+            if (head[i].token->id == 0)
+                head[i].token->lexeme = tmpc + (uintptr_t) head[i].token->lexeme;
     }
+    free(toks);
+    free(chars);
     return head;
 }
 
@@ -1,3 +1,8 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h>
+
 enum TokenType {
     // Basic Token Types in the Grammar
     Comma,
@@ -73,9 +78,18 @@ enum TokenType {
 // Generate readable string instead of int
 const char* type2char (enum TokenType t);
 
+/*
+ * The lexeme is a view of `len` chars: it is NOT NUL-terminated
+ * when the Token comes from build_TokenList (it points into the source)
+ * or from read_Token (it points into the Reader buffer).
+*/
 struct Token{
     char* lexeme;
     enum TokenType type;
+    int id; // interned spelling of identifiers and keywords, 0 for the other Tokens
+    size_t offset; // position of the lexeme in the source
+    size_t len; // length of the lexeme
+    size_t trivia; // blanks skipped right before the lexeme (see open_Reader)
 };
 
 struct TokenList {
@@ -89,17 +103,167 @@ void print_TokenList(struct TokenList* p);
 
 void free_Token(struct Token* tok);
 
+/*
+ * Free a TokenList returned by build_TokenList, read_TokenList or strip_WS.
+ * Nodes and Tokens of a list live in one block, so this is a single free.
+*/
 void free_TokenList(struct TokenList* tok);
 
 struct Token* new_Token(char* lexeme, enum TokenType tok);
 
-struct TokenList* new_TokenList(struct Token* tok);
+/*
+ * Clone a Token together with its lexeme, so that the clone
+ * does not depend on the source anymore.
+*/
+struct Token* copy_Token(struct Token* tok);
+
+/*
+ * Identifiers and keywords are interned when they are lexed: each distinct
+ * spelling is stored once, NUL-terminated, and gets an id that stays the same
+ * until free_Interned. Later phases compare and hash the ids, not the strings.
+ * Keywords always have the ids below, identifiers the ones after them.
+*/
+enum KeywordId {
+    ID_IF = 1,
+    ID_ELSE,
+    ID_WHILE,
+    ID_BREAK,
+    ID_CONTINUE,
+    ID_WRITEOUT,
+    ID_READINT,
+    ID_READFLOAT,
+    ID_READSTR,
+    ID_READBOOL,
+    ID_TRUE,
+    ID_FALSE,
+    ID_NULL,
+    N_KEYWORD_IDS
+};
+
+/*
+ * Return the id of the spelling (s, len), or 0 on memory error.
+ * Not thread safe: parallel lexing interns once the chunks are joined.
+*/
+int intern_Lexeme(const char* s, size_t len);
+
+/*
+ * Set tok->id if tok is an identifier or a keyword (0 otherwise).
+ * Return 0 if ok, 1 on memory error.
+*/
+int intern_Token(struct Token* tok);
+
+/*
+ * The spelling of an id, NUL-terminated. NULL if the id is not in use.
+*/
+const char* lexeme_Of(int id);
+
+size_t count_Interned();
+
+/*
+ * Release all the spellings: the ids and the lexemes of interned Tokens are not valid anymore.
+*/
+void free_Interned();
+
+/*
+ * Return 1 if the lexeme view (s, len) is exactly the given keyword.
+*/
+int lexeme_is(const char* s, size_t len, const char* keyword);
+
+/*
+ * Return the value of the digits of the lexeme view (s, len),
+ * or LLONG_MAX if it does not fit, as strtoll does.
+*/
+long long lexeme_Int(const char* s, size_t len);
+
+/*
+ * Return the type of the keyword (s, len), or Var if it is not a keyword.
+*/
+enum TokenType keyword_type(const char* s, size_t len);
+
+/*
+ * Recognize the Token starting at *p, store its type in tok and move *p past its lexeme.
+ * Return 0 if ok (also at the end of input), 1 if the characters are not a valid Token.
+*/
+int next_Token(const char** p, struct Token* tok);
 
 /*
  * Create a TokenList from the characters stream
  * (typically a file with source code).
+ * Lexemes are views into fp, that must outlive the TokenList.
  * Return NULL if the characters sequence is not valid in the Grammar.
 */
 struct TokenList* build_TokenList(const char* fp);
 
+/*
+ * Same as build_TokenList on the `size` chars of fp, but the source is cut
+ * at the ";\n" outside strings and the pieces are lexed by `threads` threads
+ * (all the cores if threads <= 0). If skip_ws is not 0 there are no WS Tokens
+ * in the list, as with open_Reader.
+ * Lexemes are views into fp, that must outlive the TokenList.
+*/
+struct TokenList* build_TokenList_Parallel(const char* fp, size_t size, int threads, int skip_ws);
+
+/*
+ * Map a file read-only in memory, followed by a '\0'.
+ * Return NULL if the file cannot be mapped (e.g. it is not a regular file).
+ * The mapping must be released with unmap_Source.
+*/
+const char* map_Source(const char* fileName, size_t* size);
+
+/*
+ * Release a mapping of map_Source. Nothing is done if src is NULL.
+*/
+void unmap_Source(const char* src, size_t size);
+
+/*
+ * A Reader lexes a source a piece at a time, through a buffer
+ * that is refilled when a Token reaches its end.
+ * Memory stays bounded by READER_SIZE, or twice the longest Token.
+*/
+#ifndef READER_SIZE
+#define READER_SIZE (64 * 1024)
+#endif
+
+#define READ_OK 0
+#define READ_INVALID 1 // not a valid Token
+#define READ_END 2 // no more Tokens
+#define READ_ERROR 3 // I/O or memory error
+
+struct Reader {
+    int fd;
+    char* buf; // chars read and not discarded yet, followed by '\0'
+    size_t cap;
+    size_t pos; // next char to lex
+    size_t len; // chars in buf
+    size_t offset; // position of buf[0] in the source
+    int eof;
+    int skip_ws;
+};
+
+/*
+ * Open a Reader on the file, or on the standard input if fileName is "-".
+ * Works with pipes too. Return NULL if the file cannot be opened.
+ * If skip_ws is not 0 the Reader never returns WS Tokens: the blanks
+ * are only counted in the trivia of the Token that follows them.
+*/
+struct Reader* open_Reader(const char* fileName, int skip_ws);
+
+void close_Reader(struct Reader* r);
+
+/*
+ * Store in tok the next Token of the source. The lexeme is valid until the next call.
+ * Return one of the READ_* codes above.
+*/
+int read_Token(struct Reader* r, struct Token* tok);
+
+/*
+ * Create a TokenList reading all the Tokens from r.
+ * Lexemes are copied in the list, that does not depend on r,
+ * but identifiers and keywords point to their interned spelling.
+ * Return NULL if the characters sequence is not valid in the Grammar.
+*/
+struct TokenList* read_TokenList(struct Reader* r);
+
 struct TokenList* strip_WS(struct TokenList* list);
+
+#endif
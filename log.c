@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "log.h"
+
+int log_Level = LOG_WARNING;
+
+const char* log_File;
+const char* log_Text;
+
+const char* level_Names[] = {"error", "warning", "info", "debug"};
+
+
+/*
+ * Offsets where the lines of the source start, read at the first message that needs them:
+ * then each message only looks its offset up. The lock keeps messages of different threads apart.
+*/
+size_t* line_Starts;
+size_t line_Count; // 0 if the source is not available
+size_t source_Len;
+int lines_Read;
+pthread_mutex_t lines_Lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+void log_Source(const char* fileName, const char* text) {
+    pthread_mutex_lock(&lines_Lock);
+    log_File = fileName;
+    log_Text = text;
+    free(line_Starts);
+    line_Starts = NULL;
+    line_Count = 0;
+    lines_Read = 0;
+    pthread_mutex_unlock(&lines_Lock);
+}
+
+
+int add_LineStart(size_t offset, size_t* cap) {
+    size_t* grown;
+    size_t new_cap;
+
+    if (line_Count == *cap) {
+        new_cap = *cap == 0 ? 256 : 2 * *cap;
+        grown = realloc(line_Starts, new_cap * sizeof(size_t));
+        if (grown == NULL)
+            return 1;
+        line_Starts = grown;
+        *cap = new_cap;
+    }
+    line_Starts[line_Count++] = offset;
+    return 0;
+}
+
+
+int read_Lines() {
+    // Return 1 if the source is not available, or there is no memory for its lines
+    FILE* fp;
+    size_t i, cap;
+    int c, status;
+
+    fp = NULL;
+    if (log_Text == NULL) {
+        if (log_File == NULL || strcmp(log_File, "-") == 0)
+            return 1;
+        fp = fopen(log_File, "r");
+        if (fp == NULL)
+            return 1;
+    }
+    cap = 0;
+    status = add_LineStart(0, &cap);
+    for (i = 0; status == 0; i++) {
+        c = fp == NULL ? (unsigned char) log_Text[i] : getc(fp);
+        if (fp == NULL ? c == '\0' : c == EOF)
+            break;
+        if (c == '\n')
+            status = add_LineStart(i + 1, &cap);
+    }
+    source_Len = i;
+    if (fp != NULL)
+        fclose(fp);
+    return status;
+}
+
+
+int locate_Offset(size_t offset, size_t* line, size_t* col) {
+    /*
+     * The line is the last one that starts at or before offset.
+     * Return 1 if the source is not available.
+    */
+    size_t lo, hi, mid;
+    int status;
+
+    pthread_mutex_lock(&lines_Lock);
+    if (! lines_Read) {
+        lines_Read = 1;
+        if (read_Lines() != 0) {
+            free(line_Starts);
+            line_Starts = NULL;
+            line_Count = 0;
+        }
+    }
+    status = line_Count == 0;
+    if (status == 0) {
+        if (offset > source_Len)
+            offset = source_Len;
+        lo = 0;
+        hi = line_Count;
+        while (hi - lo > 1) {
+            mid = lo + (hi - lo) / 2;
+            if (line_Starts[mid] <= offset)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        *line = lo + 1;
+        *col = offset - line_Starts[lo] + 1;
+    }
+    pthread_mutex_unlock(&lines_Lock);
+    return status;
+}
+
+void log_Message(enum LogLevel level, const char* where, const char* format, va_list args) {
+    // One fprintf for the whole message, so that lines from different threads do not mix
+    char msg[1024];
+    vsnprintf(msg, sizeof(msg), format, args);
+    fprintf(stderr, "%s%s: %s\n", where, level_Names[level], msg);
+}
+
+
+void log_Print(enum LogLevel level, const char* format, ...) {
+    va_list args;
+    if ((int) level > log_Level)
+        return;
+    va_start(args, format);
+    log_Message(level, "", format, args);
+    va_end(args);
+}
+
+
+void log_Offset(enum LogLevel level, size_t offset, const char* format, ...) {
+    char where[512];
+    const char* name;
+    size_t line, col;
+    va_list args;
+
+    if ((int) level > log_Level)
+        return;
+    if (log_File == NULL)
+        name = "<source>";
+    else if (strcmp(log_File, "-") == 0)
+        name = "<stdin>";
+    else
+        name = log_File;
+    if (locate_Offset(offset, &line, &col) == 0)
+        snprintf(where, sizeof(where), "%s:%zu:%zu: ", name, line, col);
+    else
+        snprintf(where, sizeof(where), "%s: offset %zu: ", name, offset);
+    va_start(args, format);
+    log_Message(level, where, format, args);
+    va_end(args);
+}
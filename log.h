@@ -0,0 +1,50 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+
+/*
+ * Diagnostics of the compiler. All messages go to stderr, prefixed by their level
+ * and, when they refer to the source, by its position: `file:line:col: `.
+ * Only messages up to log_Level are printed (LOG_WARNING by default).
+ * Compiling with -DLOG_NO_DEBUG removes the log_Debug calls altogether.
+*/
+
+enum LogLevel {
+    LOG_ERROR,
+    LOG_WARNING,
+    LOG_INFO,
+    LOG_DEBUG
+};
+
+extern int log_Level;
+
+/*
+ * The source that offsets refer to, used to turn them into line and column.
+ * fileName can be "-" (the standard input cannot be read again: only offsets are printed).
+ * text, if not NULL, is the whole source in memory and is used instead of the file.
+*/
+void log_Source(const char* fileName, const char* text);
+
+void log_Print(enum LogLevel level, const char* format, ...);
+
+/*
+ * Same as log_Print, for the source position `offset`.
+*/
+void log_Offset(enum LogLevel level, size_t offset, const char* format, ...);
+
+#define log_Error(...) log_Print(LOG_ERROR, __VA_ARGS__)
+
+#define log_Warning(...) log_Print(LOG_WARNING, __VA_ARGS__)
+
+#define log_Info(...) \
+    do { if (log_Level >= LOG_INFO) log_Print(LOG_INFO, __VA_ARGS__); } while (0)
+
+#ifdef LOG_NO_DEBUG
+#define log_Debug(...) do { } while (0)
+#else
+#define log_Debug(...) \
+    do { if (log_Level >= LOG_DEBUG) log_Print(LOG_DEBUG, __VA_ARGS__); } while (0)
+#endif
+
+#endif
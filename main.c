@@ -2,76 +2,291 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "cgen.h"
+#include "cgen_c.h"
+#include "cgen_asm.h"
+#include "cgen_ir.h"
+#include "semantic.h"
+#include "vm.h"
+#include "interp.h"
+#include "stats.h"
+#include "log.h"
 
-// gcc main.c parser.c lexer.c
+// gcc main.c cgen.c cgen_c.c cgen_asm.c cgen_ir.c ir.c ir_opt.c bytecode.c vm.c interp.c semantic.c stats.c log.c parser.c lexer.c -lm
+
+
+enum Target {TARGET_PYTHON, TARGET_C, TARGET_ASM, TARGET_RUN, TARGET_INTERP};
 
 
 int main_parser(int argc, char* argv[]);
 int main_lexer(int argc, char* argv[]);
 int main_cgen(int argc, char* argv[]);
+int main_semantic(int argc, char* argv[]);
 
 
 int main(int argc, char* argv[]) {
     //main_parser(argc, argv);
-    main_cgen(argc, argv);
+    //main_semantic(argc, argv);
+    return main_cgen(argc, argv);
 }
 
 
 int main_cgen(int argc, char* argv[]) {
-    struct ParseTree *tree, *tmp;
-    char* code;
-    int status;
+    /*
+     * ./a.out [--target=python | --target=c | --target=asm | --run | --interp] [--opt] [--mmap] [--stats | --stats=json] [--quiet | --verbose | --debug] <file path> [output path]
+     * --target=c writes a C program (./out.c by default) instead of the Python one (./out.py),
+     * --target=asm x86-64 assembly for Linux (./out.s), only for int, float and bool programs:
+     * `as out.s -o out.o && ld out.o` makes the executable.
+     * --run writes no file: the program is compiled to bytecode and runs at once, on stdin and stdout.
+     * --interp runs the program in the same way, walking the ParseTree instead of bytecode.
+     * The exit status is then the one of the program, 1 after a runtime error.
+     * --opt lowers the program to SSA (see ir.h) and runs the passes on it before
+     * the Python code is written: constants, values computed twice, dead code.
+     * --stats then prints each pass too, and --debug dumps the IR before and after them.
+     * --mmap maps the source read-only instead of reading it through a Reader:
+     * the lexemes are views into the mapping, nothing is copied. Only for a regular file.
+     * --stats prints, on stderr, time and memory used by each phase.
+     * Nothing else is printed but errors and warnings, on stderr:
+     * --quiet only keeps the errors, --verbose adds some info and
+     * --debug traces the phases, dumps the ParseTree on stdout and each generated line
+     * (or the bytecode) on stderr.
+     * The code is written to the output file while it is generated: if that fails, the file is removed.
+    */
+    struct ParseTree *tree;
+    struct TokenList *tokens, *curr;
+    struct SymbolTable *table;
+    struct VmCode *code;
+    struct Reader *reader;
+    struct Stats stats;
     char* outFile;
-
-    if (argc < 2) {
-        printf("Expecting at the least 1 argument: file path.\n");
+    char const* fileName;
+    const char* src;
+    size_t size;
+    struct Ir *ir;
+    struct IrPassStats passes[IR_PASSES];
+    int status, i, nargs, show, opt, mapped;
+    enum Target target;
+
+    fileName = NULL;
+    outFile = NULL;
+    code = NULL;
+    ir = NULL;
+    opt = 0;
+    mapped = 0;
+    src = NULL;
+    size = 0;
+    nargs = 0;
+    show = 0; // 1 for the table, 2 for JSON
+    target = TARGET_PYTHON;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--target=python") == 0)
+            target = TARGET_PYTHON;
+        else if (strcmp(argv[i], "--target=c") == 0)
+            target = TARGET_C;
+        else if (strcmp(argv[i], "--target=asm") == 0)
+            target = TARGET_ASM;
+        else if (strcmp(argv[i], "--run") == 0)
+            target = TARGET_RUN;
+        else if (strcmp(argv[i], "--interp") == 0)
+            target = TARGET_INTERP;
+        else if (strcmp(argv[i], "--opt") == 0)
+            opt = 1;
+        else if (strcmp(argv[i], "--mmap") == 0)
+            mapped = 1;
+        else if (strcmp(argv[i], "--stats") == 0)
+            show = 1;
+        else if (strcmp(argv[i], "--stats=json") == 0)
+            show = 2;
+        else if (strcmp(argv[i], "--quiet") == 0)
+            log_Level = LOG_ERROR;
+        else if (strcmp(argv[i], "--verbose") == 0)
+            log_Level = LOG_INFO;
+        else if (strcmp(argv[i], "--debug") == 0)
+            log_Level = LOG_DEBUG;
+        else if (strncmp(argv[i], "--", 2) == 0) {
+            log_Error("unknown option: %s", argv[i]);
+            return 1;
+        }
+        else if (nargs++ == 0)
+            fileName = argv[i];
+        else
+            outFile = argv[i];
+    }
+    if (fileName == NULL) {
+        log_Error("expecting at the least 1 argument: file path");
         return 1;
     }
-    char const* const fileName = argv[1];
+    if (opt && target != TARGET_PYTHON) {
+        log_Error("--opt is only for the Python target");
+        return 1;
+    }
+    if (outFile == NULL)
+        outFile = target == TARGET_C ? "./out.c" : target == TARGET_ASM ? "./out.s" : "./out.py";
+    init_Stats(&stats);
+    log_Source(fileName, NULL);
+
+    // Whitespaces are dropped by the lexer, the parser never sees them
+    begin_Phase(&stats, PHASE_LEX);
+    if (mapped) {
+        // The mapping stays until the end: the Tokens point into it
+        src = map_Source(fileName, &size);
+        if (src == NULL) {
+            log_Error("cannot map %s", fileName);
+            return 1;
+        }
+        log_Source(fileName, src);
+        tokens = build_TokenList_Parallel(src, size, 1, 1);
+        stats.source = size;
+    }
+    else {
+        reader = open_Reader(fileName, 1);
+        if (reader == NULL) {
+            log_Error("cannot read %s", fileName);
+            return 1;
+        }
+        tokens = read_TokenList(reader);
+        stats.source = reader->offset + reader->len;
+        close_Reader(reader);
+    }
+    end_Phase(&stats, PHASE_LEX);
 
+    if (tokens == NULL) {
+        log_Error("parsing failed: no valid tokens");
+        unmap_Source(src, size);
+        return -1;
+    }
+    for (curr = tokens; curr != NULL; curr = curr->next) {
+        stats.tokens++;
+        if (curr->token->type == Endline)
+            stats.lines++;
+    }
+
+    begin_Phase(&stats, PHASE_PARSE);
     tree = alloc_ParseTree();
-    if (tree == NULL)
+    if (tree == NULL) {
+        free_TokenList(tokens);
+        unmap_Source(src, size);
         return MEMORY_ERROR;
+    }
+    status = build_ParseTree(tokens, &tree);
+    end_Phase(&stats, PHASE_PARSE);
+    stats.nodes = stats_ParseTree().live;
 
-    status = build_ParseTree_FromFile(fileName, &tree);
-    print_ParseTree(tree);
+    if (log_Level >= LOG_DEBUG)
+        print_ParseTree(tree);
 
     if (status != SUBTREE_OK) {
-        printf("PARSING ERROR\n");
+        log_Error("parsing failed");
+        free_ParseTree(tree);
+        free_TokenList(tokens);
+        unmap_Source(src, size);
         return - 1;
     }
 
-    //tmp = tree;//->child->child;//->child->child;
-    //tmp = tmp->sibling->sibling; // Expr
-    //tmp = tmp->child->child->child->child->child; // Str
+    begin_Phase(&stats, PHASE_SEMANTIC);
+    status = analyze_Program_Table(tree, &table);
+    end_Phase(&stats, PHASE_SEMANTIC);
 
-    code = code_gen(tree);
-    if (code == NULL) {
-        printf("Error in CODE-GEN");
+    if (status < 0) {
+        log_Error("semantic analysis failed");
         free_ParseTree(tree);
+        free_TokenList(tokens);
+        unmap_Source(src, size);
         return -1;
     }
-    printf("Generated code is:\n|\n%s|\n", code);
 
-    if (argc > 2)
-        outFile = argv[2];
-    else
-        outFile = "./out.py";
+    if (opt) {
+        begin_Phase(&stats, PHASE_OPT);
+        ir = lower_Program(tree, table);
+        status = ir == NULL ? PARSING_ERROR : verify_Ir(ir);
+        if (status == SUBTREE_OK && log_Level >= LOG_DEBUG) {
+            fprintf(stderr, "IR before the passes:\n");
+            print_Ir(ir, stderr);
+        }
+        if (status == SUBTREE_OK)
+            status = optimize_Ir(ir, passes, log_Level >= LOG_DEBUG);
+        end_Phase(&stats, PHASE_OPT);
+
+        if (status != SUBTREE_OK) {
+            log_Error("optimization failed");
+            free_Ir(ir);
+            free_SymbolTable(table);
+            free_ParseTree(tree);
+            free_TokenList(tokens);
+            unmap_Source(src, size);
+            return -1;
+        }
+        if (log_Level >= LOG_DEBUG) {
+            fprintf(stderr, "IR after the passes:\n");
+            print_Ir(ir, stderr);
+        }
+    }
 
-    FILE *fp = fopen(outFile, "w");
-    if (fp != NULL) {
-        fputs(code, fp);
-        fclose(fp);
+    if (target == TARGET_INTERP) {
+        // No code: the tree runs as the analysis annotated it
+        begin_Phase(&stats, PHASE_RUN);
+        status = interp_Program(tree, table, stdin, stdout);
+        end_Phase(&stats, PHASE_RUN);
+        free_SymbolTable(table);
+    }
+    else {
+        begin_Phase(&stats, PHASE_CGEN);
+        if (target == TARGET_C)
+            status = code_gen_C_ToFile(tree, table, outFile, &stats.output);
+        else if (target == TARGET_ASM)
+            status = code_gen_Asm_ToFile(tree, table, outFile, &stats.output);
+        else if (target == TARGET_RUN) {
+            code = compile_Bytecode(tree, table);
+            status = code == NULL ? PARSING_ERROR : SUBTREE_OK;
+        }
+        else if (ir != NULL)
+            status = code_gen_Ir_ToFile(ir, outFile, &stats.output);
+        else
+            status = code_gen_ToFile(tree, outFile, &stats.output);
+        end_Phase(&stats, PHASE_CGEN);
+        free_Ir(ir);
+        free_SymbolTable(table);
+
+        if (status == WRITE_ERROR) {
+            log_Error("cannot write %s", outFile);
+            status = -1;
+        }
+        else if (status != SUBTREE_OK) {
+            log_Error("code generation failed");
+            status = -1;
+        }
+        else if (target == TARGET_RUN) {
+            // The program runs after the compiler is done with the tree
+            if (log_Level >= LOG_DEBUG)
+                print_Bytecode(code, stderr);
+            stats.output = code->n * sizeof(struct VmIns);
+            begin_Phase(&stats, PHASE_RUN);
+            status = run_Bytecode(code, stdin, stdout);
+            end_Phase(&stats, PHASE_RUN);
+            free_Bytecode(code);
+        }
     }
 
-    free(code);
     free_ParseTree(tree);
+    free_TokenList(tokens);
+    unmap_Source(src, size);
+
+    if (show == 1) {
+        print_Stats(&stats, stderr);
+        if (opt)
+            print_PassStats(passes, IR_PASSES, stderr);
+    }
+    else if (show == 2) {
+        print_StatsJSON(&stats, stderr);
+        fputc('\n', stderr);
+    }
     return status;
 
 }
 
+
 int main_parser(int argc, char* argv[]) {
     struct ParseTree *tree;
     int status;
@@ -118,28 +333,22 @@ int main_lexer(int argc, char* argv[]) {
     char const* const fileName = argv[1];
 
     /*
-     * Load the file in memory and return a char* to it
+     * Open the file, or the standard input if fileName is "-"
     */
-    FILE* file = fopen(fileName, "r");
-    if (file == NULL) {
+    struct Reader* reader = open_Reader(fileName, 0);
+    if (reader == NULL) {
         printf("Cannot read the given file path.\n");
         return -1;
     }
-    struct stat buffer;
-    int status = stat(fileName, &buffer);
-    char vec[buffer.st_size + 1];
-    size_t read = fread(vec, sizeof(char), buffer.st_size, file);
-    fclose(file);
-    vec[buffer.st_size] = '\0';
-    const char* fp = vec;
 
     /*
      * Build Token list
     */
     // Will also print total count
     clock_t begin = clock();
-    struct TokenList* list = build_TokenList(fp);
+    struct TokenList* list = read_TokenList(reader);
     clock_t end = clock();
+    close_Reader(reader);
 
 
     double time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
@@ -156,6 +365,47 @@ int main_lexer(int argc, char* argv[]) {
         no_ws = strip_WS(list);
         print_TokenList(no_ws);
     }
-    free_TokenList(list);
     free_TokenList(no_ws);
+    free_TokenList(list);
+    return 0;
+}
+
+
+int main_semantic(int argc, char* argv[]) {
+    struct SymbolTable *table;
+    struct ContextStack *stack;
+    char sym;
+    struct ParseTree *tree, *assign1, *line2, *assign3;
+    int parser, semantic;
+
+    if (argc < 2) {
+        printf("Expecting exactly 1 argument: file path.\n");
+        return -1;
+    }
+    char const* const fileName = argv[1];
+
+    tree = alloc_ParseTree();
+    if (tree == NULL)
+        return MEMORY_ERROR;
+
+    parser = build_ParseTree_FromFile(fileName, &tree);
+
+    print_ParseTree(tree);
+
+    if (parser != SUBTREE_OK){
+        printf("PARSING ERROR\n");
+        free_ParseTree(tree);
+        return -1;
+    }
+
+    semantic = analyze_Program(tree);
+
+    if (semantic < 0){
+        printf("SEMANTIC ERROR\n");
+        free_ParseTree(tree);
+        return -1;
+    }
+
+    free_ParseTree(tree);
+    return 0;
 }
@@ -4,6 +4,7 @@
 #include <sys/stat.h>
 
 #include "parser.h"
+#include "log.h"
 
 /* Preliminary Definitions
 
@@ -39,14 +40,103 @@ int is_BaseExpr(struct TokenList** head, struct ParseTree** tree);
 int is_Term(struct TokenList** head, struct ParseTree** tree);
 
 
+/*
+ * Tokens of the inner nodes: one per kind, shared by all the nodes of that kind.
+*/
+struct Token tag_Tokens[ListExpr + 1];
+
+/*
+ * The roots built by build_ParseTree_FromFile, each with the TokenList it owns:
+ * free_ParseTree frees the list with its root.
+*/
+struct ParseUnit {
+    struct ParseTree* root;
+    struct TokenList* tokens;
+    struct ParseUnit* next;
+};
+
+struct ParseUnit* parse_Units = NULL;
+
+
+struct Token* tag_Token(enum TokenType type) {
+    if (tag_Tokens[type].lexeme == NULL) {
+        tag_Tokens[type].lexeme = "";
+        tag_Tokens[type].type = type;
+    }
+    return &tag_Tokens[type];
+}
+
+
+/*
+ * Pool of ParseTree nodes.
+ * Nodes are carved out of blocks of POOL_BLOCK nodes, and freed nodes are kept
+ * in a free list (linked through sibling) that is used first: the parser allocates
+ * many nodes only to free them right away when the subtree does not match.
+ * The blocks go back to malloc when the last live node is freed, that is
+ * when all the trees of a compilation are gone.
+ * The pool is not thread safe.
+*/
+struct PoolBlock {
+    struct PoolBlock* next;
+    struct ParseTree nodes[POOL_BLOCK];
+};
+
+struct NodePool {
+    struct PoolBlock* blocks; // the first one is being carved
+    size_t used; // nodes carved out of the first block
+    struct ParseTree* free;
+    struct PoolStats stats;
+};
+
+struct NodePool node_Pool;
+
+
+struct PoolStats stats_ParseTree() {
+    return node_Pool.stats;
+}
+
+
+void release_Pool() {
+    struct PoolBlock* next;
+    while (node_Pool.blocks != NULL) {
+        next = node_Pool.blocks->next;
+        free(node_Pool.blocks);
+        node_Pool.blocks = next;
+    }
+    node_Pool.used = 0;
+    node_Pool.free = NULL;
+}
+
+
 struct ParseTree* alloc_ParseTree() {
     struct ParseTree* tree;
-    tree = malloc(sizeof(struct ParseTree));
-    if (tree == NULL)
-        return NULL;
+    struct PoolBlock* block;
+
+    if (node_Pool.free != NULL) {
+        tree = node_Pool.free;
+        node_Pool.free = tree->sibling;
+        node_Pool.stats.reused++;
+    }
+    else {
+        if (node_Pool.blocks == NULL || node_Pool.used == POOL_BLOCK) {
+            block = malloc(sizeof(struct PoolBlock));
+            if (block == NULL)
+                return NULL;
+            block->next = node_Pool.blocks;
+            node_Pool.blocks = block;
+            node_Pool.used = 0;
+            node_Pool.stats.mallocs++;
+        }
+        tree = &node_Pool.blocks->nodes[node_Pool.used++];
+    }
+    node_Pool.stats.allocs++;
+    if (++node_Pool.stats.live > node_Pool.stats.peak)
+        node_Pool.stats.peak = node_Pool.stats.live;
     tree->data = NULL;
     tree->child = NULL;
     tree->sibling = NULL;
+    tree->slot = -1;
+    tree->value_type = -1;
     return tree;
 }
 
@@ -56,60 +146,129 @@ struct ParseTree* new_ParseTree(struct Token* c) {
     tree = alloc_ParseTree();
     if (tree == NULL)
         return NULL;
-    tree->data = new_Token(c->lexeme, c->type);
-    if (tree->data == NULL) {
-        free(tree);
-        return NULL;
-    }
+    tree->data = c;
     tree->child = NULL;
     tree->sibling = NULL;
     return tree;
 }
 
 
-void print_PT(struct ParseTree* tree, int indent) {
+struct WalkItem {
+    struct ParseTree* node;
+    int depth;
+};
+
+#define WALK_FIRST 64
+
+
+int walk_ParseTree(struct ParseTree* tree, int (*visit)(struct ParseTree*, int, void*), void* arg) {
+    /*
+     * The stack holds the nodes still to visit. Popping a node pushes its sibling,
+     * then its child, so the child comes out first. Only one sibling per level
+     * waits in the stack: its size is the depth of the tree, not the number of nodes.
+     * It starts in `first`, so small subtrees (as the ones the parser frees
+     * when they do not match) are walked without malloc.
+    */
+    struct WalkItem first[WALK_FIRST], *stack, *tmp;
+    struct ParseTree *node, *child, *sibling;
+    size_t top, cap;
+    int depth, skip;
+
     if (tree == NULL)
-        return;
-    // This is a Depth-First print
-    if (indent > 0) {
-        char space[indent + 1];
-        memset(space, ' ', indent * sizeof(char));
-        memset(space+indent, '\0', sizeof(char));
-        printf("%s", space);
+        return SUBTREE_OK;
+    cap = WALK_FIRST;
+    stack = first;
+    top = 0;
+    stack[top].node = tree;
+    stack[top++].depth = 0;
+    while (top > 0) {
+        top--;
+        node = stack[top].node;
+        depth = stack[top].depth;
+        // read the links first, visit may free the node
+        child = node->child;
+        sibling = node->sibling;
+        skip = visit(node, depth, arg);
+        if (top + 2 > cap) {
+            if (stack == first) {
+                tmp = malloc(2 * cap * sizeof(struct WalkItem));
+                if (tmp != NULL)
+                    memcpy(tmp, first, top * sizeof(struct WalkItem));
+            }
+            else
+                tmp = realloc(stack, 2 * cap * sizeof(struct WalkItem));
+            if (tmp == NULL) {
+                if (stack != first)
+                    free(stack);
+                return MEMORY_ERROR;
+            }
+            stack = tmp;
+            cap *= 2;
+        }
+        if (sibling != NULL) {
+            stack[top].node = sibling;
+            stack[top++].depth = depth;
+        }
+        if (child != NULL && ! skip) {
+            stack[top].node = child;
+            stack[top++].depth = depth + 1;
+        }
     }
-    print_Token(tree->data);
-    struct ParseTree* sibling;
-    struct ParseTree* child;
-    sibling = tree->sibling;
-    child = tree->child;
-    print_PT(child, indent + 2);
-    print_PT(sibling, indent);
+    if (stack != first)
+        free(stack);
+    return SUBTREE_OK;
+}
+
+
+int print_PT(struct ParseTree* node, int depth, void* arg) {
+    (void) arg;
+    printf("%*s", 2 * depth, "");
+    print_Token(node->data);
+    return 0;
 }
 
 
 void print_ParseTree(struct ParseTree* tree) {
-    print_PT(tree, 0);
+    // This is a Depth-First print
+    walk_ParseTree(tree, print_PT, NULL);
+}
+
+
+int free_PT(struct ParseTree* node, int depth, void* arg) {
+    // Back to the pool, the walker has already read the links
+    (void) depth;
+    (void) arg;
+    node->sibling = node_Pool.free;
+    node_Pool.free = node;
+    node_Pool.stats.frees++;
+    node_Pool.stats.live--;
+    return 0;
 }
 
 
 void free_ParseTree(struct ParseTree* tree) {
-    struct ParseTree* sibling;
-    struct ParseTree* child;
-    sibling = tree->sibling;
-    child = tree->child;
-    free_Token(tree->data);
-    free(tree);
-    if (sibling != NULL)
-        free_ParseTree(sibling);
-    if (child != NULL)
-        free_ParseTree(child);
+    struct ParseUnit **link, *unit;
+    if (tree == NULL)
+        return;
+    // Nodes do not own their Tokens, but the root may own the whole list
+    for (link = &parse_Units; *link != NULL; link = &(*link)->next)
+        if ((*link)->root == tree) {
+            unit = *link;
+            *link = unit->next;
+            free_TokenList(unit->tokens);
+            free(unit);
+            break;
+        }
+    walk_ParseTree(tree, free_PT, NULL);
+    if (node_Pool.stats.live == 0)
+        release_Pool();
 }
 
 /*
  * Template function for easy-to-check Tokens
  *
  * Match the current Token in the TokenList** tok, with the given TokenType type.
- * If char* lexeme != NULL, then also checks that the current Token's lexeme matches it.
+ * If id != 0, then also checks that the current Token's interned lexeme is that one.
  *
  * First, all WS are skipped. Then, if the check fails *tok unchanged. Otherwise it's advanced.
  *
@@ -117,212 +276,212 @@ void free_ParseTree(struct ParseTree* tree) {
 */
 
 
-int __single_Token_template (struct TokenList** tok, struct ParseTree** new, enum TokenType type, char* lexeme, int hasEndline) {
+int __single_Token_template (struct TokenList** tok, struct ParseTree** new, enum TokenType type, int id, int hasEndline) {
     if (*tok == NULL)
         return PARSING_ERROR;
     struct TokenList* current = *tok;
     if (current->token->type != type) {
-        printf("Expecting <%s>, Found <%s>\n", type2char(type), type2char(current->token->type));
+        log_Offset(LOG_ERROR, current->token->offset, "expecting <%s>, found <%s>",
+                   type2char(type), type2char(current->token->type));
         return PARSING_ERROR;
     }
-    if (lexeme != NULL)
-        if(strcmp(current->token->lexeme, lexeme) != 0) {
-            printf("Expecting %s, Found %s\n", lexeme, current->token->lexeme);
-            return PARSING_ERROR;
-        }
-    // As by definition above, new is already allocated
-    struct Token* newTok = new_Token(current->token->lexeme, current->token->type);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    if (id != 0 && current->token->id != id) {
+        log_Offset(LOG_ERROR, current->token->offset, "expecting %s, found %.*s",
+                   lexeme_Of(id), (int) current->token->len, current->token->lexeme);
+        return PARSING_ERROR;
+    }
+    // As by definition above, new is already allocated.
+    // The leaf refers to the Token in the list, nothing is copied
+    (*new)->data = current->token;
     (*new)->child = NULL;
     (*new)->sibling = NULL;
     *tok = current->next;
     if (hasEndline && *tok==NULL){
-        printf("Did you forget a Endline Token (semicolon)?\n");
+        log_Offset(LOG_ERROR, current->token->offset + current->token->len,
+                   "did you forget a Endline Token (semicolon)?");
         return PARSING_ERROR;
     }
     return SUBTREE_OK;
 }
 
 
-int _single_Token_template (struct TokenList** tok, struct ParseTree** new, enum TokenType type, char* lexeme) {
-    return __single_Token_template(tok, new, type, lexeme, 1);
+int _single_Token_template (struct TokenList** tok, struct ParseTree** new, enum TokenType type, int id) {
+    return __single_Token_template(tok, new, type, id, 1);
 }
 
 
 int is_Endline (struct TokenList** tok, struct ParseTree** new) {
-    return __single_Token_template(tok, new, Endline, NULL, 0);
+    return __single_Token_template(tok, new, Endline, 0, 0);
 }
 
 
 int is_Int (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Int, NULL);
+    return _single_Token_template(tok, new, Int, 0);
 }
 
 
 int is_Dot (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Dot, NULL);
+    return _single_Token_template(tok, new, Dot, 0);
 }
 
 
 int is_Var (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Var, NULL);
+    return _single_Token_template(tok, new, Var, 0);
 }
 
 
 int is_readIn (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, ReadIn, NULL);
+    return _single_Token_template(tok, new, ReadIn, 0);
 }
 
 
 int is_writeOut (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, WriteOut, "writeOut");
+    return _single_Token_template(tok, new, WriteOut, ID_WRITEOUT);
 }
 
 
 int is_If (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, If, "if");
+    return _single_Token_template(tok, new, If, ID_IF);
 }
 
 
 int is_Else (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Else, "else");
+    return _single_Token_template(tok, new, Else, ID_ELSE);
 }
 
 
 int is_While (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, While, "while");
+    return _single_Token_template(tok, new, While, ID_WHILE);
 }
 
 
 int is_Break (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Break, "break");
+    return _single_Token_template(tok, new, Break, ID_BREAK);
 }
 
 
 int is_Continue (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Continue, "continue");
+    return _single_Token_template(tok, new, Continue, ID_CONTINUE);
 }
 
 
 int is_Lbrack (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Lbrack, NULL);
+    return _single_Token_template(tok, new, Lbrack, 0);
 }
 
 
 int is_Rbrack (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Rbrack, NULL);
+    return _single_Token_template(tok, new, Rbrack, 0);
 }
 
 
 int is_Lpar (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Lpar, NULL);
+    return _single_Token_template(tok, new, Lpar, 0);
 }
 
 
 int is_Rpar (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Rpar, NULL);
+    return _single_Token_template(tok, new, Rpar, 0);
 }
 
 
 int is_Comma (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Comma, NULL);
+    return _single_Token_template(tok, new, Comma, 0);
 }
 
 
 int is_EqEq (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, EqEq, NULL);
+    return _single_Token_template(tok, new, EqEq, 0);
 }
 
 
 int is_Equal (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Equal, NULL);
+    return _single_Token_template(tok, new, Equal, 0);
 }
 
 
 int is_Plus (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Plus, NULL);
+    return _single_Token_template(tok, new, Plus, 0);
 }
 
 
 int is_Minus (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Minus, NULL);
+    return _single_Token_template(tok, new, Minus, 0);
 }
 
 
 int is_NotEq (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, NotEq, NULL);
+    return _single_Token_template(tok, new, NotEq, 0);
 }
 
 
 int is_Greater (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Greater, NULL);
+    return _single_Token_template(tok, new, Greater, 0);
 }
 
 
 int is_GreaterEq (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, GreaterEq, NULL);
+    return _single_Token_template(tok, new, GreaterEq, 0);
 }
 
 
 int is_Lesser (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Lesser, NULL);
+    return _single_Token_template(tok, new, Lesser, 0);
 }
 
 
 int is_LesserEq (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, LesserEq, NULL);
+    return _single_Token_template(tok, new, LesserEq, 0);
 }
 
 
 int is_Star (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Star, NULL);
+    return _single_Token_template(tok, new, Star, 0);
 }
 
 
 int is_Div (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Div, NULL);
+    return _single_Token_template(tok, new, Div, 0);
 }
 
 
 int is_FloatDiv (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, FloatDiv, NULL);
+    return _single_Token_template(tok, new, FloatDiv, 0);
 }
 
 
 int is_Percent (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Percent, NULL);
+    return _single_Token_template(tok, new, Percent, 0);
 }
 
 
 int is_Or (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Or, NULL);
+    return _single_Token_template(tok, new, Or, 0);
 }
 
 
 int is_And (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, And, NULL);
+    return _single_Token_template(tok, new, And, 0);
 }
 
 
 int is_Pow (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Pow, NULL);
+    return _single_Token_template(tok, new, Pow, 0);
 }
 
 
 int is_Null (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Null, NULL);
+    return _single_Token_template(tok, new, Null, 0);
 }
 
 
 int is_Bool (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, Bool, NULL);
+    return _single_Token_template(tok, new, Bool, 0);
 }
 
 
 int is_CharSeq (struct TokenList** tok, struct ParseTree** new) {
-    return _single_Token_template(tok, new, QuotedStr, NULL);
+    return _single_Token_template(tok, new, QuotedStr, 0);
 }
 
 
@@ -332,15 +491,11 @@ int is_QuotedStr (struct TokenList** tok, struct ParseTree** new) {
 
     struct ParseTree *charseq, *comma, *obj, *last;
     int status, nVar, nObj;
-    struct Token *newTok;
 
     status = SUBTREE_OK;
     nVar = nObj = 0;
 
-    newTok = new_Token((char[1]){'\0'}, QuotedStr);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(QuotedStr);
 
     charseq = alloc_ParseTree();
     if (charseq == NULL)
@@ -354,8 +509,9 @@ int is_QuotedStr (struct TokenList** tok, struct ParseTree** new) {
     last = charseq;
 
     // Count the variables to interpolate
-    int i = 0;
-    while (charseq->data->lexeme[i] != '\0') {
+    // (the lexeme ends with the closing '"', so i+1 is always inside it)
+    size_t i = 0;
+    while (i < charseq->data->len) {
         if (charseq->data->lexeme[i] == '%') {
             if (charseq->data->lexeme[i+1] == '%') // escape char
                 i += 2;
@@ -394,7 +550,8 @@ int is_QuotedStr (struct TokenList** tok, struct ParseTree** new) {
     }
 
     if (nObj != nVar) {
-        printf("QuotedStr with #obj != #interpolation (%d != %d)\n", nObj, nVar);
+        log_Offset(LOG_ERROR, charseq->data->offset,
+                   "QuotedStr with #obj != #interpolation (%d != %d)", nObj, nVar);
         return PARSING_ERROR;
     }
     return status;
@@ -489,14 +646,10 @@ int is_BaseExpr (struct TokenList** tok, struct ParseTree** new) {
 
     int status;
     struct ParseTree *lpar, *rpar, *subexpr, *obj;
-    struct Token *newTok;
 
     status = SUBTREE_OK;
 
-    newTok = new_Token((char[1]){'\0'}, BaseExpr);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(BaseExpr);
 
     if ((*tok)->token->type == Lpar) {
         // is a sub expression
@@ -546,90 +699,51 @@ int is_BaseExpr (struct TokenList** tok, struct ParseTree** new) {
 }
 
 
-int is_Term (struct TokenList** tok, struct ParseTree** new) {
-    if (*tok == NULL)
-        return PARSING_ERROR;
-
-    int status;
-    enum TokenType type;
-    struct ParseTree *base, *op, *term;
-    struct Token *newTok;
-
-    status = SUBTREE_OK;
-
-    newTok = new_Token((char[1]){'\0'}, Term);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
-
-    base = alloc_ParseTree();
-    if (base == NULL)
-        return MEMORY_ERROR;
-    status = is_BaseExpr(tok, &base);
-    if (status != SUBTREE_OK){
-        free_ParseTree(base);
-        return status;
-    }
-    (*new)->child = base;
-
-    // The remainder of a Term is optional
-    type = (*tok)->token->type;
+/*
+ * Expr, Pred and Term are chains of operands with operators of the same precedence:
+ *
+ *   expr : pred (condOp pred)*
+ *   pred : term (('+' | '-') term)*
+ *   term : baseExpr (('*' | '/' | '/.' | '%') baseExpr)*
+ *
+ * Operands and operators of a chain are siblings, all children of one node.
+ * A chain is read in a loop, so its length costs no stack and no wrapper nodes.
+ * The passes fold it from the left: operators are left associative.
+*/
 
-    if (match_TermOp_type(type)){
-        op = alloc_ParseTree();
-        if (op == NULL)
-            return MEMORY_ERROR;
-        status = is_Operator(tok, &op);
-        if (status != SUBTREE_OK){
-            free_ParseTree(op);
-            return status;
-        }
-        base->sibling = op;
 
-        term = alloc_ParseTree();
-        if (term == NULL)
-            return MEMORY_ERROR;
-        status = is_Term(tok, &term);
-        if (status != SUBTREE_OK){
-            free_ParseTree(term);
-            return status;
-        }
-        op->sibling = term;
-    }
-    return status;
+enum TokenType op_Level (enum TokenType type) {
+    // The kind of chain made by a binary operator, UNK if type is not one
+    if (match_CondOp_type(type))
+        return Expr;
+    if (type == Plus || type == Minus)
+        return Pred;
+    if (match_TermOp_type(type))
+        return Term;
+    return UNK;
 }
 
 
-int is_Pred (struct TokenList** tok, struct ParseTree** new) {
-    if (*tok == NULL)
-        return PARSING_ERROR;
-
-    struct ParseTree *term, *op, *pred;
-    struct Token *newTok;
-    enum TokenType type;
+int is_Chain (struct TokenList** tok, struct ParseTree** new, enum TokenType kind,
+              int (*is_operand)(struct TokenList**, struct ParseTree**)) {
+    struct ParseTree *operand, *op, *last;
     int status;
 
-    status = SUBTREE_OK;
-    newTok = new_Token((char[1]){'\0'}, Pred);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(kind);
 
-    term = alloc_ParseTree();
-    if (term == NULL)
+    operand = alloc_ParseTree();
+    if (operand == NULL)
         return MEMORY_ERROR;
-    status = is_Term(tok, &term);
+    status = is_operand(tok, &operand);
     if (status != SUBTREE_OK){
-        free_ParseTree(term);
+        free_ParseTree(operand);
         return status;
     }
-    (*new)->child = term;
+    (*new)->child = operand;
+    last = operand;
 
-    // The remainder of Pred is optional
-    // (only if there is '+' | '-')
-    type = (*tok)->token->type;
-    if (match_AritmOp_type(type) &&
-        !match_TermOp_type(type)){
+    // The remainder of the chain is optional
+    while (*tok != NULL && op_Level((*tok)->token->type) == kind) {
         op = alloc_ParseTree();
         if (op == NULL)
             return MEMORY_ERROR;
@@ -638,85 +752,49 @@ int is_Pred (struct TokenList** tok, struct ParseTree** new) {
             free_ParseTree(op);
             return status;
         }
-        term->sibling = op;
+        last->sibling = op;
 
-        pred = alloc_ParseTree();
-        if (pred == NULL)
+        operand = alloc_ParseTree();
+        if (operand == NULL)
             return MEMORY_ERROR;
-        status = is_Pred(tok, &pred);
+        status = is_operand(tok, &operand);
         if (status != SUBTREE_OK){
-            free_ParseTree(pred);
+            free_ParseTree(operand);
             return status;
         }
-        op->sibling = pred;
+        op->sibling = operand;
+        last = operand;
     }
-
     return status;
 }
 
 
-int is_Expr (struct TokenList** tok, struct ParseTree** new) {
+int is_Term (struct TokenList** tok, struct ParseTree** new) {
     if (*tok == NULL)
         return PARSING_ERROR;
+    return is_Chain(tok, new, Term, is_BaseExpr);
+}
 
-    struct ParseTree *pred, *op, *expr;
-    struct Token *newTok;
-    enum TokenType type;
-    int status;
-
-    status = SUBTREE_OK;
-    newTok = new_Token((char[1]){'\0'}, Expr);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
 
-    pred = alloc_ParseTree();
-    if (pred == NULL)
-        return MEMORY_ERROR;
-    status = is_Pred(tok, &pred);
-    if (status != SUBTREE_OK){
-        free_ParseTree(pred);
-        return status;
-    }
-    (*new)->child = pred;
+int is_Pred (struct TokenList** tok, struct ParseTree** new) {
+    if (*tok == NULL)
+        return PARSING_ERROR;
+    return is_Chain(tok, new, Pred, is_Term);
+}
 
-    // The remainder of Expr is optional
-    // (only if there is a conditional operator)
-    type = (*tok)->token->type;
-    if (match_CondOp_type(type)){
-        op = alloc_ParseTree();
-        if (op == NULL)
-            return MEMORY_ERROR;
-        status = is_Operator(tok, &op);
-        if (status != SUBTREE_OK){
-            free_ParseTree(op);
-            return status;
-        }
-        pred->sibling = op;
 
-        expr = alloc_ParseTree();
-        if (expr == NULL)
-            return MEMORY_ERROR;
-        status = is_Expr(tok, &expr);
-        if (status != SUBTREE_OK){
-            free_ParseTree(expr);
-            return status;
-        }
-        op->sibling = expr;
-    }
-    return status;
+int is_Expr (struct TokenList** tok, struct ParseTree** new) {
+    if (*tok == NULL)
+        return PARSING_ERROR;
+    return is_Chain(tok, new, Expr, is_Pred);
 }
 
 
 int is_List (struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *open, *listexpr, *close;
     int status, has_expr;
-    struct Token* newTok;
 
-    newTok = new_Token((char[1]){'\0'}, List);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(List);
 
     status = SUBTREE_OK;
     has_expr = 0;
@@ -764,13 +842,9 @@ int is_List (struct TokenList** tok, struct ParseTree** new) {
 int is_ListElem(struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *var, *lbrack, *idx, *rbrack;
     int status;
-    struct Token *newTok;
 
     status = SUBTREE_OK;
-    newTok = new_Token((char[1]){'\0'}, ListElem);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(ListElem);
 
     var = alloc_ParseTree();
     if (var == NULL)
@@ -823,13 +897,9 @@ int is_ListElem(struct TokenList** tok, struct ParseTree** new) {
 int is_ListExpr(struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *obj, *comma, *last;
     int status;
-    struct Token* newTok;
 
     status = SUBTREE_OK;
-    newTok = new_Token((char[1]){'\0'}, ListExpr);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(ListExpr);
 
     obj = alloc_ParseTree();
     if (obj == NULL)
@@ -876,12 +946,8 @@ int is_Str (struct TokenList** tok, struct ParseTree** new) {
 
     struct ParseTree *quotedstr, *plus, *last;
     int status;
-    struct Token* newTok;
 
-    newTok = new_Token((char[1]){'\0'}, Str);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(Str);
 
     status = SUBTREE_OK;
     quotedstr = alloc_ParseTree();
@@ -928,12 +994,8 @@ int is_Str (struct TokenList** tok, struct ParseTree** new) {
 int is_Frac (struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *dot, *integer;
     int status;
-    struct Token* newTok;
 
-    newTok = new_Token((char[1]){'\0'}, Frac);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(Frac);
 
     status = SUBTREE_OK;
     dot = alloc_ParseTree();
@@ -964,12 +1026,8 @@ int is_Frac (struct TokenList** tok, struct ParseTree** new) {
 int is_Exp (struct TokenList** tok, struct ParseTree** new) {
     int status, has_sign;
     struct ParseTree *pow, *sign, *integer;
-    struct Token* newTok;
 
-    newTok = new_Token((char[1]){'\0'}, Pow);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(Pow);
 
     status = SUBTREE_OK;
     has_sign = 0;
@@ -1031,12 +1089,8 @@ int is_Float(struct TokenList** tok, struct ParseTree** new) {
 
     struct ParseTree *integer, *frac, *pow, *last;
     int status;
-    struct Token* newTok;
 
-    newTok = new_Token((char[1]){'\0'}, Float);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(Float);
 
     status = SUBTREE_OK;
 
@@ -1111,12 +1165,8 @@ int is_Float(struct TokenList** tok, struct ParseTree** new) {
 int is_Num(struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *sign, *numeric;
     int status, has_sign;
-    struct Token* newTok;
 
-    newTok = new_Token((char[1]){'\0'}, Num);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(Num);
 
     status = SUBTREE_OK;
     has_sign = 1;
@@ -1162,14 +1212,10 @@ int is_Num(struct TokenList** tok, struct ParseTree** new) {
 int is_Obj(struct TokenList** tok, struct ParseTree** new) {
     if (*tok == NULL)
         return PARSING_ERROR;
-    struct Token* newTok;
     struct ParseTree* subtree;
     int status;
 
-    newTok = new_Token((char[1]){'\0'}, Obj);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(Obj);
 
     subtree = alloc_ParseTree();
     if (subtree == NULL)
@@ -1211,12 +1257,8 @@ int is_Obj(struct TokenList** tok, struct ParseTree** new) {
 int is_Assign(struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *var1, *eq, *var2;
     int status;
-    struct Token *newTok;
 
-    newTok = new_Token((char[1]) {'\0'}, Assign);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(Assign);
 
     var1 = alloc_ParseTree();
     if (var1 == NULL)
@@ -1256,12 +1298,8 @@ int is_Input(struct TokenList** tok, struct ParseTree** new) {
     // Create subtree
     struct ParseTree *readin, *var;
     int status;
-    struct Token* newTok;
 
-    newTok = new_Token((char[1]){'\0'}, Input);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(Input);
 
     readin = alloc_ParseTree();
     if (readin == NULL)
@@ -1291,12 +1329,8 @@ int is_Output(struct TokenList** tok, struct ParseTree** new) {
     // Create subtree
     struct ParseTree *writeOut, *obj;
     int status;
-    struct Token* newTok;
 
-    newTok = new_Token((char[1]){'\0'}, Output);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(Output);
 
     writeOut = alloc_ParseTree();
     if (writeOut == NULL)
@@ -1325,14 +1359,10 @@ int is_Output(struct TokenList** tok, struct ParseTree** new) {
 int is_OptElse (struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *elsetok, *line, *endline, *last;
     int status;
-    struct Token* newTok;
 
     status = SUBTREE_OK;
 
-    newTok = new_Token((char[1]){'\0'}, OptElse);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(OptElse);
 
     elsetok = alloc_ParseTree();
     if (elsetok == NULL)
@@ -1369,15 +1399,11 @@ int is_OptElse (struct TokenList** tok, struct ParseTree** new) {
 int is_IfBody (struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *line, *endline, *optelse, *last;
     int status, count;
-    struct Token* newTok;
 
     status = SUBTREE_OK;
     count = 0;
 
-    newTok = new_Token((char[1]){'\0'}, IfBody);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(IfBody);
     last = NULL;
 
     while ( (*tok) != NULL &&
@@ -1407,7 +1433,10 @@ int is_IfBody (struct TokenList** tok, struct ParseTree** new) {
     }
 
     if (count == 0) {
-        printf("IfBody cannot be empty\n");
+        if (*tok != NULL)
+            log_Offset(LOG_ERROR, (*tok)->token->offset, "IfBody cannot be empty");
+        else
+            log_Error("IfBody cannot be empty");
         return PARSING_ERROR;
     }
 
@@ -1429,13 +1458,9 @@ int is_IfBody (struct TokenList** tok, struct ParseTree** new) {
 int is_IfCond (struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *lpar, *expr, *rpar;
     int status;
-    struct Token* newTok;
     status = SUBTREE_OK;
 
-    newTok = new_Token((char[1]){'\0'}, IfCond);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(IfCond);
 
     lpar = alloc_ParseTree();
     if (lpar == NULL)
@@ -1468,12 +1493,8 @@ int is_IfCond (struct TokenList** tok, struct ParseTree** new) {
 int is_IfLine (struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *iftok, *ifcond, *ifbody;
     int status;
-    struct Token* newTok;
 
-    newTok = new_Token((char[1]){'\0'}, IfLine);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(IfLine);
 
     status = SUBTREE_OK;
 
@@ -1506,13 +1527,9 @@ int is_IfLine (struct TokenList** tok, struct ParseTree** new) {
 int is_LoopLine(struct TokenList** tok, struct ParseTree** new) {
     struct ParseTree *whilekey, *ifcond, *loopbody;
     int status;
-    struct Token* newTok;
 
     status = SUBTREE_OK;
-    newTok = new_Token((char[1]){'\0'}, LoopLine);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*new)->data = newTok;
+    (*new)->data = tag_Token(LoopLine);
 
     whilekey = alloc_ParseTree();
     if (whilekey == NULL)
@@ -1547,14 +1564,10 @@ int is_LoopLine(struct TokenList** tok, struct ParseTree** new) {
 int is_Line(struct TokenList** tok, struct ParseTree** line) {
     // Create subtree
     struct ParseTree* subtree;
-    struct Token* newTok;
     int status;
     struct TokenList* curr;
 
-    newTok = new_Token((char[1]){'\0'}, Line);
-    if (newTok == NULL)
-        return MEMORY_ERROR;
-    (*line)->data = newTok;
+    (*line)->data = tag_Token(Line);
 
     subtree = alloc_ParseTree();
     if (subtree == NULL)
@@ -1584,22 +1597,18 @@ int is_Line(struct TokenList** tok, struct ParseTree** line) {
 
 
 int is_Program(struct TokenList** head, struct ParseTree** tree) {
-    struct Token *tok;
     int status, child;
     struct ParseTree *current;
     struct ParseTree *line, *endline;
     
-    tok = new_Token((char[1]){'\0'}, Program);
-    if (tok == NULL)
-        return MEMORY_ERROR;
-    (*tree)->data = tok;
+    (*tree)->data = tag_Token(Program);
 
     // Entry point of any valid tokens sequence for this grammar.
     line = alloc_ParseTree();
     endline = alloc_ParseTree();
     if (line == NULL || endline == NULL) {
-        free(line);
-        free(endline);
+        free_ParseTree(line);
+        free_ParseTree(endline);
         return MEMORY_ERROR;
     }
 
@@ -1628,7 +1637,10 @@ int is_Program(struct TokenList** head, struct ParseTree** tree) {
         current = line;
         line = alloc_ParseTree();
         if (status != SUBTREE_OK) {
-            printf("ERROR PARSING LINE: %d\n", status);
+            if (*head != NULL)
+                log_Offset(LOG_ERROR, (*head)->token->offset, "cannot parse the line (%d)", status);
+            else
+                log_Error("cannot parse the line (%d): unexpected end of input", status);
             break;
         }
 
@@ -1638,7 +1650,10 @@ int is_Program(struct TokenList** head, struct ParseTree** tree) {
         current = endline;
         endline = alloc_ParseTree();
         if (status != SUBTREE_OK) {
-            printf("Missing ENDLINE\n");
+            if (*head != NULL)
+                log_Offset(LOG_ERROR, (*head)->token->offset, "missing ENDLINE");
+            else
+                log_Error("missing ENDLINE at the end of input");
             break;
         }
     }
@@ -1659,40 +1674,41 @@ int build_ParseTree (struct TokenList* head, struct ParseTree** tree) {
 
 
 int build_ParseTree_FromFile (const char *fileName, struct ParseTree **tree) {
-    FILE *file;
-    char *vec;
-    struct stat buffer;
-    struct TokenList *list, *list2;
+    // fileName can be "-" to read the standard input
+    struct Reader *reader;
+    struct ParseUnit *unit;
     int status;
 
-    file = fopen(fileName, "r");
-    if (file == NULL) {
-        printf("Cannot read the given file path.\n");
+    // Whitespaces are dropped by the Reader, the parser never sees them
+    log_Source(fileName, NULL);
+    reader = open_Reader(fileName, 1);
+    if (reader == NULL) {
+        log_Error("cannot read %s", fileName);
         return MEMORY_ERROR;
     }
-    stat(fileName, &buffer);
-    vec = malloc((buffer.st_size + 1) * sizeof(char));
-    if (vec == NULL)
+    unit = malloc(sizeof(struct ParseUnit));
+    if (unit == NULL) {
+        close_Reader(reader);
         return MEMORY_ERROR;
-    fread(vec, sizeof(char), buffer.st_size, file);
-    fclose(file);
-    *(vec+buffer.st_size) = '\0';
-    const char *fp = vec;
+    }
 
     /*
      * Build Token list
     */
     // Will also print total count
-    list = build_TokenList(fp);
+    unit->tokens = read_TokenList(reader);
+    close_Reader(reader);
 
-    if (list == NULL)
+    if (unit->tokens == NULL) {
+        free(unit);
         return MEMORY_ERROR; // TODO - buildTokenList should return int too
-    list2 = strip_WS(list);
-    free_TokenList(list);
+    }
 
-    status = build_ParseTree(list2, tree);
+    status = build_ParseTree(unit->tokens, tree);
 
-    free_TokenList(list2);
-    free(vec);
+    // From now on the tree owns the list: see free_ParseTree
+    unit->root = *tree;
+    unit->next = parse_Units;
+    parse_Units = unit;
     return status;
 }
@@ -1,9 +1,15 @@
+#ifndef PARSER_H
+#define PARSER_H
+
 #include "lexer.h"
 
 struct ParseTree {
     struct Token* data;
     struct ParseTree* child;
     struct ParseTree* sibling;
+    // Set by the semantic analysis, -1 before it (see analyze_Program_Table)
+    int slot; // of a Var: its place in the frame of the variables
+    int value_type; // of an Expr, Pred, Term, BaseExpr, Obj or ListExpr: _int, _float, ...
 };
 
 
@@ -14,25 +20,73 @@ struct ParseTree {
 
 /*
  * Create a new ParseTree from a given Token.
- * The Token is COPIED with all its internal data into a new memory loc.
- * Therefore when the ParseTree created by this function will be freed, Token* c will not.
+ * The Token is NOT copied: the ParseTree points to it, and it must outlive the tree.
  * Return NULL if a memory error happens.
 */
 struct ParseTree* new_ParseTree(struct Token* c);
 
 
+/*
+ * Allocate an empty ParseTree from the node pool.
+ * Return NULL if a memory error happens.
+*/
 struct ParseTree* alloc_ParseTree();
 
+#ifndef POOL_BLOCK
+#define POOL_BLOCK 1024 // nodes per malloc
+#endif
+
+/*
+ * Counters of the node pool, since the start of the program.
+*/
+struct PoolStats {
+    size_t allocs; // calls to alloc_ParseTree
+    size_t reused; // allocs served by freed nodes
+    size_t frees; // nodes given back by free_ParseTree
+    size_t mallocs; // blocks of POOL_BLOCK nodes taken from malloc
+    size_t live; // nodes allocated and not freed yet
+    size_t peak; // max of live
+};
+
+struct PoolStats stats_ParseTree();
+
 
 void print_ParseTree(struct ParseTree* tree);
 
 /*
- * Free memory for the ParseTree and all its internal data, including children and siblings.
- * ParseTrees are built by *cloning* Tokens, so only the clones are freed.
+ * Depth-first (pre-order) visit of the tree and its siblings, without recursion,
+ * so that long chains of Lines cannot overflow the stack.
+ * visit(node, depth, arg) is called on every node, depth is 0 for tree.
+ * If it returns non-zero the children of that node are not visited.
+ * visit may free the node: its links are read before the call.
+ * Return SUBTREE_OK, or MEMORY_ERROR if the stack cannot grow.
+*/
+int walk_ParseTree(struct ParseTree* tree, int (*visit)(struct ParseTree*, int, void*), void* arg);
+
+/*
+ * The Token of all the inner nodes of the given kind (Program, Line, Expr, ...).
+ * It is shared and never freed.
+*/
+struct Token* tag_Token(enum TokenType type);
+
+/*
+ * Free memory for the ParseTree, including children and siblings.
+ * Nodes go back to the pool, that returns its memory when no node is left.
+ * Leaves point to the Tokens of the list they were parsed from, that are not freed,
+ * but a tree built by build_ParseTree_FromFile owns its list: it is freed with the root.
 */
 void free_ParseTree(struct ParseTree* tree);
 
 
+/*
+ * Leaves of the tree point to the Tokens of head, that must outlive the tree.
+*/
 int build_ParseTree (struct TokenList* head, struct ParseTree** tree);
 
+/*
+ * The TokenList is read from the file and handed over to the tree.
+ * Lexemes of the leaves are NUL-terminated.
+*/
 int build_ParseTree_FromFile (const char *fileName, struct ParseTree **tree);
+
+#endif
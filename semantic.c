@@ -4,9 +4,84 @@
 #include <sys/stat.h>
 
 #include "semantic.h"
+#include "log.h"
+
+int resultType_aritm [6][6] = {
+    /*
+     Valid for + - * /
+     Row index is 1st operand type.
+     Col index is 2nd operand type.
+     Value is the result type of the operation,
+     or _undef if the operation is impossible.
+    */
+
+    /*             int       float    null    string    bool    list*/
+    /* int   */ { _int,     _float,  _undef,  _undef,  _undef, _undef},
+    /* float */ { _float,   _float,  _undef,  _undef,  _undef, _undef},
+    /* string */{ _undef,   _undef,  _undef,  _undef,  _undef, _undef},
+    /* bool  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
+    /* null  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
+    /* list  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef}
+};
+
+int resultType_FloatDiv [6][6] = {
+    /*
+     Valid for /.
+    */
+
+    /*             int       float    null    string    bool    list*/
+    /* int   */ { _float,   _float,  _undef,  _undef,  _undef, _undef},
+    /* float */ { _float,   _float,  _undef,  _undef,  _undef, _undef},
+    /* string */{ _undef,   _undef,  _undef,  _undef,  _undef, _undef},
+    /* bool  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
+    /* null  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
+    /* list  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef}
+};
+
+
+int resultType_compare [6][6] = {
+    /*
+     Valid for < > <= >=
+     Row index is 1st operand type.
+     Col index is 2nd operand type.
+     Value is the result type of the operation,
+     or _undef if the operation is impossible.
+    */
+    /*             int       float    null    string    bool    list*/
+    /* int   */ { _bool,    _bool,   _undef,  _undef,  _undef, _undef},
+    /* float */ { _bool,    _bool,   _undef,  _undef,  _undef, _undef},
+    /* string */{ _undef,   _undef,  _undef,  _undef,  _undef, _undef},
+    /* bool  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
+    /* null  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
+    /* list  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef}
+};
+
+
+int resultType_logic [6][6] = {
+    /*
+     Valid for && || != ==
+     Row index is 1st operand type.
+     Col index is 2nd operand type.
+     Value is the result type of the operation,
+     or _undef if the operation is impossible.
+    */
+    /*             int       float    null    string    bool    list */
+    /* int   */ { _bool,    _bool,   _bool,   _bool,   _bool,  _undef},
+    /* float */ { _bool,    _bool,   _bool,   _bool,   _bool,  _undef},
+    /* string */{ _bool,    _bool,   _bool,   _bool,   _bool,  _undef},
+    /* bool  */ { _bool,    _bool,   _bool,   _bool,   _bool,  _undef},
+    /* null  */ { _bool,    _bool,   _bool,   _bool,   _bool,  _undef},
+    /* list  */ { _undef,   _undef,  _undef,  _undef,  _undef, _bool}
+};
 
 
 int analyze_ListExpr(struct ParseTree *node, struct SymbolTable **table, struct Symbol **sym);
+int analyze_Var(struct ParseTree *node, struct SymbolTable **table);
+int analyze_Obj(struct ParseTree *tree, struct SymbolTable **table, struct Symbol **sym);
+int analyze_Str(struct ParseTree *node, struct SymbolTable **table);
+int analyze_BaseExpr(struct ParseTree *node, struct SymbolTable **table, struct Symbol **sym);
+int analyze_Term(struct ParseTree *node, struct SymbolTable **table, struct Symbol **sym);
+int analyze_Pred(struct ParseTree *node, struct SymbolTable **table, struct Symbol **sym);
 int analyze_List(struct ParseTree *node, struct SymbolTable **table, struct Symbol **sym);
 int analyze_ListElem(struct ParseTree *node, struct SymbolTable **table);
 int analyze_Expr(struct ParseTree *node, struct SymbolTable **table, struct Symbol **sym);
@@ -14,26 +89,29 @@ int analyze_Line(struct ParseTree *node, struct SymbolTable **table, struct Cont
 int analyze_ifCond(struct ParseTree *node, struct SymbolTable **table);
 
 
-struct Symbol* new_Sym(char *sym) {
+#define SYMBOLS_CAP 64 // initial slots of a SymbolTable
+
+
+struct Symbol* new_Sym(int id) {
     struct Symbol *new;
 
     new = malloc(sizeof(struct Symbol));
     if (new == NULL)
         return NULL;
-    new->sym = malloc(sizeof(char) * (strlen(sym) + 1));
-    if (new->sym == NULL)
-        return NULL;
-    memcpy(new->sym, sym, strlen(sym) + 1);
+    new->sym = lexeme_Of(id);
+    new->id = id;
     new->type = _undef;
     new->list_type = _undef;
+    new->scope = 0;
+    new->slot = -1;
+    new->outer = NULL;
+    new->prev = NULL;
     return new;
 }
 
 
 void free_Symbol(struct Symbol *sym) {
-    if (sym == NULL)
-        return;
-    free(sym->sym);
+    // The spelling belongs to the interner
     free(sym);
 }
 
@@ -66,30 +144,107 @@ struct SymbolTable* alloc_SymbolTable() {
     table = malloc(sizeof(struct SymbolTable));
     if (table == NULL)
         return NULL;
-    table->head = NULL;
-    table->next = NULL;
+    table->slots = calloc(SYMBOLS_CAP, sizeof(struct Symbol*));
+    if (table->slots == NULL) {
+        free(table);
+        return NULL;
+    }
+    table->cap = SYMBOLS_CAP;
+    table->count = 0;
+    table->scope = 0;
+    table->last = NULL;
+    table->nslots = 0;
     return table;
 }
 
 
 void free_SymbolTable(struct SymbolTable *table) {
-    struct SymbolTable *curr;
+    struct Symbol *curr;
 
-    while((curr=table) != NULL) {
-        table = table->next;
-        free_Symbol(curr->head);
-        free(curr);
+    if (table == NULL)
+        return;
+    // Every symbol is in the chain of definitions, hidden ones too
+    while ((curr = table->last) != NULL) {
+        table->last = curr->prev;
+        free_Symbol(curr);
     }
+    free(table->slots);
+    free(table);
 }
 
 
-struct Symbol* search_symbol(struct SymbolTable *table, char *lexeme) {
-    while (table != NULL && table->head != NULL) {
-        if (strcmp(table->head->sym, lexeme) == 0)
-            return table->head;
-        table = table->next;
+size_t home_Slot(int id, size_t mask) {
+    // Ids are consecutive: spread them (Fibonacci hashing)
+    return ((unsigned int) id * 2654435769u) & mask;
+}
+
+
+size_t find_Slot(struct SymbolTable *table, int id) {
+    // The slot of the symbol, or the empty slot where it would go
+    size_t mask, i;
+
+    mask = table->cap - 1;
+    i = home_Slot(id, mask);
+    while (table->slots[i] != NULL && table->slots[i]->id != id)
+        i = (i + 1) & mask;
+    return i;
+}
+
+
+int grow_SymbolTable(struct SymbolTable *table) {
+    // Double the slots and insert the symbols again. Return 1 on memory error.
+    struct Symbol **old;
+    size_t cap, i, j, mask;
+
+    old = table->slots;
+    cap = table->cap;
+    table->slots = calloc(2 * cap, sizeof(struct Symbol*));
+    if (table->slots == NULL) {
+        table->slots = old;
+        return 1;
     }
-    return NULL;
+    table->cap = 2 * cap;
+    mask = table->cap - 1;
+    for (i = 0; i < cap; i++) {
+        if (old[i] == NULL)
+            continue;
+        j = home_Slot(old[i]->id, mask);
+        while (table->slots[j] != NULL)
+            j = (j + 1) & mask;
+        table->slots[j] = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+
+void remove_Slot(struct SymbolTable *table, size_t i) {
+    /*
+     * Empty the slot, then move back the symbols after it that would not
+     * be found anymore, so that no tombstone is needed.
+    */
+    size_t mask, j, home;
+
+    mask = table->cap - 1;
+    j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        if (table->slots[j] == NULL)
+            break;
+        home = home_Slot(table->slots[j]->id, mask);
+        // Move it if its home is not in the cyclic range (i, j]
+        if ((i < j && (home <= i || home > j)) || (i > j && home <= i && home > j)) {
+            table->slots[i] = table->slots[j];
+            i = j;
+        }
+    }
+    table->slots[i] = NULL;
+    table->count--;
+}
+
+
+struct Symbol* search_symbol(struct SymbolTable *table, int id) {
+    return table->slots[find_Slot(table, id)];
 }
 
 
@@ -102,39 +257,70 @@ void print_Symbol(struct Symbol *sym){
 
 
 void print_SymbolTable(struct SymbolTable *table){
-    struct SymbolTable *current;
+    struct Symbol *current;
 
-    current = table;
     printf("---Sym Table---\n");
-    while (current != NULL && current->head != NULL) {
-        print_Symbol(current->head);
-        current = current->next;
-    }
+    for (current = table->last; current != NULL; current = current->prev)
+        print_Symbol(current);
     printf("---End Table---\n");
 }
 
 
-void _add_symbol(struct SymbolTable **table, char *lexeme, int type) {
+struct Symbol* add_symbol(struct SymbolTable *table, int id, int type) {
     struct Symbol *new;
-    struct SymbolTable *new_head;
+    size_t i;
 
-    new = new_Sym(lexeme);
+    // Keep the table at most half full
+    if (2 * (table->count + 1) > table->cap && grow_SymbolTable(table)) {
+        log_Error("memory error while creating symbol: %s", lexeme_Of(id));
+        return NULL;
+    }
+    i = find_Slot(table, id);
+    if (table->slots[i] != NULL && table->slots[i]->scope == table->scope) {
+        table->slots[i]->type = type;
+        log_Debug("symbol type changed: %s, type %s", lexeme_Of(id), type2str(type));
+        return table->slots[i];
+    }
+
+    new = new_Sym(id);
     if (new == NULL) {
-        printf("Memory Error While Creating Symbol: %s\n", lexeme);
-        return;
+        log_Error("memory error while creating symbol: %s", lexeme_Of(id));
+        return NULL;
     }
     new->type = type;
-    new_head = alloc_SymbolTable();
-    new_head->head = new;
-    new_head->next = *table;
-    *table = new_head;
-    printf("Symbol Added Into Table: %s\n", lexeme);
-    printf("Type Assigned to Symbol %s: %s\n", lexeme, type2str(type));
+    new->scope = table->scope;
+    new->slot = table->nslots++;
+    new->outer = table->slots[i];
+    new->prev = table->last;
+    table->last = new;
+    if (table->slots[i] == NULL)
+        table->count++;
+    table->slots[i] = new;
+    log_Debug("symbol added into table: %s, type %s", new->sym, type2str(type));
+    return new;
+}
+
+
+void open_Scope(struct SymbolTable *table) {
+    table->scope++;
 }
 
 
-void add_symbol(struct SymbolTable **table, char *lexeme) {
-    _add_symbol(table, lexeme, _undef);
+void close_Scope(struct SymbolTable *table) {
+    struct Symbol *sym;
+    size_t i;
+
+    while ((sym = table->last) != NULL && sym->scope == table->scope) {
+        table->last = sym->prev;
+        i = find_Slot(table, sym->id);
+        if (sym->outer != NULL)
+            table->slots[i] = sym->outer;
+        else
+            remove_Slot(table, i);
+        free_Symbol(sym);
+    }
+    if (table->scope > 0)
+        table->scope--;
 }
 
 
@@ -160,6 +346,7 @@ void push_Context(struct ContextStack **stack, enum TokenType type) {
     if (top == NULL)
         return;
     top->top = type;
+    top->loops = (*stack == NULL ? 0 : (*stack)->loops) + (type == LoopLine);
     top->next = *stack;
     *stack = top;
 }
@@ -202,23 +389,6 @@ int len_Context(struct ContextStack *stack){
 }
 
 
-int assign_type(struct SymbolTable **table, char *lexeme, int type) {
-    struct SymbolTable *tab;
-
-    tab = *table;
-    while (tab != NULL && tab->head != NULL) {
-        if (strcmp(tab->head->sym, lexeme) == 0){
-            tab->head->type = type;
-            printf("Assigned type to identifier %s: %s\n", lexeme, type2str(type));
-            return type;
-        }
-        tab = tab->next;
-    }
-    printf("ERROR: Tried to assign type to unkown identifier: %s.\n", lexeme);
-    return UNDEFINED_SYMBOL;
-}
-
-
 int is_ComparisonOp (enum TokenType type) {
     return (type == Greater ||
             type == GreaterEq ||
@@ -249,6 +419,14 @@ int is_AritmOp (enum TokenType type) {
    ---------------
 */
 
+size_t node_Offset(struct ParseTree *node) {
+    // Source position of the first Token under node
+    while (node->child != NULL)
+        node = node->child;
+    return node->data->offset;
+}
+
+
 int _analyze_Program(struct ParseTree *node, struct SymbolTable **table, struct ContextStack **stack) {
     struct ParseTree *line;
     int status, count;
@@ -259,47 +437,76 @@ int _analyze_Program(struct ParseTree *node, struct SymbolTable **table, struct
     count = 0;
     res = NODE_OK;
     while (line != NULL){
-        printf("-----Line %d-----\n", ++count);
+        log_Debug("line %d", ++count);
         status = analyze_Line(line, table, stack);
-        printf("\n");
         if (status < 0){
-            printf("ERROR: %s\n", type2str(status));
+            log_Offset(LOG_ERROR, node_Offset(line), "line is not valid: %s", type2str(status));
             res = SEMANTIC_ERROR;
         }
         else
-            printf("OK. Type is %s\n", type2str(status));
-        printf("-----------------\n");
+            log_Debug("line %d OK, type is %s", count, type2str(status));
         // Skip Endline
         line = line->sibling->sibling;
     }
     return res;
 }
 
-int analyze_Program(struct ParseTree *node) {
-    struct SymbolTable *table;
+int analyze_Program_Table(struct ParseTree *node, struct SymbolTable **table) {
     struct ContextStack *stack;
     int res;
 
-    table = alloc_SymbolTable();
+    *table = alloc_SymbolTable();
+    if (*table == NULL)
+        return SEMANTIC_ERROR;
     stack = alloc_Context();
 
-    res = _analyze_Program(node, &table, &stack);
+    res = _analyze_Program(node, table, &stack);
 
-    free_SymbolTable(table);
     free_Context(stack);
+    if (res < 0) {
+        free_SymbolTable(*table);
+        *table = NULL;
+    }
+    return res;
+}
 
+
+int analyze_Program(struct ParseTree *node) {
+    struct SymbolTable *table;
+    int res;
+
+    res = analyze_Program_Table(node, &table);
+    free_SymbolTable(table);
     return res;
 }
 
 
+int type_Of(struct ParseTree *node, struct SymbolTable *table) {
+    // The analysis already passed: this only computes the type again, nothing is logged
+    switch (node->data->type) {
+        case Expr: return analyze_Expr(node, &table, NULL);
+        case Pred: return analyze_Pred(node, &table, NULL);
+        case Term: return analyze_Term(node, &table, NULL);
+        case BaseExpr: return analyze_BaseExpr(node, &table, NULL);
+        case Obj: return analyze_Obj(node, &table, NULL);
+        case ListExpr: return analyze_ListExpr(node, &table, NULL);
+        case Var: return analyze_Var(node, &table);
+        case ListElem: return analyze_ListElem(node, &table);
+        default: return NODE_TYPE_ERROR;
+    }
+}
+
+
 int analyze_Var(struct ParseTree *node, struct SymbolTable **table) {
     struct Symbol* found;
 
-    found = search_symbol(*table, node->data->lexeme);
+    found = search_symbol(*table, node->data->id);
     // found contains the _type of the symbol, or UNDEFINED
-    if (found != NULL)
+    if (found != NULL) {
+        node->slot = found->slot;
         return found->type;
-    printf("Variable Symbol Not Found In Symbol Table: %s\n", node->data->lexeme);
+    }
+    log_Offset(LOG_ERROR, node->data->offset, "variable not found in symbol table: %s", lexeme_Of(node->data->id));
     return UNDEFINED_SYMBOL;
 }
 
@@ -313,7 +520,7 @@ int analyze_List(struct ParseTree *node, struct SymbolTable **table, struct Symb
     if (type < 0)
         return type;
     if (sym != NULL){
-        printf("Setting List Type to %s: %s\n", type2str(type), (*sym)->sym);
+        log_Debug("setting list type to %s: %s", type2str(type), (*sym)->sym);
         (*sym)->list_type = type;
     }
     return _list;
@@ -336,28 +543,53 @@ int analyze_Num(struct ParseTree *tree) {
 }
 
 
+int analyze_Str(struct ParseTree *node, struct SymbolTable **table) {
+    // The objects put into the string must be defined
+    struct ParseTree *piece, *arg;
+    int type;
+
+    for (piece = node->child; piece != NULL; piece = piece->sibling) {
+        if (piece->data->type != QuotedStr)
+            continue;
+        for (arg = piece->child->sibling; arg != NULL; arg = arg->sibling) {
+            if (arg->data->type != Obj)
+                continue;
+            type = analyze_Obj(arg, table, NULL);
+            if (type < 0)
+                return type;
+        }
+    }
+    return _string;
+}
+
+
 int analyze_Obj(struct ParseTree *tree, struct SymbolTable **table, struct Symbol **sym) {
     struct ParseTree *node;
-    int list_type;
+    int type;
 
     node = tree->child; // Obj always have 1 child
     if (node->data->type == Num)
-        return analyze_Num(node);
-    if (node->data->type == Str)
-        return _string;
-    if (node->data->type == Null)
-        return _null;
-    if (node->data->type == Bool)
-        return _bool;
-    if (node->data->type == Var)
-        return analyze_Var(node, table);
-    if (node->data->type == ListElem)
-        return analyze_ListElem(node, table);
-    if (node->data->type == List)
-        return analyze_List(node, table, sym);
-    printf("Leaf (Obj) Token Type Not Recognized\n");
-    print_ParseTree(node);
-    return NODE_TYPE_ERROR;
+        type = analyze_Num(node);
+    else if (node->data->type == Str)
+        type = analyze_Str(node, table);
+    else if (node->data->type == Null)
+        type = _null;
+    else if (node->data->type == Bool)
+        type = _bool;
+    else if (node->data->type == Var)
+        type = analyze_Var(node, table);
+    else if (node->data->type == ListElem)
+        type = analyze_ListElem(node, table);
+    else if (node->data->type == List)
+        type = analyze_List(node, table, sym);
+    else {
+        log_Offset(LOG_ERROR, node_Offset(node), "leaf (Obj) Token type not recognized");
+        if (log_Level >= LOG_DEBUG)
+            print_ParseTree(node);
+        return NODE_TYPE_ERROR;
+    }
+    tree->value_type = type;
+    return type;
 }
 
 
@@ -366,38 +598,47 @@ int analyze_BaseExpr(struct ParseTree *node, struct SymbolTable **table, struct
 
     child = node->child;
     if (child->data->type == Obj)
-        return analyze_Obj(child, table, sym);
-    // else must be Lpar '(' and sub expression
-    child = child->sibling;
-    return analyze_Expr(child, table, sym);
+        node->value_type = analyze_Obj(child, table, sym);
+    else
+        // else must be Lpar '(' and sub expression
+        node->value_type = analyze_Expr(child->sibling, table, sym);
+    return node->value_type;
 }
 
 
+/*
+ * Term, Pred and Expr are chains: operand (op operand)*
+ * The type of the chain is computed from the left, one operator at a time.
+*/
+
+
 int analyze_Term(struct ParseTree *node, struct SymbolTable **table, struct Symbol **sym) {
     struct ParseTree *child, *op;
     int type1, type2, result;
 
     child = node->child;
-    type1 = analyze_BaseExpr(child, table, sym);
-    if (type1 < 0)
-        return type1;
-    if (child->sibling == NULL)
-        return type1;
-    op = child->sibling; // save the operator
-    type2 = analyze_Term(op->sibling, table, sym);
-    if (type2 < 0)
-        return type2;
-
-    // Now compute the result type
-    if (is_AritmOp(op->data->type))
-        if (op->data->type == FloatDiv)
-            result = resultType_FloatDiv[type1][type2];
+    result = analyze_BaseExpr(child, table, sym);
+    while (result >= 0 && child->sibling != NULL) {
+        op = child->sibling; // save the operator
+        child = op->sibling;
+        type1 = result;
+        type2 = analyze_BaseExpr(child, table, sym);
+        if (type2 < 0)
+            return type2;
+
+        // Now compute the result type
+        if (is_AritmOp(op->data->type))
+            if (op->data->type == FloatDiv)
+                result = resultType_FloatDiv[type1][type2];
+            else
+                result = resultType_aritm[type1][type2];
         else
-            result = resultType_aritm[type1][type2];
-    else
-        result = NODE_TYPE_ERROR;
-    if (result == _undef)
-        printf("Operation %s not defined for types: %s, %s\n", op->data->lexeme, type2str(type1), type2str(type2));
+            result = NODE_TYPE_ERROR;
+        if (result == _undef)
+            log_Offset(LOG_ERROR, op->data->offset, "operation %.*s not defined for types: %s, %s",
+                       (int) op->data->len, op->data->lexeme, type2str(type1), type2str(type2));
+    }
+    node->value_type = result;
     return result;
 }
 
@@ -407,92 +648,108 @@ int analyze_Pred(struct ParseTree *node, struct SymbolTable **table, struct Symb
     int type1, type2, result;
 
     child = node->child;
-    type1 = analyze_Term(child, table, sym);
-    if (type1 < 0)
-        return type1;
-    if (child->sibling == NULL)
-        return type1;
-    op = child->sibling; // save the operator
-    type2 = analyze_Pred(op->sibling, table, sym);
-    if (type2 < 0)
-        return type2;
-
-    // Now compute the result type
-    if (op->data->type == Plus || op->data->type == Minus)
-        result = resultType_aritm[type1][type2];
-    else
-        result = NODE_TYPE_ERROR;
-    if (result == _undef)
-        printf("Operation %s not defined for types: %s, %s\n", op->data->lexeme, type2str(type1), type2str(type2));
+    result = analyze_Term(child, table, sym);
+    while (result >= 0 && child->sibling != NULL) {
+        op = child->sibling; // save the operator
+        child = op->sibling;
+        type1 = result;
+        type2 = analyze_Term(child, table, sym);
+        if (type2 < 0)
+            return type2;
+
+        // Now compute the result type
+        if (op->data->type == Plus || op->data->type == Minus)
+            result = resultType_aritm[type1][type2];
+        else
+            result = NODE_TYPE_ERROR;
+        if (result == _undef)
+            log_Offset(LOG_ERROR, op->data->offset, "operation %.*s not defined for types: %s, %s",
+                       (int) op->data->len, op->data->lexeme, type2str(type1), type2str(type2));
+    }
+    node->value_type = result;
     return result;
 }
 
 
 int analyze_Expr(struct ParseTree *node, struct SymbolTable **table, struct Symbol **sym){
+    /*
+     * Typed as Python groups the generated code: each comparison is between
+     * the operands next to it (a < b < c is a < b and b < c),
+     * and `and`, `or` join the groups of comparisons.
+    */
     struct ParseTree *child, *op;
-    int type1, type2, result;
+    int left, right, group, result, joined;
 
     child = node->child;
-    type1 = analyze_Pred(child, table, sym);
-    if (type1 < 0){
-        printf("Sub Expression Ill-Formed ");
-        if (sym != NULL)
-            printf("For Symbol: %s\n", (*sym)->sym);
-        else
-            printf("\n");
-        return type1;
-    }
-    if (child->sibling == NULL)
-        return type1;
-    op = child->sibling; // save the operator
-    type2 = analyze_Expr(op->sibling, table, sym);
-    if (type2 < 0){
-        printf("Sub Expression Ill-Formed ");
-        if (sym != NULL)
-            printf("For Symbol: %s\n", (*sym)->sym);
+    left = analyze_Pred(child, table, sym);
+    if (left < 0){
+        log_Debug("sub expression ill-formed for symbol: %s", sym != NULL ? (*sym)->sym : "-");
+        return left;
+    }
+    group = result = left;
+    joined = 0;
+    while (group >= 0 && result >= 0 && child->sibling != NULL) {
+        op = child->sibling; // save the operator
+        child = op->sibling;
+        right = analyze_Pred(child, table, sym);
+        if (right < 0){
+            log_Debug("sub expression ill-formed for symbol: %s", sym != NULL ? (*sym)->sym : "-");
+            return right;
+        }
+        // Now compute the result type
+        if (op->data->type == And || op->data->type == Or) {
+            result = joined ? resultType_logic[result][group] : group;
+            joined = 1;
+            group = right;
+        }
+        else if (is_ComparisonOp(op->data->type))
+            group = resultType_compare[left][right];
+        else if (is_LogicOp(op->data->type))
+            group = resultType_logic[left][right];
         else
-            printf("\n");
-        return type2;
-    }
-    // Now compute the result type
-    if (is_ComparisonOp(op->data->type))
-        result = resultType_compare[type1][type2];
-    else if (is_LogicOp(op->data->type))
-        result = resultType_logic[type1][type2];
-    else
-        result = NODE_TYPE_ERROR;
+            group = NODE_TYPE_ERROR;
+        left = right;
+    }
+    if (joined && result >= 0 && group >= 0)
+        result = resultType_logic[result][group];
+    else if (! joined || group < 0)
+        result = group;
+    node->value_type = result;
     return result;
 }
 
-
 int analyze_ListElem(struct ParseTree *node, struct SymbolTable **table) {
-    char *var;
+    const char *var;
     struct ParseTree *idx;
     struct Symbol *found, *found_idx;
 
-    var = node->child->data->lexeme;
-    found = search_symbol(*table, var);
+    var = lexeme_Of(node->child->data->id);
+    found = search_symbol(*table, node->child->data->id);
     if (found == NULL){
-        printf("List Name Not Found In Symbol Table: %s\n", var);
+        log_Offset(LOG_ERROR, node_Offset(node), "list name not found in symbol table: %s", var);
         return UNDEFINED_SYMBOL;
     }
     else if (found->type != _list){
-        printf("Identifier is not a list: %s\n", var);
+        log_Offset(LOG_ERROR, node_Offset(node), "identifier is not a list: %s", var);
         return NODE_TYPE_ERROR;
     }
     else {
         idx = node->child->sibling->sibling;
         if (idx->data->type == Var) {
-            found_idx = search_symbol(*table, idx->data->lexeme);
+            found_idx = search_symbol(*table, idx->data->id);
             if (found_idx == NULL){
-                printf("Index For List %s is Undefined Symbol: %s\n", var, idx->data->lexeme);
+                log_Offset(LOG_ERROR, idx->data->offset, "index for list %s is undefined symbol: %s",
+                           var, lexeme_Of(idx->data->id));
                 return UNDEFINED_SYMBOL;
             }
             else if (found_idx->type != _int){
-                printf("List %s Indexes Must Be Int, it is %s\n", var, type2str(found_idx->type));
+                log_Offset(LOG_ERROR, idx->data->offset, "list %s indexes must be int, it is %s",
+                           var, type2str(found_idx->type));
                 return NODE_TYPE_ERROR;
             }
+            idx->slot = found_idx->slot;
         }
+        node->child->slot = found->slot;
         return found->list_type;
     }
 }
@@ -526,34 +783,38 @@ int analyze_ListExpr(struct ParseTree *node, struct SymbolTable **table, struct
                     return LIST_TYPE_ERROR;
         curr_obj = curr_obj->sibling;
     }
+    node->value_type = type;
     return type;
 }
 
 
 int analyze_Assign(struct ParseTree *node, struct SymbolTable **table) {
     struct ParseTree *var, *expr;
-    int found_var, valid_expr;
+    int valid_expr;
     struct Symbol *sym;
 
     var = node->child;
     expr = var->sibling->sibling;
 
-    found_var = analyze_Var(var, table);
-    if (found_var == UNDEFINED_SYMBOL)
-        add_symbol(table, var->data->lexeme);
-
-    sym = search_symbol(*table, var->data->lexeme);
+    // A new identifier is not an error here: it is being defined
+    sym = search_symbol(*table, var->data->id);
+    if (sym == NULL)
+        sym = add_symbol(*table, var->data->id, _undef);
+    if (sym == NULL)
+        return SEMANTIC_ERROR;
+    var->slot = sym->slot;
     valid_expr = analyze_Expr(expr, table, &sym);
     if (valid_expr < 0){
-        printf("Expression is not valid\n");
+        log_Debug("expression is not valid");
         return valid_expr;
     }
     if (sym->type != _undef && valid_expr != sym->type){
-        printf("ERROR: Cannot Modify Type for Identifier %s to %s. It was %s.\n",
-               var->data->lexeme, type2str(valid_expr), type2str(sym->type));
+        log_Offset(LOG_ERROR, var->data->offset, "cannot modify type for identifier %s to %s, it was %s",
+                   sym->sym, type2str(valid_expr), type2str(sym->type));
         return OVERWRITE_TYPE_ERROR;
     }
-    assign_type(table, var->data->lexeme, valid_expr);
+    sym->type = valid_expr;
+    log_Debug("assigned type to identifier %s: %s", sym->sym, type2str(valid_expr));
     return valid_expr;
 }
 
@@ -565,26 +826,27 @@ int analyze_Input(struct ParseTree *node, struct SymbolTable **table) {
 
     readin = node->child;
     var = readin->sibling;
-    if (strcmp(readin->data->lexeme, "readInt") == 0)
-        type = _int;
-    else if (strcmp(readin->data->lexeme, "readFloat") == 0)
-        type = _float;
-    else if (strcmp(readin->data->lexeme, "readStr") == 0)
-        type = _string;
-    else if (strcmp(readin->data->lexeme, "readBool") == 0)
-        type = _bool;
-    else
-        type = _undef;
+    switch (readin->data->id) {
+        case ID_READINT: type = _int; break;
+        case ID_READFLOAT: type = _float; break;
+        case ID_READSTR: type = _string; break;
+        case ID_READBOOL: type = _bool; break;
+        default: type = _undef;
+    }
 
-    found = search_symbol(*table, var->data->lexeme);
+    found = search_symbol(*table, var->data->id);
     if (found != NULL && type != found->type){
-        printf("ERROR: Cannot Modify Type for Identifier %s to %s. It was %s.\n",
-               var->data->lexeme, type2str(type), type2str(found->type));
+        log_Offset(LOG_ERROR, var->data->offset, "cannot modify type for identifier %s to %s, it was %s",
+                   found->sym, type2str(type), type2str(found->type));
         return OVERWRITE_TYPE_ERROR;
     }
     if (type == _undef)
-        printf("WARNING: Identifier Will Have Undefined Type: %s\n", var->data->lexeme);
-    _add_symbol(table, var->data->lexeme, type);
+        log_Offset(LOG_WARNING, var->data->offset, "identifier will have undefined type: %s", lexeme_Of(var->data->id));
+    // Reading it again keeps the same symbol
+    found = add_symbol(*table, var->data->id, type);
+    if (found == NULL)
+        return SEMANTIC_ERROR;
+    var->slot = found->slot;
     return type;
 }
 
@@ -605,7 +867,7 @@ int analyze_ifCond(struct ParseTree *node, struct SymbolTable **table) {
     expr = node->child->sibling;
     res = analyze_Expr(expr, table, NULL);
     if (res != _bool){
-        printf("ERROR. If Condition Must Be Boolean Expression: %s\n", type2str(res));
+        log_Offset(LOG_ERROR, node_Offset(expr), "condition must be a boolean expression: %s", type2str(res));
         return NODE_TYPE_ERROR;
     }
     return res;
@@ -621,7 +883,7 @@ int analyze_OptElse(struct ParseTree *node, struct SymbolTable **table, struct C
     while (line != NULL){
         res = analyze_Line(line, table, stack);
         if (res < 0){
-            printf("ERROR In Else Body\n");
+            log_Debug("error in else body");
             return res;
         }
         // Skip Endline
@@ -640,7 +902,7 @@ int analyze_ifBody(struct ParseTree *node, struct SymbolTable **table, struct Co
     while (line != NULL){
         res = analyze_Line(line, table, stack);
         if (res < 0){
-            printf("ERROR In IfBody\n");
+            log_Debug("error in IfBody");
             return res;
         }
         // Skip Endline
@@ -665,11 +927,11 @@ int analyze_IfLine(struct ParseTree *node, struct SymbolTable **table, struct Co
     pop_Context(stack);
 
     if (res_cond < 0){
-        printf("If Condition Ill-Formed: %s\n", type2str(res_cond));
+        log_Debug("if condition ill-formed: %s", type2str(res_cond));
         return res_cond;
     }
     if (res_body < 0){
-        printf("If Body Ill-Formed: %s\n", type2str(res_cond));
+        log_Debug("if body ill-formed: %s", type2str(res_body));
         return res_body;
     }
     return NODE_OK;
@@ -677,17 +939,21 @@ int analyze_IfLine(struct ParseTree *node, struct SymbolTable **table, struct Co
 
 
 int analyze_BreakLine(struct ParseTree *node, struct SymbolTable **table, struct ContextStack **stack) {
-    // 'break' allowed only in conditionals and loops
-    if ((*stack)->top != IfLine && (*stack)->top != LoopLine)
+    // 'break' allowed only in a loop, also inside the conditionals of its body
+    if (*stack == NULL || (*stack)->loops == 0) {
+        log_Offset(LOG_ERROR, node_Offset(node), "break out of a loop");
         return BREAK_OUT_OF_CONTEXT;
+    }
     return NODE_OK;
 }
 
 
 int analyze_ContinueLine(struct ParseTree *node, struct SymbolTable **table, struct ContextStack **stack) {
-    // 'continue' allowed only in conditionals and loops
-    if ((*stack)->top != IfLine && (*stack)->top != LoopLine)
+    // 'continue' allowed only in a loop, also inside the conditionals of its body
+    if (*stack == NULL || (*stack)->loops == 0) {
+        log_Offset(LOG_ERROR, node_Offset(node), "continue out of a loop");
         return CONTINUE_OUT_OF_CONTEXT;
+    }
     return NODE_OK;
 }
 
@@ -703,11 +969,11 @@ int analyze_LoopLine(struct ParseTree *node, struct SymbolTable **table, struct
     pop_Context(stack);
 
     if (res_cond < 0){
-        printf("Loop Condition Ill-Formed: %s\n", type2str(res_cond));
+        log_Debug("loop condition ill-formed: %s", type2str(res_cond));
         return res_cond;
     }
     if (res_body < 0){
-        printf("Loop Body Ill-Formed: %s\n", type2str(res_cond));
+        log_Debug("loop body ill-formed: %s", type2str(res_body));
         return res_body;
     }
     return NODE_OK;
@@ -741,43 +1007,3 @@ int analyze_Line(struct ParseTree *node, struct SymbolTable **table, struct Cont
     else
         return NODE_OK;
 }
-
-
-int main(int argc, char* argv[]){
-    struct SymbolTable *table;
-    struct ContextStack *stack;
-    char sym;
-    struct ParseTree *tree, *assign1, *line2, *assign3;
-    int parser, semantic;
-
-    if (argc < 2) {
-        printf("Expecting exactly 1 argument: file path.\n");
-        return -1;
-    }
-    char const* const fileName = argv[1];
-
-    tree = alloc_ParseTree();
-    if (tree == NULL)
-        return MEMORY_ERROR;
-
-    parser = build_ParseTree_FromFile(fileName, &tree);
-
-    print_ParseTree(tree);
-
-    if (parser != SUBTREE_OK){
-        printf("PARSING ERROR\n");
-        free_ParseTree(tree);
-        return -1;
-    }
-
-    semantic = analyze_Program(tree);
-
-    if (semantic < 0){
-        printf("SEMANTIC ERROR\n");
-        free_ParseTree(tree);
-        return -1;
-    }
-
-    free_ParseTree(tree);
-    return 0;
-}
@@ -1,3 +1,6 @@
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
 #include "parser.h"
 
 #define _int 0
@@ -18,87 +21,39 @@
 #define CONTINUE_OUT_OF_CONTEXT -6
 #define OVERWRITE_TYPE_ERROR -7
 
-
-int resultType_aritm [6][6] = {
-    /*
-     Valid for + - * /
-     Row index is 1st operand type.
-     Col index is 2nd operand type.
-     Value is the result type of the operation,
-     or _undef if the operation is impossible.
-    */
-
-    /*             int       float    null    string    bool    list*/
-    /* int   */ { _int,     _float,  _undef,  _undef,  _undef, _undef},
-    /* float */ { _float,   _float,  _undef,  _undef,  _undef, _undef},
-    /* string */{ _undef,   _undef,  _undef,  _undef,  _undef, _undef},
-    /* bool  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
-    /* null  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
-    /* list  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef}
-};
-
-int resultType_FloatDiv [6][6] = {
-    /*
-     Valid for /.
-    */
-
-    /*             int       float    null    string    bool    list*/
-    /* int   */ { _float,   _float,  _undef,  _undef,  _undef, _undef},
-    /* float */ { _float,   _float,  _undef,  _undef,  _undef, _undef},
-    /* string */{ _undef,   _undef,  _undef,  _undef,  _undef, _undef},
-    /* bool  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
-    /* null  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
-    /* list  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef}
-};
-
-
-int resultType_compare [6][6] = {
-    /*
-     Valid for < > <= >=
-     Row index is 1st operand type.
-     Col index is 2nd operand type.
-     Value is the result type of the operation,
-     or _undef if the operation is impossible.
-    */
-    /*             int       float    null    string    bool    list*/
-    /* int   */ { _bool,    _bool,   _undef,  _undef,  _undef, _undef},
-    /* float */ { _bool,    _bool,   _undef,  _undef,  _undef, _undef},
-    /* string */{ _undef,   _undef,  _undef,  _undef,  _undef, _undef},
-    /* bool  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
-    /* null  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef},
-    /* list  */ { _undef,   _undef,  _undef,  _undef,  _undef, _undef}
-};
-
-
-int resultType_logic [6][6] = {
-    /*
-     Valid for && || != ==
-     Row index is 1st operand type.
-     Col index is 2nd operand type.
-     Value is the result type of the operation,
-     or _undef if the operation is impossible.
-    */
-    /*             int       float    null    string    bool    list */
-    /* int   */ { _bool,    _bool,   _bool,   _bool,   _bool,  _undef},
-    /* float */ { _bool,    _bool,   _bool,   _bool,   _bool,  _undef},
-    /* string */{ _bool,    _bool,   _bool,   _bool,   _bool,  _undef},
-    /* bool  */ { _bool,    _bool,   _bool,   _bool,   _bool,  _undef},
-    /* null  */ { _bool,    _bool,   _bool,   _bool,   _bool,  _undef},
-    /* list  */ { _undef,   _undef,  _undef,  _undef,  _undef, _bool}
-};
+// Type of the result of each operation, by the types of its operands (see semantic.c)
+extern int resultType_aritm[6][6];
+extern int resultType_FloatDiv[6][6];
+extern int resultType_compare[6][6];
+extern int resultType_logic[6][6];
 
 
 struct Symbol {
-    char *sym;
+    const char *sym; // the interned spelling
+    int id; // interned id of the identifier
     int type;
     int list_type; // type of each element if list
+    int scope; // depth of the scope that defined it
+    int slot; // place of its value in a frame: each symbol has its own
+    struct Symbol *outer; // the symbol with the same name that it hides, if any
+    struct Symbol *prev; // defined right before this one
 };
 
 
+/*
+ * Hash table with open addressing and linear probing, on the interned ids.
+ * A slot holds the innermost symbol of its name: the ones it hides
+ * come back when its scope is closed.
+ * The language has the scoping of Python (if and while do not open a scope)
+ * so analyze_Program only uses the outermost one.
+*/
 struct SymbolTable {
-    // currently implemented as a linked list
-    struct Symbol *head;
-    struct SymbolTable *next;
+    struct Symbol **slots; // NULL if empty
+    size_t cap; // a power of 2
+    size_t count; // slots in use
+    int scope; // depth of the current scope, 0 for the outermost
+    struct Symbol *last; // last symbol defined
+    int nslots; // slots given to the symbols so far, hidden ones too: the size of a frame
 };
 
 
@@ -106,13 +61,33 @@ struct ContextStack {
     // will contain the context given by TokenType
     // e.g., Program, LoopLine, etc.
     enum TokenType top;
+    int loops; // LoopLine contexts from this one down
     struct ContextStack *next;
 };
 
 
-struct Symbol* new_Sym(char *sym);
+struct Symbol* new_Sym(int id);
 struct SymbolTable* alloc_SymbolTable();
-struct Symbol* search_symbol(struct SymbolTable *table, char *lexeme);
+void free_SymbolTable(struct SymbolTable *table);
+struct Symbol* search_symbol(struct SymbolTable *table, int id);
+
+/*
+ * Slot where the probes for the id start, in a table of mask + 1 slots.
+*/
+size_t home_Slot(int id, size_t mask);
+
+/*
+ * Define a symbol in the current scope, or give a new type to the one that is there already.
+ * Return the symbol, or NULL on memory error.
+*/
+struct Symbol* add_symbol(struct SymbolTable *table, int id, int type);
+
+void open_Scope(struct SymbolTable *table);
+
+/*
+ * Drop the symbols of the current scope, the ones they hid are visible again.
+*/
+void close_Scope(struct SymbolTable *table);
 
 void push_Context(struct ContextStack **stack, enum TokenType type);
 enum TokenType pop_Context(struct ContextStack **stack);
@@ -121,3 +96,27 @@ struct ContextStack* alloc_Context();
 void print_Context(struct ContextStack *stack);
 
 int analyze_Program(struct ParseTree *node);
+
+const char* type2str(int type);
+
+/*
+ * Source position of the first Token under node, for the messages.
+*/
+size_t node_Offset(struct ParseTree *node);
+
+/*
+ * Same as analyze_Program, and give back the symbols with their types
+ * (NULL if the analysis failed). The caller must free_SymbolTable it.
+ * The tree is annotated on the way: each Var gets the slot of its symbol,
+ * and each Expr, Pred, Term, BaseExpr, Obj and ListExpr its value_type.
+*/
+int analyze_Program_Table(struct ParseTree *node, struct SymbolTable **table);
+
+/*
+ * Type (_int, _float, ...) of an Expr, Pred, Term, BaseExpr, Obj, ListExpr, Var or ListElem
+ * of a program that passed the analysis, with the symbols of analyze_Program_Table.
+ * For a ListExpr it is the type of the elements.
+*/
+int type_Of(struct ParseTree *node, struct SymbolTable *table);
+
+#endif
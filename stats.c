@@ -0,0 +1,161 @@
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "stats.h"
+
+const char* phase_Names[N_PHASES] = {"lex", "parse", "semantic", "opt", "cgen", "run"};
+
+size_t alloc_Count;
+size_t alloc_Bytes;
+
+
+#ifdef STATS_ALLOC
+/*
+ * Opt-in: build with -DSTATS_ALLOC and link with
+ * -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+ * The linker sends the calls of the linked modules here, and these forward
+ * them to the allocator of the C library, which also gets the calls to free.
+ * Without the flag nothing is counted, and the allocator is not touched.
+*/
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+void count_Alloc(size_t size) {
+    // The parallel lexer allocates from several threads
+    __atomic_fetch_add(&alloc_Count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&alloc_Bytes, size, __ATOMIC_RELAXED);
+}
+
+void* __wrap_malloc(size_t size) {
+    count_Alloc(size);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    count_Alloc(n * size);
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* p, size_t size) {
+    count_Alloc(size);
+    return __real_realloc(p, size);
+}
+#endif
+
+
+size_t count_Allocs() {
+    return __atomic_load_n(&alloc_Count, __ATOMIC_RELAXED);
+}
+
+
+size_t count_AllocBytes() {
+    return __atomic_load_n(&alloc_Bytes, __ATOMIC_RELAXED);
+}
+
+
+double wall_Time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+double cpu_Time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+long peak_RSS() {
+    // KiB on Linux
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss;
+}
+
+
+void init_Stats(struct Stats* stats) {
+    memset(stats, 0, sizeof(struct Stats));
+}
+
+
+void begin_Phase(struct Stats* stats, enum Phase phase) {
+    struct PhaseStats* p = &stats->phase[phase];
+    p->allocs0 = count_Allocs();
+    p->bytes0 = count_AllocBytes();
+    p->cpu0 = cpu_Time();
+    p->wall0 = wall_Time();
+}
+
+
+void end_Phase(struct Stats* stats, enum Phase phase) {
+    struct PhaseStats* p = &stats->phase[phase];
+    p->wall += wall_Time() - p->wall0;
+    p->cpu += cpu_Time() - p->cpu0;
+    p->allocs += count_Allocs() - p->allocs0;
+    p->bytes += count_AllocBytes() - p->bytes0;
+    p->rss = peak_RSS();
+    p->ran = 1;
+}
+
+
+void total_Stats(struct Stats* stats, struct PhaseStats* total) {
+    int i;
+    memset(total, 0, sizeof(struct PhaseStats));
+    for (i = 0; i < N_PHASES; i++) {
+        if (! stats->phase[i].ran)
+            continue;
+        total->wall += stats->phase[i].wall;
+        total->cpu += stats->phase[i].cpu;
+        total->allocs += stats->phase[i].allocs;
+        total->bytes += stats->phase[i].bytes;
+    }
+    total->rss = peak_RSS();
+}
+
+
+void print_Stats(struct Stats* stats, FILE* fp) {
+    struct PhaseStats total, *p;
+    int i;
+
+    total_Stats(stats, &total);
+    fprintf(fp, "%-10s %10s %10s %10s %12s %10s\n",
+            "phase", "wall ms", "cpu ms", "allocs", "alloc KiB", "RSS KiB");
+    for (i = 0; i < N_PHASES; i++) {
+        p = &stats->phase[i];
+        if (! p->ran)
+            continue;
+        fprintf(fp, "%-10s %10.3f %10.3f %10zu %12.1f %10ld\n", phase_Names[i],
+                p->wall * 1e3, p->cpu * 1e3, p->allocs, p->bytes / 1024.0, p->rss);
+    }
+    fprintf(fp, "%-10s %10.3f %10.3f %10zu %12.1f %10ld\n", "total",
+            total.wall * 1e3, total.cpu * 1e3, total.allocs, total.bytes / 1024.0, total.rss);
+    fprintf(fp, "source %zu bytes, %zu lines, %zu tokens, %zu nodes, output %zu bytes\n",
+            stats->source, stats->lines, stats->tokens, stats->nodes, stats->output);
+}
+
+
+void print_StatsJSON(struct Stats* stats, FILE* fp) {
+    struct PhaseStats total, *p;
+    int i, first;
+
+    total_Stats(stats, &total);
+    fprintf(fp, "{\"phases\": {");
+    first = 1;
+    for (i = 0; i < N_PHASES; i++) {
+        p = &stats->phase[i];
+        if (! p->ran)
+            continue;
+        fprintf(fp, "%s\"%s\": {\"wall\": %.6f, \"cpu\": %.6f, \"allocs\": %zu, \"bytes\": %zu, \"rss_kib\": %ld}",
+                first ? "" : ", ", phase_Names[i], p->wall, p->cpu, p->allocs, p->bytes, p->rss);
+        first = 0;
+    }
+    fprintf(fp, "}, \"total\": {\"wall\": %.6f, \"cpu\": %.6f, \"allocs\": %zu, \"bytes\": %zu, \"rss_kib\": %ld}",
+            total.wall, total.cpu, total.allocs, total.bytes, total.rss);
+    fprintf(fp, ", \"source\": %zu, \"lines\": %zu, \"tokens\": %zu, \"nodes\": %zu, \"output\": %zu}",
+            stats->source, stats->lines, stats->tokens, stats->nodes, stats->output);
+}
@@ -0,0 +1,70 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Phases of a compilation, in order.
+ * PHASE_LEX also reads the source and drops the whitespaces:
+ * the Reader does the three at once (see read_Token).
+ * In the same way PHASE_CGEN writes the code to the output file as it goes.
+ * PHASE_OPT is the SSA middle end, with --opt: lowering, passes and checks.
+ * PHASE_RUN is the program itself, with --run or --interp.
+*/
+enum Phase {
+    PHASE_LEX,
+    PHASE_PARSE,
+    PHASE_SEMANTIC,
+    PHASE_OPT,
+    PHASE_CGEN,
+    PHASE_RUN,
+    N_PHASES
+};
+
+extern const char* phase_Names[N_PHASES];
+
+struct PhaseStats {
+    int ran;
+    double wall; // seconds
+    double cpu; // seconds of CPU used by the process
+    size_t allocs; // calls to malloc, calloc and realloc
+    size_t bytes; // bytes asked to them
+    long rss; // peak resident set size at the end of the phase, in KiB
+    // private: values at begin_Phase
+    double wall0, cpu0;
+    size_t allocs0, bytes0;
+};
+
+struct Stats {
+    struct PhaseStats phase[N_PHASES];
+    size_t source; // bytes of the source
+    size_t tokens;
+    size_t nodes; // of the ParseTree
+    size_t lines; // of the program
+    size_t output; // bytes of the generated code
+};
+
+void init_Stats(struct Stats* stats);
+
+void begin_Phase(struct Stats* stats, enum Phase phase);
+
+void end_Phase(struct Stats* stats, enum Phase phase);
+
+/*
+ * Allocations made by the process so far. They are counted only when
+ * stats.c is built with STATS_ALLOC (see there): otherwise they stay 0.
+ * Memory given back with free is not subtracted.
+*/
+size_t count_Allocs();
+size_t count_AllocBytes();
+
+/*
+ * Print the phases that ran, and the totals, as a table or as a JSON object.
+ * The JSON object is not followed by a newline.
+*/
+void print_Stats(struct Stats* stats, FILE* fp);
+
+void print_StatsJSON(struct Stats* stats, FILE* fp);
+
+#endif
@@ -3,7 +3,7 @@
 
 #include "../parser.h"
 
-// gcc test_1.c ../parser.c ../lexer.c -o test_1.out
+// gcc test_1.c ../parser.c ../lexer.c ../log.c -o test_1.out
 
 
 int main() {
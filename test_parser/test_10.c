@@ -3,7 +3,7 @@
 
 #include "../parser.h"
 
-// gcc test_10.c ../parser.c ../lexer.c -o test_10.out
+// gcc test_10.c ../parser.c ../lexer.c ../log.c -o test_10.out
 
 
 int assert_SimpleTerm(struct ParseTree *subtree, enum TokenType terminal);
@@ -50,7 +50,7 @@ int main() {
     tmp = tmp->child->child->sibling;
     assert(tmp->data->type == FloatDiv);
     tmp = tmp->sibling;
-    assert_SimpleTerm(tmp, Var);
+    assert_SimpleBase(tmp, Var);
 
     tmp = walk->child->sibling;
     assert(tmp->data->type == GreaterEq);
@@ -58,40 +58,41 @@ int main() {
 
     tmp = tmp->sibling; // big branch
 
-    assert(tmp->data->type == Expr);
+    assert(tmp->data->type == Pred);
+    assert(tmp->sibling == NULL);
     walk = tmp;
 
     tmp = tmp->child;
-    assert_SimplePred(tmp, Var);
-    tmp = tmp->child->child; // base expr
+    assert(tmp->data->type == Term);
+    tmp = tmp->child; // base expr
+    assert_SimpleBase(tmp, Var);
     tmp = tmp->sibling;
     assert(tmp->data->type == Star);
     tmp = tmp->sibling;
-    assert(tmp->data->type == Term);
     assert(tmp->sibling == NULL);
-    tmp = tmp->child;
     assert_ComplExpr(tmp);
     tmp = tmp->child->sibling; // the expr
     tmp = tmp->child;
-    assert_SimplePred(tmp, Var);
-    tmp = tmp->child->sibling;
+    assert(tmp->data->type == Pred);
+    tmp = tmp->child;
+    assert_SimpleTerm(tmp, Var);
+    tmp = tmp->sibling;
     assert(tmp->data->type == Plus);
     tmp = tmp->sibling;
-    assert_SimplePred(tmp, Var);
+    assert_SimpleTerm(tmp, Var);
+    assert(tmp->sibling == NULL);
 
-    tmp = walk->child->child->sibling; // !!
+    // Operands of the same precedence are siblings: b * (c+d) - f * (...)
+    tmp = walk->child->sibling;
     assert(tmp->data->type == Minus);
     tmp = tmp->sibling;
-    assert(tmp->data->type == Pred);
-    tmp = tmp->child;
     assert(tmp->data->type == Term);
+    assert(tmp->sibling == NULL);
     tmp = tmp->child;
     assert_SimpleBase(tmp, Var);
     tmp = tmp->sibling;
     assert(tmp->data->type == Star);
     tmp = tmp->sibling;
-    assert(tmp->data->type == Term);
-    tmp = tmp->child;
     assert_ComplExpr(tmp);
     // ...
 
@@ -3,7 +3,7 @@
 
 #include "../parser.h"
 
-// gcc test_11.c ../parser.c ../lexer.c -o test_11.out
+// gcc test_11.c ../parser.c ../lexer.c ../log.c -o test_11.out
 
 
 int assert_SimplePred(struct ParseTree *subtree, enum TokenType terminal);
@@ -48,13 +48,15 @@ int main() {
     walk = walk->child;
     assert(walk->sibling->data->type == Plus);
     walk = walk->sibling->sibling;
-    assert_SimplePred(walk, Var);
+    assert(walk->data->type == Term);
+    assert(walk->child->data->type == BaseExpr);
+    assert(walk->sibling == NULL);
 
     walk = tmp->sibling;
     assert(walk->data->type == EqEq);
     assert(walk->child == NULL);
     walk = walk->sibling;
-    assert_SimpleExpr(walk, Num);
+    assert_SimplePred(walk, Num);
     
 
     printf("---------------\n");
@@ -0,0 +1,63 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../ast.h"
+
+// gcc test_12.c ../ast.c ../parser.c ../lexer.c ../log.c -o test_12.out
+
+
+void same_Tree(struct ParseTree* a, struct ParseTree* b) {
+    // Check that the two trees have the same shape, types and lexemes
+    for (; a != NULL; a = a->sibling, b = b->sibling) {
+        assert(b != NULL);
+        assert(a->data->type == b->data->type);
+        assert(a->data->len == b->data->len);
+        assert(strncmp(a->data->lexeme, b->data->lexeme, a->data->len) == 0);
+        same_Tree(a->child, b->child);
+    }
+    assert(b == NULL);
+}
+
+
+int main() {
+    struct ParseTree *tree, *view;
+    struct AST* ast;
+    int status;
+
+    char const* const fileName = "./test_code_11";
+
+    tree = alloc_ParseTree();
+    if (tree == NULL)
+        return MEMORY_ERROR;
+
+    status = build_ParseTree_FromFile(fileName, &tree);
+
+    assert(status == SUBTREE_OK);
+
+    ast = build_AST(tree);
+    assert(ast != NULL);
+
+    // Depth-first numbering: the root is 0 and its first child is 1
+    assert(ast->kind[0] == Program);
+    assert(ast->sibling[0] == AST_NONE);
+    assert(ast->token[0] == AST_NONE);
+    assert(ast->child[0] == 1);
+    assert(ast->kind[1] == Line);
+
+    view = view_AST(ast);
+    assert(view != NULL);
+    same_Tree(tree, view);
+
+    // The AST does not depend on the tree
+    free_ParseTree(tree);
+    assert(view->data->type == Program);
+    print_AST(ast);
+
+    printf("---------------\n");
+    printf("--- TEST OK ---\n");
+    printf("---------------\n");
+
+    free_AST(ast);
+    return status;
+}
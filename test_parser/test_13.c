@@ -0,0 +1,70 @@
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "../parser.h"
+
+// gcc test_13.c ../parser.c ../lexer.c ../log.c -o test_13.out
+
+/*
+ * Stress test: a program of millions of lines is a chain of millions of siblings,
+ * that print_ParseTree and free_ParseTree must go through without recursion.
+*/
+
+#define N_LINES 2000000
+
+
+int count_Node(struct ParseTree* node, int depth, void* arg) {
+    size_t* count = arg;
+    (*count)++;
+    assert(depth == (node->data->type == Program ? 0 : node->data->type == Break ? 2 : 1));
+    return 0;
+}
+
+
+int main() {
+    struct ParseTree *tree;
+    FILE* file;
+    size_t count;
+    int status, out;
+
+    char const* const fileName = "./test_code_13.tmp";
+
+    file = fopen(fileName, "w");
+    assert(file != NULL);
+    for (int i = 0; i < N_LINES; i++)
+        fputs("break;\n", file);
+    fclose(file);
+
+    tree = alloc_ParseTree();
+    if (tree == NULL)
+        return MEMORY_ERROR;
+
+    status = build_ParseTree_FromFile(fileName, &tree);
+    unlink(fileName);
+
+    assert(status == SUBTREE_OK);
+
+    // Program, then Line (with its Break) and Endline for each line
+    count = 0;
+    assert(walk_ParseTree(tree, count_Node, &count) == SUBTREE_OK);
+    assert(count == 1 + 3 * (size_t) N_LINES);
+
+    // Print to nowhere, then restore stdout
+    fflush(stdout);
+    out = dup(STDOUT_FILENO);
+    assert(freopen("/dev/null", "w", stdout) != NULL);
+    print_ParseTree(tree);
+    fflush(stdout);
+    dup2(out, STDOUT_FILENO);
+    close(out);
+
+    free_ParseTree(tree);
+
+    printf("---------------\n");
+    printf("--- TEST OK ---\n");
+    printf("---------------\n");
+
+    return status;
+}
@@ -0,0 +1,67 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../parser.h"
+
+// gcc test_14.c ../parser.c ../lexer.c ../log.c -o test_14.out
+
+/*
+ * Node pool: every node given out is given back, nodes of the speculative
+ * subtrees are reused, and a second compilation starts from an empty pool.
+*/
+
+
+int count_Node(struct ParseTree* node, int depth, void* arg) {
+    size_t* count = arg;
+    (void) node;
+    (void) depth;
+    (*count)++;
+    return 0;
+}
+
+
+int main() {
+    struct ParseTree *tree;
+    struct PoolStats before, after, again;
+    size_t count;
+    int status;
+
+    char const* const fileName = "./test_code_6";
+
+    before = stats_ParseTree();
+    assert(before.live == 0);
+
+    tree = alloc_ParseTree();
+    if (tree == NULL)
+        return MEMORY_ERROR;
+
+    status = build_ParseTree_FromFile(fileName, &tree);
+    assert(status == SUBTREE_OK);
+
+    after = stats_ParseTree();
+    count = 0;
+    walk_ParseTree(tree, count_Node, &count);
+    assert(after.live == count);
+    assert(after.allocs - after.frees == after.live);
+    assert(after.reused > 0);
+    assert(after.mallocs - before.mallocs < after.allocs - before.allocs);
+
+    free_ParseTree(tree);
+    after = stats_ParseTree();
+    assert(after.live == 0);
+    assert(after.allocs == after.frees);
+
+    // The blocks were released with the last node
+    tree = alloc_ParseTree();
+    assert(tree != NULL);
+    again = stats_ParseTree();
+    assert(again.mallocs == after.mallocs + 1);
+    assert(again.reused == after.reused);
+    free_ParseTree(tree);
+
+    printf("---------------\n");
+    printf("--- TEST OK ---\n");
+    printf("---------------\n");
+
+    return status;
+}
@@ -0,0 +1,88 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../parser.h"
+
+// gcc test_15.c ../parser.c ../lexer.c ../log.c -o test_15.out
+
+/*
+ * Interning: keywords have their fixed ids, the same identifier has the same id
+ * whichever way it was lexed, and its lexeme is the single interned spelling.
+*/
+
+
+int main() {
+    struct TokenList *list, *read, *curr, *other;
+    struct Reader* reader;
+    int y, z, count;
+
+    char const* const fileName = "./test_code_6";
+    const char* src = "while (y < x)\n    z = y % 3;\n;\n";
+
+    list = build_TokenList(src);
+    assert(list != NULL);
+    assert(list->token->type == While && list->token->id == ID_WHILE);
+
+    y = intern_Lexeme("y", 1);
+    z = intern_Lexeme("z", 1);
+    assert(y >= N_KEYWORD_IDS && z >= N_KEYWORD_IDS && y != z);
+    assert(intern_Lexeme("while", 5) == ID_WHILE);
+    assert(intern_Lexeme("readFloat", 9) == ID_READFLOAT);
+    assert(strcmp(lexeme_Of(y), "y") == 0);
+    assert(lexeme_Of(0) == NULL);
+
+    // Only identifiers and keywords get an id
+    count = 0;
+    for (curr = list; curr != NULL; curr = curr->next) {
+        if (curr->token->type == Var) {
+            assert(curr->token->id == intern_Lexeme(curr->token->lexeme, curr->token->len));
+            count++;
+        }
+        else if (curr->token->type != While)
+            assert(curr->token->id == 0);
+    }
+    assert(count == 4);
+
+    // The Reader gives the same ids, and its identifiers point to the interned spelling
+    reader = open_Reader(fileName, 1);
+    assert(reader != NULL);
+    read = read_TokenList(reader);
+    close_Reader(reader);
+    assert(read != NULL);
+    count = 0;
+    for (curr = read; curr != NULL; curr = curr->next) {
+        if (curr->token->id == y || curr->token->id == z) {
+            assert(curr->token->lexeme == lexeme_Of(curr->token->id));
+            count++;
+        }
+        if (curr->token->type == ReadIn)
+            assert(curr->token->id == ID_READINT);
+    }
+    assert(count == 7);
+
+    // Many distinct identifiers: the ids stay the same while the table grows
+    char name[16];
+    for (int i = 0; i < 100000; i++) {
+        snprintf(name, sizeof(name), "v%d", i);
+        assert(intern_Lexeme(name, strlen(name)) >= N_KEYWORD_IDS);
+    }
+    assert(intern_Lexeme("y", 1) == y);
+    assert(strcmp(lexeme_Of(intern_Lexeme("v99999", 6)), "v99999") == 0);
+
+    // Parallel lexing interns once the chunks are joined
+    other = build_TokenList_Parallel(src, strlen(src), 2, 1);
+    assert(other != NULL && other->next->next->token->id == y);
+
+    free_TokenList(other);
+    free_TokenList(read);
+    free_TokenList(list);
+    free_Interned();
+    assert(count_Interned() == 0);
+
+    printf("---------------\n");
+    printf("--- TEST OK ---\n");
+    printf("---------------\n");
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser.h"
+#include "../semantic.h"
+#include "../cgen_asm.h"
+
+// gcc test_16.c ../parser.c ../lexer.c ../ast.c ../log.c ../semantic.c ../cgen.c ../cgen_asm.c -o test_16.out
+
+/*
+ * The asm target: each program is compiled to ./test_16.s, assembled and linked
+ * with the system as and ld, run on its input and its output checked.
+ * Without as or ld only the code generation is checked.
+*/
+
+
+char* compile_Asm(const char* src) {
+    // The assembly of the program, NULL if it is out of the subset
+    struct ParseTree* tree;
+    struct SymbolTable* table;
+    char* code;
+    FILE* fp;
+
+    fp = fopen("./test_16.e", "w");
+    assert(fp != NULL);
+    fputs(src, fp);
+    fclose(fp);
+
+    tree = alloc_ParseTree();
+    assert(tree != NULL);
+    assert(build_ParseTree_FromFile("./test_16.e", &tree) == SUBTREE_OK);
+    assert(analyze_Program_Table(tree, &table) >= 0);
+    code = code_gen_Asm(tree, table);
+    free_SymbolTable(table);
+    free_ParseTree(tree);
+    remove("./test_16.e");
+    return code;
+}
+
+
+int run_Asm(const char* src, const char* input, const char* expected, int tools) {
+    // Exit status of the program, after checking what it wrote
+    char output[4096];
+    size_t len;
+    char* code;
+    FILE* fp;
+    int status;
+
+    code = compile_Asm(src);
+    assert(code != NULL);
+    assert(strstr(code, "_start:") != NULL);
+    fp = fopen("./test_16.s", "w");
+    assert(fp != NULL);
+    fputs(code, fp);
+    fclose(fp);
+    free(code);
+    if (! tools)
+        return 0;
+
+    assert(system("as ./test_16.s -o ./test_16.o && ld ./test_16.o -o ./test_16.bin") == 0);
+    fp = fopen("./test_16.in", "w");
+    assert(fp != NULL);
+    fputs(input, fp);
+    fclose(fp);
+    status = system("./test_16.bin < ./test_16.in > ./test_16.txt 2> /dev/null");
+
+    fp = fopen("./test_16.txt", "r");
+    assert(fp != NULL);
+    len = fread(output, 1, sizeof(output) - 1, fp);
+    output[len] = '\0';
+    fclose(fp);
+    if (strcmp(output, expected) != 0)
+        printf("expected:\n%s\nfound:\n%s\n", expected, output);
+    assert(strcmp(output, expected) == 0);
+
+    remove("./test_16.o");
+    remove("./test_16.bin");
+    remove("./test_16.in");
+    remove("./test_16.txt");
+    return status;
+}
+
+
+int main() {
+    char spill[2048];
+    size_t len;
+    char* code;
+    int tools, i;
+
+    tools = system("as --version > /dev/null 2>&1 && ld --version > /dev/null 2>&1") == 0;
+    if (! tools)
+        printf("as or ld not found: the programs are not run\n");
+
+    // The primes of code.e: the counters of the loops stay in registers
+    const char* primes =
+        "readInt N;\n"
+        "totSum = 0;\n"
+        "i = 0;\n"
+        "while (i <= N)\n"
+        "    j = 2;\n"
+        "    isPrime = True;\n"
+        "    while ((j <= i / 2) && isPrime)\n"
+        "        if (i % j == 0)\n"
+        "            isPrime = False;\n"
+        "        ;\n"
+        "        j = j + 1;\n"
+        "    ;\n"
+        "    if (isPrime)\n"
+        "        totSum = totSum + i;\n"
+        "    ;\n"
+        "    i = i + 1;\n"
+        ";\n"
+        "writeOut \"Total primes sum until %s is %s\", N, totSum;\n";
+    code = compile_Asm(primes);
+    assert(code != NULL);
+    assert(strstr(code, "(%rbp)") == NULL);
+    assert(strstr(code, "addq $1, ") != NULL);
+    free(code);
+    assert(run_Asm(primes, "1000\n", "Total primes sum until 1000 is 76128\n", tools) == 0);
+
+    // Division and modulo of negative numbers round down, as // and % of Python
+    assert(run_Asm(
+        "a = 0 - 7;\n"
+        "b = 2;\n"
+        "q = a / b;\n"
+        "r = a % b;\n"
+        "writeOut \"%s %s\", q, r;\n"
+        "q = a / (0 - b);\n"
+        "r = 7 % (0 - 3);\n"
+        "writeOut \"%s %s\", q, r;\n"
+        "q = a / 4;\n"
+        "r = a % 4;\n"
+        "writeOut \"%s %s\", q, r;\n",
+        "", "-4 1\n3 -2\n-2 1\n", tools) == 0);
+
+    // Floats, bools and the short-circuit of && and ||
+    assert(run_Asm(
+        "readInt n;\n"
+        "readBool b;\n"
+        "x = n /. 4;\n"
+        "y = x * 2.0 + 1;\n"
+        "c = (y > 5.0) && (x != 2.5);\n"
+        "writeOut c;\n"
+        "d = (n < 0) || b;\n"
+        "writeOut d;\n"
+        "if ((x == 2.5) && b)\n"
+        "    writeOut \"yes\";\n"
+        "else\n"
+        "    writeOut \"no\";\n"
+        ";\n",
+        "10\nTrue\n", "False\nTrue\nyes\n", tools) == 0);
+
+    // More variables than registers: some of them go to the stack
+    len = snprintf(spill, sizeof(spill), "readInt n;\n");
+    for (i = 1; i <= 12; i++)
+        len += snprintf(spill + len, sizeof(spill) - len, "a%d = n + %d;\n", i, i);
+    len += snprintf(spill + len, sizeof(spill) - len, "k = 0;\nwhile (k < 2)\n");
+    for (i = 1; i <= 12; i++)
+        len += snprintf(spill + len, sizeof(spill) - len, "    a%d = a%d + a%d;\n", i, i, i % 12 + 1);
+    snprintf(spill + len, sizeof(spill) - len, "    k = k + 1;\n;\nwriteOut \"%%s %%s %%s\", a1, a6, a12;\n");
+    code = compile_Asm(spill);
+    assert(code != NULL && strstr(code, "(%rbp)") != NULL);
+    free(code);
+    assert(run_Asm(spill, "0\n", "8 28 23\n", tools) == 0);
+
+    // break, continue and the errors of the runtime
+    const char* loop =
+        "readInt n;\n"
+        "s = 0;\n"
+        "k = 0;\n"
+        "while (True)\n"
+        "    k = k + 1;\n"
+        "    if (k % 2 == 0)\n"
+        "        continue;\n"
+        "    ;\n"
+        "    if (k > n)\n"
+        "        break;\n"
+        "    ;\n"
+        "    s = s + 100 / (n - k);\n"
+        ";\n"
+        "writeOut s;\n";
+    assert(run_Asm(loop, "10\n", "178\n", tools) == 0);
+    assert(run_Asm(loop, "9\n", "", tools) != 0);
+    assert(run_Asm(loop, "nine\n", "", tools) != 0);
+    assert(run_Asm(loop, "", "", tools) != 0);
+
+    // Out of the subset
+    assert(compile_Asm("readStr s;\n") == NULL);
+    assert(compile_Asm("x = 1.5;\nwriteOut x;\n") == NULL);
+    assert(compile_Asm("l = [1, 2];\n") == NULL);
+
+    remove("./test_16.s");
+
+    printf("---------------\n");
+    printf("--- TEST OK ---\n");
+    printf("---------------\n");
+
+    return 0;
+}
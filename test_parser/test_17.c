@@ -0,0 +1,175 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser.h"
+#include "../semantic.h"
+#include "../vm.h"
+
+// gcc test_17.c ../parser.c ../lexer.c ../ast.c ../log.c ../semantic.c ../cgen.c ../bytecode.c ../vm.c -lm -o test_17.out
+
+/*
+ * The bytecode and its VM: each program is compiled in memory and run
+ * on its input, and what it writes is checked. Runtime errors go to stderr.
+*/
+
+
+struct VmCode* compile_Vm(const char* src) {
+    struct ParseTree* tree;
+    struct SymbolTable* table;
+    struct VmCode* code;
+    FILE* fp;
+
+    fp = fopen("./test_17.e", "w");
+    assert(fp != NULL);
+    fputs(src, fp);
+    fclose(fp);
+
+    tree = alloc_ParseTree();
+    assert(tree != NULL);
+    assert(build_ParseTree_FromFile("./test_17.e", &tree) == SUBTREE_OK);
+    assert(analyze_Program_Table(tree, &table) >= 0);
+    code = compile_Bytecode(tree, table);
+    free_SymbolTable(table);
+    free_ParseTree(tree);
+    remove("./test_17.e");
+    return code;
+}
+
+
+int run_Vm(const char* src, const char* input, const char* expected) {
+    // Status of the run, after checking what the program wrote
+    struct VmCode* code;
+    char output[4096];
+    size_t len;
+    FILE *in, *out;
+    int status;
+
+    code = compile_Vm(src);
+    assert(code != NULL);
+    in = tmpfile();
+    out = tmpfile();
+    assert(in != NULL && out != NULL);
+    fputs(input, in);
+    rewind(in);
+    status = run_Bytecode(code, in, out);
+    free_Bytecode(code);
+
+    rewind(out);
+    len = fread(output, 1, sizeof(output) - 1, out);
+    output[len] = '\0';
+    fclose(in);
+    fclose(out);
+    if (strcmp(output, expected) != 0)
+        printf("expected:\n%s\nfound:\n%s\n", expected, output);
+    assert(strcmp(output, expected) == 0);
+    return status;
+}
+
+
+int count_Op(struct VmCode* code, enum VmOp op) {
+    int i, n;
+
+    n = 0;
+    for (i = 0; i < code->n; i++)
+        n += code->ins[i].op == (short) op;
+    return n;
+}
+
+
+int main() {
+    struct VmCode* code;
+
+    // The primes of code.e: a loop is one conditional jump per round
+    const char* primes =
+        "readInt N;\n"
+        "totSum = 0;\n"
+        "i = 0;\n"
+        "while (i <= N)\n"
+        "    j = 2;\n"
+        "    isPrime = True;\n"
+        "    while ((j <= i / 2) && isPrime)\n"
+        "        if (i % j == 0)\n"
+        "            writeOut \"%s is not prime\", i;\n"
+        "            isPrime = False;\n"
+        "        ;\n"
+        "        j = j + 1;\n"
+        "    ;\n"
+        "    if (isPrime)\n"
+        "        totSum = totSum + i;\n"
+        "    ;\n"
+        "    i = i + 1;\n"
+        ";\n"
+        "writeOut \"Total primes sum until %s is %s\", N, totSum;\n";
+    code = compile_Vm(primes);
+    assert(code != NULL);
+    assert(count_Op(code, VM_JLE) == 1 && count_Op(code, VM_JMP) == 2);
+    assert(count_Op(code, VM_MOV) == 5); // the constants: i = i + 1 is a single addi
+    free_Bytecode(code);
+    assert(run_Vm(primes, "10\n",
+        "4 is not prime\n6 is not prime\n8 is not prime\n9 is not prime\n10 is not prime\n"
+        "Total primes sum until 10 is 18\n") == 0);
+
+    // Division and modulo of negative numbers round down, as // and % of Python
+    assert(run_Vm(
+        "a = 0 - 7;\n"
+        "b = 2;\n"
+        "q = a / b;\n"
+        "r = a % b;\n"
+        "writeOut \"%s %s\", q, r;\n"
+        "x = a /. b;\n"
+        "y = 7.5 % (0 - 2);\n"
+        "writeOut \"%s %s\", x, y;\n",
+        "", "-4 1\n-3.5 -0.5\n") == 0);
+
+    // Strings, lists and the value of && and ||
+    assert(run_Vm(
+        "readStr name;\n"
+        "readFloat x;\n"
+        "y = x * 2;\n"
+        "s = \"hi %s, %s\", name, y + \"!\";\n"
+        "writeOut s;\n"
+        "l = [1, 2, 3];\n"
+        "k = 2;\n"
+        "e = l[k] + l[0];\n"
+        "writeOut e;\n"
+        "writeOut l;\n"
+        "f = [0.5];\n"
+        "writeOut f;\n"
+        "w = [\"a\"];\n"
+        "writeOut w;\n"
+        "same = (l == [1, 2, 3]) && (s != \"\");\n"
+        "writeOut same;\n"
+        "t = \"a\\tb\";\n"
+        "writeOut t;\n",
+        "bob\n1.25\n", "hi bob, 2.5!\n4\n[1, 2, 3]\n[0.5]\n['a']\nTrue\na\tb\n") == 0);
+
+    // break, continue and the errors of the runtime
+    const char* loop =
+        "readInt n;\n"
+        "s = 0;\n"
+        "k = 0;\n"
+        "while (True)\n"
+        "    k = k + 1;\n"
+        "    if (k % 2 == 0)\n"
+        "        continue;\n"
+        "    ;\n"
+        "    if (k > n)\n"
+        "        break;\n"
+        "    ;\n"
+        "    s = s + 100 / (n - k);\n"
+        ";\n"
+        "writeOut s;\n";
+    assert(run_Vm(loop, "10\n", "178\n") == 0);
+    assert(run_Vm(loop, "9\n", "") == 1);
+    assert(run_Vm(loop, "nine\n", "") == 1);
+    assert(run_Vm(loop, "", "") == 1);
+    assert(run_Vm("l = [1];\nreadInt i;\nwriteOut \"a\";\nx = l[i];\n", "1\n", "a\n") == 1);
+
+    printf("---------------\n");
+    printf("--- TEST OK ---\n");
+    printf("---------------\n");
+
+    return 0;
+}
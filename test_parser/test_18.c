@@ -0,0 +1,232 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser.h"
+#include "../semantic.h"
+#include "../interp.h"
+
+// gcc test_18.c ../parser.c ../lexer.c ../ast.c ../log.c ../semantic.c ../cgen.c ../vm.c ../interp.c -lm -o test_18.out
+
+/*
+ * The annotations of the semantic analysis and the interpreter that runs on them:
+ * each Var gets the slot of its symbol and each Expr its type, then each program
+ * is run on its input and what it writes is checked. Runtime errors go to stderr.
+*/
+
+
+struct Slots {
+    int ids[64];
+    int slots[64];
+    int n;
+    int nslots;
+    int bad; // nodes with a missing or wrong annotation
+};
+
+
+int check_Node(struct ParseTree* node, int depth, void* arg) {
+    struct Slots* seen = arg;
+    int i;
+
+    (void) depth;
+    if (node->data == NULL)
+        return 0;
+    if (node->data->type == Expr || node->data->type == Pred || node->data->type == Term)
+        seen->bad += node->value_type < 0;
+    if (node->data->type != Var)
+        return 0;
+    if (node->slot < 0 || node->slot >= seen->nslots)
+        seen->bad++;
+    for (i = 0; i < seen->n; i++)
+        if (seen->ids[i] == node->data->id) {
+            seen->bad += seen->slots[i] != node->slot;
+            return 0;
+        }
+    assert(seen->n < 64);
+    seen->ids[seen->n] = node->data->id;
+    seen->slots[seen->n++] = node->slot;
+    return 0;
+}
+
+
+struct ParseTree* analyze_Source(const char* src, struct SymbolTable** table) {
+    struct ParseTree* tree;
+    FILE* fp;
+
+    fp = fopen("./test_18.e", "w");
+    assert(fp != NULL);
+    fputs(src, fp);
+    fclose(fp);
+
+    tree = alloc_ParseTree();
+    assert(tree != NULL);
+    assert(build_ParseTree_FromFile("./test_18.e", &tree) == SUBTREE_OK);
+    remove("./test_18.e");
+    if (analyze_Program_Table(tree, table) < 0) {
+        free_ParseTree(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+
+int run_Interp(const char* src, const char* input, const char* expected) {
+    // Status of the run, after checking what the program wrote
+    struct ParseTree* tree;
+    struct SymbolTable* table;
+    char output[4096];
+    size_t len;
+    FILE *in, *out;
+    int status;
+
+    tree = analyze_Source(src, &table);
+    assert(tree != NULL);
+    in = tmpfile();
+    out = tmpfile();
+    assert(in != NULL && out != NULL);
+    fputs(input, in);
+    rewind(in);
+    status = interp_Program(tree, table, in, out);
+    free_SymbolTable(table);
+    free_ParseTree(tree);
+
+    rewind(out);
+    len = fread(output, 1, sizeof(output) - 1, out);
+    output[len] = '\0';
+    fclose(in);
+    fclose(out);
+    if (strcmp(output, expected) != 0)
+        printf("expected:\n%s\nfound:\n%s\n", expected, output);
+    assert(strcmp(output, expected) == 0);
+    return status;
+}
+
+
+int main() {
+    struct ParseTree* tree;
+    struct SymbolTable* table;
+    struct Slots seen;
+
+    // The primes of code.e
+    const char* primes =
+        "readInt N;\n"
+        "totSum = 0;\n"
+        "i = 0;\n"
+        "while (i <= N)\n"
+        "    j = 2;\n"
+        "    isPrime = True;\n"
+        "    while ((j <= i / 2) && isPrime)\n"
+        "        if (i % j == 0)\n"
+        "            writeOut \"%s is not prime\", i;\n"
+        "            isPrime = False;\n"
+        "        ;\n"
+        "        j = j + 1;\n"
+        "    ;\n"
+        "    if (isPrime)\n"
+        "        totSum = totSum + i;\n"
+        "    ;\n"
+        "    i = i + 1;\n"
+        ";\n"
+        "writeOut \"Total primes sum until %s is %s\", N, totSum;\n";
+
+    // Each name has one slot, each operation a type
+    tree = analyze_Source(primes, &table);
+    assert(tree != NULL);
+    memset(&seen, 0, sizeof(seen));
+    seen.nslots = table->nslots;
+    assert(walk_ParseTree(tree, check_Node, &seen) == SUBTREE_OK);
+    assert(seen.bad == 0);
+    assert(seen.n == 5 && table->nslots == 5);
+    free_SymbolTable(table);
+    free_ParseTree(tree);
+
+    // The variables in the arguments of a string are resolved too
+    assert(analyze_Source("s = \"%s\", x;\n", &table) == NULL);
+
+    assert(run_Interp(primes, "10\n",
+        "4 is not prime\n6 is not prime\n8 is not prime\n9 is not prime\n10 is not prime\n"
+        "Total primes sum until 10 is 18\n") == 0);
+
+    // Division and modulo of negative numbers round down, as // and % of Python
+    assert(run_Interp(
+        "a = 0 - 7;\n"
+        "b = 2;\n"
+        "q = a / b;\n"
+        "r = a % b;\n"
+        "writeOut \"%s %s\", q, r;\n"
+        "x = a /. b;\n"
+        "y = 7.5 % (0 - 2);\n"
+        "writeOut \"%s %s\", x, y;\n",
+        "", "-4 1\n-3.5 -0.5\n") == 0);
+
+    // Strings, lists and the value of && and ||
+    assert(run_Interp(
+        "readStr name;\n"
+        "readFloat x;\n"
+        "y = x * 2;\n"
+        "s = \"hi %s, %s\", name, y + \"!\";\n"
+        "writeOut s;\n"
+        "l = [1, 2, 3];\n"
+        "k = 2;\n"
+        "e = l[k] + l[0];\n"
+        "writeOut e;\n"
+        "writeOut l;\n"
+        "w = [\"a\"];\n"
+        "writeOut w;\n"
+        "same = (l == [1, 2, 3]) && (s != \"\");\n"
+        "writeOut same;\n"
+        "t = \"a\\tb\";\n"
+        "writeOut t;\n",
+        "bob\n1.25\n", "hi bob, 2.5!\n4\n[1, 2, 3]\n['a']\nTrue\na\tb\n") == 0);
+
+    // A string or a list read before it is assigned is empty
+    assert(run_Interp(
+        "readInt n;\n"
+        "if (n > 0)\n"
+        "    s = \"x\";\n"
+        "    l = [1];\n"
+        ";\n"
+        "writeOut s;\n"
+        "writeOut l;\n",
+        "0\n", "\n[]\n") == 0);
+
+    // break, continue and the errors of the runtime
+    const char* loop =
+        "readInt n;\n"
+        "s = 0;\n"
+        "k = 0;\n"
+        "while (True)\n"
+        "    k = k + 1;\n"
+        "    if (k % 2 == 0)\n"
+        "        continue;\n"
+        "    ;\n"
+        "    if (k > n)\n"
+        "        break;\n"
+        "    ;\n"
+        "    s = s + 100 / (n - k);\n"
+        ";\n"
+        "writeOut s;\n";
+    assert(run_Interp(loop, "10\n", "178\n") == 0);
+    assert(run_Interp(loop, "9\n", "") == 1);
+    assert(run_Interp(loop, "nine\n", "") == 1);
+    assert(run_Interp(loop, "", "") == 1);
+    assert(run_Interp("l = [1];\nreadInt i;\nwriteOut \"a\";\nx = l[i];\n", "1\n", "a\n") == 1);
+
+    // A break or a continue is only in a loop, also when it is in an if
+    assert(analyze_Source("break;\n", &table) == NULL);
+    assert(analyze_Source("readInt a;\nif (a > 1)\n    break;\n;\nwriteOut \"%s\", a;\n", &table) == NULL);
+    assert(analyze_Source("while (False)\n    break;\n;\nif (True)\n    continue;\n;\n", &table) == NULL);
+    assert(run_Interp("while (True)\n    if (True)\n        break;\n    ;\n;\nwriteOut \"a\";\n", "", "a\n") == 0);
+
+    // A comparison is typed with the operands next to it, as the Python code groups it
+    assert(run_Interp("readInt a;\nb = 2;\nx = a < b && b < 3;\ny = a < b < 5 || a == b == True;\nwriteOut x;\nwriteOut y;\n",
+                      "1\n", "True\nTrue\n") == 0);
+    assert(analyze_Source("a = 1;\nx = a < 2 < \"s\";\n", &table) == NULL);
+
+    printf("---------------\n");
+    printf("--- TEST OK ---\n");
+    printf("---------------\n");
+
+    return 0;
+}
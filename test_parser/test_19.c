@@ -0,0 +1,299 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser.h"
+#include "../semantic.h"
+#include "../ir.h"
+#include "../cgen_ir.h"
+
+// gcc test_19.c ../parser.c ../lexer.c ../ast.c ../log.c ../semantic.c ../cgen.c ../vm.c ../ir.c ../ir_opt.c ../cgen_ir.c -lm -o test_19.out
+
+/*
+ * The SSA middle end: each program is lowered and checked, the passes run
+ * with a check after each one, and what they leave is compared with the expected code.
+ * When python3 is there, the code is run too, and what it prints is checked.
+*/
+
+
+struct Ir* lower_Source(const char* src) {
+    struct ParseTree* tree;
+    struct SymbolTable* table;
+    struct Ir* ir;
+    FILE* fp;
+
+    fp = fopen("./test_19.e", "w");
+    assert(fp != NULL);
+    fputs(src, fp);
+    fclose(fp);
+
+    tree = alloc_ParseTree();
+    assert(tree != NULL);
+    assert(build_ParseTree_FromFile("./test_19.e", &tree) == SUBTREE_OK);
+    remove("./test_19.e");
+    assert(analyze_Program_Table(tree, &table) >= 0);
+    ir = lower_Program(tree, table);
+    assert(ir != NULL);
+    assert(verify_Ir(ir) == SUBTREE_OK);
+    free_SymbolTable(table);
+    free_ParseTree(tree);
+    return ir;
+}
+
+
+char* optimize_Source(const char* src, struct IrPassStats* stats) {
+    // The Python code after the passes
+    struct Ir* ir;
+    char* code;
+
+    ir = lower_Source(src);
+    assert(optimize_Ir(ir, stats, 1) == SUBTREE_OK);
+    code = code_gen_Ir(ir);
+    assert(code != NULL);
+    free_Ir(ir);
+    return code;
+}
+
+
+void check_Code(const char* src, const char* expected) {
+    struct IrPassStats stats[IR_PASSES];
+    char* code;
+
+    code = optimize_Source(src, stats);
+    if (strcmp(code, expected) != 0)
+        printf("expected:\n%s\nfound:\n%s\n", expected, code);
+    assert(strcmp(code, expected) == 0);
+    free(code);
+}
+
+
+void check_Run(const char* src, const char* input, const char* expected) {
+    struct IrPassStats stats[IR_PASSES];
+    char output[4096];
+    char* code;
+    size_t len;
+    FILE* fp;
+
+    code = optimize_Source(src, stats);
+    fp = fopen("./test_19.py", "w");
+    assert(fp != NULL);
+    fputs(code, fp);
+    fclose(fp);
+    fp = fopen("./test_19.in", "w");
+    assert(fp != NULL);
+    fputs(input, fp);
+    fclose(fp);
+    assert(system("python3 ./test_19.py < ./test_19.in > ./test_19.txt 2> /dev/null") == 0);
+
+    fp = fopen("./test_19.txt", "r");
+    assert(fp != NULL);
+    len = fread(output, 1, sizeof(output) - 1, fp);
+    output[len] = '\0';
+    fclose(fp);
+    if (strcmp(output, expected) != 0)
+        printf("expected:\n%s\nfound:\n%s\n%s\n", expected, output, code);
+    assert(strcmp(output, expected) == 0);
+    remove("./test_19.py");
+    remove("./test_19.in");
+    remove("./test_19.txt");
+    free(code);
+}
+
+
+int main() {
+    struct IrPassStats stats[IR_PASSES];
+    struct Ir* ir;
+    char dump[8192];
+    size_t len;
+    FILE* fp;
+    char* code;
+    int python, before, i;
+
+    python = system("python3 --version > /dev/null 2>&1") == 0;
+    if (! python)
+        printf("python3 not found: the programs are not run\n");
+
+    // The primes of code.e
+    const char* primes =
+        "readInt N;\n"
+        "totSum = 0;\n"
+        "i = 0;\n"
+        "while (i <= N)\n"
+        "    j = 2;\n"
+        "    isPrime = True;\n"
+        "    while ((j <= i / 2) && isPrime)\n"
+        "        if (i % j == 0)\n"
+        "            writeOut \"%s is not prime\", i;\n"
+        "            isPrime = False;\n"
+        "        ;\n"
+        "        j = j + 1;\n"
+        "    ;\n"
+        "    if (isPrime)\n"
+        "        totSum = totSum + i;\n"
+        "    ;\n"
+        "    i = i + 1;\n"
+        ";\n"
+        "writeOut \"Total primes sum until %s is %s\", N, totSum;\n";
+
+    // A phi for each variable written in a loop, at its header
+    ir = lower_Source(primes);
+    fp = tmpfile();
+    assert(fp != NULL);
+    print_Ir(ir, fp);
+    rewind(fp);
+    len = fread(dump, 1, sizeof(dump) - 1, fp);
+    dump[len] = '\0';
+    fclose(fp);
+    assert(strstr(dump, "b1: <- b0, b11  ; loop, test b1, exit b3\n") != NULL);
+    assert(strstr(dump, " = phi int [b0 v1], [b11 v44]  ; totSum\n") != NULL);
+    assert(strstr(dump, " = and bool ") != NULL);
+
+    // Each pass checks and counts what it did: the variables that do not change lose their phis
+    before = count_IrOps(ir);
+    assert(optimize_Ir(ir, stats, 1) == SUBTREE_OK);
+    assert(strcmp(stats[0].name, "sccp") == 0 && strcmp(stats[3].name, "dce") == 0);
+    assert(stats[0].before == before && stats[3].after == count_IrOps(ir));
+    for (i = 1; i < IR_PASSES; i++)
+        assert(stats[i].before == stats[i - 1].after);
+    assert(count_IrOps(ir) < before);
+    code = code_gen_Ir(ir);
+    assert(code != NULL);
+    assert(strstr(code, "while i_4 <= N_0:\n") != NULL);
+    assert(strstr(code, "print(\"%s is not prime\" % i_4)\n") != NULL);
+    free(code);
+    free_Ir(ir);
+
+    // Constants are folded as Python computes them: / of two ints is a float
+    check_Code(
+        "a = 2 + 3 * 4;\n"
+        "b = a / 4;\n"
+        "c = (0 - 7) % 2;\n"
+        "s = \"a\" + \"b\";\n"
+        "e = (s == \"ab\") && (a == 14.0);\n"
+        "writeOut b;\n"
+        "writeOut c;\n"
+        "writeOut s;\n"
+        "writeOut e;\n",
+        "print(3.5)\n"
+        "print(1)\n"
+        "print(\"ab\")\n"
+        "print(True)\n");
+
+    // Never when it would overflow or divide by zero: Python keeps its error
+    check_Code(
+        "a = 9223372036854775807 + 1;\n"
+        "writeOut a;\n"
+        "b = 1 / 0;\n"
+        "writeOut \"after\";\n",
+        "print(9223372036854775807 + 1)\n"
+        "1 / 0\n"
+        "print(\"after\")\n");
+
+    // A branch that always goes one way, a loop that never runs, a value computed twice
+    check_Code(
+        "readInt n;\n"
+        "if (1 > 2)\n"
+        "    writeOut \"never\";\n"
+        "else\n"
+        "    writeOut \"always\";\n"
+        ";\n"
+        "while (False)\n"
+        "    writeOut \"no\";\n"
+        ";\n"
+        "x = n * 2 + 1;\n"
+        "y = n * 2 + 1;\n"
+        "z = x + y;\n"
+        "writeOut z;\n",
+        "n_0 = int(input())\n"
+        "print(\"always\")\n"
+        "x_22 = n_0 * 2 + 1\n"
+        "print(x_22 + x_22)\n");
+
+    // The right side of && that can fail is still only computed when the left one is true
+    check_Code(
+        "readInt n;\n"
+        "x = (n > 0) && (10 / n > 1);\n"
+        "writeOut x;\n",
+        "n_0 = int(input())\n"
+        "t_2 = n_0 > 0\n"
+        "if t_2:\n"
+        "    x_9 = 10 / n_0 > 1\n"
+        "else:\n"
+        "    x_9 = t_2\n"
+        "\n"
+        "print(x_9)\n");
+
+    // An arm with only a loop that never runs writes nothing: it still needs a body
+    check_Code(
+        "readInt a;\n"
+        "if (a > 1)\n"
+        "    k = 0;\n"
+        "    while (k < 0)\n"
+        "        k = k + 1;\n"
+        "    ;\n"
+        ";\n"
+        "writeOut \"%s\", a;\n",
+        "a_0 = int(input())\n"
+        "if a_0 > 1:\n"
+        "    pass\n"
+        "\n"
+        "print(\"%s\" % a_0)\n");
+
+    if (! python) {
+        printf("---------------\n");
+        printf("--- TEST OK ---\n");
+        printf("---------------\n");
+        return 0;
+    }
+
+    check_Run(primes, "10\n",
+        "4 is not prime\n6 is not prime\n8 is not prime\n9 is not prime\n10 is not prime\n"
+        "Total primes sum until 10 is 18\n");
+
+    // break, continue and phis that swap: x, y = y, x
+    check_Run(
+        "readInt n;\n"
+        "x = 1;\n"
+        "y = 2;\n"
+        "s = 0;\n"
+        "k = 0;\n"
+        "while (True)\n"
+        "    k = k + 1;\n"
+        "    t = x;\n"
+        "    x = y;\n"
+        "    y = t;\n"
+        "    if (k % 2 == 0)\n"
+        "        continue;\n"
+        "    ;\n"
+        "    if (k > n)\n"
+        "        break;\n"
+        "    ;\n"
+        "    s = s + x * 10 + y;\n"
+        ";\n"
+        "writeOut s;\n"
+        "writeOut x;\n",
+        "5\n", "63\n2\n");
+
+    // Strings, lists and floats are written as the first code generation writes them
+    check_Run(
+        "readStr name;\n"
+        "readFloat f;\n"
+        "l = [1, 2, 3];\n"
+        "k = 2;\n"
+        "e = l[k] + l[0];\n"
+        "g = f * 2.5 - 1;\n"
+        "s = \"hi %s, %s\", name, g;\n"
+        "writeOut s;\n"
+        "writeOut e;\n"
+        "writeOut l;\n"
+        "h = f /. 3;\n"
+        "writeOut h;\n",
+        "bob\n1.5\n", "hi bob, 2.75\n4\n[1, 2, 3]\n0.5\n");
+
+    printf("---------------\n");
+    printf("--- TEST OK ---\n");
+    printf("---------------\n");
+
+    return 0;
+}
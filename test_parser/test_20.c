@@ -0,0 +1,111 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser.h"
+#include "../semantic.h"
+
+// gcc test_20.c ../parser.c ../lexer.c ../ast.c ../log.c ../semantic.c -o test_20.out
+
+/*
+ * The scopes of the SymbolTable: names defined in an inner scope hide the outer ones,
+ * and closing it brings them back. All the names start their probes at the last slots
+ * of the table of 128 slots, so their run wraps around to its start. The table grows
+ * while the inner scope is open, and the run is inserted again from slot 0:
+ * inner symbols come before outer ones, and closing the scope has to move these back.
+*/
+
+#define OUTER 40
+#define INNER 60
+#define SHADOWED 10
+#define HOME 124
+
+
+int pick_Names(int* ids, int n) {
+    // Ids of n names that start their probes at slots HOME to 127, in the tables of 128 and 256 slots
+    char name[32];
+    size_t home;
+    int i, k;
+
+    k = 0;
+    for (i = 0; k < n && i < 1000000; i++) {
+        snprintf(name, sizeof(name), "n%d", i);
+        ids[k] = intern_Lexeme(name, strlen(name));
+        assert(ids[k] > 0);
+        home = home_Slot(ids[k], 255);
+        if (home >= HOME && home < 128)
+            k++;
+    }
+    return k;
+}
+
+
+int main() {
+    struct SymbolTable* table;
+    struct Symbol* sym;
+    int ids[OUTER + INNER];
+    int i;
+
+    table = alloc_SymbolTable();
+    assert(table != NULL);
+    assert(pick_Names(ids, OUTER + INNER) == OUTER + INNER);
+
+    for (i = 0; i < OUTER; i++)
+        assert(add_symbol(table, ids[i], _int) != NULL);
+    assert(table->cap == 128);
+
+    open_Scope(table);
+    // Defining again in the same scope only changes the type
+    for (i = 0; i < INNER; i++) {
+        assert(add_symbol(table, ids[OUTER + i], _bool) != NULL);
+        assert(add_symbol(table, ids[OUTER + i], _float) != NULL);
+    }
+    for (i = 0; i < SHADOWED; i++)
+        assert(add_symbol(table, ids[i], _string) != NULL);
+    assert(table->cap == 256);
+    assert(table->count == OUTER + INNER);
+
+    for (i = 0; i < OUTER; i++) {
+        sym = search_symbol(table, ids[i]);
+        assert(sym != NULL && sym->id == ids[i]);
+        assert(sym->type == (i < SHADOWED ? _string : _int));
+        assert(sym->scope == (i < SHADOWED ? 1 : 0));
+        if (i < SHADOWED)
+            assert(sym->outer != NULL && sym->outer->type == _int);
+    }
+    for (i = 0; i < INNER; i++) {
+        sym = search_symbol(table, ids[OUTER + i]);
+        assert(sym != NULL && sym->type == _float && sym->scope == 1);
+    }
+
+    // The hidden symbols are back, the inner ones are gone and no run is broken
+    close_Scope(table);
+    assert(table->scope == 0);
+    assert(table->count == OUTER);
+    for (i = 0; i < OUTER; i++) {
+        sym = search_symbol(table, ids[i]);
+        assert(sym != NULL && sym->id == ids[i]);
+        assert(sym->type == _int && sym->scope == 0 && sym->outer == NULL);
+    }
+    for (i = 0; i < INNER; i++)
+        assert(search_symbol(table, ids[OUTER + i]) == NULL);
+
+    // The emptied slots can be used again
+    for (i = 0; i < INNER; i++)
+        assert(add_symbol(table, ids[OUTER + i], _bool) != NULL);
+    for (i = 0; i < OUTER + INNER; i++) {
+        sym = search_symbol(table, ids[i]);
+        assert(sym != NULL && sym->type == (i < OUTER ? _int : _bool));
+    }
+    assert(table->count == OUTER + INNER);
+
+    free_SymbolTable(table);
+    free_Interned();
+
+    printf("---------------\n");
+    printf("--- TEST OK ---\n");
+    printf("---------------\n");
+
+    return 0;
+}
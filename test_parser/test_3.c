@@ -3,7 +3,7 @@
 
 #include "../parser.h"
 
-// gcc test_3.c ../parser.c ../lexer.c -o test_3.out
+// gcc test_3.c ../parser.c ../lexer.c ../log.c -o test_3.out
 
 
 int main() {
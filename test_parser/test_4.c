@@ -3,7 +3,7 @@
 
 #include "../parser.h"
 
-// gcc test_4.c ../parser.c ../lexer.c -o test_4.out
+// gcc test_4.c ../parser.c ../lexer.c ../log.c -o test_4.out
 
 
 int assert_SimplePred(struct ParseTree *subtree, enum TokenType terminal);
@@ -112,7 +112,7 @@ int main() {
     expr1 = expr1->sibling;
     assert(expr1->data->type = EqEq);
     expr1 = expr1->sibling;
-    assert_SimpleExpr(expr1, Num);
+    assert_SimplePred(expr1, Num);
 
     // Check ifbody
     assert(ifbody->data->type == Line);
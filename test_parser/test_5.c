@@ -3,7 +3,7 @@
 
 #include "../parser.h"
 
-// gcc test_5.c ../parser.c ../lexer.c -o test_5.out
+// gcc test_5.c ../parser.c ../lexer.c ../log.c -o test_5.out
 
 
 int main() {
@@ -66,11 +66,10 @@ int main() {
     ifcond = ifcond->child->sibling;
     assert(ifcond->data->type == Lesser);
     ifcond = ifcond->sibling;
-    assert(ifcond->data->type == Expr);
-    assert(ifcond->child->data->type == Pred);
-    assert(ifcond->child->child->data->type == Term);
-    assert(ifcond->child->child->child->data->type == BaseExpr);
-    basexpr = ifcond->child->child->child;
+    assert(ifcond->data->type == Pred);
+    assert(ifcond->child->data->type == Term);
+    assert(ifcond->child->child->data->type == BaseExpr);
+    basexpr = ifcond->child->child;
     assert(basexpr->child->data->type == Obj);
     assert(basexpr->child->child->data->type == Num);
 
@@ -3,7 +3,7 @@
 
 #include "../parser.h"
 
-// gcc test_6.c ../parser.c ../lexer.c -o test_6.out
+// gcc test_6.c ../parser.c ../lexer.c ../log.c -o test_6.out
 
 
 int main() {
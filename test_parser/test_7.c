@@ -3,7 +3,7 @@
 
 #include "../parser.h"
 
-// gcc test_7.c ../parser.c ../lexer.c -o test_7.out
+// gcc test_7.c ../parser.c ../lexer.c ../log.c -o test_7.out
 
 
 int main() {
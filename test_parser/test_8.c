@@ -3,7 +3,7 @@
 
 #include "../parser.h"
 
-// gcc test_8.c ../parser.c ../lexer.c -o test_8.out
+// gcc test_8.c ../parser.c ../lexer.c ../log.c -o test_8.out
 
 
 int main() {
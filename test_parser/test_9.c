@@ -3,7 +3,7 @@
 
 #include "../parser.h"
 
-// gcc test_9.c ../parser.c ../lexer.c -o test_9.out
+// gcc test_9.c ../parser.c ../lexer.c ../log.c -o test_9.out
 
 
 int main() {
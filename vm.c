@@ -0,0 +1,727 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "vm.h"
+
+/*
+ * The loop of the VM jumps straight from an instruction to the next one with the
+ * computed goto of GCC and clang: each instruction ends with its own indirect jump.
+ * Elsewhere, or built with -DVM_SWITCH, it is a switch in a loop.
+*/
+#if defined(__GNUC__) && ! defined(VM_SWITCH)
+#define VM_THREADED
+#endif
+
+
+/*
+ * ---------------
+ * Strings and lists
+ * ---------------
+*/
+
+struct VmObj* new_VmStr (const char* s, size_t len) {
+    struct VmObj* str;
+
+    str = malloc(sizeof(struct VmObj) + len + 1);
+    if (str == NULL)
+        return NULL;
+    str->refs = 1;
+    str->elem = -1;
+    str->len = len;
+    str->data = NULL;
+    memcpy(str->s, s, len);
+    str->s[len] = '\0';
+    return str;
+}
+
+
+struct VmObj* new_VmList (size_t len, int elem) {
+    struct VmObj* list;
+
+    list = malloc(sizeof(struct VmObj));
+    if (list == NULL)
+        return NULL;
+    list->data = malloc((len > 0 ? len : 1) * sizeof(union VmValue));
+    if (list->data == NULL) {
+        free(list);
+        return NULL;
+    }
+    list->refs = 1;
+    list->elem = elem;
+    list->len = len;
+    return list;
+}
+
+
+void release_VmObj (struct VmObj* obj) {
+    size_t i;
+
+    if (obj == NULL || --obj->refs > 0)
+        return;
+    if (obj->elem == _string || obj->elem == _list)
+        for (i = 0; i < obj->len; i++)
+            release_VmObj(obj->data[i].o);
+    free(obj->data);
+    free(obj);
+}
+
+
+int put_Buf (struct VmBuf* buf, const char* s, size_t len) {
+    char* grown;
+    size_t cap;
+
+    if (buf->len + len + 1 > buf->cap) {
+        cap = buf->cap > 0 ? buf->cap : 64;
+        while (buf->len + len + 1 > cap)
+            cap *= 2;
+        grown = realloc(buf->s, cap);
+        if (grown == NULL)
+            return MEMORY_ERROR;
+        buf->s = grown;
+        buf->cap = cap;
+    }
+    memcpy(buf->s + buf->len, s, len);
+    buf->len += len;
+    buf->s[buf->len] = '\0';
+    return SUBTREE_OK;
+}
+
+
+size_t str_Float (double v, char* out) {
+    // repr of a Python float: the shortest digits that read back the same value
+    char buf[64], digits[32];
+    int prec, exp, nd, i, k;
+    char* p;
+
+    if (isnan(v))
+        return sprintf(out, "nan");
+    if (isinf(v))
+        return sprintf(out, v > 0 ? "inf" : "-inf");
+    for (prec = 0; prec < 17; prec++) {
+        snprintf(buf, sizeof(buf), "%.*e", prec, v);
+        if (strtod(buf, NULL) == v)
+            break;
+    }
+    nd = 0;
+    for (p = buf; *p != 'e'; p++)
+        if (*p >= '0' && *p <= '9')
+            digits[nd++] = *p;
+    exp = atoi(p + 1);
+    while (nd > 1 && digits[nd - 1] == '0')
+        nd--;
+    k = 0;
+    if (buf[0] == '-')
+        out[k++] = '-';
+    if (exp >= -4 && exp < 16) {
+        if (exp < 0) {
+            out[k++] = '0';
+            out[k++] = '.';
+            for (i = 0; i < -exp - 1; i++)
+                out[k++] = '0';
+            for (i = 0; i < nd; i++)
+                out[k++] = digits[i];
+        }
+        else {
+            for (i = 0; i <= exp; i++)
+                out[k++] = i < nd ? digits[i] : '0';
+            out[k++] = '.';
+            if (nd <= exp + 1)
+                out[k++] = '0';
+            for (i = exp + 1; i < nd; i++)
+                out[k++] = digits[i];
+        }
+        out[k] = '\0';
+        return k;
+    }
+    out[k++] = digits[0];
+    if (nd > 1) {
+        out[k++] = '.';
+        for (i = 1; i < nd; i++)
+            out[k++] = digits[i];
+    }
+    return k + sprintf(out + k, "e%c%02d", exp < 0 ? '-' : '+', exp < 0 ? -exp : exp);
+}
+
+
+int str_Value (struct VmBuf* buf, union VmValue v, int type, int repr) {
+    // str() of the value, or its repr inside a list
+    char num[400];
+    const char* s;
+    char quote;
+    size_t i, len;
+    int status;
+
+    switch (type) {
+        case _int:
+            return put_Buf(buf, num, sprintf(num, "%lld", v.i));
+        case _float:
+            return put_Buf(buf, num, str_Float(v.f, num));
+        case _bool:
+            return put_Buf(buf, v.i ? "True" : "False", v.i ? 4 : 5);
+        case _null:
+            return put_Buf(buf, "None", 4);
+        case _string:
+            if (! repr)
+                return put_Buf(buf, v.o->s, v.o->len);
+            // Python quotes with ' unless the string has a ' and no "
+            s = v.o->s;
+            len = v.o->len;
+            quote = memchr(s, '\'', len) != NULL && memchr(s, '"', len) == NULL ? '"' : '\'';
+            status = put_Buf(buf, &quote, 1);
+            for (i = 0; i < len && status == SUBTREE_OK; i++) {
+                if (s[i] == quote || s[i] == '\\')
+                    status = put_Buf(buf, "\\", 1);
+                if (s[i] == '\n')
+                    status |= put_Buf(buf, "\\n", 2);
+                else
+                    status |= put_Buf(buf, s + i, 1);
+            }
+            return status | put_Buf(buf, &quote, 1);
+        default:
+            status = put_Buf(buf, "[", 1);
+            for (i = 0; i < v.o->len && status == SUBTREE_OK; i++) {
+                if (i > 0)
+                    status = put_Buf(buf, ", ", 2);
+                status |= str_Value(buf, v.o->data[i], v.o->elem, 1);
+            }
+            return status | put_Buf(buf, "]", 1);
+    }
+}
+
+
+int equal_Strs (struct VmObj* a, struct VmObj* b) {
+    return a->len == b->len && memcmp(a->s, b->s, a->len) == 0;
+}
+
+
+int equal_Lists (struct VmObj* a, struct VmObj* b) {
+    // Numbers are equal whatever their type, as in Python
+    size_t i;
+    int sa, sb;
+
+    if (a->len != b->len)
+        return 0;
+    if (a->len == 0)
+        return 1;
+    sa = a->elem == _string || a->elem == _list;
+    sb = b->elem == _string || b->elem == _list;
+    if ((sa || sb) && a->elem != b->elem)
+        return 0;
+    for (i = 0; i < a->len; i++) {
+        if (a->elem == _string && ! equal_Strs(a->data[i].o, b->data[i].o))
+            return 0;
+        if (a->elem == _list && ! equal_Lists(a->data[i].o, b->data[i].o))
+            return 0;
+        if (! sa && (a->elem == _float ? a->data[i].f : a->data[i].i) != (b->elem == _float ? b->data[i].f : b->data[i].i))
+            return 0;
+    }
+    return 1;
+}
+
+
+size_t unescape_Literal (const char* s, size_t len, char* out) {
+    // The bytes of a Python literal: an unknown escape keeps its backslash
+    static const char* from = "ntr\\'\"abfv";
+    static const char* to = "\n\t\r\\'\"\a\b\f\v";
+    const char* c;
+    size_t i, n;
+    int k, v;
+
+    n = 0;
+    for (i = 0; i < len; i++) {
+        if (s[i] != '\\' || i + 1 == len)
+            out[n++] = s[i];
+        else if ((c = strchr(from, s[i + 1])) != NULL) {
+            out[n++] = to[c - from];
+            i++;
+        }
+        else if (s[i + 1] >= '0' && s[i + 1] <= '7') {
+            v = 0;
+            for (k = 0; k < 3 && i + 1 < len && s[i + 1] >= '0' && s[i + 1] <= '7'; k++, i++)
+                v = 8 * v + s[i + 1] - '0';
+            out[n++] = (char) v;
+        }
+        else
+            out[n++] = s[i];
+    }
+    return n;
+}
+
+
+/*
+ * ---------------
+ * Input
+ * ---------------
+*/
+
+const char* read_Value (FILE* in, int type, union VmValue* v, struct VmBuf* line) {
+    // The next line, as input() and then int(), float(), bool() give it, or the message of the error
+    char* end;
+    char c;
+    int got;
+
+    line->len = 0;
+    if (put_Buf(line, "", 0) != SUBTREE_OK)
+        return "MemoryError: out of memory";
+    got = 0;
+    while ((got = getc(in)) != EOF && got != '\n') {
+        c = (char) got;
+        if (put_Buf(line, &c, 1) != SUBTREE_OK)
+            return "MemoryError: out of memory";
+    }
+    if (got == EOF && line->len == 0)
+        return "EOFError: EOF when reading a line";
+
+    switch (type) {
+        case _int:
+            v->i = strtoll(line->s, &end, 10);
+            break;
+        case _float:
+            v->f = strtod(line->s, &end);
+            break;
+        case _bool:
+            v->i = line->len > 0;
+            return NULL;
+        default:
+            v->o = new_VmStr(line->s, line->len);
+            return v->o == NULL ? "MemoryError: out of memory" : NULL;
+    }
+    while (*end == ' ' || *end == '\t' || *end == '\r')
+        end++;
+    if (end == line->s || *end != '\0')
+        return type == _int ? "ValueError: invalid literal for int()" : "ValueError: could not convert string to float";
+    return NULL;
+}
+
+
+/*
+ * ---------------
+ * The VM
+ * ---------------
+*/
+
+long long floor_Div (long long a, long long b) {
+    long long q;
+
+    q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0)))
+        q--;
+    return q;
+}
+
+
+long long floor_Mod (long long a, long long b) {
+    long long r;
+
+    r = a % b;
+    if (r != 0 && ((r < 0) != (b < 0)))
+        r += b;
+    return r;
+}
+
+
+double floor_FMod (double a, double b) {
+    double r;
+
+    r = fmod(a, b);
+    if (r != 0.0 && ((r < 0) != (b < 0)))
+        r += b;
+    else if (r == 0.0)
+        r = copysign(0.0, b);
+    return r;
+}
+
+
+void set_Obj (union VmValue* reg, struct VmObj* obj) {
+    // Write a new reference into the register, and give back the old one
+    struct VmObj* old;
+
+    old = reg->o;
+    reg->o = obj;
+    release_VmObj(old);
+}
+
+
+const char* format_Str (struct VmBuf* buf, struct VmObj* lit, union VmValue* args, int n) {
+    // lit % (args): %% is %, %s the next argument. Their count was checked by the analysis
+    size_t i;
+    int k, status;
+
+    buf->len = 0;
+    status = put_Buf(buf, "", 0);
+    k = 0;
+    for (i = 0; i < lit->len && status == SUBTREE_OK; i++) {
+        if (lit->s[i] == '%' && lit->s[i + 1] == '%') {
+            status = put_Buf(buf, "%", 1);
+            i++;
+        }
+        else if (lit->s[i] == '%' && lit->s[i + 1] == 's' && k < n) {
+            status = put_Buf(buf, args[k].o->s, args[k].o->len);
+            k++;
+            i++;
+        }
+        else
+            status = put_Buf(buf, lit->s + i, 1);
+    }
+    return status == SUBTREE_OK ? NULL : "MemoryError: out of memory";
+}
+
+
+int run_Bytecode (struct VmCode* code, FILE* in, FILE* out) {
+    /*
+     * The registers are a single array: the instructions name them by index.
+     * A runtime error stops the program at once, as the exception would in Python.
+    */
+    struct VmIns *ins, *ip;
+    union VmValue *regs, *elem, v;
+    struct VmObj* obj;
+    struct VmBuf buf;
+    const char* error;
+    long long idx;
+    int i, k;
+
+    regs = calloc(code->nregs > 0 ? code->nregs : 1, sizeof(union VmValue));
+    if (regs == NULL)
+        return 1;
+    for (i = 0; i < code->nconsts; i++) {
+        k = code->nregs - code->nconsts + i;
+        regs[k] = code->consts[i];
+        if (code->is_obj[k])
+            regs[k].o->refs++;
+    }
+    buf.s = NULL;
+    buf.len = buf.cap = 0;
+    error = NULL;
+    obj = NULL;
+    ins = code->ins;
+    ip = ins;
+
+#define A regs[ip->a]
+#define B regs[ip->b]
+#define C regs[ip->c]
+#define FAIL(message) do { error = message; goto done; } while (0)
+#define NEW_OBJ(made) do { if ((obj = (made)) == NULL) FAIL("MemoryError: out of memory"); set_Obj(&A, obj); } while (0)
+
+#ifdef VM_THREADED
+    static void* labels[N_VM_OPS] = {
+        &&L_VM_HALT, &&L_VM_MOV, &&L_VM_MOVO,
+        &&L_VM_ADDI, &&L_VM_SUBI, &&L_VM_MULI, &&L_VM_DIVI, &&L_VM_MODI,
+        &&L_VM_ADDF, &&L_VM_SUBF, &&L_VM_MULF, &&L_VM_DIVF, &&L_VM_MODF, &&L_VM_ITOF,
+        &&L_VM_LTI, &&L_VM_LEI, &&L_VM_EQI, &&L_VM_NEI,
+        &&L_VM_LTF, &&L_VM_LEF, &&L_VM_EQF, &&L_VM_NEF,
+        &&L_VM_EQS, &&L_VM_NES, &&L_VM_EQL, &&L_VM_NEL,
+        &&L_VM_TRUTHI, &&L_VM_TRUTHF, &&L_VM_TRUTHS, &&L_VM_TRUTHL,
+        &&L_VM_JMP, &&L_VM_JZ, &&L_VM_JNZ, &&L_VM_JLT, &&L_VM_JLE, &&L_VM_JEQ, &&L_VM_JNE,
+        &&L_VM_TOSTR, &&L_VM_CONCAT, &&L_VM_FORMAT, &&L_VM_LIST, &&L_VM_ELEM, &&L_VM_READ, &&L_VM_PRINT
+    };
+#define CASE(op) L_##op:
+#define NEXT ip++; goto *labels[ip->op]
+#define GOTO(target) ip = ins + (target); goto *labels[ip->op]
+    goto *labels[ip->op];
+    {
+#else
+#define CASE(op) case op:
+#define NEXT ip++; continue
+#define GOTO(target) ip = ins + (target); continue
+    for (;;) switch (ip->op) {
+#endif
+        CASE(VM_HALT)
+            goto done;
+        CASE(VM_MOV)
+            A = B;
+            NEXT;
+        CASE(VM_MOVO)
+            B.o->refs++;
+            set_Obj(&A, B.o);
+            NEXT;
+
+        CASE(VM_ADDI)
+            A.i = B.i + C.i;
+            NEXT;
+        CASE(VM_SUBI)
+            A.i = B.i - C.i;
+            NEXT;
+        CASE(VM_MULI)
+            A.i = B.i * C.i;
+            NEXT;
+        CASE(VM_DIVI)
+            if (C.i == 0)
+                FAIL("ZeroDivisionError: integer division by zero");
+            A.i = floor_Div(B.i, C.i);
+            NEXT;
+        CASE(VM_MODI)
+            if (C.i == 0)
+                FAIL("ZeroDivisionError: integer modulo by zero");
+            A.i = floor_Mod(B.i, C.i);
+            NEXT;
+        CASE(VM_ADDF)
+            A.f = B.f + C.f;
+            NEXT;
+        CASE(VM_SUBF)
+            A.f = B.f - C.f;
+            NEXT;
+        CASE(VM_MULF)
+            A.f = B.f * C.f;
+            NEXT;
+        CASE(VM_DIVF)
+            if (C.f == 0.0)
+                FAIL("ZeroDivisionError: float division by zero");
+            A.f = B.f / C.f;
+            NEXT;
+        CASE(VM_MODF)
+            if (C.f == 0.0)
+                FAIL("ZeroDivisionError: float modulo");
+            A.f = floor_FMod(B.f, C.f);
+            NEXT;
+        CASE(VM_ITOF)
+            A.f = (double) B.i;
+            NEXT;
+
+        CASE(VM_LTI)
+            A.i = B.i < C.i;
+            NEXT;
+        CASE(VM_LEI)
+            A.i = B.i <= C.i;
+            NEXT;
+        CASE(VM_EQI)
+            A.i = B.i == C.i;
+            NEXT;
+        CASE(VM_NEI)
+            A.i = B.i != C.i;
+            NEXT;
+        CASE(VM_LTF)
+            A.i = B.f < C.f;
+            NEXT;
+        CASE(VM_LEF)
+            A.i = B.f <= C.f;
+            NEXT;
+        CASE(VM_EQF)
+            A.i = B.f == C.f;
+            NEXT;
+        CASE(VM_NEF)
+            A.i = B.f != C.f;
+            NEXT;
+        CASE(VM_EQS)
+            A.i = equal_Strs(B.o, C.o);
+            NEXT;
+        CASE(VM_NES)
+            A.i = ! equal_Strs(B.o, C.o);
+            NEXT;
+        CASE(VM_EQL)
+            A.i = equal_Lists(B.o, C.o);
+            NEXT;
+        CASE(VM_NEL)
+            A.i = ! equal_Lists(B.o, C.o);
+            NEXT;
+        CASE(VM_TRUTHI)
+            A.i = B.i != 0;
+            NEXT;
+        CASE(VM_TRUTHF)
+            A.i = B.f != 0.0;
+            NEXT;
+        CASE(VM_TRUTHS)
+        CASE(VM_TRUTHL)
+            A.i = B.o->len > 0;
+            NEXT;
+
+        CASE(VM_JMP)
+            GOTO(ip->a);
+        CASE(VM_JZ)
+            if (A.i == 0) {
+                GOTO(ip->c);
+            }
+            NEXT;
+        CASE(VM_JNZ)
+            if (A.i != 0) {
+                GOTO(ip->c);
+            }
+            NEXT;
+        CASE(VM_JLT)
+            if (A.i < B.i) {
+                GOTO(ip->c);
+            }
+            NEXT;
+        CASE(VM_JLE)
+            if (A.i <= B.i) {
+                GOTO(ip->c);
+            }
+            NEXT;
+        CASE(VM_JEQ)
+            if (A.i == B.i) {
+                GOTO(ip->c);
+            }
+            NEXT;
+        CASE(VM_JNE)
+            if (A.i != B.i) {
+                GOTO(ip->c);
+            }
+            NEXT;
+
+        CASE(VM_TOSTR)
+            buf.len = 0;
+            if (str_Value(&buf, B, ip->t, 0) != SUBTREE_OK)
+                FAIL("MemoryError: out of memory");
+            NEW_OBJ(new_VmStr(buf.s, buf.len));
+            NEXT;
+        CASE(VM_CONCAT)
+            buf.len = 0;
+            if (put_Buf(&buf, B.o->s, B.o->len) != SUBTREE_OK || put_Buf(&buf, C.o->s, C.o->len) != SUBTREE_OK)
+                FAIL("MemoryError: out of memory");
+            NEW_OBJ(new_VmStr(buf.s, buf.len));
+            NEXT;
+        CASE(VM_FORMAT)
+            if ((error = format_Str(&buf, B.o, regs + ip->c, ip->t)) != NULL)
+                goto done;
+            NEW_OBJ(new_VmStr(buf.s, buf.len));
+            NEXT;
+        CASE(VM_LIST)
+            NEW_OBJ(new_VmList(ip->c, ip->t));
+            for (k = 0; k < ip->c; k++) {
+                obj->data[k] = regs[ip->b + k];
+                if (ip->t == _string || ip->t == _list)
+                    obj->data[k].o->refs++;
+            }
+            NEXT;
+        CASE(VM_ELEM)
+            // A list variable can hold ints and then floats: the type of the elements is checked
+            obj = B.o;
+            idx = C.i < 0 ? C.i + (long long) obj->len : C.i;
+            if (idx < 0 || idx >= (long long) obj->len)
+                FAIL("IndexError: list index out of range");
+            if (obj->elem != ip->t && ! ((obj->elem == _int || obj->elem == _bool) &&
+                                         (ip->t == _int || ip->t == _float || ip->t == _bool)))
+                FAIL("TypeError: list element of unexpected type");
+            elem = obj->data + idx;
+            if (ip->t == _string || ip->t == _list) {
+                elem->o->refs++;
+                set_Obj(&A, elem->o);
+            }
+            else if (ip->t == _float && obj->elem != _float)
+                A.f = (double) elem->i;
+            else
+                A = *elem;
+            NEXT;
+        CASE(VM_READ)
+            if ((error = read_Value(in, ip->t, &v, &buf)) != NULL)
+                goto done;
+            if (ip->t == _string)
+                set_Obj(&A, v.o);
+            else
+                A = v;
+            NEXT;
+        CASE(VM_PRINT)
+            if (ip->t == _string)
+                fwrite(A.o->s, 1, A.o->len, out);
+            else if (ip->t == _int)
+                fprintf(out, "%lld", A.i);
+            else {
+                buf.len = 0;
+                if (str_Value(&buf, A, ip->t, 0) != SUBTREE_OK)
+                    FAIL("MemoryError: out of memory");
+                fwrite(buf.s, 1, buf.len, out);
+            }
+            putc('\n', out);
+            NEXT;
+    }
+#undef A
+#undef B
+#undef C
+#undef FAIL
+#undef NEW_OBJ
+#undef CASE
+#undef NEXT
+#undef GOTO
+
+done:
+    fflush(out);
+    if (error != NULL)
+        fprintf(stderr, "%s\n", error);
+    for (i = 0; i < code->nregs; i++)
+        if (code->is_obj[i])
+            release_VmObj(regs[i].o);
+    free(regs);
+    free(buf.s);
+    return error != NULL;
+}
+
+
+/*
+ * ---------------
+ * Listing
+ * ---------------
+*/
+
+const char* vm_OpNames[N_VM_OPS] = {
+    "halt", "mov", "movo",
+    "addi", "subi", "muli", "divi", "modi",
+    "addf", "subf", "mulf", "divf", "modf", "itof",
+    "lti", "lei", "eqi", "nei", "ltf", "lef", "eqf", "nef",
+    "eqs", "nes", "eql", "nel",
+    "truthi", "truthf", "truths", "truthl",
+    "jmp", "jz", "jnz", "jlt", "jle", "jeq", "jne",
+    "tostr", "concat", "format", "list", "elem", "read", "print"
+};
+
+
+void print_Bytecode (struct VmCode* code, FILE* fp) {
+    struct VmIns* ip;
+    char num[400];
+    int i, first;
+
+    first = code->nregs - code->nconsts;
+    for (i = 0; i < code->nconsts; i++) {
+        fprintf(fp, "       r%d = ", first + i);
+        switch (code->const_types[i]) {
+            case _float:
+                str_Float(code->consts[i].f, num);
+                fprintf(fp, "%s\n", num);
+                break;
+            case _string:
+                fprintf(fp, "\"%s\"\n", code->consts[i].o->s);
+                break;
+            default:
+                fprintf(fp, "%lld\n", code->consts[i].i);
+        }
+    }
+    for (i = 0; i < code->n; i++) {
+        ip = code->ins + i;
+        fprintf(fp, "%5d  %-7s", i, vm_OpNames[ip->op]);
+        switch (ip->op) {
+            case VM_HALT:
+                break;
+            case VM_JMP:
+                fprintf(fp, " -> %d", ip->a);
+                break;
+            case VM_JZ: case VM_JNZ:
+                fprintf(fp, " r%d -> %d", ip->a, ip->c);
+                break;
+            case VM_JLT: case VM_JLE: case VM_JEQ: case VM_JNE:
+                fprintf(fp, " r%d r%d -> %d", ip->a, ip->b, ip->c);
+                break;
+            case VM_READ: case VM_PRINT:
+                fprintf(fp, " r%d (%s)", ip->a, type2str(ip->t));
+                break;
+            case VM_MOV: case VM_MOVO: case VM_ITOF:
+            case VM_TRUTHI: case VM_TRUTHF: case VM_TRUTHS: case VM_TRUTHL:
+                fprintf(fp, " r%d r%d", ip->a, ip->b);
+                break;
+            case VM_TOSTR:
+                fprintf(fp, " r%d r%d (%s)", ip->a, ip->b, type2str(ip->t));
+                break;
+            case VM_FORMAT:
+                fprintf(fp, " r%d r%d r%d..r%d", ip->a, ip->b, ip->c, ip->c + ip->t - 1);
+                break;
+            case VM_LIST:
+                fprintf(fp, " r%d r%d..r%d (%s)", ip->a, ip->b, ip->b + ip->c - 1, type2str(ip->t));
+                break;
+            case VM_ELEM:
+                fprintf(fp, " r%d r%d r%d (%s)", ip->a, ip->b, ip->c, type2str(ip->t));
+                break;
+            default:
+                fprintf(fp, " r%d r%d r%d", ip->a, ip->b, ip->c);
+        }
+        fputc('\n', fp);
+    }
+}
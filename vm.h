@@ -0,0 +1,139 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdio.h>
+
+#include "semantic.h"
+
+/*
+ * Bytecode for a register machine, to run a program in the compiler itself.
+ * Every variable has its register, and so has every constant: they are loaded
+ * once before the first instruction, so that no instruction carries a value.
+ * The temporaries of an expression come after the variables.
+ * The types are the ones found by the semantic analysis: each instruction knows
+ * what its registers hold, and only list elements are checked while running.
+*/
+
+enum VmOp {
+    VM_HALT,
+    VM_MOV, // a = b, numbers and bools
+    VM_MOVO, // a = b, strings and lists
+    VM_ADDI, VM_SUBI, VM_MULI, VM_DIVI, VM_MODI, // a = b op c, ints: floor / and %
+    VM_ADDF, VM_SUBF, VM_MULF, VM_DIVF, VM_MODF, // a = b op c, floats
+    VM_ITOF, // float a = int b
+    VM_LTI, VM_LEI, VM_EQI, VM_NEI, // a = b op c, ints and bools
+    VM_LTF, VM_LEF, VM_EQF, VM_NEF, // a = b op c, floats
+    VM_EQS, VM_NES, VM_EQL, VM_NEL, // a = b op c, strings and lists
+    VM_TRUTHI, VM_TRUTHF, VM_TRUTHS, VM_TRUTHL, // a = bool(b)
+    VM_JMP, // go to a
+    VM_JZ, VM_JNZ, // go to c if a is zero, not zero
+    VM_JLT, VM_JLE, VM_JEQ, VM_JNE, // go to c if a op b, ints and bools
+    VM_TOSTR, // a = str(b), b of type t
+    VM_CONCAT, // a = b + c, strings
+    VM_FORMAT, // a = b % (the t strings from c), b is the literal
+    VM_LIST, // a = the list of the c registers from b, elements of type t
+    VM_ELEM, // a = b[c], the element as type t
+    VM_READ, // a = the next input line as type t
+    VM_PRINT, // write str(a), a of type t, and a newline
+    N_VM_OPS
+};
+
+struct VmIns {
+    short op;
+    short t; // _int, _float, ... for the instructions that need a type
+    int a, b, c;
+};
+
+/*
+ * Strings and lists are shared: a register holds a reference, given back when it is written again.
+ * A list never changes once it is made.
+*/
+struct VmObj {
+    int refs;
+    int elem; // type of the elements of a list, -1 for a string
+    size_t len; // bytes of a string, elements of a list
+    union VmValue* data; // of a list
+    char s[]; // of a string, with a NUL after len bytes
+};
+
+union VmValue {
+    long long i; // ints and bools
+    double f;
+    struct VmObj* o; // strings and lists
+};
+
+struct VmCode {
+    struct VmIns* ins;
+    int n;
+    int nregs; // variables, temporaries and constants
+    union VmValue* consts; // the values of the last nconsts registers
+    int* const_types;
+    int nconsts;
+    char* is_obj; // registers that hold a string or a list
+};
+
+/*
+ * The runtime: the VM and the interpreter of the tree (interp.h) share it.
+ * Functions that can fail give back NULL or the message of the Python exception.
+*/
+struct VmObj* new_VmStr(const char *s, size_t len);
+
+// The data of the list is not set
+struct VmObj* new_VmList(size_t len, int elem);
+
+void release_VmObj(struct VmObj *obj);
+
+// Write a new reference into the register, and give back the old one
+void set_Obj(union VmValue *reg, struct VmObj *obj);
+
+struct VmBuf {
+    // The text of str() of a value, or an input line, while it is made
+    char* s;
+    size_t len, cap;
+};
+
+// Append len bytes, and a NUL after them. Return SUBTREE_OK or MEMORY_ERROR
+int put_Buf(struct VmBuf *buf, const char *s, size_t len);
+
+// Append str() of the value, or its repr inside a list
+int str_Value(struct VmBuf *buf, union VmValue v, int type, int repr);
+
+int equal_Strs(struct VmObj *a, struct VmObj *b);
+
+int equal_Lists(struct VmObj *a, struct VmObj *b);
+
+// The next line, read as input() and then int(), float() or bool() would, in line
+const char* read_Value(FILE *in, int type, union VmValue *v, struct VmBuf *line);
+
+// repr of a Python float, into out that has room for 32 bytes: return its length
+size_t str_Float(double v, char *out);
+
+// // and % of Python
+long long floor_Div(long long a, long long b);
+long long floor_Mod(long long a, long long b);
+double floor_FMod(double a, double b);
+
+// The bytes of a string literal, without its quotes: out must have room for len bytes
+size_t unescape_Literal(const char *s, size_t len, char *out);
+
+/*
+ * Compile the program, that passed analyze_Program_Table with these symbols.
+ * Return NULL on error. The caller must free_Bytecode the result.
+*/
+struct VmCode* compile_Bytecode(struct ParseTree *root, struct SymbolTable *table);
+
+void free_Bytecode(struct VmCode *code);
+
+/*
+ * Run the code, reading the input lines from in and writing to out.
+ * A runtime error is written on stderr as Python writes it, after what out had so far.
+ * Return 0, or 1 after a runtime error.
+*/
+int run_Bytecode(struct VmCode *code, FILE *in, FILE *out);
+
+/*
+ * One instruction per line, for --debug.
+*/
+void print_Bytecode(struct VmCode *code, FILE *fp);
+
+#endif